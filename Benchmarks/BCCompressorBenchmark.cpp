@@ -0,0 +1,115 @@
+﻿#include "Benchmark.h"
+#include "..\Common\BCCompressor.h"
+#include "..\Common\DDSWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	const UINT ImageSize = 512;
+
+	// 多线程压缩使用的线程数, 结果须与单线程逐字节相同.
+	const UINT ThreadCount = 4;
+
+	///<summary>
+	/// 合成测试图像: 平滑的渐变加上少量噪声, alpha为从左到右的渐变,
+	/// 左侧有一列完全透明的块, 用于BC1的3色模式.
+	///</summary>
+	std::vector<uint8_t> MakeImage()
+	{
+		std::mt19937 rng(1234);
+		std::uniform_int_distribution<int> noise(-8, 8);
+
+		std::vector<uint8_t> pixels(4 * ImageSize * ImageSize);
+		for (UINT y = 0; y < ImageSize; ++y)
+		{
+			for (UINT x = 0; x < ImageSize; ++x)
+			{
+				float u = (float)x / ImageSize;
+				float v = (float)y / ImageSize;
+				int r = (int)(255.0f * (0.5f + 0.5f * sinf(6.0f * u + 2.0f * v))) + noise(rng);
+				int g = (int)(255.0f * v) + noise(rng);
+				int b = (int)(255.0f * (0.5f + 0.5f * cosf(9.0f * v * u))) + noise(rng);
+				int a = x < 16 ? 0 : (int)(255.0f * u);
+
+				uint8_t* p = &pixels[4 * (y * ImageSize + x)];
+				p[0] = (uint8_t)(std::min)((std::max)(r, 0), 255);
+				p[1] = (uint8_t)(std::min)((std::max)(g, 0), 255);
+				p[2] = (uint8_t)(std::min)((std::max)(b, 0), 255);
+				p[3] = (uint8_t)a;
+			}
+		}
+		return pixels;
+	}
+
+	struct FormatInfo
+	{
+		DXGI_FORMAT Format;
+		const wchar_t* Name;
+		double MinPSNR;			// 这张图像上的最低PSNR(dB).
+	};
+
+	const FormatInfo kFormats[] =
+	{
+		{ DXGI_FORMAT_BC1_UNORM, L"BC1", 32.0 },
+		{ DXGI_FORMAT_BC2_UNORM, L"BC2", 32.0 },
+		{ DXGI_FORMAT_BC3_UNORM, L"BC3", 32.0 },
+		{ DXGI_FORMAT_BC4_UNORM, L"BC4", 45.0 },
+		{ DXGI_FORMAT_BC5_UNORM, L"BC5", 45.0 },
+	};
+
+	const wchar_t* QualityName(BCQuality quality)
+	{
+		switch (quality)
+		{
+		case BCQuality::Fast: return L"Fast";
+		case BCQuality::Normal: return L"Normal";
+		default: return L"High";
+		}
+	}
+}
+
+void BenchmarkBCCompressor(BenchmarkReport& report)
+{
+	std::vector<uint8_t> pixels = MakeImage();
+
+	BCSurface surface;
+	surface.Pixels = pixels.data();
+	surface.Width = ImageSize;
+	surface.Height = ImageSize;
+
+	const UINT iterations = 3;
+
+	for (const auto& info : kFormats)
+	{
+		const size_t bytes = DDSWriter::SurfaceBytes(info.Format, ImageSize, ImageSize);
+		std::vector<uint8_t> single(bytes);
+		std::vector<uint8_t> multi(bytes);
+
+		for (BCQuality quality : { BCQuality::Fast, BCQuality::Normal, BCQuality::High })
+		{
+			std::wstring name = std::wstring(info.Name) + L" " + QualityName(quality);
+
+			auto t0 = BenchmarkClock::now();
+			for (UINT it = 0; it < iterations; ++it)
+				BCCompressor::Compress(surface, info.Format, quality, multi.data(), ThreadCount);
+			auto t1 = BenchmarkClock::now();
+			BCCompressor::Compress(surface, info.Format, quality, single.data(), 1);
+			auto t2 = BenchmarkClock::now();
+
+			double mpix = (double)ImageSize * ImageSize / 1.0e6;
+			double psnr = BCCompressor::ComputePSNR(surface, multi.data(), info.Format);
+
+			std::wostringstream oss;
+			oss << name << L": " << mpix * iterations / (ElapsedMs(t0, t1) / 1000.0) << L" Mpix/s with " << ThreadCount << L" threads (1 thread "
+				<< mpix / (ElapsedMs(t1, t2) / 1000.0) << L" Mpix/s), PSNR " << psnr << L" dB";
+			report.Print(oss.str());
+
+			report.Check(single == multi, name + L": multi-threaded output matches single-threaded");
+			report.Check(psnr >= info.MinPSNR, name + L": PSNR above threshold");
+		}
+	}
+}
@@ -0,0 +1,58 @@
+﻿#pragma once
+
+#include <Windows.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+
+///**************************************************************
+/// Common中各模块的性能测试, 不属于任何演示程序.
+/// 每个测试把耗时写到控制台, 并用Check与逐个计算/原先的实现对比结果,
+/// 不一致的检查计为失败, 程序以失败数作为返回值.
+///**************************************************************
+class BenchmarkReport
+{
+public:
+	// 输出一行结果.
+	void Print(const std::wstring& line)
+	{
+		std::wcout << L"  " << line << L"\n";
+	}
+
+	// 记录一项检查, 失败时输出说明.
+	void Check(bool passed, const std::wstring& what)
+	{
+		++mCheckCount;
+		if (!passed)
+		{
+			++mFailureCount;
+			std::wcout << L"  FAILED: " << what << L"\n";
+		}
+	}
+
+	UINT CheckCount() const { return mCheckCount; }
+	UINT FailureCount() const { return mFailureCount; }
+
+private:
+	UINT mCheckCount = 0;
+	UINT mFailureCount = 0;
+};
+
+typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+inline double ElapsedMs(BenchmarkClock::time_point begin, BenchmarkClock::time_point end)
+{
+	return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+void BenchmarkTextModelReader(BenchmarkReport& report);
+void BenchmarkBCCompressor(BenchmarkReport& report);
+void BenchmarkDynamicAabbTree(BenchmarkReport& report);
+void BenchmarkTriangleBvh(BenchmarkReport& report);
+void BenchmarkTransformBatch(BenchmarkReport& report);
+void BenchmarkRandom(BenchmarkReport& report);
+void BenchmarkHeightfield(BenchmarkReport& report);
+void BenchmarkCamera(BenchmarkReport& report);
+void BenchmarkLightCuller(BenchmarkReport& report);
+void BenchmarkClusteredLightGrid(BenchmarkReport& report);
+void BenchmarkMeshCodec(BenchmarkReport& report);
@@ -0,0 +1,132 @@
+﻿#include "Benchmark.h"
+#include "..\Common\Camera.h"
+#include "..\Common\d3dUtil.h"
+#include "..\Common\MathHelper.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	float MaxRelativeError(const XMFLOAT4X4& a, FXMMATRIX b)
+	{
+		XMFLOAT4X4 m;
+		XMStoreFloat4x4(&m, b);
+
+		float error = 0.0f;
+		for (int i = 0; i < 4; ++i)
+		{
+			for (int j = 0; j < 4; ++j)
+				error = (std::max)(error, fabsf(a.m[i][j] - m.m[i][j]) / (std::max)(1.0f, fabsf(m.m[i][j])));
+		}
+		return error;
+	}
+
+	XMMATRIX Inverse(FXMMATRIX m)
+	{
+		XMVECTOR det = XMMatrixDeterminant(m);
+		return XMMatrixInverse(&det, m);
+	}
+
+	// 与原来的计算结果之间允许的最大相对差值, 主要来自直接写出的逆矩阵.
+	const float MaxError = 5.0e-5f;
+}
+
+///<summary>
+/// 摄像机绕原点运动(与演示程序相同), 投影不变. 比较每次更新摄像机后取出全部矩阵的时间(微秒)
+/// 与原来每帧用XMMatrixInverse计算的时间, 并检查所有矩阵与原来的计算结果一致.
+///</summary>
+void BenchmarkCamera(BenchmarkReport& report)
+{
+	const UINT iterations = 100000;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> angle(0.1f, XM_PI - 0.1f);
+	std::uniform_real_distribution<float> radius(5.0f, 150.0f);
+
+	std::vector<XMFLOAT3> positions(iterations);
+	for (auto& p : positions)
+		XMStoreFloat3(&p, MathHelper::SphericalToCartesian(radius(rng), 2.0f * angle(rng), angle(rng)));
+
+	const XMVECTOR target = XMVectorZero();
+	const XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+	const float aspect = 16.0f / 9.0f;
+
+	XMFLOAT4X4 sink[6];
+	XMFLOAT4 planes[6];
+
+	Camera camera;
+	camera.SetLens(0.25f * XM_PI, aspect, 1.0f, 1000.0f);
+
+	auto t0 = BenchmarkClock::now();
+	for (UINT i = 0; i < iterations; ++i)
+	{
+		camera.LookAt(XMLoadFloat3(&positions[i]), target, up);
+		sink[0] = camera.View();
+		sink[1] = camera.Proj();
+		sink[2] = camera.ViewProj();
+		sink[3] = camera.InvView();
+		sink[4] = camera.InvProj();
+		sink[5] = camera.InvViewProj();
+		planes[0] = camera.FrustumPlanes()[0];
+	}
+	auto t1 = BenchmarkClock::now();
+
+	// 原来每帧的做法.
+	for (UINT i = 0; i < iterations; ++i)
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&positions[i]), target, up);
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, aspect, 1.0f, 1000.0f);
+		XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+		XMStoreFloat4x4(&sink[0], view);
+		XMStoreFloat4x4(&sink[1], proj);
+		XMStoreFloat4x4(&sink[2], viewProj);
+		XMStoreFloat4x4(&sink[3], Inverse(view));
+		XMStoreFloat4x4(&sink[4], Inverse(proj));
+		XMStoreFloat4x4(&sink[5], Inverse(viewProj));
+		ExtractFrustumPlanes(planes, viewProj);
+	}
+	auto t2 = BenchmarkClock::now();
+
+	float matrixError = 0.0f;
+	float inverseError = 0.0f;
+	float planeError = 0.0f;
+	for (UINT i = 0; i < iterations; ++i)
+	{
+		XMMATRIX view = XMMatrixLookAtLH(XMLoadFloat3(&positions[i]), target, up);
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, aspect, 1.0f, 1000.0f);
+		XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+
+		camera.LookAt(XMLoadFloat3(&positions[i]), target, up);
+		matrixError = (std::max)(matrixError, MaxRelativeError(camera.View(), view));
+		matrixError = (std::max)(matrixError, MaxRelativeError(camera.Proj(), proj));
+		matrixError = (std::max)(matrixError, MaxRelativeError(camera.ViewProj(), viewProj));
+		inverseError = (std::max)(inverseError, MaxRelativeError(camera.InvView(), Inverse(view)));
+		inverseError = (std::max)(inverseError, MaxRelativeError(camera.InvProj(), Inverse(proj)));
+		inverseError = (std::max)(inverseError, MaxRelativeError(camera.InvViewProj(), Inverse(viewProj)));
+
+		ExtractFrustumPlanes(planes, viewProj);
+		const XMFLOAT4* cached = camera.FrustumPlanes();
+		for (int p = 0; p < 6; ++p)
+		{
+			const float* a = &cached[p].x;
+			const float* b = &planes[p].x;
+			for (int k = 0; k < 4; ++k)
+				planeError = (std::max)(planeError, fabsf(a[k] - b[k]) / (std::max)(1.0f, fabsf(b[k])));
+		}
+	}
+
+	std::wostringstream oss;
+	oss << L"cached " << 1000.0 * ElapsedMs(t0, t1) / iterations << L" us/update (XMMatrixInverse "
+		<< 1000.0 * ElapsedMs(t1, t2) / iterations << L" us/update), max error: matrices " << matrixError
+		<< L", inverses " << inverseError << L", planes " << planeError;
+	report.Print(oss.str());
+
+	report.Check(matrixError <= MaxError, L"View/Proj/ViewProj match XMMatrixLookAtLH/XMMatrixPerspectiveFovLH");
+	report.Check(inverseError <= MaxError, L"analytic inverses match XMMatrixInverse");
+	report.Check(planeError <= MaxError, L"frustum planes match ExtractFrustumPlanes");
+}
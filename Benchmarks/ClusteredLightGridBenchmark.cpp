@@ -0,0 +1,121 @@
+﻿#include "Benchmark.h"
+#include "..\Common\ClusteredLightGrid.h"
+#include "..\Common\d3dUtil.h"
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// 球(xyz为中心, w为半径)与包围盒是否相交, 与ClusteredLightGrid中的测试相同.
+	bool SphereIntersectsBox(const XMFLOAT4& s, const XMFLOAT3& mn, const XMFLOAT3& mx)
+	{
+		float dx = s.x - (std::min)((std::max)(s.x, mn.x), mx.x);
+		float dy = s.y - (std::min)((std::max)(s.y, mn.y), mx.y);
+		float dz = s.z - (std::min)((std::max)(s.z, mn.z), mx.z);
+		return dx * dx + dy * dy + dz * dz < s.w * s.w;
+	}
+
+	// 多线程构建使用的线程数.
+	const UINT ThreadCount = 4;
+
+	///<summary>
+	/// 光源分布在摄像机前方300 x 60 x 300的区域中. 比较构建网格与逐簇测试所有光源的时间(毫秒),
+	/// 每个簇的光源列表须与逐簇测试的结果完全相同.
+	///</summary>
+	void Run(BenchmarkReport& report, UINT lightCount, UINT iterations)
+	{
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> x(-150.0f, 150.0f);
+		std::uniform_real_distribution<float> y(0.0f, 60.0f);
+		std::uniform_real_distribution<float> falloff(5.0f, 20.0f);
+
+		std::vector<Light> lights(lightCount);
+		for (auto& l : lights)
+		{
+			l.Position = XMFLOAT3(x(rng), y(rng), x(rng));
+			l.FalloffEnd = falloff(rng);
+			l.FalloffStart = 0.25f * l.FalloffEnd;
+		}
+
+		Camera camera;
+		camera.SetLens(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, 500.0f);
+		camera.LookAt(XMVectorSet(0.0f, 40.0f, -160.0f, 1.0f), XMVectorZero(), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+
+		ClusteredLightGrid grid;
+
+		auto t0 = BenchmarkClock::now();
+		for (UINT it = 0; it < iterations; ++it)
+			grid.Build(camera, lights.data(), lightCount, 1);
+		auto t1 = BenchmarkClock::now();
+
+		std::vector<ClusteredLightGrid::Cluster> clusters = grid.Clusters();
+		std::vector<UINT> indices = grid.LightIndices();
+
+		auto t2 = BenchmarkClock::now();
+		grid.Build(camera, lights.data(), lightCount, ThreadCount);
+		auto t3 = BenchmarkClock::now();
+
+		// 对照: 光源变换到观察空间后逐簇测试.
+		XMMATRIX view = XMLoadFloat4x4(&camera.View());
+		std::vector<XMFLOAT4> spheres(lightCount);
+		for (UINT i = 0; i < lightCount; ++i)
+		{
+			XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&lights[i].Position), view);
+			XMStoreFloat4(&spheres[i], XMVectorSetW(center, lights[i].FalloffEnd));
+		}
+
+		const UINT clusterCount = grid.ClusterCount();
+		std::vector<std::vector<UINT>> reference(clusterCount);
+		auto t4 = BenchmarkClock::now();
+		for (UINT c = 0; c < clusterCount; ++c)
+		{
+			for (UINT i = 0; i < lightCount; ++i)
+			{
+				if (SphereIntersectsBox(spheres[i], grid.ClusterMin(c), grid.ClusterMax(c)))
+					reference[c].push_back(i);
+			}
+		}
+		auto t5 = BenchmarkClock::now();
+
+		UINT mismatches = 0;
+		for (UINT c = 0; c < clusterCount; ++c)
+		{
+			if (clusters[c].Count != reference[c].size() ||
+				!std::equal(reference[c].begin(), reference[c].end(), indices.begin() + clusters[c].Offset))
+			{
+				++mismatches;
+			}
+		}
+
+		bool sameThreaded = grid.LightIndices() == indices;
+		for (UINT c = 0; c < clusterCount && sameThreaded; ++c)
+		{
+			sameThreaded = grid.Clusters()[c].Offset == clusters[c].Offset &&
+				grid.Clusters()[c].Count == clusters[c].Count;
+		}
+
+		std::wostringstream oss;
+		oss << grid.SizeX() << L"x" << grid.SizeY() << L"x" << grid.SizeZ() << L", " << lightCount << L" lights: build "
+			<< ElapsedMs(t0, t1) / iterations << L" ms (" << ThreadCount << L" threads " << ElapsedMs(t2, t3)
+			<< L" ms, brute force " << ElapsedMs(t4, t5) << L" ms), " << (double)indices.size() / clusterCount
+			<< L" lights/cluster";
+		report.Print(oss.str());
+
+		std::wostringstream name;
+		name << lightCount << L" lights: ";
+		std::wostringstream what;
+		what << name.str() << mismatches << L" clusters differ from brute force";
+		report.Check(mismatches == 0, what.str());
+		report.Check(sameThreaded, name.str() + L"multi-threaded result matches single-threaded");
+	}
+}
+
+void BenchmarkClusteredLightGrid(BenchmarkReport& report)
+{
+	for (UINT lightCount : { 1000u, 10000u })
+		Run(report, lightCount, 5);
+}
@@ -0,0 +1,126 @@
+﻿#include "Benchmark.h"
+#include "..\Common\DynamicAabbTree.h"
+#include "..\Common\d3dUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// 对照: 逐个测试所有包围盒, 与QueryFrustum使用同样的平面测试.
+	void QueryFlat(const XMFLOAT4 planes[6], const std::vector<BoundingBox>& boxes, std::vector<UINT>& visible)
+	{
+		XMFLOAT3 absNormals[6];
+		for (int p = 0; p < 6; ++p)
+			absNormals[p] = XMFLOAT3(fabsf(planes[p].x), fabsf(planes[p].y), fabsf(planes[p].z));
+
+		visible.clear();
+		for (UINT i = 0; i < (UINT)boxes.size(); ++i)
+		{
+			const BoundingBox& box = boxes[i];
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; ++p)
+			{
+				float d = planes[p].x * box.Center.x + planes[p].y * box.Center.y + planes[p].z * box.Center.z + planes[p].w;
+				float r = absNormals[p].x * box.Extents.x + absNormals[p].y * box.Extents.y + absNormals[p].z * box.Extents.z;
+				inside = d + r >= 0.0f;
+			}
+			if (inside)
+				visible.push_back(i);
+		}
+	}
+
+	void Run(BenchmarkReport& report, UINT itemCount, UINT iterations)
+	{
+		// 物体密度保持不变: 场景边长随物体数量的立方根增长.
+		const float halfSize = 10.0f * std::cbrt((float)itemCount);
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> position(-halfSize, halfSize);
+		std::uniform_real_distribution<float> extent(0.25f, 2.0f);
+		std::uniform_real_distribution<float> step(-0.5f, 0.5f);
+
+		std::vector<BoundingBox> boxes(itemCount);
+		for (auto& box : boxes)
+		{
+			box.Center = XMFLOAT3(position(rng), position(rng), position(rng));
+			box.Extents = XMFLOAT3(extent(rng), extent(rng), extent(rng));
+		}
+
+		DynamicAabbTree tree(0.5f);
+		std::vector<int> proxies(itemCount);
+
+		auto t0 = BenchmarkClock::now();
+		for (UINT i = 0; i < itemCount; ++i)
+			proxies[i] = tree.CreateProxy(boxes[i], i);
+		auto t1 = BenchmarkClock::now();
+		double buildMs = ElapsedMs(t0, t1);
+
+		// 摄像机在场景中心朝+z方向看, 远平面为场景边长的一半.
+		XMMATRIX view = XMMatrixLookAtLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX proj = XMMatrixPerspectiveFovLH(0.25f * XM_PI, 16.0f / 9.0f, 1.0f, halfSize);
+		XMFLOAT4 planes[6];
+		ExtractFrustumPlanes(planes, view * proj);
+
+		std::vector<UINT> visible, flatVisible;
+		visible.reserve(itemCount);
+		flatVisible.reserve(itemCount);
+
+		double moveMs = 0.0;
+		double treeMs = 0.0;
+		double flatMs = 0.0;
+		bool superset = true;
+		const UINT movingCount = (std::max)(itemCount / 10, 1u);
+
+		for (UINT it = 0; it < iterations; ++it)
+		{
+			// 每次移动10%的物体.
+			auto m0 = BenchmarkClock::now();
+			for (UINT k = 0; k < movingCount; ++k)
+			{
+				UINT i = (it * movingCount + k) % itemCount;
+				XMFLOAT3 d(step(rng), step(rng), step(rng));
+				boxes[i].Center.x += d.x;
+				boxes[i].Center.y += d.y;
+				boxes[i].Center.z += d.z;
+				tree.MoveProxy(proxies[i], boxes[i], d);
+			}
+			auto m1 = BenchmarkClock::now();
+
+			visible.clear();
+			tree.QueryFrustum(planes, visible);
+			auto m2 = BenchmarkClock::now();
+
+			QueryFlat(planes, boxes, flatVisible);
+			auto m3 = BenchmarkClock::now();
+
+			moveMs += ElapsedMs(m0, m1);
+			treeMs += ElapsedMs(m1, m2);
+			flatMs += ElapsedMs(m2, m3);
+
+			// 树中的包围盒外扩过, 可见集合必须包含逐个测试的结果.
+			std::sort(visible.begin(), visible.end());
+			superset = superset && std::includes(visible.begin(), visible.end(), flatVisible.begin(), flatVisible.end());
+		}
+
+		std::wostringstream oss;
+		oss << itemCount << L" items: build " << buildMs << L" ms, move 10% " << moveMs / iterations
+			<< L" ms, frustum query " << 1000.0 * treeMs / iterations << L" us (flat " << 1000.0 * flatMs / iterations
+			<< L" us), height " << tree.Height();
+		report.Print(oss.str());
+
+		std::wostringstream name;
+		name << itemCount << L" items: ";
+		report.Check(superset, name.str() + L"frustum query contains every box visible to the flat test");
+		report.Check(tree.Validate(), name.str() + L"tree is valid after moves");
+	}
+}
+
+void BenchmarkDynamicAabbTree(BenchmarkReport& report)
+{
+	for (UINT count : { 1000u, 10000u, 100000u })
+		Run(report, count, 20);
+}
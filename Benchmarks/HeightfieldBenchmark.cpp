@@ -0,0 +1,149 @@
+﻿#include "Benchmark.h"
+#include "..\Common\Heightfield.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// 原来的逐顶点计算.
+	float HillsHeight(float x, float z)
+	{
+		return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+	}
+
+	XMFLOAT3 HillsNormal(float x, float z)
+	{
+		XMFLOAT3 n(
+			-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
+			1.0f,
+			-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
+
+		XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
+		XMStoreFloat3(&n, unitNormal);
+
+		return n;
+	}
+
+	struct HillVertex
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexC;
+	};
+
+	// 批量求值使用的线程数, 结果须与单线程逐字节相同.
+	const UINT ThreadCount = 4;
+
+	///<summary>
+	/// 在rowCount x columnCount的山丘网格(间距与波浪演示相同)上比较逐顶点sinf/cosf与批量求值.
+	/// 高度与偏导数中的sin/cos都乘以坐标, 所以误差按坐标的量级(网格半宽)放宽.
+	///</summary>
+	void Run(BenchmarkReport& report, UINT rowCount, UINT columnCount)
+	{
+		const float spacing = 160.0f / 49.0f;
+		float halfWidth = 0.5f * spacing * (columnCount - 1);
+		float halfDepth = 0.5f * spacing * (rowCount - 1);
+
+		std::vector<HillVertex> scalar((size_t)rowCount * columnCount);
+		for (UINT i = 0; i < rowCount; ++i)
+		{
+			for (UINT j = 0; j < columnCount; ++j)
+			{
+				HillVertex& v = scalar[(size_t)i * columnCount + j];
+				v.Position = XMFLOAT3(-halfWidth + j * spacing, 0.0f, halfDepth - i * spacing);
+				v.Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
+				v.TexC = XMFLOAT2(0.0f, 0.0f);
+			}
+		}
+		std::vector<HillVertex> batch = scalar;
+		std::vector<HillVertex> single = scalar;
+
+		auto t0 = BenchmarkClock::now();
+		for (auto& v : scalar)
+		{
+			XMFLOAT3 p = v.Position;
+			v.Position.y = HillsHeight(p.x, p.z);
+			v.Normal = HillsNormal(p.x, p.z);
+		}
+		auto t1 = BenchmarkClock::now();
+		Heightfield::Evaluate(Heightfield::Hills(), batch.data(), sizeof(HillVertex), offsetof(HillVertex, Normal),
+			rowCount, columnCount, ThreadCount);
+		auto t2 = BenchmarkClock::now();
+		Heightfield::Evaluate(Heightfield::Hills(), single.data(), sizeof(HillVertex), offsetof(HillVertex, Normal),
+			rowCount, columnCount, 1);
+
+		float maxHeightError = 0.0f;
+		float maxNormalError = 0.0f;
+		for (size_t i = 0; i < scalar.size(); ++i)
+		{
+			maxHeightError = (std::max)(maxHeightError, fabsf(scalar[i].Position.y - batch[i].Position.y));
+			maxNormalError = (std::max)(maxNormalError, fabsf(scalar[i].Normal.x - batch[i].Normal.x));
+			maxNormalError = (std::max)(maxNormalError, fabsf(scalar[i].Normal.y - batch[i].Normal.y));
+			maxNormalError = (std::max)(maxNormalError, fabsf(scalar[i].Normal.z - batch[i].Normal.z));
+		}
+		float extent = (std::max)(halfWidth, halfDepth);
+
+		std::wostringstream oss;
+		oss << rowCount << L"x" << columnCount << L": sinf/cosf " << ElapsedMs(t0, t1) << L" ms, batch "
+			<< ElapsedMs(t1, t2) << L" ms, max height error " << maxHeightError << L", max normal error " << maxNormalError;
+		report.Print(oss.str());
+
+		std::wostringstream name;
+		name << rowCount << L"x" << columnCount << L": ";
+		report.Check(maxHeightError < 1.0e-6f * extent, name.str() + L"heights match sinf/cosf");
+		report.Check(maxNormalError < 1.0e-6f + 1.0e-8f * extent, name.str() + L"normals match sinf/cosf");
+		report.Check(memcmp(batch.data(), single.data(), batch.size() * sizeof(HillVertex)) == 0,
+			name.str() + L"multi-threaded result matches single-threaded");
+	}
+
+	// SinCos与sinf/cosf在[-range, range]上的最大绝对误差.
+	float SinCosError(float range)
+	{
+		const UINT count = 1 << 20;
+		float maxError = 0.0f;
+		for (UINT i = 0; i < count; i += 4)
+		{
+			XMFLOAT4 x;
+			float* lanes = &x.x;
+			for (UINT k = 0; k < 4; ++k)
+				lanes[k] = -range + 2.0f * range * (i + k) / count;
+
+			XMVECTOR s, c;
+			Heightfield::SinCos(XMLoadFloat4(&x), &s, &c);
+
+			XMFLOAT4 sinValues, cosValues;
+			XMStoreFloat4(&sinValues, s);
+			XMStoreFloat4(&cosValues, c);
+			for (UINT k = 0; k < 4; ++k)
+			{
+				maxError = (std::max)(maxError, fabsf((&sinValues.x)[k] - sinf(lanes[k])));
+				maxError = (std::max)(maxError, fabsf((&cosValues.x)[k] - cosf(lanes[k])));
+			}
+		}
+		return maxError;
+	}
+}
+
+void BenchmarkHeightfield(BenchmarkReport& report)
+{
+	Run(report, 50, 50);
+	Run(report, 512, 512);
+	Run(report, 2048, 2048);
+
+	// Heightfield.h中记录的误差上限, 另加sinf/cosf本身约6e-8的误差.
+	for (float range : { 100.0f, 10000.0f })
+	{
+		float error = SinCosError(range);
+
+		std::wostringstream oss;
+		oss << L"SinCos |x| <= " << range << L": max error " << error;
+		report.Print(oss.str());
+		report.Check(error <= (range <= 100.0f ? 3.0e-7f : 3.6e-7f) + 6.0e-8f, oss.str() + L" within the documented bound");
+	}
+}
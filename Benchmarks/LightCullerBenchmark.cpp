@@ -0,0 +1,149 @@
+﻿#include "Benchmark.h"
+#include "..\Common\LightCuller.h"
+#include "..\Common\d3dUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	float Luminance(const XMFLOAT3& c)
+	{
+		return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+	}
+
+	float Saturate(float x)
+	{
+		return (std::min)((std::max)(x, 0.0f), 1.0f);
+	}
+
+	///<summary>
+	/// 对照: 逐个读取Light结构体, 计算所有相交光源的影响后稳定排序, 取前maxLights个.
+	/// 影响为0的光源不计入, 与LightCuller相同.
+	///</summary>
+	void AssignReference(const Light* lights, UINT lightCount, const BoundingBox& bounds, UINT maxLights,
+		std::vector<std::pair<float, UINT>>& candidates, std::vector<UINT>& result)
+	{
+		XMFLOAT3 mn(bounds.Center.x - bounds.Extents.x, bounds.Center.y - bounds.Extents.y, bounds.Center.z - bounds.Extents.z);
+		XMFLOAT3 mx(bounds.Center.x + bounds.Extents.x, bounds.Center.y + bounds.Extents.y, bounds.Center.z + bounds.Extents.z);
+
+		candidates.clear();
+		for (UINT i = 0; i < lightCount; ++i)
+		{
+			const Light& light = lights[i];
+			float dx = light.Position.x - (std::min)((std::max)(light.Position.x, mn.x), mx.x);
+			float dy = light.Position.y - (std::min)((std::max)(light.Position.y, mn.y), mx.y);
+			float dz = light.Position.z - (std::min)((std::max)(light.Position.z, mn.z), mx.z);
+			float d2 = dx * dx + dy * dy + dz * dz;
+			if (!(d2 < light.FalloffEnd * light.FalloffEnd))
+				continue;
+
+			float invRange = 1.0f / (std::max)(light.FalloffEnd - light.FalloffStart, 1.0e-4f);
+			float score = Luminance(light.Strength) * Saturate((light.FalloffEnd - sqrtf(d2)) * invRange);
+			if (score > 0.0f)
+				candidates.emplace_back(score, i);
+		}
+
+		std::stable_sort(candidates.begin(), candidates.end(),
+			[](const std::pair<float, UINT>& a, const std::pair<float, UINT>& b) { return a.first > b.first; });
+
+		result.clear();
+		for (UINT i = 0; i < (std::min)((UINT)candidates.size(), maxLights); ++i)
+			result.push_back(candidates[i].second);
+	}
+
+	// 多线程分配使用的线程数.
+	const UINT ThreadCount = 4;
+
+	///<summary>
+	/// 物体和光源分布在200 x 50 x 200的区域中. 比较SIMD分配与逐个计算后排序的时间(毫秒),
+	/// 每个物体的光源列表须与对照完全相同.
+	///</summary>
+	void Run(BenchmarkReport& report, UINT objectCount, UINT lightCount, UINT maxLightsPerObject, UINT iterations)
+	{
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> x(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> y(0.0f, 50.0f);
+		std::uniform_real_distribution<float> extent(0.5f, 3.0f);
+		std::uniform_real_distribution<float> falloff(5.0f, 20.0f);
+		std::uniform_real_distribution<float> strength(0.1f, 1.0f);
+
+		std::vector<BoundingBox> bounds(objectCount);
+		for (auto& b : bounds)
+		{
+			b.Center = XMFLOAT3(x(rng), y(rng), x(rng));
+			b.Extents = XMFLOAT3(extent(rng), extent(rng), extent(rng));
+		}
+
+		std::vector<Light> lights(lightCount);
+		for (auto& l : lights)
+		{
+			l.Position = XMFLOAT3(x(rng), y(rng), x(rng));
+			l.Strength = XMFLOAT3(strength(rng), strength(rng), strength(rng));
+			l.FalloffEnd = falloff(rng);
+			l.FalloffStart = 0.25f * l.FalloffEnd;
+		}
+
+		LightCuller culler;
+		std::vector<LightCuller::Range> ranges;
+		std::vector<UINT> indices;
+
+		auto t0 = BenchmarkClock::now();
+		for (UINT it = 0; it < iterations; ++it)
+		{
+			culler.SetLights(lights.data(), lightCount);
+			culler.Assign(bounds.data(), objectCount, maxLightsPerObject, ranges, indices, 1);
+		}
+		auto t1 = BenchmarkClock::now();
+
+		std::vector<LightCuller::Range> threadedRanges;
+		std::vector<UINT> threadedIndices;
+		culler.Assign(bounds.data(), objectCount, maxLightsPerObject, threadedRanges, threadedIndices, ThreadCount);
+
+		std::vector<std::pair<float, UINT>> candidates;
+		std::vector<std::vector<UINT>> reference(objectCount);
+		auto t2 = BenchmarkClock::now();
+		for (UINT i = 0; i < objectCount; ++i)
+			AssignReference(lights.data(), lightCount, bounds[i], maxLightsPerObject, candidates, reference[i]);
+		auto t3 = BenchmarkClock::now();
+
+		UINT mismatches = 0;
+		size_t total = 0;
+		for (UINT i = 0; i < objectCount; ++i)
+		{
+			const LightCuller::Range& r = ranges[i];
+			if (r.Count != reference[i].size() ||
+				!std::equal(reference[i].begin(), reference[i].end(), indices.begin() + r.Offset))
+			{
+				++mismatches;
+			}
+			total += r.Count;
+		}
+
+		std::wostringstream oss;
+		oss << objectCount << L" objects, " << lightCount << L" lights: SIMD " << ElapsedMs(t0, t1) / iterations
+			<< L" ms (reference " << ElapsedMs(t2, t3) << L" ms), " << (double)total / objectCount << L" lights/object";
+		report.Print(oss.str());
+
+		std::wostringstream name;
+		name << objectCount << L" objects, " << lightCount << L" lights: ";
+		std::wostringstream what;
+		what << name.str() << mismatches << L" objects differ from the sorted reference";
+		report.Check(mismatches == 0, what.str());
+
+		bool sameThreaded = indices == threadedIndices;
+		for (UINT i = 0; i < objectCount && sameThreaded; ++i)
+			sameThreaded = ranges[i].Offset == threadedRanges[i].Offset && ranges[i].Count == threadedRanges[i].Count;
+		report.Check(sameThreaded, name.str() + L"multi-threaded result matches single-threaded");
+	}
+}
+
+void BenchmarkLightCuller(BenchmarkReport& report)
+{
+	for (UINT lightCount : { 100u, 1000u, 10000u })
+		Run(report, 1000, lightCount, 8, 5);
+}
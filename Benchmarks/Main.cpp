@@ -0,0 +1,51 @@
+﻿#include "Benchmark.h"
+
+namespace
+{
+	struct BenchmarkEntry
+	{
+		const wchar_t* Name;
+		void (*Run)(BenchmarkReport& report);
+	};
+
+	const BenchmarkEntry kBenchmarks[] =
+	{
+		{ L"TextModelReader", BenchmarkTextModelReader },
+		{ L"BCCompressor", BenchmarkBCCompressor },
+		{ L"DynamicAabbTree", BenchmarkDynamicAabbTree },
+		{ L"TriangleBvh", BenchmarkTriangleBvh },
+		{ L"TransformBatch", BenchmarkTransformBatch },
+		{ L"Random", BenchmarkRandom },
+		{ L"Heightfield", BenchmarkHeightfield },
+		{ L"Camera", BenchmarkCamera },
+		{ L"LightCuller", BenchmarkLightCuller },
+		{ L"ClusteredLightGrid", BenchmarkClusteredLightGrid },
+		{ L"MeshCodec", BenchmarkMeshCodec },
+	};
+}
+
+///<summary>
+/// 不带参数时运行所有测试, 否则只运行名字与参数相同(不区分大小写)的测试.
+/// 工作目录为项目目录, 模型等文件按相对路径读取.
+///</summary>
+int wmain(int argc, wchar_t* argv[])
+{
+	BenchmarkReport report;
+
+	for (const auto& entry : kBenchmarks)
+	{
+		bool selected = argc <= 1;
+		for (int i = 1; i < argc && !selected; ++i)
+			selected = _wcsicmp(argv[i], entry.Name) == 0;
+
+		if (!selected)
+			continue;
+
+		std::wcout << L"== " << entry.Name << L"\n";
+		entry.Run(report);
+	}
+
+	std::wcout << report.CheckCount() - report.FailureCount() << L"/" << report.CheckCount() << L" checks passed\n";
+
+	return (int)report.FailureCount();
+}
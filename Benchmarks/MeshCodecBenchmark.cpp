@@ -0,0 +1,180 @@
+﻿#include "Benchmark.h"
+#include "..\Common\MappedFile.h"
+#include "..\Common\MeshCodec.h"
+#include "..\Common\ModelLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// 与演示程序的顶点格式相同.
+	struct BenchVertex
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexC;
+	};
+
+	bool ReadText(const std::wstring& filename, std::vector<BenchVertex>& vertices, std::vector<UINT>& indices)
+	{
+		TextModelReader reader;
+		if (!reader.Open(filename))
+			return false;
+
+		vertices.resize(reader.VertexCount());
+		indices.resize(3 * reader.TriangleCount());
+		return reader.ReadVertices(vertices.data(), sizeof(BenchVertex), offsetof(BenchVertex, Normal)) &&
+			reader.ReadIndices(indices.data());
+	}
+
+	bool Decode(const std::vector<uint8_t>& encoded, std::vector<BenchVertex>& vertices, std::vector<UINT>& indices)
+	{
+		CompressedModelReader reader;
+		if (!reader.Open(encoded.data(), encoded.size()))
+			return false;
+
+		vertices.resize(reader.VertexCount());
+		indices.resize(3 * reader.TriangleCount());
+		return reader.ReadVertices(vertices.data(), sizeof(BenchVertex), offsetof(BenchVertex, Normal)) &&
+			reader.ReadIndices(indices.data());
+	}
+
+	void Encode(const std::vector<BenchVertex>& vertices, const std::vector<UINT>& indices,
+		const MeshCodecOptions& options, std::vector<uint8_t>& encoded)
+	{
+		std::vector<XMFLOAT3> positions(vertices.size());
+		std::vector<XMFLOAT3> normals(vertices.size());
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			positions[i] = vertices[i].Position;
+			normals[i] = vertices[i].Normal;
+		}
+
+		MeshCodec::Encode(positions.data(), normals.data(), (UINT)vertices.size(),
+			indices.data(), (UINT)indices.size(), options, encoded);
+	}
+
+	///<summary>
+	/// 比较解码.mshz与解析文本模型的时间, 吞吐量按写出的顶点位置、法线和索引字节计算.
+	/// 不做三角形重排时三角形顺序不变, 逐个索引检查位置误差不超过半个量化步长(另加浮点数舍入),
+	/// 法线误差在量化精度内. 另外检查随演示程序发布的.mshz与用默认选项重新压缩的结果相同.
+	///</summary>
+	void Run(BenchmarkReport& report, const std::wstring& model, UINT iterations)
+	{
+		const std::wstring filename = model + L".txt";
+
+		std::vector<BenchVertex> textVertices;
+		std::vector<UINT> textIndices;
+		if (!ReadText(filename, textVertices, textIndices))
+		{
+			report.Check(false, L"read " + filename);
+			return;
+		}
+
+		MeshCodecOptions options;
+		std::vector<uint8_t> encoded;
+		Encode(textVertices, textIndices, options, encoded);
+
+		std::vector<BenchVertex> vertices;
+		std::vector<UINT> indices;
+		if (!Decode(encoded, vertices, indices))
+		{
+			report.Check(false, filename + L": decode");
+			return;
+		}
+
+		// 分开计时, 避免解析文本时换出缓存中的压缩数据.
+		auto t0 = BenchmarkClock::now();
+		for (UINT it = 0; it < iterations; ++it)
+			ReadText(filename, textVertices, textIndices);
+		auto t1 = BenchmarkClock::now();
+		for (UINT it = 0; it < iterations; ++it)
+			Decode(encoded, vertices, indices);
+		auto t2 = BenchmarkClock::now();
+
+		double textMs = ElapsedMs(t0, t1) / iterations;
+		double decodeMs = ElapsedMs(t1, t2) / iterations;
+
+		const double outputBytes = (double)vertices.size() * 2 * sizeof(XMFLOAT3) + (double)indices.size() * sizeof(UINT);
+
+		std::wostringstream oss;
+		oss << filename << L": " << encoded.size() / 1024 << L" KB, decode " << decodeMs << L" ms ("
+			<< outputBytes / decodeMs / 1.0e6 << L" GB/s), text " << textMs << L" ms";
+		report.Print(oss.str());
+
+		report.Check(indices.size() == textIndices.size() && vertices.size() <= textVertices.size(),
+			filename + L": triangle count unchanged, no vertices added");
+
+		MappedFile shipped;
+		report.Check(shipped.Open(model + L".mshz") && shipped.Size() == encoded.size() &&
+			memcmp(shipped.Data(), encoded.data(), encoded.size()) == 0, model + L".mshz is up to date");
+
+		///
+		/// 不重排三角形时逐个索引比较.
+		///
+		options.OptimizeVertexCache = false;
+		Encode(textVertices, textIndices, options, encoded);
+		if (!Decode(encoded, vertices, indices) || indices.size() != textIndices.size())
+		{
+			report.Check(false, filename + L": decode without reordering");
+			return;
+		}
+
+		XMFLOAT3 vMin = textVertices[0].Position;
+		XMFLOAT3 vMax = textVertices[0].Position;
+		for (const auto& v : textVertices)
+		{
+			XMStoreFloat3(&vMin, XMVectorMin(XMLoadFloat3(&vMin), XMLoadFloat3(&v.Position)));
+			XMStoreFloat3(&vMax, XMVectorMax(XMLoadFloat3(&vMax), XMLoadFloat3(&v.Position)));
+		}
+
+		const float maxQ = (float)((1u << options.PositionBits) - 1);
+		const float halfStep[3] = {
+			0.5f * (vMax.x - vMin.x) / maxQ, 0.5f * (vMax.y - vMin.y) / maxQ, 0.5f * (vMax.z - vMin.z) / maxQ };
+
+		// 八面体坐标量化误差为半个步长, 对应的角度误差不超过约3倍步长(弧度).
+		const float maxNormalAngle = 6.0f / (float)((1u << options.NormalBits) - 1);
+
+		float positionError = 0.0f;
+		float normalAngle = 0.0f;
+		bool sameTopology = true;
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			const BenchVertex& a = vertices[indices[i]];
+			const BenchVertex& b = textVertices[textIndices[i]];
+			for (int c = 0; c < 3; ++c)
+			{
+				float e = fabsf((&a.Position.x)[c] - (&b.Position.x)[c]);
+				positionError = (std::max)(positionError, halfStep[c] > 0.0f ? e / halfStep[c] : e);
+			}
+
+			XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&b.Normal));
+			float d = XMVectorGetX(XMVector3Dot(XMLoadFloat3(&a.Normal), n));
+			normalAngle = (std::max)(normalAngle, acosf((std::min)(d, 1.0f)));
+
+			// 顶点按首次引用编号, 原来相同的索引解码后也必须相同.
+			if (i > 0 && (textIndices[i] == textIndices[i - 1]) != (indices[i] == indices[i - 1]))
+				sameTopology = false;
+		}
+
+		std::wostringstream errors;
+		errors << L"  position error " << positionError << L" half steps, normal error " << normalAngle << L" rad";
+		report.Print(errors.str());
+
+		report.Check(sameTopology, filename + L": triangle order preserved without reordering");
+		report.Check(positionError <= 1.05f, filename + L": positions within half a quantization step");
+		report.Check(normalAngle <= maxNormalAngle, filename + L": normals within the quantization error");
+	}
+}
+
+void BenchmarkMeshCodec(BenchmarkReport& report)
+{
+	Run(report, L"../Models/skull", 20);
+	Run(report, L"../Models/car", 20);
+}
@@ -0,0 +1,116 @@
+﻿#include "Benchmark.h"
+#include "..\Common\ModelLoader.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+	struct BenchVertex
+	{
+		float Position[3];
+		float Normal[3];
+	};
+
+	// 原先的读取方式: std::ifstream逐个读取.
+	bool ReadWithStream(const std::wstring& filename, std::vector<BenchVertex>& vertices, std::vector<UINT>& indices)
+	{
+		std::ifstream fin(filename);
+		if (!fin)
+			return false;
+
+		UINT vcount = 0;
+		UINT tcount = 0;
+		std::string ignore;
+		fin >> ignore >> vcount;
+		fin >> ignore >> tcount;
+		fin >> ignore >> ignore >> ignore >> ignore;
+
+		vertices.resize(vcount);
+		for (UINT i = 0; i < vcount; ++i)
+		{
+			fin >> vertices[i].Position[0] >> vertices[i].Position[1] >> vertices[i].Position[2];
+			fin >> vertices[i].Normal[0] >> vertices[i].Normal[1] >> vertices[i].Normal[2];
+		}
+		fin >> ignore >> ignore >> ignore;
+
+		indices.resize(3 * tcount);
+		for (UINT i = 0; i < tcount; ++i)
+			fin >> indices[3 * i + 0] >> indices[3 * i + 1] >> indices[3 * i + 2];
+
+		return !fin.fail();
+	}
+
+	bool ReadMapped(const std::wstring& filename, std::vector<BenchVertex>& vertices, std::vector<UINT>& indices)
+	{
+		TextModelReader reader;
+		if (!reader.Open(filename))
+			return false;
+
+		vertices.resize(reader.VertexCount());
+		indices.resize(3 * reader.TriangleCount());
+		return reader.ReadVertices(vertices.data(), sizeof(BenchVertex), offsetof(BenchVertex, Normal)) &&
+			reader.ReadIndices(indices.data());
+	}
+
+	// 两种方式的浮点数解析可能相差最后一位.
+	bool NearlyEqual(float a, float b)
+	{
+		return fabsf(a - b) <= 1.0e-6f * (std::max)(1.0f, fabsf(a));
+	}
+
+	void Run(BenchmarkReport& report, const std::wstring& filename, UINT iterations)
+	{
+		std::vector<BenchVertex> streamVertices, mappedVertices;
+		std::vector<UINT> streamIndices, mappedIndices;
+
+		if (!ReadWithStream(filename, streamVertices, streamIndices) || !ReadMapped(filename, mappedVertices, mappedIndices))
+		{
+			report.Check(false, L"read " + filename);
+			return;
+		}
+
+		double streamMs = 0.0;
+		double mappedMs = 0.0;
+		for (UINT it = 0; it < iterations; ++it)
+		{
+			auto t0 = BenchmarkClock::now();
+			ReadWithStream(filename, streamVertices, streamIndices);
+			auto t1 = BenchmarkClock::now();
+			ReadMapped(filename, mappedVertices, mappedIndices);
+			auto t2 = BenchmarkClock::now();
+
+			streamMs += ElapsedMs(t0, t1);
+			mappedMs += ElapsedMs(t1, t2);
+		}
+
+		std::wostringstream oss;
+		oss << filename << L": ifstream " << streamMs / iterations << L" ms, mapped " << mappedMs / iterations << L" ms";
+		report.Print(oss.str());
+
+		report.Check(streamVertices.size() == mappedVertices.size() && streamIndices.size() == mappedIndices.size(),
+			filename + L": vertex/triangle counts match ifstream");
+		report.Check(streamIndices == mappedIndices, filename + L": indices match ifstream");
+
+		bool sameVertices = streamVertices.size() == mappedVertices.size();
+		for (size_t i = 0; i < streamVertices.size() && sameVertices; ++i)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				sameVertices = sameVertices &&
+					NearlyEqual(streamVertices[i].Position[k], mappedVertices[i].Position[k]) &&
+					NearlyEqual(streamVertices[i].Normal[k], mappedVertices[i].Normal[k]);
+			}
+		}
+		report.Check(sameVertices, filename + L": positions and normals match ifstream");
+	}
+}
+
+void BenchmarkTextModelReader(BenchmarkReport& report)
+{
+	Run(report, L"../Models/skull.txt", 10);
+	Run(report, L"../Models/car.txt", 10);
+}
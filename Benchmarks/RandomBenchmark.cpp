@@ -0,0 +1,121 @@
+﻿#include "Benchmark.h"
+#include "..\Common\Random.h"
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	bool InUnitRange(const std::vector<float>& values)
+	{
+		for (float v : values)
+		{
+			if (!(v >= 0.0f && v < 1.0f))
+				return false;
+		}
+		return true;
+	}
+
+	double Mean(const std::vector<float>& values)
+	{
+		double sum = 0.0;
+		for (float v : values)
+			sum += v;
+		return sum / values.size();
+	}
+
+	// 所有向量的长度都接近1, 并且在n所在的一侧(n为零向量时不检查).
+	bool AreUnitVectors(const std::vector<XMFLOAT3>& vectors, FXMVECTOR n)
+	{
+		for (const auto& v : vectors)
+		{
+			XMVECTOR u = XMLoadFloat3(&v);
+			if (fabsf(XMVectorGetX(XMVector3Length(u)) - 1.0f) > 1.0e-4f || XMVectorGetX(XMVector3Dot(u, n)) < 0.0f)
+				return false;
+		}
+		return true;
+	}
+}
+
+///<summary>
+/// 每秒生成的百万个[0, 1)浮点数: rand(), NextFloat()逐个生成, FillFloats()批量生成,
+/// 以及FillUnitVec3()每秒生成的百万个单位向量. 同时检查取值范围、均值、单位长度和可重复性.
+///</summary>
+void BenchmarkRandom(BenchmarkReport& report)
+{
+	const UINT count = 1 << 20;
+	const UINT iterations = 10;
+
+	RandomStream rng;
+	std::vector<float> values(count);
+	std::vector<XMFLOAT3> vectors(count);
+
+	auto t0 = BenchmarkClock::now();
+	for (UINT it = 0; it < iterations; ++it)
+	{
+		for (UINT i = 0; i < count; ++i)
+			values[i] = (float)rand() / (float)RAND_MAX;
+	}
+	auto t1 = BenchmarkClock::now();
+	for (UINT it = 0; it < iterations; ++it)
+	{
+		for (UINT i = 0; i < count; ++i)
+			values[i] = rng.NextFloat();
+	}
+	auto t2 = BenchmarkClock::now();
+	bool scalarInRange = InUnitRange(values);
+	double scalarMean = Mean(values);
+
+	auto t3 = BenchmarkClock::now();
+	for (UINT it = 0; it < iterations; ++it)
+		rng.FillFloats(values.data(), count);
+	auto t4 = BenchmarkClock::now();
+	for (UINT it = 0; it < iterations; ++it)
+		rng.FillUnitVec3(vectors.data(), count);
+	auto t5 = BenchmarkClock::now();
+
+	auto rate = [&](BenchmarkClock::time_point begin, BenchmarkClock::time_point end)
+	{
+		return (double)count * iterations / ElapsedMs(begin, end) / 1000.0;
+	};
+
+	std::wostringstream oss;
+	oss << L"M values/s: rand() " << rate(t0, t1) << L", NextFloat " << rate(t1, t2) << L", FillFloats "
+		<< rate(t3, t4) << L", FillUnitVec3 " << rate(t4, t5);
+	report.Print(oss.str());
+
+	report.Check(scalarInRange, L"NextFloat() in [0, 1)");
+	report.Check(fabs(scalarMean - 0.5) < 0.01, L"NextFloat() mean near 0.5");
+	report.Check(InUnitRange(values), L"FillFloats() in [0, 1)");
+	report.Check(fabs(Mean(values) - 0.5) < 0.01, L"FillFloats() mean near 0.5");
+	report.Check(AreUnitVectors(vectors, XMVectorZero()), L"FillUnitVec3() returns unit vectors");
+
+	XMVECTOR n = XMVector3Normalize(XMVectorSet(1.0f, 2.0f, -0.5f, 0.0f));
+	rng.FillHemisphereUnitVec3(vectors.data(), count, n);
+	report.Check(AreUnitVectors(vectors, n), L"FillHemisphereUnitVec3() returns unit vectors on the side of n");
+
+	bool hitLow = false, hitHigh = false, intInRange = true;
+	for (UINT i = 0; i < 10000; ++i)
+	{
+		int v = rng.NextInt(-3, 3);
+		intInRange = intInRange && v >= -3 && v <= 3;
+		hitLow = hitLow || v == -3;
+		hitHigh = hitHigh || v == 3;
+	}
+	report.Check(intInRange && hitLow && hitHigh, L"NextInt(-3, 3) covers exactly [-3, 3]");
+
+	// 相同的种子和流编号得到相同的序列, 流编号不同则序列不同.
+	RandomStream a(7, 3), b(7, 3), c(7, 4);
+	std::vector<float> fa(1024), fb(1024), fc(1024);
+	bool sameScalar = true;
+	for (UINT i = 0; i < 1024; ++i)
+		sameScalar = sameScalar && a.NextUInt() == b.NextUInt();
+	a.FillFloats(fa.data(), 1024);
+	b.FillFloats(fb.data(), 1024);
+	c.FillFloats(fc.data(), 1024);
+	report.Check(sameScalar && fa == fb, L"same seed and stream give the same sequence");
+	report.Check(fa != fc, L"different streams give different sequences");
+}
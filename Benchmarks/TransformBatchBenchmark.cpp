@@ -0,0 +1,98 @@
+﻿#include "Benchmark.h"
+#include "..\Common\TransformBatch.h"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// 与渲染项相同, 每个物体单独分配.
+	struct Item
+	{
+		XMFLOAT4X4 World;
+		XMFLOAT4X4 TexTransform;
+	};
+
+	// 批量转置使用的线程数, 物体数超过ParallelThreshold时才会分给多个线程.
+	const UINT ThreadCount = 4;
+
+	///<summary>
+	/// 比较批量转置与原来逐个渲染项转置(指针访问物体, 每次打包一个常量块)的吞吐量,
+	/// 单位为每秒百万个矩阵(每个物体两个矩阵). 约一半的物体可见, 两种方式写出的常量块须逐字节相同.
+	///</summary>
+	void Run(BenchmarkReport& report, UINT count, UINT iterations)
+	{
+		std::mt19937 rng(1234);
+		std::uniform_real_distribution<float> value(-10.0f, 10.0f);
+
+		TransformBatch batch;
+		std::vector<std::unique_ptr<Item>> items;
+		std::vector<Item*> visibleItems;
+		std::vector<UINT> visibleSlots;
+		for (UINT i = 0; i < count; ++i)
+		{
+			auto item = std::make_unique<Item>();
+			XMMATRIX world = XMMatrixRotationRollPitchYaw(value(rng), value(rng), value(rng)) *
+				XMMatrixTranslation(value(rng), value(rng), value(rng));
+			XMStoreFloat4x4(&item->World, world);
+			XMStoreFloat4x4(&item->TexTransform, XMMatrixScaling(value(rng), value(rng), 1.0f));
+
+			UINT slot = batch.Add(item->World, item->TexTransform);
+
+			if (rng() & 1)
+			{
+				visibleItems.push_back(item.get());
+				visibleSlots.push_back(slot);
+			}
+			items.push_back(std::move(item));
+		}
+
+		const UINT visibleCount = (UINT)visibleSlots.size();
+		std::vector<Item> batchOutput(count);
+		std::vector<Item> perItemOutput(count);
+		memset(batchOutput.data(), 0, count * sizeof(Item));
+		memset(perItemOutput.data(), 0, count * sizeof(Item));
+
+		auto t0 = BenchmarkClock::now();
+		for (UINT it = 0; it < iterations; ++it)
+			batch.BuildConstants(visibleSlots.data(), visibleCount, batchOutput.data(), sizeof(Item), ThreadCount);
+		auto t1 = BenchmarkClock::now();
+
+		for (UINT it = 0; it < iterations; ++it)
+		{
+			for (UINT i = 0; i < visibleCount; ++i)
+			{
+				Item* ri = visibleItems[i];
+
+				XMMATRIX world = XMLoadFloat4x4(&ri->World);
+				XMMATRIX texTransform = XMLoadFloat4x4(&ri->TexTransform);
+
+				Item objConstants;
+				XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
+				XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+				memcpy(&perItemOutput[visibleSlots[i]], &objConstants, sizeof(Item));
+			}
+		}
+		auto t2 = BenchmarkClock::now();
+
+		double matrices = 2.0 * visibleCount * iterations;
+		std::wostringstream oss;
+		oss << count << L" items: batch " << matrices / ElapsedMs(t0, t1) / 1000.0 << L" M matrices/s (per item "
+			<< matrices / ElapsedMs(t1, t2) / 1000.0 << L" M matrices/s)";
+		report.Print(oss.str());
+
+		std::wostringstream name;
+		name << count << L" items: batch constants match per-item constants";
+		report.Check(memcmp(batchOutput.data(), perItemOutput.data(), count * sizeof(Item)) == 0, name.str());
+	}
+}
+
+void BenchmarkTransformBatch(BenchmarkReport& report)
+{
+	for (UINT count : { 1000u, 10000u, 100000u })
+		Run(report, count, 20);
+}
@@ -0,0 +1,156 @@
+﻿#include "Benchmark.h"
+#include "..\Common\TriangleBvh.h"
+#include "..\Common\ModelLoader.h"
+#include <DirectXCollision.h>
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// 逐个三角形求交, 返回最近交点的距离, 没有交点时返回-1.
+	float IntersectBrute(FXMVECTOR origin, FXMVECTOR direction, const std::vector<XMFLOAT3>& positions,
+		const std::vector<UINT>& indices)
+	{
+		float best = FLT_MAX;
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			XMVECTOR v0 = XMLoadFloat3(&positions[indices[i + 0]]);
+			XMVECTOR v1 = XMLoadFloat3(&positions[indices[i + 1]]);
+			XMVECTOR v2 = XMLoadFloat3(&positions[indices[i + 2]]);
+
+			float distance;
+			if (TriangleTests::Intersects(origin, direction, v0, v1, v2, distance) && distance < best)
+				best = distance;
+		}
+		return best < FLT_MAX ? best : -1.0f;
+	}
+
+	///<summary>
+	/// 射线从包围球外的随机点射向包围盒内的随机点, 比较BVH与逐个三角形求交的结果.
+	/// 两者命中与否须相同, 命中距离的相对误差不超过1e-3.
+	///</summary>
+	void Run(BenchmarkReport& report, const std::wstring& name, const std::vector<XMFLOAT3>& positions,
+		const std::vector<UINT>& indices, UINT rayCount)
+	{
+		TriangleBvh bvh;
+		auto t0 = BenchmarkClock::now();
+		bvh.Build(positions.data(), sizeof(XMFLOAT3), indices.data(), (UINT)indices.size());
+		auto t1 = BenchmarkClock::now();
+
+		XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for (const auto& p : positions)
+		{
+			vMin = XMVectorMin(vMin, XMLoadFloat3(&p));
+			vMax = XMVectorMax(vMax, XMLoadFloat3(&p));
+		}
+		const XMVECTOR center = (vMin + vMax) * 0.5f;
+		const XMVECTOR extents = (vMax - vMin) * 0.5f;
+		const float radius = 2.0f * XMVectorGetX(XMVector3Length(extents)) + 1.0f;
+
+		std::mt19937 rng(42);
+		std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+
+		std::vector<XMFLOAT3> origins(rayCount);
+		std::vector<XMFLOAT3> directions(rayCount);
+		for (UINT r = 0; r < rayCount; ++r)
+		{
+			XMVECTOR onSphere = XMVector3Normalize(XMVectorSet(uniform(rng), uniform(rng), uniform(rng), 0.0f));
+			XMVECTOR o = center + onSphere * radius;
+			XMVECTOR target = center + extents * XMVectorSet(uniform(rng), uniform(rng), uniform(rng), 0.0f);
+			XMStoreFloat3(&origins[r], o);
+			XMStoreFloat3(&directions[r], XMVector3Normalize(target - o));
+		}
+
+		std::vector<float> bvhDistances(rayCount, -1.0f);
+		auto b0 = BenchmarkClock::now();
+		for (UINT r = 0; r < rayCount; ++r)
+		{
+			float distance;
+			UINT triangle;
+			if (bvh.Intersect(XMLoadFloat3(&origins[r]), XMLoadFloat3(&directions[r]), FLT_MAX, distance, triangle))
+				bvhDistances[r] = distance;
+		}
+		auto b1 = BenchmarkClock::now();
+
+		std::vector<float> bruteDistances(rayCount);
+		for (UINT r = 0; r < rayCount; ++r)
+			bruteDistances[r] = IntersectBrute(XMLoadFloat3(&origins[r]), XMLoadFloat3(&directions[r]), positions, indices);
+		auto b2 = BenchmarkClock::now();
+
+		UINT mismatches = 0;
+		UINT hits = 0;
+		for (UINT r = 0; r < rayCount; ++r)
+		{
+			bool bvhHit = bvhDistances[r] >= 0.0f;
+			bool bruteHit = bruteDistances[r] >= 0.0f;
+			if (bvhHit != bruteHit || (bvhHit && fabsf(bvhDistances[r] - bruteDistances[r]) > 1e-3f * bruteDistances[r]))
+				++mismatches;
+			hits += bruteHit ? 1 : 0;
+		}
+
+		std::wostringstream oss;
+		oss << name << L", " << indices.size() / 3 << L" triangles: build " << ElapsedMs(t0, t1) << L" ms, "
+			<< 1000.0 * ElapsedMs(b0, b1) / rayCount << L" us/ray (brute force " << 1000.0 * ElapsedMs(b1, b2) / rayCount
+			<< L" us/ray), " << hits << L"/" << rayCount << L" hits, " << bvh.NodeCount() << L" nodes";
+		report.Print(oss.str());
+
+		std::wostringstream what;
+		what << name << L": " << mismatches << L" rays differ from brute force";
+		report.Check(mismatches == 0, what.str());
+	}
+
+	bool LoadPositions(const std::wstring& filename, std::vector<XMFLOAT3>& positions, std::vector<UINT>& indices)
+	{
+		TextModelReader reader;
+		if (!reader.Open(filename))
+			return false;
+
+		positions.resize(reader.VertexCount());
+		indices.resize(3 * reader.TriangleCount());
+		return reader.ReadVertices(positions.data(), sizeof(XMFLOAT3)) && reader.ReadIndices(indices.data());
+	}
+
+	///<summary>
+	/// 所有三角形的重心都在同一点附近(绕z轴排成扇形的细长三角形), SAH无法有效划分,
+	/// 用来检查深度上限和遍历栈.
+	///</summary>
+	void MakeFan(UINT triangleCount, std::vector<XMFLOAT3>& positions, std::vector<UINT>& indices)
+	{
+		positions.clear();
+		indices.clear();
+		for (UINT t = 0; t < triangleCount; ++t)
+		{
+			float angle = XM_2PI * t / triangleCount;
+			float c = cosf(angle);
+			float s = sinf(angle);
+			UINT base = (UINT)positions.size();
+			positions.push_back(XMFLOAT3(-c, -s, -0.01f));
+			positions.push_back(XMFLOAT3(c, s, -0.01f));
+			positions.push_back(XMFLOAT3(0.0f, 0.0f, 0.01f * (t % 7)));
+			indices.push_back(base + 0);
+			indices.push_back(base + 1);
+			indices.push_back(base + 2);
+		}
+	}
+}
+
+void BenchmarkTriangleBvh(BenchmarkReport& report)
+{
+	std::vector<XMFLOAT3> positions;
+	std::vector<UINT> indices;
+
+	const std::wstring skull = L"../Models/skull.txt";
+	if (LoadPositions(skull, positions, indices))
+		Run(report, L"skull", positions, indices, 10000);
+	else
+		report.Check(false, L"read " + skull);
+
+	MakeFan(20000, positions, indices);
+	Run(report, L"fan", positions, indices, 2000);
+}
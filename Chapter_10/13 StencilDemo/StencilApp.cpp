@@ -1,5 +1,22 @@
 #include "StencilApp.h"
 
+namespace
+{
+	// ԴԤ, ʱδʹõʼ߼ mip.
+	const uint64_t gTextureBudgetBytes = 8ull * 1024 * 1024;
+
+	// 벼, ɫ벼ֺ񻺴湲.
+	const D3D11_INPUT_ELEMENT_DESC gVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
+		D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
+		D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24,
+		D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+}
+
 StencilApp::StencilApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
 }
@@ -13,13 +30,16 @@ bool StencilApp::Init()
 	if (D3DApp::Init() == false)
 		return false;
 
-	LoadTextures();
+	if (!LoadTextures())
+		return false;
+
 	BuildSamplerStates();
 	BuildRoomBuffers();
 	BuildSkullBuffers();
 	BuildShadersAndInputLayout();
 	BuildMaterials();
 	BuildRenderItems();
+	BuildCuller();
 	BuildConstantBuffers();
 	BuildRasterizerStates();
 
@@ -30,8 +50,10 @@ void StencilApp::OnResize()
 {
 	D3DApp::OnResize();
 
-	XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, AspectRatio(), 1.0f, 1000.0f);
-	XMStoreFloat4x4(&mProj, proj);
+	mCamera.SetLens(XM_PIDIV4, AspectRatio(), 1.0f, 1000.0f);
+
+	// ȾĿСı, ߱Ȳʱ汾.
+	mPassDirty = true;
 }
 
 void StencilApp::UpdateScene(GameTimer gt)
@@ -39,8 +61,19 @@ void StencilApp::UpdateScene(GameTimer gt)
 	OnKeyboardInput(gt);
 	AnimateMaterials(gt);
 	UpdateCamera(gt);
-	UpdateMainPassCB(gt);
-	UpdateReflectedPassCB(gt);
+	UpdateCulling();
+	UpdateObjectConstants();
+
+	// ȾĿ궼ûʱ̳, Ҫϴ.
+	// (ɫʹgTotalTime/gDeltaTime.)
+	if (mPassDirty || mCamera.Version() != mPassVersion)
+	{
+		UpdateMainPassCB(gt);
+		UpdateReflectedPassCB(gt);
+
+		mPassVersion = mCamera.Version();
+		mPassDirty = false;
+	}
 }
 
 void StencilApp::DrawScene()
@@ -66,13 +99,13 @@ void StencilApp::DrawScene()
 	md3dImmediateContext->VSSetConstantBuffers(2, 1, mConstantBuffers["mainPass"].GetAddressOf());
 	md3dImmediateContext->PSSetConstantBuffers(2, 1, mConstantBuffers["mainPass"].GetAddressOf());
 
-	DrawRenderItems(md3dImmediateContext.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+	DrawRenderItems(md3dImmediateContext.Get(), mVisibleRitems[(int)RenderLayer::Opaque]);
 
 	/// <summary>
 	/// ǾΪģ.
 	/// </summary>
 	md3dImmediateContext->OMSetDepthStencilState(mDepthStecnilStates["markMirror"].Get(), 1);
-	DrawRenderItems(md3dImmediateContext.Get(), mRitemLayer[(int)RenderLayer::Mirrors]);
+	DrawRenderItems(md3dImmediateContext.Get(), mVisibleRitems[(int)RenderLayer::Mirrors]);
 
 	/// <summary>
 	/// Ʒ.
@@ -83,7 +116,7 @@ void StencilApp::DrawScene()
 	md3dImmediateContext->VSSetConstantBuffers(2, 1, mConstantBuffers["reflectPass"].GetAddressOf());
 	md3dImmediateContext->PSSetConstantBuffers(2, 1, mConstantBuffers["reflectPass"].GetAddressOf());
 
-	DrawRenderItems(md3dImmediateContext.Get(), mRitemLayer[(int)RenderLayer::Reflect]);
+	DrawRenderItems(md3dImmediateContext.Get(), mVisibleRitems[(int)RenderLayer::Reflect]);
 
 	/// <summary>
 	/// ƾ.
@@ -95,15 +128,18 @@ void StencilApp::DrawScene()
 	md3dImmediateContext->OMSetDepthStencilState(nullptr, 0);
 	const float blendFactor[] = { 0.0f, 0.0f, 0.0f, 0.0f };
 	md3dImmediateContext->OMSetBlendState(mBlendStates["transparent"].Get(), blendFactor, 0xffffffff);
-	DrawRenderItems(md3dImmediateContext.Get(), mRitemLayer[(int)RenderLayer::Transparent]);
+	DrawRenderItems(md3dImmediateContext.Get(), mVisibleRitems[(int)RenderLayer::Transparent]);
 
 	/// <summary>
 	/// Ӱ.
 	/// </summary>
 	md3dImmediateContext->OMSetDepthStencilState(mDepthStecnilStates["shadow"].Get(), 0);
-	DrawRenderItems(md3dImmediateContext.Get(), mRitemLayer[(int)RenderLayer::Shadow]);
+	DrawRenderItems(md3dImmediateContext.Get(), mVisibleRitems[(int)RenderLayer::Shadow]);
 	md3dImmediateContext->OMSetDepthStencilState(nullptr, 0);
 
+	// ֡ĩԤ.
+	mTextures.EndFrame(md3dImmediateContext.Get());
+
 	HR(mSwapChain->Present(0, 0));
 
 	// .
@@ -115,6 +151,22 @@ void StencilApp::OnMouseDown(WPARAM btnState, int x, int y)
 	mLastMousePos.x = x;
 	mLastMousePos.y = y;
 
+	// мʰȡ.
+	if ((btnState & MK_MBUTTON) != 0)
+	{
+		float distance = 0.0f;
+		UINT triangle = 0;
+		RenderItem* picked = Pick(x, y, distance, triangle);
+
+		std::wostringstream outs;
+		if (picked != nullptr)
+			outs << L"Picked render item " << picked->ObjectCBIndex << L", triangle " << triangle
+				<< L", distance " << distance << L"\n";
+		else
+			outs << L"Picked nothing\n";
+		OutputDebugStringW(outs.str().c_str());
+	}
+
 	SetCapture(mhMainWnd);
 }
 
@@ -164,17 +216,23 @@ void StencilApp::OnKeyboardInput(const GameTimer& gt)
 
 	mSkullTranslation.y = MathHelper::Max(mSkullTranslation.y, 0.0f);
 
+	//  T Դ汨.
+	if (GetAsyncKeyState('T') & 0x0001)
+		mTextures.Report();
+
 	// õ.
 	XMMATRIX skullScale = XMMatrixScaling(0.45f, 0.45f, 0.45f);
 	XMMATRIX skullRotation = XMMatrixRotationY(XM_PIDIV2);
 	XMMATRIX skullOffset = XMMatrixTranslation(mSkullTranslation.x, mSkullTranslation.y, mSkullTranslation.z);
 	XMMATRIX skullWorld = skullScale * skullRotation * skullOffset;
 	XMStoreFloat4x4(&mSkullRitem->World, skullWorld);
+	mSkullRitem->BoundsDirty = true;
 
 	// ¾õ.
 	XMVECTOR mirrorPlane = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);			// ǽ.
 	XMMATRIX reflection = XMMatrixReflect(mirrorPlane);
 	XMStoreFloat4x4(&mReflectedSkullRitem->World, skullWorld * reflection);
+	mReflectedSkullRitem->BoundsDirty = true;
 
 	// Ӱ.
 	XMVECTOR shadowPlane = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);			// .
@@ -182,6 +240,7 @@ void StencilApp::OnKeyboardInput(const GameTimer& gt)
 	XMMATRIX shadow = XMMatrixShadow(shadowPlane, toMainLight);
 	XMMATRIX shadowOffset = XMMatrixTranslation(0.0f, 0.01f, 0.0f);
 	XMStoreFloat4x4(&mShadowedSkullRitem->World, skullWorld * shadow * shadowOffset);
+	mShadowedSkullRitem->BoundsDirty = true;
 }
 
 void StencilApp::UpdateCamera(GameTimer gt)
@@ -193,32 +252,24 @@ void StencilApp::UpdateCamera(GameTimer gt)
 	XMVECTOR pos = XMVectorSet(x, y, z, 1.0f);
 	XMVECTOR target = XMVectorZero();
 	XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
-	XMMATRIX view = XMMatrixLookAtLH(pos, target, up);
 
-	XMStoreFloat4x4(&mView, view);
+	mCamera.LookAt(pos, target, up);
 }
 
 void StencilApp::UpdateMainPassCB(GameTimer gt)
 {
-	XMMATRIX view = XMLoadFloat4x4(&mView);
-	XMMATRIX proj = XMLoadFloat4x4(&mProj);
-	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
-	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
-	XMMATRIX invProj = XMMatrixInverse(&XMMatrixDeterminant(proj), proj);
-	XMMATRIX invViewProj = XMMatrixInverse(&XMMatrixDeterminant(viewProj), viewProj);
-
-	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(view));
-	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(invView));
-	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(proj));
-	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(invProj));
-	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(viewProj));
-	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
-
-	mMainPassCB.EyePosW = mEyePos;
+	XMStoreFloat4x4(&mMainPassCB.View, XMMatrixTranspose(XMLoadFloat4x4(&mCamera.View())));
+	XMStoreFloat4x4(&mMainPassCB.InvView, XMMatrixTranspose(XMLoadFloat4x4(&mCamera.InvView())));
+	XMStoreFloat4x4(&mMainPassCB.Proj, XMMatrixTranspose(XMLoadFloat4x4(&mCamera.Proj())));
+	XMStoreFloat4x4(&mMainPassCB.InvProj, XMMatrixTranspose(XMLoadFloat4x4(&mCamera.InvProj())));
+	XMStoreFloat4x4(&mMainPassCB.ViewProj, XMMatrixTranspose(XMLoadFloat4x4(&mCamera.ViewProj())));
+	XMStoreFloat4x4(&mMainPassCB.InvViewProj, XMMatrixTranspose(XMLoadFloat4x4(&mCamera.InvViewProj())));
+
+	mMainPassCB.EyePosW = mCamera.GetPosition3f();
 	mMainPassCB.RenderTargetSize = XMFLOAT2((float)mClientWidth, (float)mClientHeight);
 	mMainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / mClientWidth, 1.0f / mClientHeight);
-	mMainPassCB.NearZ = 1.0f;
-	mMainPassCB.FarZ = 1000.0f;
+	mMainPassCB.NearZ = mCamera.GetNearZ();
+	mMainPassCB.FarZ = mCamera.GetFarZ();
 	mMainPassCB.TotalTime = gt.TotalTime();
 	mMainPassCB.DeltaTime = gt.DeltaTime();
 
@@ -257,7 +308,7 @@ void StencilApp::AnimateMaterials(GameTimer gt)
 {
 }
 
-void StencilApp::LoadTextures()
+bool StencilApp::LoadTextures()
 {
 	const std::vector<std::wstring> texPathList =
 	{
@@ -267,13 +318,21 @@ void StencilApp::LoadTextures()
 		L"../../Textures/white1x1.dds"
 	};
 
-	mTextureSrvs.resize(texPathList.size());
+	mTextures.Initialize(md3dDevice.Get(), gTextureBudgetBytes);
+	mTextureHandles.assign(texPathList.size(), -1);
 
+	std::wstring error;
 	for (UINT i = 0; i < (UINT)texPathList.size(); ++i)
 	{
-		HR(CreateDDSTextureFromFile(md3dDevice.Get(), texPathList[i].c_str(),
-			nullptr, mTextureSrvs[i].GetAddressOf()));
+		mTextureHandles[i] = mTextures.Load(texPathList[i], "diffuse", error);
+		if (mTextureHandles[i] < 0)
+		{
+			MessageBox(nullptr, error.c_str(), 0, 0);
+			return false;
+		}
 	}
+
+	return true;
 }
 
 void StencilApp::BuildSamplerStates()
@@ -472,50 +531,37 @@ void StencilApp::BuildRoomBuffers()
 	geo->DrawArgs["wall"] = wallSubmesh;
 	geo->DrawArgs["mirror"] = mirrorSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+	TriangleBvh::BuildSubmeshBvhs(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
 void StencilApp::BuildSkullBuffers()
 {
-	std::fstream fin("Models/skull.txt");
-	if (!fin)
+	MeshCacheFile mesh;
+	std::wstring error;
+	if (!MeshCache::LoadTextModel(L"../../Models/skull.mshz", gVertexDesc, ARRAYSIZE(gVertexDesc), sizeof(Vertex),
+		[](void* data, UINT vertexCount)
+		{
+			// ò.
+			Vertex* vertices = static_cast<Vertex*>(data);
+			for (UINT i = 0; i < vertexCount; ++i)
+				vertices[i].TexC = { 0.0f, 0.0f };
+		},
+		"zero-texc-1",
+		mesh, error))
 	{
-		MessageBox(0, L"Models/skull.txt not found.", 0, 0);
+		MessageBox(nullptr, error.c_str(), 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
-
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	std::vector<Vertex> vertices(vcount);
-	for (UINT i = 0; i < vcount; ++i)
-	{
-		fin >> vertices[i].Position.x >> vertices[i].Position.y >> vertices[i].Position.z;
-		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
-
-		// ò.
-		vertices[i].TexC = { 0.0f, 0.0f };
-	}
-
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
+	// , ʹÿص, ֮ʹк.
+	std::vector<UINT> indices(mesh.Indices(), mesh.Indices() + mesh.IndexCount());
+	MeshletBuilder::Build(mesh.Vertices(), sizeof(Vertex), mesh.VertexCount(), indices, mSkullMeshlets);
 
-	std::vector<UINT> indices(3 * tcount);
-	for (UINT i = 0; i < tcount; ++i)
-	{
-		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
-
-	fin.close();
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(UINT);
+	const UINT vbByteSize = mesh.VertexCount() * sizeof(Vertex);
+	const UINT ibByteSize = mesh.IndexCount() * sizeof(UINT);
 
 	/// <summary>
 	/// 㻺.
@@ -529,7 +575,7 @@ void StencilApp::BuildSkullBuffers()
 	cbd.StructureByteStride = 0;
 
 	D3D11_SUBRESOURCE_DATA vInitData;
-	vInitData.pSysMem = vertices.data();
+	vInitData.pSysMem = mesh.Vertices();
 	vInitData.SysMemPitch = 0;
 	vInitData.SysMemSlicePitch = 0;
 
@@ -560,12 +606,15 @@ void StencilApp::BuildSkullBuffers()
 	geo->Name = "skullGeo";
 
 	SubmeshGeometry skullSubmesh;
-	skullSubmesh.IndexCount = (UINT)indices.size();
+	skullSubmesh.IndexCount = mesh.IndexCount();
 	skullSubmesh.StartIndexLocation = 0;
 	skullSubmesh.BaseVertexLocation = 0;
 
 	geo->DrawArgs["skull"] = skullSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, mesh.Vertices(), sizeof(Vertex), indices.data());
+	TriangleBvh::BuildSubmeshBvhs(*geo, mesh.Vertices(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -616,17 +665,7 @@ void StencilApp::BuildShadersAndInputLayout()
 	HR(md3dDevice->CreatePixelShader(pixelBlob->GetBufferPointer(), pixelBlob->GetBufferSize(),
 		nullptr, mPixelShaders["opaquePS"].GetAddressOf()));
 
-	D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
-		D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
-		D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24,
-		D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-	HR(md3dDevice->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc),
+	HR(md3dDevice->CreateInputLayout(gVertexDesc, ARRAYSIZE(gVertexDesc),
 		vertexBlob->GetBufferPointer(), vertexBlob->GetBufferSize(),
 		mInputLayout.GetAddressOf()));
 }
@@ -808,6 +847,8 @@ void StencilApp::BuildRenderItems()
 	floorRitem->IndexCount = floorRitem->Geo->DrawArgs["floor"].IndexCount;
 	floorRitem->StartIndexLocation = floorRitem->Geo->DrawArgs["floor"].StartIndexLocation;
 	floorRitem->BaseVertexLocation = floorRitem->Geo->DrawArgs["floor"].BaseVertexLocation;
+	floorRitem->Bounds = floorRitem->Geo->DrawArgs["floor"].Bounds;
+	floorRitem->Bvh = floorRitem->Geo->DrawArgs["floor"].Bvh.get();
 	floorRitem->VertexBuffer = mVertexBuffers["room"].Get();
 	floorRitem->IndexBuffer = mIndexBuffers["room"].Get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(floorRitem.get());
@@ -822,6 +863,8 @@ void StencilApp::BuildRenderItems()
 	wallRitem->IndexCount = wallRitem->Geo->DrawArgs["wall"].IndexCount;
 	wallRitem->StartIndexLocation = wallRitem->Geo->DrawArgs["wall"].StartIndexLocation;
 	wallRitem->BaseVertexLocation = wallRitem->Geo->DrawArgs["wall"].BaseVertexLocation;
+	wallRitem->Bounds = wallRitem->Geo->DrawArgs["wall"].Bounds;
+	wallRitem->Bvh = wallRitem->Geo->DrawArgs["wall"].Bvh.get();
 	wallRitem->VertexBuffer = mVertexBuffers["room"].Get();
 	wallRitem->IndexBuffer = mIndexBuffers["room"].Get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(wallRitem.get());
@@ -837,8 +880,11 @@ void StencilApp::BuildRenderItems()
 	skullRitem->IndexCount = skullRitem->Geo->DrawArgs["skull"].IndexCount;
 	skullRitem->StartIndexLocation = skullRitem->Geo->DrawArgs["skull"].StartIndexLocation;
 	skullRitem->BaseVertexLocation = skullRitem->Geo->DrawArgs["skull"].BaseVertexLocation;
+	skullRitem->Bounds = skullRitem->Geo->DrawArgs["skull"].Bounds;
+	skullRitem->Bvh = skullRitem->Geo->DrawArgs["skull"].Bvh.get();
 	skullRitem->VertexBuffer = mVertexBuffers["skull"].Get();
 	skullRitem->IndexBuffer = mIndexBuffers["skull"].Get();
+	skullRitem->Meshlets = &mSkullMeshlets;
 	mSkullRitem = skullRitem.get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(skullRitem.get());
 
@@ -854,6 +900,8 @@ void StencilApp::BuildRenderItems()
 	*shadowedSkullRitem = *skullRitem;
 	shadowedSkullRitem->ObjectCBIndex = 4;
 	shadowedSkullRitem->Mat = mMaterials["shadowMat"].get();
+	// ӰͶӰ, Χͷ׶任û, .
+	shadowedSkullRitem->Meshlets = nullptr;
 	mShadowedSkullRitem = shadowedSkullRitem.get();
 	mRitemLayer[(int)RenderLayer::Shadow].push_back(shadowedSkullRitem.get());
 
@@ -868,6 +916,8 @@ void StencilApp::BuildRenderItems()
 	mirrorRitem->IndexCount = mirrorRitem->Geo->DrawArgs["mirror"].IndexCount;
 	mirrorRitem->StartIndexLocation = mirrorRitem->Geo->DrawArgs["mirror"].StartIndexLocation;
 	mirrorRitem->BaseVertexLocation = mirrorRitem->Geo->DrawArgs["mirror"].BaseVertexLocation;
+	mirrorRitem->Bounds = mirrorRitem->Geo->DrawArgs["mirror"].Bounds;
+	mirrorRitem->Bvh = mirrorRitem->Geo->DrawArgs["mirror"].Bvh.get();
 	mirrorRitem->VertexBuffer = mVertexBuffers["room"].Get();
 	mirrorRitem->IndexBuffer = mIndexBuffers["room"].Get();
 	mRitemLayer[(int)RenderLayer::Mirrors].push_back(mirrorRitem.get());
@@ -879,6 +929,148 @@ void StencilApp::BuildRenderItems()
 	mAllRitems.push_back(std::move(reflectedSkullRitem));
 	mAllRitems.push_back(std::move(shadowedSkullRitem));
 	mAllRitems.push_back(std::move(mirrorRitem));
+
+	// 任ObjectCBIndex.
+	mObjectTransforms.Clear();
+	for (auto& ri : mAllRitems)
+	{
+		UINT slot = mObjectTransforms.Add(ri->World, ri->TexTransform);
+		assert(slot == (UINT)ri->ObjectCBIndex);
+	}
+	mObjectConstants.resize(mAllRitems.size());
+}
+
+void StencilApp::BuildCuller()
+{
+	mSceneTree.Clear();
+	mCullItems.clear();
+
+	for (auto& ri : mAllRitems)
+	{
+		ri->CullId = (UINT)mCullItems.size();
+		ri->WorldBounds = TransformBounds(ri->Bounds, XMLoadFloat4x4(&ri->World));
+		ri->TreeProxy = mSceneTree.CreateProxy(ri->WorldBounds, ri->CullId);
+		ri->BoundsDirty = false;
+		mCullItems.push_back(ri.get());
+	}
+
+	mCullVisible.assign(mCullItems.size(), false);
+}
+
+void StencilApp::UpdateCulling()
+{
+	// ֻı˵ȾҪ¼ռΧ,
+	// ƶİΧʱҪĶ, ֻ²һҶڵ.
+	for (auto ri : mCullItems)
+	{
+		if (ri->BoundsDirty)
+		{
+			BoundingBox bounds = TransformBounds(ri->Bounds, XMLoadFloat4x4(&ri->World));
+			XMFLOAT3 displacement(
+				bounds.Center.x - ri->WorldBounds.Center.x,
+				bounds.Center.y - ri->WorldBounds.Center.y,
+				bounds.Center.z - ri->WorldBounds.Center.z);
+
+			mSceneTree.MoveProxy(ri->TreeProxy, bounds, displacement);
+			mObjectTransforms.SetWorld(ri->ObjectCBIndex, ri->World);
+			ri->WorldBounds = bounds;
+			ri->BoundsDirty = false;
+		}
+	}
+
+	mVisibleIds.clear();
+	mSceneTree.QueryFrustum(mCamera.FrustumPlanes(), mVisibleIds);
+
+	std::fill(mCullVisible.begin(), mCullVisible.end(), false);
+	for (UINT id : mVisibleIds)
+		mCullVisible[id] = true;
+
+	// ÿһ㱣ԭĻ˳.
+	for (int layer = 0; layer < (int)RenderLayer::Count; ++layer)
+	{
+		mVisibleRitems[layer].clear();
+		for (auto ri : mRitemLayer[layer])
+		{
+			if (mCullVisible[ri->CullId])
+				mVisibleRitems[layer].push_back(ri);
+		}
+	}
+
+	// ɼȾ޳׶ͱ.
+	XMFLOAT3 eyePos = mCamera.GetPosition3f();
+	for (UINT id : mVisibleIds)
+	{
+		RenderItem* ri = mCullItems[id];
+		if (ri->Meshlets != nullptr)
+		{
+			MeshletCuller::Cull(*ri->Meshlets, XMLoadFloat4x4(&ri->World), mCamera.FrustumPlanes(),
+				eyePos, ri->MeshletRanges);
+		}
+	}
+}
+
+void StencilApp::UpdateObjectConstants()
+{
+	static_assert(offsetof(ObjectConstants, World) == 0 &&
+		offsetof(ObjectConstants, TexTransform) == sizeof(XMFLOAT4X4),
+		"TransformBatch writes World then TexTransform at the start of each block.");
+
+	// ֻת׶ڵȾ.
+	mVisibleSlots.clear();
+	for (UINT id : mVisibleIds)
+		mVisibleSlots.push_back(mCullItems[id]->ObjectCBIndex);
+
+	mObjectTransforms.BuildConstants(mVisibleSlots.data(), (UINT)mVisibleSlots.size(),
+		mObjectConstants.data(), sizeof(ObjectConstants));
+}
+
+RenderItem* StencilApp::Pick(int screenX, int screenY, float& distance, UINT& triangle)
+{
+	// Ļ -> ۲ռ(ԭΪ).
+	const XMFLOAT4X4& proj = mCamera.Proj();
+	float vx = (2.0f * screenX / mClientWidth - 1.0f) / proj(0, 0);
+	float vy = (-2.0f * screenY / mClientHeight + 1.0f) / proj(1, 1);
+
+	XMMATRIX invView = XMLoadFloat4x4(&mCamera.InvView());
+
+	XMVECTOR rayOrigin = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), invView);
+	XMVECTOR rayDir = XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(vx, vy, 1.0f, 0.0f), invView));
+
+	RenderItem* picked = nullptr;
+	distance = MathHelper::Infinity;
+	triangle = 0;
+
+	// ߽ΧеȺ󷵻Ⱦ, صǰоԶȾ.
+	mSceneTree.RayCast(rayOrigin, rayDir, MathHelper::Infinity, [&](UINT id, float maxDistance)
+	{
+		RenderItem* ri = mCullItems[id];
+		if (ri->Bvh == nullptr)
+			return maxDistance;
+
+		// ӰͶӰ, , ʰȡ.
+		XMMATRIX world = XMLoadFloat4x4(&ri->World);
+		XMVECTOR det = XMMatrixDeterminant(world);
+		if (fabsf(XMVectorGetX(det)) < 1e-6f)
+			return maxDistance;
+
+		// ߱任ģͿռ, 򲻵λ, õľռľ.
+		XMMATRIX invWorld = XMMatrixInverse(&det, world);
+		XMVECTOR localOrigin = XMVector3TransformCoord(rayOrigin, invWorld);
+		XMVECTOR localDir = XMVector3TransformNormal(rayDir, invWorld);
+
+		float t = 0.0f;
+		UINT tri = 0;
+		if (ri->Bvh->Intersect(localOrigin, localDir, maxDistance, t, tri))
+		{
+			picked = ri;
+			distance = t;
+			triangle = tri;
+			return t;
+		}
+		return maxDistance;
+	});
+
+	return picked;
 }
 
 void StencilApp::DrawRenderItems(ID3D11DeviceContext* context, const std::vector<RenderItem*>& ritems)
@@ -893,15 +1085,8 @@ void StencilApp::DrawRenderItems(ID3D11DeviceContext* context, const std::vector
 		context->IASetIndexBuffer(ri->IndexBuffer, DXGI_FORMAT_R32_UINT, 0);
 		context->IASetPrimitiveTopology(ri->PrimitiveType);
 
-		/// .
-		XMMATRIX world = XMLoadFloat4x4(&ri->World);
-		XMMATRIX texTransform = XMLoadFloat4x4(&ri->TexTransform);
-		
-		ObjectConstants objConstants;
-		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
-		XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
-
-		d3dUtil::CopyDataToGpu(context, &objConstants,
+		/// , UpdateObjectConstants()ת.
+		d3dUtil::CopyDataToGpu(context, &mObjectConstants[ri->ObjectCBIndex],
 			sizeof(ObjectConstants), mConstantBuffers["object"].Get());
 
 		context->VSSetConstantBuffers(0, 1, mConstantBuffers["object"].GetAddressOf());
@@ -922,10 +1107,22 @@ void StencilApp::DrawRenderItems(ID3D11DeviceContext* context, const std::vector
 		context->PSSetConstantBuffers(1, 1, mConstantBuffers["material"].GetAddressOf());
 
 		// .
-		context->PSSetShaderResources(0, 1, mTextureSrvs[ri->Mat->DiffuseSrvHeapIndex].GetAddressOf());
-
-		// .
-		context->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation,
-			ri->BaseVertexLocation, 0);
+		ID3D11ShaderResourceView* diffuseSrv = mTextures.Use(mTextureHandles[ri->Mat->DiffuseSrvHeapIndex]);
+		context->PSSetShaderResources(0, 1, &diffuseSrv);
+
+		// , ʱֻ޳ϲ.
+		if (ri->Meshlets == nullptr)
+		{
+			context->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation,
+				ri->BaseVertexLocation, 0);
+		}
+		else
+		{
+			for (const auto& range : ri->MeshletRanges)
+			{
+				context->DrawIndexedInstanced(range.IndexCount, 1, ri->StartIndexLocation + range.StartIndexLocation,
+					ri->BaseVertexLocation, 0);
+			}
+		}
 	}
 }
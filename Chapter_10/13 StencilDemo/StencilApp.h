@@ -1,7 +1,14 @@
 #include "..\..\Common\d3dApp.h"
 #include "..\..\Common\d3dUtil.h"
 #include "..\..\Common\GeometryGenerator.h"
+#include "..\..\Common\MeshCache.h"
 #include "..\..\Common\MathHelper.h"
+#include "..\..\Common\TextureRegistry.h"
+#include "..\..\Common\DynamicAabbTree.h"
+#include "..\..\Common\TransformBatch.h"
+#include "..\..\Common\Camera.h"
+#include "..\..\Common\Meshlet.h"
+#include "..\..\Common\TriangleBvh.h"
 #include "FrameResources.h"
 
 using Microsoft::WRL::ComPtr;
@@ -39,6 +46,22 @@ struct RenderItem
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
 	UINT BaseVertexLocation = 0;
+
+	// ģͿռΧ, ıҪBoundsDirty(ͬʱmObjectTransformsе).
+	BoundingBox Bounds;
+	bool BoundsDirty = true;
+
+	// ռΧ, ڰΧвеĴ, ԼmCullItemsеı.
+	BoundingBox WorldBounds;
+	int TreeProxy = DynamicAabbTree::NullNode;
+	UINT CullId = 0;
+
+	// ģͿռBVH, ʰȡ, Ϊʱʰȡ.
+	const TriangleBvh* Bvh = nullptr;
+
+	// , Ϊʱ, ֻÿ֡޳ʣµ(StartIndexLocation).
+	const MeshletData* Meshlets = nullptr;
+	std::vector<MeshletDrawRange> MeshletRanges;
 };
 
 /// Ⱦֲ, ʹø.
@@ -85,7 +108,7 @@ public:
 
 private:
 	/// Դ.
-	void LoadTextures();
+	bool LoadTextures();
 
 	/// .
 	void BuildSamplerStates();
@@ -107,12 +130,28 @@ private:
 	/// Ⱦݴ洢.
 	void BuildRenderItems();
 
+	/// ȾΧв.
+	void BuildCuller();
+
+	/// ƶȾеİΧ, ׶ѯõÿһĿɼȾ.
+	void UpdateCulling();
+
+	///<summary>
+	/// ʰȡĻ(x, y)Ⱦ, ûʱnullptr.
+	/// ðΧвɸѡȾ, ģͿռBVH.
+	///</summary>
+	RenderItem* Pick(int screenX, int screenY, float& distance, UINT& triangle);
+
+	/// תÿɼȾ, õʱʹõ峣.
+	void UpdateObjectConstants();
+
 	/// .
 	void DrawRenderItems(ID3D11DeviceContext* context, const std::vector<RenderItem*>& ritems);
 
 private:
-	// Դͼ.
-	std::vector<ComPtr<ID3D11ShaderResourceView>> mTextureSrvs;
+	// ע, ʵ DiffuseSrvHeapIndex  mTextureHandles.
+	TextureRegistry mTextures;
+	std::vector<int> mTextureHandles;
 	std::vector<ComPtr<ID3D11SamplerState>> mSamplers;
 
 	// 㻺, , .
@@ -127,6 +166,9 @@ private:
 	// λϢ洢.
 	XMFLOAT3 mSkullTranslation = { 0.0f, 1.0f, -5.0f };
 
+	// õ, .
+	MeshletData mSkullMeshlets;
+
 	// 벼.
 	ComPtr<ID3D11InputLayout> mInputLayout = nullptr;
 
@@ -143,6 +185,18 @@ private:
 	// Ⱦ.
 	std::vector<std::unique_ptr<RenderItem>> mAllRitems;
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
+	// ׶޳, mCullItems޳.
+	DynamicAabbTree mSceneTree;
+	std::vector<RenderItem*> mCullItems;
+	std::vector<UINT> mVisibleIds;
+	std::vector<bool> mCullVisible;
+	std::vector<RenderItem*> mVisibleRitems[(int)RenderLayer::Count];
+
+	// 任(ObjectCBIndex)תú峣.
+	TransformBatch mObjectTransforms;
+	std::vector<UINT> mVisibleSlots;
+	std::vector<ObjectConstants> mObjectConstants;
+
 	RenderItem* mSkullRitem = nullptr;
 	RenderItem* mReflectedSkullRitem = nullptr;
 	RenderItem* mShadowedSkullRitem = nullptr;
@@ -152,11 +206,13 @@ private:
 	std::unordered_map<std::string, ComPtr<ID3D11BlendState>> mBlendStates;
 	std::unordered_map<std::string, ComPtr<ID3D11DepthStencilState>> mDepthStecnilStates;
 
-	// 硢۲졢ͶӰ.
-	XMFLOAT3 mEyePos = { 0.0f, 0.0f, 0.0f };
+	// , (۲졢ͶӰ).
 	XMFLOAT4X4 mWorld = MathHelper::Identity4x4();
-	XMFLOAT4X4 mView = MathHelper::Identity4x4();
-	XMFLOAT4X4 mProj = MathHelper::Identity4x4();
+	Camera mCamera;
+
+	// һϴ̳ʱ汾; ȾĿСıʱҲҪϴ.
+	UINT mPassVersion = 0;
+	bool mPassDirty = true;
 
 	// ϵ.
 	float mTheta = 1.5f * XM_PI;
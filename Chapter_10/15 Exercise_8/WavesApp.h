@@ -4,6 +4,8 @@
 #include "..\..\Common\d3dUtil.h"
 #include "..\..\Common\GeometryGenerator.h"
 #include "..\..\Common\MathHelper.h"
+#include "..\..\Common\Random.h"
+#include "..\..\Common\Heightfield.h"
 #include "Waves.h"
 #include "FrameResources.h"
 
@@ -114,12 +116,6 @@ private:
 	/// Ļ.
 	void DrawFullScreenQuad(ID3D11DeviceContext* context);
 
-	/// ɽ߶.
-	float GetHillsHeight(float x, float z) const;
-
-	/// ɽĳķ.
-	XMFLOAT3 GetHillsNormal(float x, float z) const;
-
 private:
 	// Դͼ.
 	std::vector<ComPtr<ID3D11ShaderResourceView>> mTextureSrvs;
@@ -143,6 +139,9 @@ private:
 	// .
 	std::unique_ptr<Waves> mWaves = nullptr;
 
+	// Ŷõ.
+	RandomStream mRandom;
+
 	// Ϣ.
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeos;
 
@@ -1,5 +1,15 @@
 #include "WavesApp.h"
 
+namespace
+{
+	// ÿŶķȷΧ.
+	const float MinDisturbMagnitude = 0.2f;
+	const float MaxDisturbMagnitude = 0.5f;
+
+	// ڵļŶӶ, ΧֱŶȵ4.
+	const float WavesHeightSlack = 4.0f * MaxDisturbMagnitude;
+}
+
 WavesApp::WavesApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
 }
@@ -194,9 +204,9 @@ void WavesApp::UpdateWaves(GameTimer gt)
 	{
 		t_base += 0.25f;
 
-		int i = MathHelper::Rand(4, mWaves->RowCount() - 5);
-		int j = MathHelper::Rand(4, mWaves->ColumnCount() - 5);
-		float r = MathHelper::RandF(0.2f, 0.5f);
+		int i = mRandom.NextInt(4, mWaves->RowCount() - 5);
+		int j = mRandom.NextInt(4, mWaves->ColumnCount() - 5);
+		float r = mRandom.NextFloat(MinDisturbMagnitude, MaxDisturbMagnitude);
 
 		mWaves->Disturb(i, j, r);
 	}
@@ -341,18 +351,20 @@ void WavesApp::BuildHillBuffers()
 {
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData grid;
-	geoGen.CreateGrid(160.0f, 160.0f, 50, 50, grid);
+	const UINT rowCount = 50;
+	const UINT columnCount = 50;
+	geoGen.CreateGrid(160.0f, 160.0f, rowCount, columnCount, grid);
 
 	std::vector<Vertex> vertices(grid.Vertices.size());
 	for (UINT i = 0; i < (UINT)vertices.size(); ++i)
 	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Position = p;
-		vertices[i].Position.y = GetHillsHeight(p.x, p.z);
-		vertices[i].Normal = GetHillsNormal(p.x, p.z);
+		vertices[i].Position = grid.Vertices[i].Position;
 		vertices[i].TexC = grid.Vertices[i].TexC;
 	}
 
+	// ߶Ⱥͷ.
+	Heightfield::Evaluate(Heightfield::Hills(), vertices.data(), sizeof(Vertex), offsetof(Vertex, Normal), rowCount, columnCount);
+
 	std::vector<UINT> indices = grid.Indices;
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
@@ -409,6 +421,8 @@ void WavesApp::BuildHillBuffers()
 	geo->VertexBuffer = mVertexBuffers["hill"].Get();
 	geo->IndexBuffer = mIndexBuffers["hill"].Get();
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -484,6 +498,12 @@ void WavesApp::BuildWavesBuffers()
 	geo->VertexBuffer = mVertexBuffers["waves"].Get();
 	geo->IndexBuffer = mIndexBuffers["waves"].Get();
 
+	// ˶ÿ֡CPUϸ, ﰴʼƽ, ֱΪ.
+	d3dUtil::ComputeSubmeshBounds(*geo, &mWaves->Position(0), sizeof(XMFLOAT3), indices.data());
+	auto& wavesArgs = geo->DrawArgs["waves"];
+	wavesArgs.Bounds.Extents.y += WavesHeightSlack;
+	wavesArgs.Sphere.Radius += WavesHeightSlack;
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -557,6 +577,8 @@ void WavesApp::BuildBoxBuffers()
 	geo->VertexBuffer = mVertexBuffers["box"].Get();
 	geo->IndexBuffer = mIndexBuffers["box"].Get();
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -819,21 +841,3 @@ void WavesApp::DrawRenderItems(ID3D11DeviceContext* context, const std::vector<R
 			ri->BaseVertexLocation, 0);
 	}
 }
-
-float WavesApp::GetHillsHeight(float x, float z) const
-{
-	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
-}
-
-XMFLOAT3 WavesApp::GetHillsNormal(float x, float z) const
-{
-	XMFLOAT3 n(
-		-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
-		1.0f,
-		-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
-
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
-
-	return n;
-}
@@ -1,5 +1,19 @@
 #include "StencilApp.h"
 
+namespace
+{
+	// 벼, ɫ벼ֺ񻺴湲.
+	const D3D11_INPUT_ELEMENT_DESC gVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
+		D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
+		D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24,
+		D3D11_INPUT_PER_VERTEX_DATA, 0 }
+	};
+}
+
 StencilApp::StencilApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
 }
@@ -270,21 +284,18 @@ void StencilApp::AnimateMaterials(GameTimer gt)
 
 void StencilApp::LoadTextures()
 {
-	const std::vector<std::wstring> texPathList =
-	{
-		L"../../Textures/bricks3.dds",
-		L"../../Textures/checkboard.dds",
-		L"../../Textures/ice.dds",
-		L"../../Textures/white1x1.dds"
-	};
+	// ɲͨȡ, ֻͬһ.
+	mTextureCache.Initialize(md3dDevice.Get());
+}
 
-	mTextureSrvs.resize(texPathList.size());
+TextureHandle StencilApp::AcquireTexture(const std::wstring& filename)
+{
+	std::wstring error;
+	TextureHandle texture = mTextureCache.Acquire(filename, error);
+	if (!texture)
+		MessageBox(nullptr, error.c_str(), 0, 0);
 
-	for (UINT i = 0; i < (UINT)texPathList.size(); ++i)
-	{
-		HR(CreateDDSTextureFromFile(md3dDevice.Get(), texPathList[i].c_str(),
-			nullptr, mTextureSrvs[i].GetAddressOf()));
-	}
+	return texture;
 }
 
 void StencilApp::BuildSamplerStates()
@@ -483,50 +494,32 @@ void StencilApp::BuildRoomBuffers()
 	geo->DrawArgs["wall"] = wallSubmesh;
 	geo->DrawArgs["mirror"] = mirrorSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
 void StencilApp::BuildSkullBuffers()
 {
-	std::fstream fin("Models/skull.txt");
-	if (!fin)
+	MeshCacheFile mesh;
+	std::wstring error;
+	if (!MeshCache::LoadTextModel(L"../../Models/skull.mshz", gVertexDesc, ARRAYSIZE(gVertexDesc), sizeof(Vertex),
+		[](void* data, UINT vertexCount)
+		{
+			// ò.
+			Vertex* vertices = static_cast<Vertex*>(data);
+			for (UINT i = 0; i < vertexCount; ++i)
+				vertices[i].TexC = { 0.0f, 0.0f };
+		},
+		"zero-texc-1",
+		mesh, error))
 	{
-		MessageBox(0, L"Models/skull.txt not found.", 0, 0);
+		MessageBox(nullptr, error.c_str(), 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
-
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	std::vector<Vertex> vertices(vcount);
-	for (UINT i = 0; i < vcount; ++i)
-	{
-		fin >> vertices[i].Position.x >> vertices[i].Position.y >> vertices[i].Position.z;
-		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
-
-		// ò.
-		vertices[i].TexC = { 0.0f, 0.0f };
-	}
-
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
-
-	std::vector<UINT> indices(3 * tcount);
-	for (UINT i = 0; i < tcount; ++i)
-	{
-		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
-	}
-
-	fin.close();
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(UINT);
+	const UINT vbByteSize = mesh.VertexCount() * sizeof(Vertex);
+	const UINT ibByteSize = mesh.IndexCount() * sizeof(UINT);
 
 	/// <summary>
 	/// 㻺.
@@ -540,7 +533,7 @@ void StencilApp::BuildSkullBuffers()
 	cbd.StructureByteStride = 0;
 
 	D3D11_SUBRESOURCE_DATA vInitData;
-	vInitData.pSysMem = vertices.data();
+	vInitData.pSysMem = mesh.Vertices();
 	vInitData.SysMemPitch = 0;
 	vInitData.SysMemSlicePitch = 0;
 
@@ -558,7 +551,7 @@ void StencilApp::BuildSkullBuffers()
 	ibd.StructureByteStride = 0;
 
 	D3D11_SUBRESOURCE_DATA iInitData;
-	iInitData.pSysMem = indices.data();
+	iInitData.pSysMem = mesh.Indices();
 	iInitData.SysMemPitch = 0;
 	iInitData.SysMemSlicePitch = 0;
 
@@ -571,12 +564,14 @@ void StencilApp::BuildSkullBuffers()
 	geo->Name = "skullGeo";
 
 	SubmeshGeometry skullSubmesh;
-	skullSubmesh.IndexCount = (UINT)indices.size();
+	skullSubmesh.IndexCount = mesh.IndexCount();
 	skullSubmesh.StartIndexLocation = 0;
 	skullSubmesh.BaseVertexLocation = 0;
 
 	geo->DrawArgs["skull"] = skullSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, mesh.Vertices(), sizeof(Vertex), mesh.Indices());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -627,17 +622,7 @@ void StencilApp::BuildShadersAndInputLayout()
 	HR(md3dDevice->CreatePixelShader(pixelBlob->GetBufferPointer(), pixelBlob->GetBufferSize(),
 		nullptr, mPixelShaders["opaquePS"].GetAddressOf()));
 
-	D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
-		D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
-		D3D11_INPUT_PER_VERTEX_DATA, 0 },
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24,
-		D3D11_INPUT_PER_VERTEX_DATA, 0 }
-	};
-
-	HR(md3dDevice->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc),
+	HR(md3dDevice->CreateInputLayout(gVertexDesc, ARRAYSIZE(gVertexDesc),
 		vertexBlob->GetBufferPointer(), vertexBlob->GetBufferSize(),
 		mInputLayout.GetAddressOf()));
 }
@@ -759,7 +744,7 @@ void StencilApp::BuildMaterials()
 	auto bricks = std::make_unique<Material>();
 	bricks->Name = "bricks";
 	bricks->MatCBIndex = 0;
-	bricks->DiffuseSrvHeapIndex = 0;
+	bricks->DiffuseTexture = AcquireTexture(L"../../Textures/bricks3.dds");
 	bricks->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	bricks->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
 	bricks->Roughness = 0.25f;
@@ -768,7 +753,7 @@ void StencilApp::BuildMaterials()
 	auto checkertile = std::make_unique<Material>();
 	checkertile->Name = "checkertile";
 	checkertile->MatCBIndex = 1;
-	checkertile->DiffuseSrvHeapIndex = 1;
+	checkertile->DiffuseTexture = AcquireTexture(L"../../Textures/checkboard.dds");
 	checkertile->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	checkertile->FresnelR0 = XMFLOAT3(0.07f, 0.07f, 0.07f);
 	checkertile->Roughness = 0.3f;
@@ -777,7 +762,7 @@ void StencilApp::BuildMaterials()
 	auto icemirror = std::make_unique<Material>();
 	icemirror->Name = "icemirror";
 	icemirror->MatCBIndex = 2;
-	icemirror->DiffuseSrvHeapIndex = 2;
+	icemirror->DiffuseTexture = AcquireTexture(L"../../Textures/ice.dds");
 	icemirror->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 0.3f);
 	icemirror->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
 	icemirror->Roughness = 0.5f;
@@ -786,7 +771,7 @@ void StencilApp::BuildMaterials()
 	auto skullMat = std::make_unique<Material>();
 	skullMat->Name = "skullMat";
 	skullMat->MatCBIndex = 3;
-	skullMat->DiffuseSrvHeapIndex = 3;
+	skullMat->DiffuseTexture = AcquireTexture(L"../../Textures/white1x1.dds");
 	skullMat->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	skullMat->FresnelR0 = XMFLOAT3(0.05f, 0.05f, 0.05f);
 	skullMat->Roughness = 0.3f;
@@ -795,7 +780,7 @@ void StencilApp::BuildMaterials()
 	auto shadowMat = std::make_unique<Material>();
 	shadowMat->Name = "shadowMat";
 	shadowMat->MatCBIndex = 4;
-	shadowMat->DiffuseSrvHeapIndex = 3;
+	shadowMat->DiffuseTexture = AcquireTexture(L"../../Textures/white1x1.dds");
 	shadowMat->DiffuseAlbedo = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.5f);
 	shadowMat->FresnelR0 = XMFLOAT3(0.001f, 0.001f, 0.001f);
 	shadowMat->Roughness = 0.0f;
@@ -951,7 +936,8 @@ void StencilApp::DrawRenderItems(ID3D11DeviceContext* context, const std::vector
 		context->PSSetConstantBuffers(1, 1, mConstantBuffers["material"].GetAddressOf());
 
 		// .
-		context->PSSetShaderResources(0, 1, mTextureSrvs[ri->Mat->DiffuseSrvHeapIndex].GetAddressOf());
+		ID3D11ShaderResourceView* diffuseSrv = ri->Mat->DiffuseTexture ? ri->Mat->DiffuseTexture->Srv.Get() : nullptr;
+		context->PSSetShaderResources(0, 1, &diffuseSrv);
 
 		// .
 		context->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation,
@@ -1,6 +1,8 @@
 #include "..\..\Common\d3dApp.h"
 #include "..\..\Common\d3dUtil.h"
 #include "..\..\Common\GeometryGenerator.h"
+#include "..\..\Common\MeshCache.h"
+#include "..\..\Common\TextureCache.h"
 #include "..\..\Common\MathHelper.h"
 #include "FrameResources.h"
 
@@ -88,6 +90,9 @@ private:
 	/// Դ.
 	void LoadTextures();
 
+	/// ȡ, ʧʱϢnullptr.
+	TextureHandle AcquireTexture(const std::wstring& filename);
+
 	/// .
 	void BuildSamplerStates();
 
@@ -112,8 +117,8 @@ private:
 	void DrawRenderItems(ID3D11DeviceContext* context, const std::vector<RenderItem*>& ritems);
 
 private:
-	// Դͼ.
-	std::vector<ComPtr<ID3D11ShaderResourceView>> mTextureSrvs;
+	// , ʳĹ.
+	TextureCache mTextureCache;
 	std::vector<ComPtr<ID3D11SamplerState>> mSamplers;
 
 	// 㻺, , .
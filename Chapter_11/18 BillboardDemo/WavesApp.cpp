@@ -1,5 +1,19 @@
 #include "WavesApp.h"
 
+namespace
+{
+	// ÿŶķȷΧ.
+	const float MinDisturbMagnitude = 0.2f;
+	const float MaxDisturbMagnitude = 0.5f;
+
+	// ڵļŶӶ, ΧֱŶȵ4.
+	const float WavesHeightSlack = 4.0f * MaxDisturbMagnitude;
+
+	// Ĺߴ, ɫλΪչΪСı.
+	const float TreeSpriteWidth = 20.0f;
+	const float TreeSpriteHeight = 20.0f;
+}
+
 WavesApp::WavesApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
 }
@@ -15,7 +29,9 @@ bool WavesApp::Init()
 
 	mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
 
-	LoadTextures();
+	if (!LoadTextures())
+		return false;
+
 	BuildSamplerStates();
 	BuildHillBuffers();
 	BuildWavesBuffers();
@@ -211,9 +227,9 @@ void WavesApp::UpdateWaves(GameTimer gt)
 	{
 		t_base += 0.25f;
 
-		int i = MathHelper::Rand(4, mWaves->RowCount() - 5);
-		int j = MathHelper::Rand(4, mWaves->ColumnCount() - 5);
-		float r = MathHelper::RandF(0.2f, 0.5f);
+		int i = mRandom.NextInt(4, mWaves->RowCount() - 5);
+		int j = mRandom.NextInt(4, mWaves->ColumnCount() - 5);
+		float r = mRandom.NextFloat(MinDisturbMagnitude, MaxDisturbMagnitude);
 
 		mWaves->Disturb(i, j, r);
 	}
@@ -258,16 +274,38 @@ void WavesApp::AnimateMaterials(GameTimer gt)
 	mWaveRitem->Mat = waterMat;
 }
 
-void WavesApp::LoadTextures()
+bool WavesApp::LoadTextures()
 {
 	std::vector<std::wstring> texturePath =
 	{
 		L"../../Textures/grass.dds",
 		L"../../Textures/water1.dds",
 		L"../../Textures/WireFence.dds",
-		L"../../Textures/treearray.dds"
+		L"../../Textures/treeArrayBmp.dds"
 	};
 
+	// tree0~2.bmp(תΪtree*.bmp.dds).
+	ImageImportOptions importOptions;
+	importOptions.AlphaCutoff = 0.1f;		// TreeSprite.hlslclipֵһ.
+
+	std::wstring error;
+	std::vector<std::wstring> treeFrames(3);
+	for (int i = 0; i < (int)treeFrames.size(); ++i)
+	{
+		const std::wstring source = L"../../Textures/tree" + std::to_wstring(i) + L".bmp";
+		if (!ImageImporter::EnsureConverted(source, importOptions, treeFrames[i], error))
+		{
+			MessageBox(nullptr, error.c_str(), 0, 0);
+			return false;
+		}
+	}
+
+	if (!FlipbookPacker::EnsurePacked(treeFrames, texturePath[3], error))
+	{
+		MessageBox(nullptr, error.c_str(), 0, 0);
+		return false;
+	}
+
 	mTextureSrvs.resize(texturePath.size());
 
 	for (int i = 0; i < (int)texturePath.size(); ++i)
@@ -275,6 +313,8 @@ void WavesApp::LoadTextures()
 		HR(CreateDDSTextureFromFile(md3dDevice.Get(), texturePath[i].c_str(),
 			nullptr, mTextureSrvs[i].GetAddressOf()));
 	}
+
+	return true;
 }
 
 void WavesApp::BuildSamplerStates()
@@ -359,18 +399,20 @@ void WavesApp::BuildHillBuffers()
 {
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData grid;
-	geoGen.CreateGrid(160.0f, 160.0f, 50, 50, grid);
+	const UINT rowCount = 50;
+	const UINT columnCount = 50;
+	geoGen.CreateGrid(160.0f, 160.0f, rowCount, columnCount, grid);
 
 	std::vector<Vertex> vertices(grid.Vertices.size());
 	for (UINT i = 0; i < (UINT)vertices.size(); ++i)
 	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Position = p;
-		vertices[i].Position.y = GetHillsHeight(p.x, p.z);
-		vertices[i].Normal = GetHillsNormal(p.x, p.z);
+		vertices[i].Position = grid.Vertices[i].Position;
 		vertices[i].TexC = grid.Vertices[i].TexC;
 	}
 
+	// ߶Ⱥͷ.
+	Heightfield::Evaluate(Heightfield::Hills(), vertices.data(), sizeof(Vertex), offsetof(Vertex, Normal), rowCount, columnCount);
+
 	std::vector<UINT> indices = grid.Indices;
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
@@ -427,6 +469,8 @@ void WavesApp::BuildHillBuffers()
 	geo->VertexBuffer = mVertexBuffers["hill"].Get();
 	geo->IndexBuffer = mIndexBuffers["hill"].Get();
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -502,6 +546,12 @@ void WavesApp::BuildWavesBuffers()
 	geo->VertexBuffer = mVertexBuffers["waves"].Get();
 	geo->IndexBuffer = mIndexBuffers["waves"].Get();
 
+	// ˶ÿ֡CPUϸ, ﰴʼƽ, ֱΪ.
+	d3dUtil::ComputeSubmeshBounds(*geo, &mWaves->Position(0), sizeof(XMFLOAT3), indices.data());
+	auto& wavesArgs = geo->DrawArgs["waves"];
+	wavesArgs.Bounds.Extents.y += WavesHeightSlack;
+	wavesArgs.Sphere.Radius += WavesHeightSlack;
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -575,6 +625,8 @@ void WavesApp::BuildBoxBuffers()
 	geo->VertexBuffer = mVertexBuffers["box"].Get();
 	geo->IndexBuffer = mIndexBuffers["box"].Get();
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -582,15 +634,20 @@ void WavesApp::BuildTreeSpritesBuffers()
 {
 	const UINT treeCount = 16;
 
+	// ̶, ÿλͬ.
+	RandomStream rng;
+	float xz[2 * treeCount];
+	rng.FillFloats(xz, 2 * treeCount, -45.0f, 45.0f);
+
 	std::array<TreeSpriteVertex, treeCount> vertices;
 	for (int i = 0; i < treeCount; ++i)
 	{
-		float x = MathHelper::RandF(-45.0f, 45.0f);
-		float z = MathHelper::RandF(-45.0f, 45.0f);
+		float x = xz[2 * i + 0];
+		float z = xz[2 * i + 1];
 		float y = GetHillsHeight(x, z) + 8.0f;
 
 		vertices[i].Position = { x, y, z };
-		vertices[i].Size = { 20.0f, 20.0f };
+		vertices[i].Size = { TreeSpriteWidth, TreeSpriteHeight };
 	}
 
 	std::array<UINT, treeCount> indices =
@@ -655,6 +712,16 @@ void WavesApp::BuildTreeSpritesBuffers()
 	geo->VertexBuffer = mVertexBuffers["treeSprite"].Get();
 	geo->IndexBuffer = mIndexBuffers["treeSprite"].Get();
 
+	// ڼɫչΪı, Χ尴ߴһ.
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(TreeSpriteVertex), indices.data());
+	auto& treeArgs = geo->DrawArgs["treeSprite"];
+	const float halfWidth = 0.5f * TreeSpriteWidth;
+	const float halfHeight = 0.5f * TreeSpriteHeight;
+	treeArgs.Bounds.Extents.x += halfWidth;
+	treeArgs.Bounds.Extents.y += halfHeight;
+	treeArgs.Bounds.Extents.z += halfWidth;
+	treeArgs.Sphere.Radius += sqrtf(halfWidth * halfWidth + halfHeight * halfHeight);
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -1012,16 +1079,3 @@ float WavesApp::GetHillsHeight(float x, float z) const
 {
 	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
 }
-
-XMFLOAT3 WavesApp::GetHillsNormal(float x, float z) const
-{
-	XMFLOAT3 n(
-		-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
-		1.0f,
-		-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
-
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
-
-	return n;
-}
@@ -4,6 +4,10 @@
 #include "..\..\Common\d3dUtil.h"
 #include "..\..\Common\GeometryGenerator.h"
 #include "..\..\Common\MathHelper.h"
+#include "..\..\Common\Random.h"
+#include "..\..\Common\Heightfield.h"
+#include "..\..\Common\ImageImporter.h"
+#include "..\..\Common\FlipbookPacker.h"
 #include "Waves.h"
 #include "FrameResources.h"
 
@@ -92,7 +96,7 @@ public:
 
 private:
 	/// Դ.
-	void LoadTextures();
+	bool LoadTextures();
 
 	/// .
 	void BuildSamplerStates();
@@ -123,9 +127,6 @@ private:
 	/// ɽ߶.
 	float GetHillsHeight(float x, float z) const;
 
-	/// ɽĳķ.
-	XMFLOAT3 GetHillsNormal(float x, float z) const;
-
 private:
 	// Դͼ.
 	std::vector<ComPtr<ID3D11ShaderResourceView>> mTextureSrvs;
@@ -151,6 +152,9 @@ private:
 	// .
 	std::unique_ptr<Waves> mWaves = nullptr;
 
+	// Ŷõ.
+	RandomStream mRandom;
+
 	// Ϣ.
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeos;
 
@@ -324,6 +324,8 @@ void CylinderApp::BuildCircleBuffers()
 	HR(md3dDevice->CreateBuffer(&ibd, &iInitData, mIndexBuffers["circle"].GetAddressOf()));
 
 	geo->DrawArgs["circle"] = submesh;
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
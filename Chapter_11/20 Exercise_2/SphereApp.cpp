@@ -242,6 +242,8 @@ void SphereApp::BuildSphereBuffers()
 	HR(md3dDevice->CreateBuffer(&ibd, &iInitData, mIndexBuffers["sphere"].GetAddressOf()));
 
 	geo->DrawArgs["sphere"] = submesh;
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
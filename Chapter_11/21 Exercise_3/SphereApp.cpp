@@ -181,6 +181,10 @@ void SphereApp::BuildSphereBuffers()
 	GeometryGenerator::MeshData sphere;
 	geoGen.CreateGeosphere(5.0f, 3, sphere);
 
+	// ϸֺÿζԼĶ, Ӻ󶥵1920642.
+	MeshWeldStats weldStats;
+	MeshWelder::Weld(sphere, MeshWeldOptions(), weldStats);
+
 	std::vector<Vertex> vertices(sphere.Vertices.size());
 	for (UINT i = 0; i < sphere.Vertices.size(); ++i)
 	{
@@ -242,6 +246,8 @@ void SphereApp::BuildSphereBuffers()
 	HR(md3dDevice->CreateBuffer(&ibd, &iInitData, mIndexBuffers["sphere"].GetAddressOf()));
 
 	geo->DrawArgs["sphere"] = submesh;
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
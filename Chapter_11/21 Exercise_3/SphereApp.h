@@ -4,6 +4,7 @@
 #include "..\..\Common\d3dUtil.h"
 #include "..\..\Common\GeometryGenerator.h"
 #include "..\..\Common\MathHelper.h"
+#include "..\..\Common\MeshWeld.h"
 #include "FrameResources.h"
 
 using Microsoft::WRL::ComPtr;
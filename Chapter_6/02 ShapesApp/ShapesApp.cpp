@@ -1,5 +1,17 @@
 #include "ShapesApp.h"
 
+namespace
+{
+	// 벼, ɫ벼ֺ񻺴湲.
+	const D3D11_INPUT_ELEMENT_DESC gVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
+		D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12,
+		D3D11_INPUT_PER_VERTEX_DATA, 0},
+	};
+}
+
 ShapesApp::ShapesApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
 	mMainWndCaption = L"Shapes App";
@@ -243,43 +255,31 @@ void ShapesApp::BuildShapesBuffers()
 	geo->DrawArgs["sphere"] = sphereSubmesh;
 	geo->DrawArgs["cylinder"] = cylinderSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
 void ShapesApp::BuildSkullBuffers()
 {
-	std::fstream fin(L"Models/skull.txt");
-	if (!fin)
+	MeshCacheFile mesh;
+	std::wstring error;
+	if (!MeshCache::LoadTextModel(L"../../Models/skull.mshz", gVertexDesc, ARRAYSIZE(gVertexDesc), sizeof(Vertex),
+		[](void* data, UINT vertexCount)
+		{
+			Vertex* vertices = static_cast<Vertex*>(data);
+			for (UINT i = 0; i < vertexCount; ++i)
+				vertices[i].Color = XMFLOAT4(Colors::Red);
+		},
+		"red-color-1",
+		mesh, error))
 	{
-		MessageBox(nullptr, L"Models/skull.txtڣ", 0, 0);
+		MessageBox(nullptr, error.c_str(), 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	std::vector<Vertex> vertices(vcount);
-	for (UINT i = 0; i < vcount; ++i)
-	{
-		fin >> vertices[i].Position.x >> vertices[i].Position.y >> vertices[i].Position.z;
-		fin >> ignore >> ignore >> ignore;
-		vertices[i].Color = XMFLOAT4(Colors::Red);
-	}
-	fin >> ignore >> ignore >> ignore;
-
-	std::vector<UINT> indices(3 * tcount);
-	for (UINT i = 0; i < tcount; ++i)
-	{
-		fin >> indices[3 * i + 0] >> indices[3 * i + 1] >> indices[3 * i + 2];
-	}
-	fin.close();
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(UINT);
+	const UINT vbByteSize = mesh.VertexCount() * sizeof(Vertex);
+	const UINT ibByteSize = mesh.IndexCount() * sizeof(UINT);
 
 	///
 	/// 㻺.
@@ -293,7 +293,7 @@ void ShapesApp::BuildSkullBuffers()
 	vbd.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA vInitData;
-	vInitData.pSysMem = vertices.data();
+	vInitData.pSysMem = mesh.Vertices();
 	vInitData.SysMemPitch = 0;
 	vInitData.SysMemSlicePitch = 0;
 	HR(md3dDevice->CreateBuffer(&vbd, &vInitData, mVertexBuffers["skull"].GetAddressOf()));
@@ -310,7 +310,7 @@ void ShapesApp::BuildSkullBuffers()
 	ibd.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA iInitData;
-	iInitData.pSysMem = indices.data();
+	iInitData.pSysMem = mesh.Indices();
 	iInitData.SysMemPitch = 0;
 	iInitData.SysMemSlicePitch = 0;
 	HR(md3dDevice->CreateBuffer(&ibd, &iInitData, mIndexBuffers["skull"].GetAddressOf()));
@@ -321,10 +321,12 @@ void ShapesApp::BuildSkullBuffers()
 	SubmeshGeometry skullSubmesh;
 	skullSubmesh.BaseVertexLocation = 0;
 	skullSubmesh.StartIndexLocation = 0;
-	skullSubmesh.IndexCount = (UINT)indices.size();
+	skullSubmesh.IndexCount = mesh.IndexCount();
 
 	geo->DrawArgs["skull"] = skullSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, mesh.Vertices(), sizeof(Vertex), mesh.Indices());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -351,15 +353,7 @@ void ShapesApp::BuildShadersAndInputLayout()
 	HR(md3dDevice->CreatePixelShader(pixelBlob->GetBufferPointer(), pixelBlob->GetBufferSize(),
 		nullptr, mPixelShader.GetAddressOf()));
 
-	D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
-		D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12,
-		D3D11_INPUT_PER_VERTEX_DATA, 0},
-	};
-
-	HR(md3dDevice->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc),
+	HR(md3dDevice->CreateInputLayout(gVertexDesc, ARRAYSIZE(gVertexDesc),
 		vertexBlob->GetBufferPointer(), vertexBlob->GetBufferSize(),
 		mInputLayout.GetAddressOf()));
 }
@@ -4,6 +4,8 @@
 #include "..\..\Common\d3dUtil.h"
 #include "..\..\Common\GeometryGenerator.h"
 #include "..\..\Common\MathHelper.h"
+#include "..\..\Common\Random.h"
+#include "..\..\Common\Heightfield.h"
 #include "Waves.h"
 #include "FrameResources.h"
 
@@ -96,12 +98,6 @@ private:
 	/// .
 	void DrawRenderItems(ID3D11DeviceContext* context, const std::vector<RenderItem*>& ritems);
 
-	/// ɽ߶.
-	float GetHillsHeight(float x, float z) const;
-
-	/// ɽĳķ.
-	XMFLOAT3 GetHillsNormal(float x, float z) const;
-
 private:
 	// 㻺, , .
 	std::unordered_map<std::string, ComPtr<ID3D11Buffer>> mVertexBuffers;
@@ -121,6 +117,9 @@ private:
 	// .
 	std::unique_ptr<Waves> mWaves = nullptr;
 
+	// Ŷõ.
+	RandomStream mRandom;
+
 	// Ϣ.
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeos;
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "..\..\Common\d3dApp.h"
 #include "..\..\Common\GeometryGenerator.h"
+#include "..\..\Common\MeshCache.h"
 #include "FrameResources.h"
 
 using namespace DirectX;
@@ -315,6 +315,8 @@ void CrateApp::BuildShapesBuffers()
 
 	geo->DrawArgs["box"] = boxSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -1,5 +1,15 @@
 #include "WavesApp.h"
 
+namespace
+{
+	// ÿŶķȷΧ.
+	const float MinDisturbMagnitude = 0.2f;
+	const float MaxDisturbMagnitude = 0.5f;
+
+	// ڵļŶӶ, ΧֱŶȵ4.
+	const float WavesHeightSlack = 4.0f * MaxDisturbMagnitude;
+}
+
 WavesApp::WavesApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
 }
@@ -15,7 +25,9 @@ bool WavesApp::Init()
 
 	mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
 
-	LoadTextures();
+	if (!LoadTextures())
+		return false;
+
 	BuildSamplerStates();
 	BuildHillBuffers();
 	BuildWavesBuffers();
@@ -42,6 +54,7 @@ void WavesApp::UpdateScene(GameTimer gt)
 	UpdateCamera(gt);
 	UpdatePassCB(gt);
 	UpdateWaves(gt);
+	UpdateTextureStreaming(gt);
 }
 
 void WavesApp::DrawScene()
@@ -172,9 +185,9 @@ void WavesApp::UpdateWaves(GameTimer gt)
 	{
 		t_base += 0.25f;
 
-		int i = MathHelper::Rand(4, mWaves->RowCount() - 5);
-		int j = MathHelper::Rand(4, mWaves->ColumnCount() - 5);
-		float r = MathHelper::RandF(0.2f, 0.5f);
+		int i = mRandom.NextInt(4, mWaves->RowCount() - 5);
+		int j = mRandom.NextInt(4, mWaves->ColumnCount() - 5);
+		float r = mRandom.NextFloat(MinDisturbMagnitude, MaxDisturbMagnitude);
 
 		mWaves->Disturb(i, j, r);
 	}
@@ -219,7 +232,40 @@ void WavesApp::AnimateMaterials(GameTimer gt)
 	mWaveRitem->Mat = waterMat;
 }
 
-void WavesApp::LoadTextures()
+void WavesApp::UpdateTextureStreaming(GameTimer gt)
+{
+	XMMATRIX view = XMLoadFloat4x4(&mView);
+	XMMATRIX invView = XMMatrixInverse(&XMMatrixDeterminant(view), view);
+	XMVECTOR eyePos = invView.r[3];
+
+	for (auto& ri : mAllRitems)
+	{
+		int texture = mTextureHandles[ri->Mat->DiffuseSrvHeapIndex];
+		const auto& info = mTextureStreamer.Info(texture);
+
+		// ŸıUVܶ.
+		const XMFLOAT4X4& T = ri->TexTransform;
+		float texScale = fabsf(T(0, 0) * T(1, 1) - T(0, 1) * T(1, 0));
+
+		// Χеľ, ڰΧʱȡƽľ.
+		BoundingBox bounds;
+		ri->Submesh->Bounds.Transform(bounds, XMLoadFloat4x4(&ri->World));
+		XMVECTOR center = XMLoadFloat3(&bounds.Center);
+		XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+		XMVECTOR outside = XMVectorMax(XMVectorAbs(eyePos - center) - extents, XMVectorZero());
+		float distance = MathHelper::Max(XMVectorGetX(XMVector3Length(outside)), 1.0f);
+
+		// þһ絥λĻϵ.
+		float pixelsPerUnit = mProj(1, 1) * mClientHeight / (2.0f * distance);
+
+		float mip = TextureStreamer::ComputeRequiredMip(info.Width, info.Height, ri->UVDensity * texScale, pixelsPerUnit);
+		mTextureStreamer.RequestMip(texture, mip);
+	}
+
+	mTextureStreamer.Update(md3dImmediateContext.Get());
+}
+
+bool WavesApp::LoadTextures()
 {
 	std::vector<std::wstring> texturePath =
 	{
@@ -227,13 +273,23 @@ void WavesApp::LoadTextures()
 		L"../../Textures/water1.dds"
 	};
 
-	mTextureSrvs.resize(texturePath.size());
+	// ʱֻϴСmip, Ͼϸmipݾʽ.
+	mTextureStreamer.Initialize(md3dDevice.Get(), 16 * 1024 * 1024);
+
+	mTextureHandles.assign(texturePath.size(), -1);
 
-	for (int i = 0; i < (int)texturePath.size(); ++i)
+	std::wstring error;
+	for (UINT i = 0; i < (UINT)texturePath.size(); ++i)
 	{
-		HR(CreateDDSTextureFromFile(md3dDevice.Get(), texturePath[i].c_str(),
-			nullptr, mTextureSrvs[i].GetAddressOf()));
+		mTextureHandles[i] = mTextureStreamer.Load(texturePath[i], error);
+		if (mTextureHandles[i] < 0)
+		{
+			MessageBox(nullptr, error.c_str(), 0, 0);
+			return false;
+		}
 	}
+
+	return true;
 }
 
 void WavesApp::BuildSamplerStates()
@@ -315,20 +371,25 @@ void WavesApp::BuildHillBuffers()
 {
 	GeometryGenerator geoGen;
 	GeometryGenerator::MeshData grid;
-	geoGen.CreateGrid(160.0f, 160.0f, 50, 50, grid);
+	const UINT rowCount = 50;
+	const UINT columnCount = 50;
+	geoGen.CreateGrid(160.0f, 160.0f, rowCount, columnCount, grid);
 
 	std::vector<Vertex> vertices(grid.Vertices.size());
 	for (UINT i = 0; i < (UINT)vertices.size(); ++i)
 	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Position = p;
-		vertices[i].Position.y = GetHillsHeight(p.x, p.z);
-		vertices[i].Normal = GetHillsNormal(p.x, p.z);
+		vertices[i].Position = grid.Vertices[i].Position;
 		vertices[i].TexC = grid.Vertices[i].TexC;
 	}
 
+	// ߶Ⱥͷ.
+	Heightfield::Evaluate(Heightfield::Hills(), vertices.data(), sizeof(Vertex), offsetof(Vertex, Normal), rowCount, columnCount);
+
 	std::vector<UINT> indices = grid.Indices;
 
+	mHillUVDensity = TextureStreamer::MeasureUVDensity(&vertices[0].Position, sizeof(Vertex),
+		&vertices[0].TexC, sizeof(Vertex), indices.data(), (UINT)indices.size());
+
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 	const UINT ibByteSize = (UINT)indices.size() * sizeof(UINT);
 
@@ -383,6 +444,8 @@ void WavesApp::BuildHillBuffers()
 	geo->VertexBuffer = mVertexBuffers["hill"].Get();
 	geo->IndexBuffer = mIndexBuffers["hill"].Get();
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -458,6 +521,12 @@ void WavesApp::BuildWavesBuffers()
 	geo->VertexBuffer = mVertexBuffers["waves"].Get();
 	geo->IndexBuffer = mIndexBuffers["waves"].Get();
 
+	// ˶ÿ֡CPUϸ, ﰴʼƽ, ֱΪ.
+	d3dUtil::ComputeSubmeshBounds(*geo, &mWaves->Position(0), sizeof(XMFLOAT3), indices.data());
+	auto& wavesArgs = geo->DrawArgs["waves"];
+	wavesArgs.Bounds.Extents.y += WavesHeightSlack;
+	wavesArgs.Sphere.Radius += WavesHeightSlack;
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -573,6 +642,8 @@ void WavesApp::BuildRenderItems()
 	wavesRitem->BaseVertexLocation = wavesRitem->Geo->DrawArgs["waves"].BaseVertexLocation;
 	wavesRitem->VertexBuffer = wavesRitem->Geo->VertexBuffer.Get();
 	wavesRitem->IndexBuffer = wavesRitem->Geo->IndexBuffer.Get();
+	wavesRitem->Submesh = &wavesRitem->Geo->DrawArgs["waves"];
+	wavesRitem->UVDensity = 1.0f / (mWaves->Width() * mWaves->Depth());
 	mWaveRitem = wavesRitem.get();
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(wavesRitem.get());
 
@@ -588,6 +659,8 @@ void WavesApp::BuildRenderItems()
 	hillRitem->BaseVertexLocation = hillRitem->Geo->DrawArgs["hill"].BaseVertexLocation;
 	hillRitem->VertexBuffer = hillRitem->Geo->VertexBuffer.Get();
 	hillRitem->IndexBuffer = hillRitem->Geo->IndexBuffer.Get();
+	hillRitem->Submesh = &hillRitem->Geo->DrawArgs["hill"];
+	hillRitem->UVDensity = mHillUVDensity;
 	mRitemLayer[(int)RenderLayer::Opaque].push_back(hillRitem.get());
 
 	mAllRitems.push_back(std::move(wavesRitem));
@@ -633,27 +706,10 @@ void WavesApp::DrawRenderItems(ID3D11DeviceContext* context, const std::vector<R
 		context->PSSetConstantBuffers(1, 1, mConstantBuffers["material"].GetAddressOf());
 
 		// ͼ.
-		context->PSSetShaderResources(0, 1, mTextureSrvs[ri->Mat->DiffuseSrvHeapIndex].GetAddressOf());
+		ID3D11ShaderResourceView* srv = mTextureStreamer.GetSrv(mTextureHandles[ri->Mat->DiffuseSrvHeapIndex]);
+		context->PSSetShaderResources(0, 1, &srv);
 
 		context->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation,
 			ri->BaseVertexLocation, 0);
 	}
 }
-
-float WavesApp::GetHillsHeight(float x, float z) const
-{
-	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
-}
-
-XMFLOAT3 WavesApp::GetHillsNormal(float x, float z) const
-{
-	XMFLOAT3 n(
-		-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
-		1.0f,
-		-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
-
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
-
-	return n;
-}
@@ -4,6 +4,10 @@
 #include "..\..\Common\d3dUtil.h"
 #include "..\..\Common\GeometryGenerator.h"
 #include "..\..\Common\MathHelper.h"
+#include "..\..\Common\Random.h"
+#include "..\..\Common\Heightfield.h"
+#include "..\..\Common\TextureStreamer.h"
+#include <DirectXCollision.h>
 #include "Waves.h"
 #include "FrameResources.h"
 
@@ -42,6 +46,10 @@ struct RenderItem
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
 	UINT BaseVertexLocation = 0;
+
+	// ʹõ(ģͿռΧ)UVܶ(λӦUV), ڼҪmip.
+	const SubmeshGeometry* Submesh = nullptr;
+	float UVDensity = 0.0f;
 };
 
 /// Ⱦֲ, ʹø.
@@ -81,9 +89,12 @@ public:
 	/// ˶.
 	void AnimateMaterials(GameTimer gt);
 
+	/// Ⱦľmip.
+	void UpdateTextureStreaming(GameTimer gt);
+
 private:
 	/// Դ.
-	void LoadTextures();
+	bool LoadTextures();
 
 	/// .
 	void BuildSamplerStates();
@@ -108,15 +119,10 @@ private:
 	/// .
 	void DrawRenderItems(ID3D11DeviceContext* context, const std::vector<RenderItem*>& ritems);
 
-	/// ɽ߶.
-	float GetHillsHeight(float x, float z) const;
-
-	/// ɽĳķ.
-	XMFLOAT3 GetHillsNormal(float x, float z) const;
-
 private:
-	// Դͼ.
-	std::vector<ComPtr<ID3D11ShaderResourceView>> mTextureSrvs;
+	// (ʽ), ʵDiffuseSrvHeapIndexmTextureHandles±.
+	TextureStreamer mTextureStreamer;
+	std::vector<int> mTextureHandles;
 	std::vector<ComPtr<ID3D11SamplerState>> mSamplers;
 
 	// 㻺, , .
@@ -137,6 +143,9 @@ private:
 	// .
 	std::unique_ptr<Waves> mWaves = nullptr;
 
+	// Ŷõ.
+	RandomStream mRandom;
+
 	// Ϣ.
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeos;
 
@@ -148,6 +157,9 @@ private:
 	std::vector<RenderItem*> mRitemLayer[(int)RenderLayer::Count];
 	RenderItem* mWaveRitem = nullptr;
 
+	// ɽUVܶ.
+	float mHillUVDensity = 0.0f;
+
 	// Ⱦ״̬.
 	std::unordered_map<std::string, ComPtr<ID3D11RasterizerState>> mRasterizerStates;
 
@@ -38,6 +38,7 @@ void CrateApp::UpdateScene(GameTimer gt)
 {
 	UpdateCamera(gt);
 	UpdatePassCB(gt);
+	UpdateFlipbook(gt);
 }
 
 void CrateApp::DrawScene()
@@ -63,10 +64,8 @@ void CrateApp::DrawScene()
 	// ò.
 	md3dImmediateContext->PSSetSamplers(0, mSamplers.size(), mSamplers.data()->GetAddressOf());
 
-	// ֡60֡, ÿһ֡һλ.
-	static int index = 0;
-	md3dImmediateContext->PSSetShaderResources(0, 1, mTextureSrvs[index].GetAddressOf());
-	index = (index + 1) % mTextureSrvs.size();
+	// ֡ͬһ, ǰ֡峣е±ѡ.
+	md3dImmediateContext->PSSetShaderResources(0, 1, mFireArraySrv.GetAddressOf());
 
 	md3dImmediateContext->RSSetState(nullptr);
 
@@ -169,23 +168,30 @@ void CrateApp::UpdatePassCB(GameTimer gt)
 		sizeof(PassConstants), mConstantBuffers["pass"].Get());
 }
 
+void CrateApp::UpdateFlipbook(GameTimer gt)
+{
+	// ÿ60֡.
+	const float framesPerSecond = 60.0f;
+	UINT frame = (UINT)(gt.TotalTime() * framesPerSecond) % mFireFrameCount;
+
+	for (auto& ri : mAllRitems)
+		ri->TexArrayIndex = frame;
+}
+
 void CrateApp::LoadTextures()
 {
-	mTextureSrvs.resize(120);
+	// ״ʱ120֡һ, ֻ֮һļ.
+	auto frames = FlipbookPacker::FramePaths(L"Textures/Fire", 1, 120, 3, L".DDS");
+	const std::wstring arrayPath = L"Textures/FireArray.dds";
 
-	for (int i = 0; i < (int)mTextureSrvs.capacity(); ++i)
-	{
-		std::wstring texPath;
-		if (i < 9)
-			texPath = L"Textures/Fire00" + std::to_wstring(i + 1) + L".DDS";
-		else if (i < 99)
-			texPath = L"Textures/Fire0" + std::to_wstring(i + 1) + L".DDS";
-		else
-			texPath = L"Textures/Fire" + std::to_wstring(i + 1) + L".DDS";
-
-		HR(CreateDDSTextureFromFile(md3dDevice.Get(), texPath.c_str(),
-			nullptr, mTextureSrvs[i].GetAddressOf()));
-	}
+	std::wstring error;
+	if (!FlipbookPacker::EnsurePacked(frames, arrayPath, error))
+		MessageBox(nullptr, error.c_str(), 0, 0);
+
+	mFireFrameCount = (UINT)frames.size();
+
+	HR(CreateDDSTextureFromFile(md3dDevice.Get(), arrayPath.c_str(),
+		nullptr, mFireArraySrv.GetAddressOf()));
 }
 
 void CrateApp::BuildSamplerStates()
@@ -336,6 +342,8 @@ void CrateApp::BuildShapesBuffers()
 
 	geo->DrawArgs["box"] = boxSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -461,6 +469,7 @@ void CrateApp::DrawRenderItems(ID3D11DeviceContext* context, const std::vector<R
 		ObjectConstants objConstants;
 		XMStoreFloat4x4(&objConstants.World, XMMatrixTranspose(world));
 		XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+		objConstants.TexArrayIndex = ri->TexArrayIndex;
 
 		d3dUtil::CopyDataToGpu(context, &objConstants,
 			sizeof(ObjectConstants), mConstantBuffers["object"].Get());
@@ -1,6 +1,7 @@
 #pragma once
 #include "..\..\Common\d3dApp.h"
 #include "..\..\Common\GeometryGenerator.h"
+#include "..\..\Common\FlipbookPacker.h"
 #include "FrameResources.h"
 
 using namespace DirectX;
@@ -23,6 +24,9 @@ struct RenderItem
 	// , ˶.
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 
+	// ʹõԪ, 涯ĵǰ֡.
+	UINT TexArrayIndex = 0;
+
 	// һ.
 	MeshGeometry* Geo = nullptr;
 
@@ -61,6 +65,9 @@ public:
 	void UpdateCamera(GameTimer gt);
 	void UpdatePassCB(GameTimer gt);
 
+	/// ʱƽ涯֡.
+	void UpdateFlipbook(GameTimer gt);
+
 private:
 	/// Դ.
 	void LoadTextures();
@@ -88,8 +95,9 @@ private:
 	void DrawRenderItems(ID3D11DeviceContext* context, const std::vector<RenderItem*>& ritems);
 
 private:
-	// Դͼ.
-	std::vector<ComPtr<ID3D11ShaderResourceView>> mTextureSrvs;
+	// 涯֡һ, ֻһͼ.
+	ComPtr<ID3D11ShaderResourceView> mFireArraySrv;
+	UINT mFireFrameCount = 0;
 	std::vector<ComPtr<ID3D11SamplerState>> mSamplers;
 
 	// 㻺, , .
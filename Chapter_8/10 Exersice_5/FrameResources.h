@@ -18,6 +18,10 @@ struct ObjectConstants
 {
 	XMFLOAT4X4 World = MathHelper::Identity4x4();
 	XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+
+	// ±.
+	UINT TexArrayIndex = 0;
+	XMFLOAT3 ObjectPad = { 0.0f, 0.0f, 0.0f };
 };
 
 /// ̳.
@@ -22,6 +22,8 @@ cbuffer ObjectConstants : register(b0)
 {
 	float4x4 gWorld;
 	float4x4 gTexTransform;
+	uint gTexArrayIndex;
+	float3 cbObjPad0;
 };
 
 /// MaterialCB的常量缓冲区结构体.
@@ -57,8 +59,8 @@ cbuffer PassConstants : register(b2)
 	Light gLights[MaxLights];
 };
 
-/// 主纹理.
-Texture2D gDiffuseMap : register(t0);
+/// 主纹理, 火焰动画的所有帧.
+Texture2DArray gDiffuseMap : register(t0);
 
 /// 采样器.
 SamplerState gsamPointWrap        : register(s0);
@@ -107,7 +109,7 @@ VertexOut VS (VertexIn vin)
 float4 PS (VertexOut pin) : SV_Target
 {
 	// 纹理采样.
-	float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, pin.TexC) * gDiffuseAlbedo;
+	float4 diffuseAlbedo = gDiffuseMap.Sample(gsamAnisotropicWrap, float3(pin.TexC, gTexArrayIndex)) * gDiffuseAlbedo;
 
 	// 获取环境光.
 	float4 ambient = gAmbientLight * diffuseAlbedo;
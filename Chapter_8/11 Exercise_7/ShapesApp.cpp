@@ -1,5 +1,19 @@
 #include "ShapesApp.h"
 
+namespace
+{
+	// 벼, ɫ벼ֺ񻺴湲.
+	const D3D11_INPUT_ELEMENT_DESC gVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
+		D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
+		D3D11_INPUT_PER_VERTEX_DATA, 0},
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24,
+		D3D11_INPUT_PER_VERTEX_DATA, 0}
+	};
+}
+
 ShapesApp::ShapesApp(HINSTANCE hInstance) : D3DApp(hInstance)
 {
 	mMainWndCaption = L"Shapes App";
@@ -14,6 +28,7 @@ bool ShapesApp::Init()
 	if (D3DApp::Init() == false)
 		return false;
 
+	// ں̨̼߳, ļɫ, һλʱŵȴ.
 	LoadTextures();
 	BuildSamplerStates();
 	BuildShapesBuffers();
@@ -175,13 +190,11 @@ void ShapesApp::LoadTextures()
 		L"../../Textures/white1x1.dds"
 	};
 
-	mTextureSrvs.resize(texPaths.size());
+	mTextureLoader.Initialize(md3dDevice.Get());
+	mTextureHandles.resize(texPaths.size());
 
 	for (int i = 0; i < (int)texPaths.size(); ++i)
-	{
-		HR(CreateDDSTextureFromFile(md3dDevice.Get(), texPaths[i].c_str(),
-			nullptr, mTextureSrvs[i].GetAddressOf()));
-	}
+		mTextureHandles[i] = mTextureLoader.Enqueue(texPaths[i]);
 }
 
 void ShapesApp::BuildSamplerStates()
@@ -393,57 +406,46 @@ void ShapesApp::BuildShapesBuffers()
 	geo->DrawArgs["sphere"] = sphereSubmesh;
 	geo->DrawArgs["cylinder"] = cylinderSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, vertices.data(), sizeof(Vertex), indices.data());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
 void ShapesApp::BuildSkullBuffers()
 {
-	std::fstream fin(L"Models/skull.txt");
-	if (!fin)
+	MeshCacheFile mesh;
+	std::wstring error;
+	if (!MeshCache::LoadTextModel(L"../../Models/skull.mshz", gVertexDesc, ARRAYSIZE(gVertexDesc), sizeof(Vertex),
+		[](void* data, UINT vertexCount)
+		{
+			Vertex* vertices = static_cast<Vertex*>(data);
+			for (UINT i = 0; i < vertexCount; ++i)
+			{
+				// ȡuv.
+				XMVECTOR pos = XMLoadFloat3(&vertices[i].Position);
+				XMFLOAT3 spherePos;
+				XMStoreFloat3(&spherePos, XMVector3Normalize(pos));
+
+				float theta = atan2f(spherePos.z, spherePos.x);
+				if (theta < 0.0f) theta += XM_2PI;
+
+				float phi = acosf(spherePos.y);
+
+				float u = theta / (2.0f * XM_PI);
+				float v = phi / XM_PI;
+
+				vertices[i].TexC = { u, v };
+			}
+		},
+		"spherical-texc-1",
+		mesh, error))
 	{
-		MessageBox(nullptr, L"Models/skull.txtڣ", 0, 0);
+		MessageBox(nullptr, error.c_str(), 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
-
-	std::vector<Vertex> vertices(vcount);
-	for (UINT i = 0; i < vcount; ++i)
-	{
-		fin >> vertices[i].Position.x >> vertices[i].Position.y >> vertices[i].Position.z;
-		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
-
-		// ȡuv.
-		XMVECTOR pos = XMLoadFloat3(&vertices[i].Position);
-		XMFLOAT3 spherePos;
-		XMStoreFloat3(&spherePos, XMVector3Normalize(pos));
-
-		float theta = atan2f(spherePos.z, spherePos.x);
-		if (theta < 0.0f) theta += XM_2PI;
-
-		float phi = acosf(spherePos.y);
-
-		float u = theta / (2.0f * XM_PI);
-		float v = phi / XM_PI;
-
-		vertices[i].TexC = { u, v };
-	}
-	fin >> ignore >> ignore >> ignore;
-
-	std::vector<UINT> indices(3 * tcount);
-	for (UINT i = 0; i < tcount; ++i)
-	{
-		fin >> indices[3 * i + 0] >> indices[3 * i + 1] >> indices[3 * i + 2];
-	}
-	fin.close();
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(UINT);
+	const UINT vbByteSize = mesh.VertexCount() * sizeof(Vertex);
+	const UINT ibByteSize = mesh.IndexCount() * sizeof(UINT);
 
 	///
 	/// 㻺.
@@ -457,7 +459,7 @@ void ShapesApp::BuildSkullBuffers()
 	vbd.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA vInitData;
-	vInitData.pSysMem = vertices.data();
+	vInitData.pSysMem = mesh.Vertices();
 	vInitData.SysMemPitch = 0;
 	vInitData.SysMemSlicePitch = 0;
 	HR(md3dDevice->CreateBuffer(&vbd, &vInitData, mVertexBuffers["skull"].GetAddressOf()));
@@ -474,7 +476,7 @@ void ShapesApp::BuildSkullBuffers()
 	ibd.MiscFlags = 0;
 
 	D3D11_SUBRESOURCE_DATA iInitData;
-	iInitData.pSysMem = indices.data();
+	iInitData.pSysMem = mesh.Indices();
 	iInitData.SysMemPitch = 0;
 	iInitData.SysMemSlicePitch = 0;
 	HR(md3dDevice->CreateBuffer(&ibd, &iInitData, mIndexBuffers["skull"].GetAddressOf()));
@@ -485,10 +487,12 @@ void ShapesApp::BuildSkullBuffers()
 	SubmeshGeometry skullSubmesh;
 	skullSubmesh.BaseVertexLocation = 0;
 	skullSubmesh.StartIndexLocation = 0;
-	skullSubmesh.IndexCount = (UINT)indices.size();
+	skullSubmesh.IndexCount = mesh.IndexCount();
 
 	geo->DrawArgs["skull"] = skullSubmesh;
 
+	d3dUtil::ComputeSubmeshBounds(*geo, mesh.Vertices(), sizeof(Vertex), mesh.Indices());
+
 	mGeos[geo->Name] = std::move(geo);
 }
 
@@ -535,17 +539,7 @@ void ShapesApp::BuildShadersAndInputLayout()
 	HR(md3dDevice->CreatePixelShader(pixelBlob->GetBufferPointer(), pixelBlob->GetBufferSize(),
 		nullptr, mPixelShader.GetAddressOf()));
 
-	D3D11_INPUT_ELEMENT_DESC vertexDesc[] =
-	{
-		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0,
-		D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12,
-		D3D11_INPUT_PER_VERTEX_DATA, 0},
-		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24,
-		D3D11_INPUT_PER_VERTEX_DATA, 0}
-	};
-
-	HR(md3dDevice->CreateInputLayout(vertexDesc, ARRAYSIZE(vertexDesc),
+	HR(md3dDevice->CreateInputLayout(gVertexDesc, ARRAYSIZE(gVertexDesc),
 		vertexBlob->GetBufferPointer(), vertexBlob->GetBufferSize(),
 		mInputLayout.GetAddressOf()));
 }
@@ -762,7 +756,8 @@ void ShapesApp::DrawRenderItems(ID3D11DeviceContext* context, const std::vector<
 		context->PSSetConstantBuffers(1, 1, mConstantBuffers["material"].GetAddressOf());
 
 		// .
-		context->PSSetShaderResources(0, 1, mTextureSrvs[ri->Mat->DiffuseSrvHeapIndex].GetAddressOf());
+		ID3D11ShaderResourceView* diffuseSrv = mTextureLoader.Get(mTextureHandles[ri->Mat->DiffuseSrvHeapIndex]);
+		context->PSSetShaderResources(0, 1, &diffuseSrv);
 
 		context->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation,
 			ri->BaseVertexLocation, 0);
@@ -1,6 +1,8 @@
 #pragma once
 #include "..\..\Common\d3dApp.h"
 #include "..\..\Common\GeometryGenerator.h"
+#include "..\..\Common\MeshCache.h"
+#include "..\..\Common\AsyncTextureLoader.h"
 #include "FrameResources.h"
 
 using namespace DirectX;
@@ -89,8 +91,9 @@ private:
 	void DrawRenderItems(ID3D11DeviceContext* context, const std::vector<RenderItem*>& ritems);
 
 private:
-	// Դͼ.
-	std::vector<ComPtr<ID3D11ShaderResourceView>> mTextureSrvs;
+	// 첽, ʵ DiffuseSrvHeapIndex  mTextureHandles.
+	AsyncTextureLoader mTextureLoader;
+	std::vector<int> mTextureHandles;
 	std::vector<ComPtr<ID3D11SamplerState>> mSamplers;
 
 	// 㻺, , .
@@ -0,0 +1,205 @@
+﻿#include "AsyncTextureLoader.h"
+#include "DDS.h"
+#include "DDSTextureLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <sstream>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+AsyncTextureLoader::~AsyncTextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mQuit = true;
+	}
+
+	mCondition.notify_all();
+	for (auto& worker : mWorkers)
+		worker.join();
+
+	// 未开始的任务: 放弃promise, 等待它们的future会得到broken_promise.
+	mJobs.clear();
+}
+
+void AsyncTextureLoader::Initialize(ID3D11Device* device, UINT threadCount)
+{
+	mDevice = device;
+	mStartTime = Clock::now();
+
+	if (!mWorkers.empty())
+		return;
+
+	if (threadCount == 0)
+		threadCount = (std::max)(2u, std::thread::hardware_concurrency());
+
+	for (UINT i = 0; i < threadCount; ++i)
+		mWorkers.emplace_back(&AsyncTextureLoader::WorkerMain, this);
+}
+
+int AsyncTextureLoader::Enqueue(const std::wstring& filename)
+{
+	Job job;
+	job.Filename = filename;
+
+	Entry entry;
+	entry.Filename = filename;
+	entry.Future = job.Promise.get_future().share();
+	mEntries.push_back(std::move(entry));
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mJobs.push_back(std::move(job));
+	}
+
+	mCondition.notify_one();
+
+	return (int)mEntries.size() - 1;
+}
+
+bool AsyncTextureLoader::IsReady(int handle) const
+{
+	const Entry& entry = mEntries[handle];
+	return entry.Resolved ||
+		entry.Future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+ID3D11ShaderResourceView* AsyncTextureLoader::Get(int handle)
+{
+	Entry& entry = mEntries[handle];
+	if (entry.Resolved)
+		return entry.Srv.Get();
+
+	Resolve(handle);
+	if (!entry.Srv)
+	{
+		std::wstring error = entry.Future.get().Error + L"\n";
+		OutputDebugStringW(error.c_str());
+	}
+
+	return entry.Srv.Get();
+}
+
+bool AsyncTextureLoader::Wait(int handle, std::wstring& error)
+{
+	Entry& entry = Resolve(handle);
+	if (entry.Srv)
+		return true;
+
+	error = entry.Future.get().Error;
+	return false;
+}
+
+bool AsyncTextureLoader::WaitAll(std::wstring& error)
+{
+	bool succeeded = true;
+	for (int i = 0; i < (int)mEntries.size(); ++i)
+	{
+		std::wstring entryError;
+		if (!Wait(i, entryError) && succeeded)
+		{
+			error = entryError;
+			succeeded = false;
+		}
+	}
+
+	return succeeded;
+}
+
+void AsyncTextureLoader::Report() const
+{
+	std::wostringstream oss;
+	oss.setf(std::ios::fixed);
+	oss.precision(2);
+
+	double sum = 0.0;
+	double slowest = 0.0;
+	double finish = 0.0;
+	UINT completed = 0;
+
+	for (int i = 0; i < (int)mEntries.size(); ++i)
+	{
+		const Entry& entry = mEntries[i];
+		if (!IsReady(i))
+		{
+			oss << L"Texture " << entry.Filename << L": pending\n";
+			continue;
+		}
+
+		const LoadResult& result = entry.Future.get();
+		oss << L"Texture " << entry.Filename << L": " << result.LoadMilliseconds << L" ms, done at "
+			<< result.FinishMilliseconds << L" ms" << (result.Srv ? L"" : L" (failed)") << L"\n";
+
+		sum += result.LoadMilliseconds;
+		slowest = (std::max)(slowest, result.LoadMilliseconds);
+		finish = (std::max)(finish, result.FinishMilliseconds);
+		++completed;
+	}
+
+	oss << L"Textures: " << completed << L"/" << mEntries.size() << L" loaded by " << mWorkers.size()
+		<< L" threads, sum " << sum << L" ms, slowest " << slowest << L" ms, all done at " << finish << L" ms\n";
+
+	OutputDebugStringW(oss.str().c_str());
+}
+
+AsyncTextureLoader::LoadResult AsyncTextureLoader::LoadTexture(const std::wstring& filename) const
+{
+	LoadResult result;
+	const Clock::time_point begin = Clock::now();
+
+	MappedFile file;
+	DDS_FILE_VIEW dds;
+	if (!file.Open(filename))
+	{
+		result.Error = filename + L"不存在！";
+	}
+	else if (!ParseDDSData(file.Data(), file.Size(), dds))
+	{
+		result.Error = filename + L": 不是有效的DDS文件.";
+	}
+	else if (FAILED(CreateDDSTextureFromMemory(mDevice.Get(), file.Data(), file.Size(),
+		nullptr, result.Srv.GetAddressOf())))
+	{
+		result.Srv.Reset();
+		result.Error = filename + L": 创建纹理失败.";
+	}
+
+	const Clock::time_point end = Clock::now();
+	result.LoadMilliseconds = std::chrono::duration<double, std::milli>(end - begin).count();
+	result.FinishMilliseconds = std::chrono::duration<double, std::milli>(end - mStartTime).count();
+
+	return result;
+}
+
+AsyncTextureLoader::Entry& AsyncTextureLoader::Resolve(int handle)
+{
+	Entry& entry = mEntries[handle];
+	if (!entry.Resolved)
+	{
+		entry.Srv = entry.Future.get().Srv;
+		entry.Resolved = true;
+	}
+
+	return entry;
+}
+
+void AsyncTextureLoader::WorkerMain()
+{
+	for (;;)
+	{
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mQuit || !mJobs.empty(); });
+
+			if (mQuit)
+				return;
+
+			job = std::move(mJobs.front());
+			mJobs.pop_front();
+		}
+
+		job.Promise.set_value(LoadTexture(job.Filename));
+	}
+}
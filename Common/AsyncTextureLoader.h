@@ -0,0 +1,111 @@
+﻿#pragma once
+
+#include <d3d11_1.h>
+#include <wrl.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+///**************************************************************
+/// 异步并行加载DDS纹理.
+/// Enqueue()只把文件名放入队列, 工作线程池并行地映射文件、校验文件头并
+/// 创建纹理和资源视图(ID3D11Device的创建函数是线程安全的), 主线程同时构建
+/// 几何体和着色器. 第一次绑定纹理时才在Get()中等待对应的future,
+/// 启动时间由最慢的一张纹理决定, 而不是所有纹理加载时间之和.
+///**************************************************************
+class AsyncTextureLoader
+{
+public:
+	AsyncTextureLoader() = default;
+	AsyncTextureLoader(const AsyncTextureLoader& rhs) = delete;
+	AsyncTextureLoader& operator=(const AsyncTextureLoader& rhs) = delete;
+	~AsyncTextureLoader();
+
+	///<summary>
+	/// 启动工作线程, threadCount为0时使用硬件线程数(至少2个, 读文件时线程大多在等待磁盘).
+	///</summary>
+	void Initialize(ID3D11Device* device, UINT threadCount = 0);
+
+	///<summary>
+	/// 把纹理加入加载队列并立即返回句柄.
+	///</summary>
+	int Enqueue(const std::wstring& filename);
+
+	// 纹理是否已经加载完成(成功或失败), 不等待.
+	bool IsReady(int handle) const;
+
+	///<summary>
+	/// 返回纹理的资源视图, 第一次调用时等待加载完成. 加载失败返回nullptr,
+	/// 错误信息只输出一次.
+	///</summary>
+	ID3D11ShaderResourceView* Get(int handle);
+
+	///<summary>
+	/// 等待一张纹理, 失败时返回false并设置error.
+	///</summary>
+	bool Wait(int handle, std::wstring& error);
+
+	///<summary>
+	/// 等待所有纹理, 有纹理加载失败时返回false, error为第一个错误.
+	///</summary>
+	bool WaitAll(std::wstring& error);
+
+	UINT Count() const { return (UINT)mEntries.size(); }
+
+	///<summary>
+	/// 输出每张纹理的加载耗时、耗时之和以及从Initialize()到最后一张完成的时间.
+	/// 只统计已经完成的纹理.
+	///</summary>
+	void Report() const;
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	struct LoadResult
+	{
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Srv;
+		std::wstring Error;
+		double LoadMilliseconds = 0.0;		// 映射、校验和创建的耗时.
+		double FinishMilliseconds = 0.0;	// 从Initialize()到完成的时间.
+	};
+
+	struct Job
+	{
+		std::wstring Filename;
+		std::promise<LoadResult> Promise;
+	};
+
+	struct Entry
+	{
+		std::wstring Filename;
+		std::shared_future<LoadResult> Future;
+		bool Resolved = false;					// 主线程已经取得结果.
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Srv;
+	};
+
+	// 在工作线程中加载一张纹理.
+	LoadResult LoadTexture(const std::wstring& filename) const;
+
+	// 等待并取得结果, 只在主线程调用.
+	Entry& Resolve(int handle);
+
+	void WorkerMain();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> mDevice;
+	Clock::time_point mStartTime;
+
+	std::vector<Entry> mEntries;
+
+	// 工作线程.
+	std::vector<std::thread> mWorkers;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::deque<Job> mJobs;
+	bool mQuit = false;
+};
@@ -0,0 +1,1089 @@
+﻿#include "BCCompressor.h"
+#include "DDS.h"
+#include "DDSWriter.h"
+#include <emmintrin.h>
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	inline bool IsBC1(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_BC1_UNORM || format == DXGI_FORMAT_BC1_UNORM_SRGB;
+	}
+
+	inline bool IsBC2(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_BC2_UNORM || format == DXGI_FORMAT_BC2_UNORM_SRGB;
+	}
+
+	inline bool IsBC3(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_BC3_UNORM || format == DXGI_FORMAT_BC3_UNORM_SRGB;
+	}
+
+	inline int Clamp255(int v)
+	{
+		return v < 0 ? 0 : (v > 255 ? 255 : v);
+	}
+
+	inline float Clamp255(float v)
+	{
+		return v < 0.0f ? 0.0f : (v > 255.0f ? 255.0f : v);
+	}
+
+	///
+	/// RGB565的量化与展开.
+	///
+
+	inline UINT Quantize565(const float rgb[3])
+	{
+		UINT r = (UINT)(Clamp255(rgb[0]) * (31.0f / 255.0f) + 0.5f);
+		UINT g = (UINT)(Clamp255(rgb[1]) * (63.0f / 255.0f) + 0.5f);
+		UINT b = (UINT)(Clamp255(rgb[2]) * (31.0f / 255.0f) + 0.5f);
+		return (r << 11) | (g << 5) | b;
+	}
+
+	inline void Expand565(UINT c, int rgb[3])
+	{
+		int r = (c >> 11) & 31;
+		int g = (c >> 5) & 63;
+		int b = c & 31;
+		rgb[0] = (r << 3) | (r >> 2);
+		rgb[1] = (g << 2) | (g >> 4);
+		rgb[2] = (b << 3) | (b >> 2);
+	}
+
+	inline int Expand5(int v) { return (v << 3) | (v >> 2); }
+	inline int Expand6(int v) { return (v << 2) | (v >> 4); }
+
+	///<summary>
+	/// 由两个565端点生成调色板, fourColor为false时为3色模式(第4项为透明黑色).
+	///</summary>
+	void BuildPalette(UINT c0, UINT c1, bool fourColor, int palette[4][3])
+	{
+		Expand565(c0, palette[0]);
+		Expand565(c1, palette[1]);
+
+		for (int i = 0; i < 3; ++i)
+		{
+			if (fourColor)
+			{
+				palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+				palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+			}
+			else
+			{
+				palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+				palette[3][i] = 0;
+			}
+		}
+	}
+
+	///<summary>
+	/// 单色块的最优端点: 取索引2(2/3 * a + 1/3 * b)时最接近每个8位值的(a, b).
+	/// 直接量化一个颜色误差最大有4, 用插值点可以降到0或1.
+	///</summary>
+	struct SingleColorTable
+	{
+		uint8_t Match5[256][2];
+		uint8_t Match6[256][2];
+
+		SingleColorTable()
+		{
+			Build(Match5, 32, Expand5);
+			Build(Match6, 64, Expand6);
+		}
+
+		static void Build(uint8_t table[256][2], int levels, int(*expand)(int))
+		{
+			for (int v = 0; v < 256; ++v)
+			{
+				int bestErr = INT_MAX;
+				for (int a = 0; a < levels; ++a)
+				{
+					for (int b = 0; b < levels; ++b)
+					{
+						int ea = expand(a);
+						int eb = expand(b);
+						// 端点相距越远, 不同硬件插值的差异越大, 稍加惩罚.
+						int err = std::abs((2 * ea + eb) / 3 - v) * 100 + std::abs(ea - eb) * 3;
+						if (err < bestErr)
+						{
+							bestErr = err;
+							table[v][0] = (uint8_t)a;
+							table[v][1] = (uint8_t)b;
+						}
+					}
+				}
+			}
+		}
+	};
+
+	// 第一次压缩单色块时才建表, 不压缩纹理的程序不必在启动时付出建表的开销.
+	const SingleColorTable& SingleColor()
+	{
+		static const SingleColorTable table;
+		return table;
+	}
+
+	///
+	/// 颜色块(BC1, 以及BC2/BC3的颜色部分).
+	///
+
+	struct ColorBlock
+	{
+		alignas(16) float R[16];
+		alignas(16) float G[16];
+		alignas(16) float B[16];
+		UINT TransparentMask;		// alpha < 128的像素, 只在BC1中使用.
+		UINT OpaqueCount;
+	};
+
+	///<summary>
+	/// 为每个像素选择调色板中最近的颜色(SSE2, 一次4个像素), 返回平方误差之和.
+	/// paletteSize为3时透明像素固定使用索引3.
+	///</summary>
+	float SelectColorIndices(const ColorBlock& block, const int palette[4][3], int paletteSize, UINT& indices)
+	{
+		alignas(16) int idx[16];
+		alignas(16) float err[16];
+
+		for (int j = 0; j < 16; j += 4)
+		{
+			__m128 r = _mm_load_ps(block.R + j);
+			__m128 g = _mm_load_ps(block.G + j);
+			__m128 b = _mm_load_ps(block.B + j);
+
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128i bestIdx = _mm_setzero_si128();
+
+			for (int k = 0; k < paletteSize; ++k)
+			{
+				__m128 dr = _mm_sub_ps(r, _mm_set1_ps((float)palette[k][0]));
+				__m128 dg = _mm_sub_ps(g, _mm_set1_ps((float)palette[k][1]));
+				__m128 db = _mm_sub_ps(b, _mm_set1_ps((float)palette[k][2]));
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+				best = _mm_min_ps(d, best);
+				bestIdx = _mm_or_si128(_mm_andnot_si128(closer, bestIdx), _mm_and_si128(closer, _mm_set1_epi32(k)));
+			}
+
+			_mm_store_si128((__m128i*)(idx + j), bestIdx);
+			_mm_store_ps(err + j, best);
+		}
+
+		float total = 0.0f;
+		indices = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (paletteSize == 3 && (block.TransparentMask & (1u << i)))
+			{
+				indices |= 3u << (2 * i);
+				continue;
+			}
+
+			indices |= (UINT)idx[i] << (2 * i);
+			total += err[i];
+		}
+
+		return total;
+	}
+
+	struct ColorCandidate
+	{
+		UINT C0 = 0;
+		UINT C1 = 0;
+		UINT Indices = 0;
+		float Error = FLT_MAX;
+	};
+
+	///<summary>
+	/// 量化浮点端点并选择索引. fourColor时保证C0 > C1, 否则保证C0 <= C1.
+	///</summary>
+	ColorCandidate EvaluateEndpoints(const ColorBlock& block, const float e0[3], const float e1[3], bool fourColor)
+	{
+		UINT c0 = Quantize565(e0);
+		UINT c1 = Quantize565(e1);
+
+		if (fourColor)
+		{
+			if (c0 < c1)
+				std::swap(c0, c1);
+			else if (c0 == c1)
+			{
+				// 相等时会被解释为3色模式, 稍微拉开一点.
+				if (c1 > 0)
+					--c1;
+				else
+					++c0;
+			}
+		}
+		else if (c0 > c1)
+		{
+			std::swap(c0, c1);
+		}
+
+		int palette[4][3];
+		BuildPalette(c0, c1, fourColor, palette);
+
+		ColorCandidate result;
+		result.C0 = c0;
+		result.C1 = c1;
+		result.Error = SelectColorIndices(block, palette, fourColor ? 4 : 3, result.Indices);
+		return result;
+	}
+
+	///<summary>
+	/// 包围盒端点: 向内收缩1/16, 再根据与主通道的协方差符号选择对角线.
+	///</summary>
+	void BoundingBoxEndpoints(const ColorBlock& block, float e0[3], float e1[3])
+	{
+		const float* channels[3] = { block.R, block.G, block.B };
+
+		float mn[3] = { 255.0f, 255.0f, 255.0f };
+		float mx[3] = { 0.0f, 0.0f, 0.0f };
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (block.TransparentMask & (1u << i))
+				continue;
+
+			for (int c = 0; c < 3; ++c)
+			{
+				mn[c] = (std::min)(mn[c], channels[c][i]);
+				mx[c] = (std::max)(mx[c], channels[c][i]);
+				mean[c] += channels[c][i];
+			}
+		}
+
+		int principal = 0;
+		for (int c = 0; c < 3; ++c)
+		{
+			mean[c] /= (float)block.OpaqueCount;
+			if (mx[c] - mn[c] > mx[principal] - mn[principal])
+				principal = c;
+		}
+
+		float cov[3] = { 0.0f, 0.0f, 0.0f };
+		for (int i = 0; i < 16; ++i)
+		{
+			if (block.TransparentMask & (1u << i))
+				continue;
+
+			float dm = channels[principal][i] - mean[principal];
+			for (int c = 0; c < 3; ++c)
+				cov[c] += dm * (channels[c][i] - mean[c]);
+		}
+
+		for (int c = 0; c < 3; ++c)
+		{
+			float inset = (mx[c] - mn[c]) / 16.0f;
+			e0[c] = mx[c] - inset;
+			e1[c] = mn[c] + inset;
+
+			if (cov[c] < 0.0f)
+				std::swap(e0[c], e1[c]);
+		}
+	}
+
+	///<summary>
+	/// 主成分端点: 幂迭代求协方差矩阵的主轴, 取像素在主轴上投影的两端.
+	///</summary>
+	void PrincipalAxisEndpoints(const ColorBlock& block, float e0[3], float e1[3])
+	{
+		float mean[3] = { 0.0f, 0.0f, 0.0f };
+		float mn[3] = { 255.0f, 255.0f, 255.0f };
+		float mx[3] = { 0.0f, 0.0f, 0.0f };
+		const float* channels[3] = { block.R, block.G, block.B };
+
+		for (int i = 0; i < 16; ++i)
+		{
+			if (block.TransparentMask & (1u << i))
+				continue;
+
+			for (int c = 0; c < 3; ++c)
+			{
+				mean[c] += channels[c][i];
+				mn[c] = (std::min)(mn[c], channels[c][i]);
+				mx[c] = (std::max)(mx[c], channels[c][i]);
+			}
+		}
+
+		for (int c = 0; c < 3; ++c)
+			mean[c] /= (float)block.OpaqueCount;
+
+		// 协方差矩阵的6个独立元素: rr, rg, rb, gg, gb, bb.
+		float cov[6] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			if (block.TransparentMask & (1u << i))
+				continue;
+
+			float r = block.R[i] - mean[0];
+			float g = block.G[i] - mean[1];
+			float b = block.B[i] - mean[2];
+			cov[0] += r * r;
+			cov[1] += r * g;
+			cov[2] += r * b;
+			cov[3] += g * g;
+			cov[4] += g * b;
+			cov[5] += b * b;
+		}
+
+		float axis[3] = { mx[0] - mn[0], mx[1] - mn[1], mx[2] - mn[2] };
+		for (int it = 0; it < 8; ++it)
+		{
+			float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+			float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+			float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+
+			float len = (std::max)((std::max)(std::fabs(x), std::fabs(y)), std::fabs(z));
+			if (len < 1e-6f)
+				break;
+
+			axis[0] = x / len;
+			axis[1] = y / len;
+			axis[2] = z / len;
+		}
+
+		float len2 = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+		if (len2 < 1e-12f)
+		{
+			for (int c = 0; c < 3; ++c)
+				e0[c] = e1[c] = mean[c];
+			return;
+		}
+
+		float tmin = FLT_MAX;
+		float tmax = -FLT_MAX;
+		for (int i = 0; i < 16; ++i)
+		{
+			if (block.TransparentMask & (1u << i))
+				continue;
+
+			float t = (block.R[i] - mean[0]) * axis[0] + (block.G[i] - mean[1]) * axis[1] + (block.B[i] - mean[2]) * axis[2];
+			tmin = (std::min)(tmin, t);
+			tmax = (std::max)(tmax, t);
+		}
+
+		for (int c = 0; c < 3; ++c)
+		{
+			e0[c] = Clamp255(mean[c] + axis[c] * tmax / len2);
+			e1[c] = Clamp255(mean[c] + axis[c] * tmin / len2);
+		}
+	}
+
+	///<summary>
+	/// 固定索引后用最小二乘求使误差最小的端点.
+	///</summary>
+	bool RefineEndpoints(const ColorBlock& block, UINT indices, bool fourColor, float e0[3], float e1[3])
+	{
+		static const float FourWeights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+		static const float ThreeWeights[4] = { 1.0f, 0.0f, 0.5f, 0.0f };
+		const float* weights = fourColor ? FourWeights : ThreeWeights;
+
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[3] = {};
+		float bx[3] = {};
+
+		for (int i = 0; i < 16; ++i)
+		{
+			UINT k = (indices >> (2 * i)) & 3;
+			if (!fourColor && k == 3)
+				continue;
+
+			float a = weights[k];
+			float b = 1.0f - a;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+
+			ax[0] += a * block.R[i];
+			ax[1] += a * block.G[i];
+			ax[2] += a * block.B[i];
+			bx[0] += b * block.R[i];
+			bx[1] += b * block.G[i];
+			bx[2] += b * block.B[i];
+		}
+
+		float det = aa * bb - ab * ab;
+		if (std::fabs(det) < 1e-6f)
+			return false;
+
+		float inv = 1.0f / det;
+		for (int c = 0; c < 3; ++c)
+		{
+			e0[c] = Clamp255((bb * ax[c] - ab * bx[c]) * inv);
+			e1[c] = Clamp255((aa * bx[c] - ab * ax[c]) * inv);
+		}
+
+		return true;
+	}
+
+	inline void WriteColorBlock(const ColorCandidate& c, uint8_t* out)
+	{
+		out[0] = (uint8_t)(c.C0 & 0xff);
+		out[1] = (uint8_t)(c.C0 >> 8);
+		out[2] = (uint8_t)(c.C1 & 0xff);
+		out[3] = (uint8_t)(c.C1 >> 8);
+		out[4] = (uint8_t)(c.Indices & 0xff);
+		out[5] = (uint8_t)((c.Indices >> 8) & 0xff);
+		out[6] = (uint8_t)((c.Indices >> 16) & 0xff);
+		out[7] = (uint8_t)(c.Indices >> 24);
+	}
+
+	///<summary>
+	/// 压缩颜色块. allowTransparent为true(BC1)时alpha < 128的像素编码为透明.
+	///</summary>
+	void CompressColorBlock(const uint8_t* rgba, BCQuality quality, bool allowTransparent, uint8_t* out)
+	{
+		ColorBlock block;
+		block.TransparentMask = 0;
+		block.OpaqueCount = 0;
+
+		bool solid = true;
+		int first = -1;
+		for (int i = 0; i < 16; ++i)
+		{
+			const uint8_t* p = rgba + 4 * i;
+			block.R[i] = p[0];
+			block.G[i] = p[1];
+			block.B[i] = p[2];
+
+			if (allowTransparent && p[3] < 128)
+			{
+				block.TransparentMask |= 1u << i;
+				continue;
+			}
+
+			++block.OpaqueCount;
+			if (first < 0)
+				first = i;
+			else if (memcmp(p, rgba + 4 * first, 3) != 0)
+				solid = false;
+		}
+
+		ColorCandidate best;
+
+		if (block.OpaqueCount == 0)
+		{
+			// 全透明: 3色模式下全部使用索引3.
+			best.C0 = best.C1 = 0;
+			best.Indices = 0xffffffff;
+			WriteColorBlock(best, out);
+			return;
+		}
+
+		const bool fourColor = (block.TransparentMask == 0);
+
+		if (solid)
+		{
+			const uint8_t* p = rgba + 4 * first;
+			if (fourColor)
+			{
+				// 用查表得到的两个端点, 所有像素都取索引2.
+				const SingleColorTable& table = SingleColor();
+				best.C0 = (table.Match5[p[0]][0] << 11) | (table.Match6[p[1]][0] << 5) | table.Match5[p[2]][0];
+				best.C1 = (table.Match5[p[0]][1] << 11) | (table.Match6[p[1]][1] << 5) | table.Match5[p[2]][1];
+				best.Indices = 0xaaaaaaaa;
+
+				if (best.C0 < best.C1)
+				{
+					std::swap(best.C0, best.C1);
+					best.Indices = 0xffffffff;
+				}
+				else if (best.C0 == best.C1)
+				{
+					best.Indices = 0;
+				}
+			}
+			else
+			{
+				float c[3] = { (float)p[0], (float)p[1], (float)p[2] };
+				best = EvaluateEndpoints(block, c, c, false);
+			}
+
+			WriteColorBlock(best, out);
+			return;
+		}
+
+		float e0[3], e1[3];
+		if (quality == BCQuality::Fast)
+		{
+			BoundingBoxEndpoints(block, e0, e1);
+			best = EvaluateEndpoints(block, e0, e1, fourColor);
+		}
+		else
+		{
+			PrincipalAxisEndpoints(block, e0, e1);
+			best = EvaluateEndpoints(block, e0, e1, fourColor);
+
+			if (quality == BCQuality::High)
+			{
+				float b0[3], b1[3];
+				BoundingBoxEndpoints(block, b0, b1);
+				ColorCandidate box = EvaluateEndpoints(block, b0, b1, fourColor);
+				if (box.Error < best.Error)
+					best = box;
+
+				for (int it = 0; it < 3 && best.Error > 0.0f; ++it)
+				{
+					if (!RefineEndpoints(block, best.Indices, fourColor, e0, e1))
+						break;
+
+					ColorCandidate refined = EvaluateEndpoints(block, e0, e1, fourColor);
+					if (refined.Error >= best.Error)
+						break;
+
+					best = refined;
+				}
+			}
+		}
+
+		WriteColorBlock(best, out);
+	}
+
+	///
+	/// 单通道块(BC4, 以及BC3的alpha、BC5的两个通道).
+	///
+
+	struct AlphaCandidate
+	{
+		uint8_t A0 = 0;
+		uint8_t A1 = 0;
+		alignas(16) uint8_t Indices[16];
+		UINT Error = UINT_MAX;
+	};
+
+	void BuildAlphaPalette(int a0, int a1, uint8_t palette[8])
+	{
+		palette[0] = (uint8_t)a0;
+		palette[1] = (uint8_t)a1;
+
+		if (a0 > a1)
+		{
+			for (int i = 1; i <= 6; ++i)
+				palette[1 + i] = (uint8_t)(((7 - i) * a0 + i * a1 + 3) / 7);
+		}
+		else
+		{
+			for (int i = 1; i <= 4; ++i)
+				palette[1 + i] = (uint8_t)(((5 - i) * a0 + i * a1 + 2) / 5);
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	///<summary>
+	/// 为16个值选择调色板中最近的项(SSE2, 一次16个), a0 > a1为8值模式, 否则为6值模式.
+	///</summary>
+	void EvaluateAlpha(const uint8_t* values, int a0, int a1, AlphaCandidate& result)
+	{
+		uint8_t palette[8];
+		BuildAlphaPalette(a0, a1, palette);
+
+		__m128i v = _mm_loadu_si128((const __m128i*)values);
+		__m128i best = _mm_set1_epi8((char)0xff);
+		__m128i bestIdx = _mm_setzero_si128();
+
+		for (int k = 0; k < 8; ++k)
+		{
+			__m128i p = _mm_set1_epi8((char)palette[k]);
+			__m128i d = _mm_or_si128(_mm_subs_epu8(v, p), _mm_subs_epu8(p, v));
+
+			// d < best: min(d, best) == d 且 d != best.
+			__m128i le = _mm_cmpeq_epi8(_mm_min_epu8(d, best), d);
+			__m128i closer = _mm_andnot_si128(_mm_cmpeq_epi8(d, best), le);
+
+			best = _mm_min_epu8(d, best);
+			bestIdx = _mm_or_si128(_mm_andnot_si128(closer, bestIdx), _mm_and_si128(closer, _mm_set1_epi8((char)k)));
+		}
+
+		// 平方误差之和.
+		__m128i zero = _mm_setzero_si128();
+		__m128i lo = _mm_unpacklo_epi8(best, zero);
+		__m128i hi = _mm_unpackhi_epi8(best, zero);
+		__m128i sum = _mm_add_epi32(_mm_madd_epi16(lo, lo), _mm_madd_epi16(hi, hi));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+		sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		result.A0 = (uint8_t)a0;
+		result.A1 = (uint8_t)a1;
+		result.Error = (UINT)_mm_cvtsi128_si32(sum);
+		_mm_store_si128((__m128i*)result.Indices, bestIdx);
+	}
+
+	void WriteAlphaBlock(const AlphaCandidate& c, uint8_t* out)
+	{
+		out[0] = c.A0;
+		out[1] = c.A1;
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= (uint64_t)(c.Indices[i] & 7) << (3 * i);
+
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = (uint8_t)(bits >> (8 * i));
+	}
+
+	void CompressAlphaBlock(const uint8_t* values, BCQuality quality, uint8_t* out)
+	{
+		int mn = 255;
+		int mx = 0;
+		int innerMin = 255;
+		int innerMax = 0;
+		bool hasExtremes = false;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			int v = values[i];
+			mn = (std::min)(mn, v);
+			mx = (std::max)(mx, v);
+
+			if (v == 0 || v == 255)
+				hasExtremes = true;
+			else
+			{
+				innerMin = (std::min)(innerMin, v);
+				innerMax = (std::max)(innerMax, v);
+			}
+		}
+
+		AlphaCandidate best;
+		if (mn == mx)
+		{
+			best.A0 = best.A1 = (uint8_t)mn;
+			memset(best.Indices, 0, sizeof(best.Indices));
+			WriteAlphaBlock(best, out);
+			return;
+		}
+
+		EvaluateAlpha(values, mx, mn, best);
+
+		if (quality != BCQuality::Fast)
+		{
+			AlphaCandidate c;
+
+			// 6值模式可以精确表示0和255, 其余值只需覆盖中间的范围.
+			if (hasExtremes)
+			{
+				if (innerMin > innerMax)
+					innerMin = innerMax = 0;
+
+				EvaluateAlpha(values, innerMin, innerMax, c);
+				if (c.Error < best.Error)
+					best = c;
+			}
+
+			if (quality == BCQuality::High)
+			{
+				// 端点向内收缩的小范围搜索.
+				const int range = mx - mn;
+				const int maxInset = (std::min)(4, range / 8);
+				for (int i0 = 0; i0 <= maxInset && best.Error > 0; ++i0)
+				{
+					for (int i1 = 0; i1 <= maxInset; ++i1)
+					{
+						if (i0 == 0 && i1 == 0)
+							continue;
+
+						int a0 = mx - i0;
+						int a1 = mn + i1;
+						if (a0 <= a1)
+							continue;
+
+						EvaluateAlpha(values, a0, a1, c);
+						if (c.Error < best.Error)
+							best = c;
+					}
+				}
+			}
+		}
+
+		WriteAlphaBlock(best, out);
+	}
+
+	///
+	/// 解码.
+	///
+
+	void DecodeColorBlock(const uint8_t* block, bool forceFourColor, uint8_t* rgba)
+	{
+		UINT c0 = block[0] | (block[1] << 8);
+		UINT c1 = block[2] | (block[3] << 8);
+		UINT indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((UINT)block[7] << 24);
+
+		const bool fourColor = forceFourColor || c0 > c1;
+
+		int palette[4][3];
+		BuildPalette(c0, c1, fourColor, palette);
+
+		for (int i = 0; i < 16; ++i)
+		{
+			UINT k = (indices >> (2 * i)) & 3;
+			rgba[4 * i + 0] = (uint8_t)palette[k][0];
+			rgba[4 * i + 1] = (uint8_t)palette[k][1];
+			rgba[4 * i + 2] = (uint8_t)palette[k][2];
+			rgba[4 * i + 3] = (!fourColor && k == 3) ? 0 : 255;
+		}
+	}
+
+	// 解码单通道块, 结果写到dst[0], dst[stride], ...
+	void DecodeAlphaBlock(const uint8_t* block, uint8_t* dst, UINT stride)
+	{
+		uint8_t palette[8];
+		BuildAlphaPalette(block[0], block[1], palette);
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+			bits |= (uint64_t)block[2 + i] << (8 * i);
+
+		for (int i = 0; i < 16; ++i)
+			dst[i * stride] = palette[(bits >> (3 * i)) & 7];
+	}
+
+	///
+	/// 图像与块之间的转换.
+	///
+
+	inline UINT BlockCount(UINT size)
+	{
+		return (std::max)(1u, (size + 3) / 4);
+	}
+
+	inline UINT PitchOf(const BCSurface& s)
+	{
+		return s.RowPitch ? s.RowPitch : 4 * s.Width;
+	}
+
+	// 取出一个4x4块, 超出图像的部分复制边缘像素.
+	void LoadBlock(const BCSurface& s, UINT bx, UINT by, uint8_t* rgba)
+	{
+		const UINT pitch = PitchOf(s);
+		for (UINT y = 0; y < 4; ++y)
+		{
+			UINT sy = (std::min)(4 * by + y, s.Height - 1);
+			const uint8_t* row = s.Pixels + (size_t)sy * pitch;
+			for (UINT x = 0; x < 4; ++x)
+			{
+				UINT sx = (std::min)(4 * bx + x, s.Width - 1);
+				memcpy(rgba + 4 * (4 * y + x), row + 4 * sx, 4);
+			}
+		}
+	}
+
+	void CompressRow(const BCSurface& s, UINT by, DXGI_FORMAT format, BCQuality quality, uint8_t* out)
+	{
+		const UINT blockBytes = BCCompressor::BlockBytes(format);
+		const UINT blocksX = BlockCount(s.Width);
+
+		alignas(16) uint8_t rgba[64];
+		for (UINT bx = 0; bx < blocksX; ++bx)
+		{
+			LoadBlock(s, bx, by, rgba);
+			BCCompressor::CompressBlock(rgba, format, quality, out + (size_t)bx * blockBytes);
+		}
+	}
+}
+
+bool BCCompressor::IsSupported(DXGI_FORMAT format)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC5_UNORM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+UINT BCCompressor::BlockBytes(DXGI_FORMAT format)
+{
+	return (IsBC1(format) || format == DXGI_FORMAT_BC4_UNORM) ? 8 : 16;
+}
+
+void BCCompressor::CompressBlock(const uint8_t* rgba, DXGI_FORMAT format, BCQuality quality, uint8_t* block)
+{
+	alignas(16) uint8_t channel[16];
+
+	if (IsBC1(format))
+	{
+		CompressColorBlock(rgba, quality, true, block);
+	}
+	else if (IsBC2(format))
+	{
+		// 每个像素4位alpha, 直接量化.
+		for (int i = 0; i < 8; ++i)
+		{
+			UINT a0 = (rgba[4 * (2 * i) + 3] * 15 + 127) / 255;
+			UINT a1 = (rgba[4 * (2 * i + 1) + 3] * 15 + 127) / 255;
+			block[i] = (uint8_t)(a0 | (a1 << 4));
+		}
+		CompressColorBlock(rgba, quality, false, block + 8);
+	}
+	else if (IsBC3(format))
+	{
+		for (int i = 0; i < 16; ++i)
+			channel[i] = rgba[4 * i + 3];
+		CompressAlphaBlock(channel, quality, block);
+		CompressColorBlock(rgba, quality, false, block + 8);
+	}
+	else if (format == DXGI_FORMAT_BC4_UNORM)
+	{
+		for (int i = 0; i < 16; ++i)
+			channel[i] = rgba[4 * i];
+		CompressAlphaBlock(channel, quality, block);
+	}
+	else if (format == DXGI_FORMAT_BC5_UNORM)
+	{
+		for (int c = 0; c < 2; ++c)
+		{
+			for (int i = 0; i < 16; ++i)
+				channel[i] = rgba[4 * i + c];
+			CompressAlphaBlock(channel, quality, block + 8 * c);
+		}
+	}
+}
+
+bool BCCompressor::Compress(
+	const std::vector<BCSurface>& surfaces,
+	DXGI_FORMAT format,
+	BCQuality quality,
+	const std::vector<uint8_t*>& outputs,
+	UINT threadCount)
+{
+	if (!IsSupported(format) || surfaces.size() != outputs.size())
+		return false;
+
+	// 工作单元为一行块, 所有图像的块行放在一起分配, 小的mip不会让线程空闲.
+	struct RowTask
+	{
+		UINT Surface;
+		UINT Row;
+	};
+
+	std::vector<RowTask> tasks;
+	for (UINT s = 0; s < (UINT)surfaces.size(); ++s)
+	{
+		if (surfaces[s].Pixels == nullptr || surfaces[s].Width == 0 || surfaces[s].Height == 0 || outputs[s] == nullptr)
+			return false;
+
+		UINT rows = BlockCount(surfaces[s].Height);
+		for (UINT r = 0; r < rows; ++r)
+			tasks.push_back({ s, r });
+	}
+
+	const UINT blockBytes = BlockBytes(format);
+	std::atomic<size_t> next(0);
+
+	auto worker = [&]()
+	{
+		for (;;)
+		{
+			size_t t = next.fetch_add(1);
+			if (t >= tasks.size())
+				break;
+
+			const BCSurface& s = surfaces[tasks[t].Surface];
+			const size_t rowBytes = (size_t)BlockCount(s.Width) * blockBytes;
+			CompressRow(s, tasks[t].Row, format, quality, outputs[tasks[t].Surface] + rowBytes * tasks[t].Row);
+		}
+	};
+
+	if (threadCount == 0)
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	threadCount = (std::min)(threadCount, (UINT)tasks.size());
+
+	std::vector<std::thread> threads;
+	for (UINT i = 1; i < threadCount; ++i)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto& t : threads)
+		t.join();
+
+	return true;
+}
+
+bool BCCompressor::Compress(
+	const BCSurface& surface,
+	DXGI_FORMAT format,
+	BCQuality quality,
+	uint8_t* output,
+	UINT threadCount)
+{
+	return Compress(std::vector<BCSurface>(1, surface), format, quality, std::vector<uint8_t*>(1, output), threadCount);
+}
+
+void BCCompressor::Decompress(const uint8_t* blocks, UINT width, UINT height, DXGI_FORMAT format,
+	uint8_t* rgba, UINT rowPitch)
+{
+	if (rowPitch == 0)
+		rowPitch = 4 * width;
+
+	const UINT blockBytes = BlockBytes(format);
+	const UINT blocksX = BlockCount(width);
+	const UINT blocksY = BlockCount(height);
+
+	alignas(16) uint8_t texels[64];
+	for (UINT by = 0; by < blocksY; ++by)
+	{
+		for (UINT bx = 0; bx < blocksX; ++bx)
+		{
+			const uint8_t* block = blocks + ((size_t)by * blocksX + bx) * blockBytes;
+
+			if (IsBC1(format))
+			{
+				DecodeColorBlock(block, false, texels);
+			}
+			else if (IsBC2(format))
+			{
+				DecodeColorBlock(block + 8, true, texels);
+				for (int i = 0; i < 16; ++i)
+					texels[4 * i + 3] = (uint8_t)(((block[i / 2] >> (4 * (i & 1))) & 15) * 17);
+			}
+			else if (IsBC3(format))
+			{
+				DecodeColorBlock(block + 8, true, texels);
+				DecodeAlphaBlock(block, texels + 3, 4);
+			}
+			else
+			{
+				for (int i = 0; i < 16; ++i)
+				{
+					texels[4 * i + 1] = 0;
+					texels[4 * i + 2] = 0;
+					texels[4 * i + 3] = 255;
+				}
+
+				DecodeAlphaBlock(block, texels, 4);
+				if (format == DXGI_FORMAT_BC5_UNORM)
+					DecodeAlphaBlock(block + 8, texels + 1, 4);
+			}
+
+			for (UINT y = 0; y < 4 && 4 * by + y < height; ++y)
+			{
+				uint8_t* row = rgba + (size_t)(4 * by + y) * rowPitch;
+				for (UINT x = 0; x < 4 && 4 * bx + x < width; ++x)
+					memcpy(row + 4 * (4 * bx + x), texels + 4 * (4 * y + x), 4);
+			}
+		}
+	}
+}
+
+double BCCompressor::ComputePSNR(const BCSurface& original, const uint8_t* blocks, DXGI_FORMAT format)
+{
+	std::vector<uint8_t> decoded((size_t)original.Width * original.Height * 4);
+	Decompress(blocks, original.Width, original.Height, format, decoded.data());
+
+	UINT channels = 3;
+	if (IsBC2(format) || IsBC3(format))
+		channels = 4;
+	else if (format == DXGI_FORMAT_BC4_UNORM)
+		channels = 1;
+	else if (format == DXGI_FORMAT_BC5_UNORM)
+		channels = 2;
+
+	const UINT pitch = PitchOf(original);
+	double sum = 0.0;
+	double count = 0.0;
+	for (UINT y = 0; y < original.Height; ++y)
+	{
+		const uint8_t* a = original.Pixels + (size_t)y * pitch;
+		const uint8_t* b = decoded.data() + (size_t)y * original.Width * 4;
+		for (UINT x = 0; x < original.Width; ++x)
+		{
+			// BC1中透明像素的颜色没有意义, 只检查它是否仍然透明.
+			if (IsBC1(format) && a[4 * x + 3] < 128)
+			{
+				if (b[4 * x + 3] != 0)
+					sum += 255.0 * 255.0;
+				count += 1.0;
+				continue;
+			}
+
+			for (UINT c = 0; c < channels; ++c)
+			{
+				double d = (double)a[4 * x + c] - (double)b[4 * x + c];
+				sum += d * d;
+			}
+			count += channels;
+		}
+	}
+
+	double mse = sum / count;
+	if (mse <= 0.0)
+		return 100.0;	// 完全一致.
+
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+bool BCCompressor::SaveDDS(
+	const std::wstring& filename,
+	const std::vector<BCSurface>& mips,
+	DXGI_FORMAT format,
+	BCQuality quality,
+	std::wstring& error,
+	UINT threadCount)
+{
+	if (!IsSupported(format))
+	{
+		error = L"BCCompressor: unsupported format.";
+		return false;
+	}
+
+	if (mips.empty())
+	{
+		error = L"BCCompressor: no image.";
+		return false;
+	}
+
+	DDSImage image;
+	image.Format = format;
+	image.Width = mips[0].Width;
+	image.Height = mips[0].Height;
+	image.MipLevels = (UINT)mips.size();
+
+	std::vector<std::vector<uint8_t>> data(mips.size());
+	std::vector<uint8_t*> outputs(mips.size());
+	for (UINT i = 0; i < (UINT)mips.size(); ++i)
+	{
+		UINT w = (std::max)(image.Width >> i, 1u);
+		UINT h = (std::max)(image.Height >> i, 1u);
+		if (mips[i].Width != w || mips[i].Height != h)
+		{
+			error = L"BCCompressor: mip dimensions do not halve.";
+			return false;
+		}
+
+		data[i].resize(DDSWriter::SurfaceBytes(format, w, h));
+		outputs[i] = data[i].data();
+		image.Subresources.push_back(outputs[i]);
+	}
+
+	if (!Compress(mips, format, quality, outputs, threadCount))
+	{
+		error = L"BCCompressor: invalid input image.";
+		return false;
+	}
+
+	return DDSWriter::Save(filename, image, error);
+}
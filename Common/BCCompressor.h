@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <dxgiformat.h>
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///**************************************************************
+/// BC1/BC2/BC3/BC4/BC5块压缩. 输入为R8G8B8A8图像, 输出可直接写入DDS文件.
+///   BC1: RGB(有alpha < 128的像素时使用3色模式表示透明);
+///   BC2: BC1的颜色块 + 每像素4位的alpha;
+///   BC3: BC1的颜色块 + BC4的alpha块;
+///   BC4: 只压缩R通道;
+///   BC5: 分别压缩R、G两个通道(法线贴图).
+/// 调色板搜索用SSE2实现, 多张图像(如整个mip链)的块行在所有线程间一起分配.
+/// sRGB格式与对应的UNORM格式编码方式相同, 只是文件中的格式不同.
+///**************************************************************
+
+enum class BCQuality
+{
+	Fast,		// 包围盒端点(向内收缩), 按协方差选择对角线.
+	Normal,		// 主成分分析(幂迭代)求颜色主轴, 单色块查表.
+	High		// 在Normal的基础上用最小二乘迭代优化端点, BC4搜索收缩后的端点和6值模式.
+};
+
+struct BCSurface
+{
+	const uint8_t* Pixels = nullptr;	// R8G8B8A8.
+	UINT Width = 0;
+	UINT Height = 0;
+	UINT RowPitch = 0;					// 0表示 4 * Width.
+};
+
+class BCCompressor
+{
+public:
+	static bool IsSupported(DXGI_FORMAT format);
+
+	// 每个4x4块的字节数, BC1/BC4为8, BC2/BC3/BC5为16.
+	static UINT BlockBytes(DXGI_FORMAT format);
+
+	///<summary>
+	/// 压缩surfaces中的每张图像到outputs中对应的位置(大小由GetSurfaceInfo给出).
+	/// threadCount为0时使用所有硬件线程.
+	///</summary>
+	static bool Compress(
+		const std::vector<BCSurface>& surfaces,
+		DXGI_FORMAT format,
+		BCQuality quality,
+		const std::vector<uint8_t*>& outputs,
+		UINT threadCount = 0);
+
+	static bool Compress(
+		const BCSurface& surface,
+		DXGI_FORMAT format,
+		BCQuality quality,
+		uint8_t* output,
+		UINT threadCount = 0);
+
+	// 压缩一个4x4块, rgba为16个R8G8B8A8像素(按行排列).
+	static void CompressBlock(const uint8_t* rgba, DXGI_FORMAT format, BCQuality quality, uint8_t* block);
+
+	///<summary>
+	/// 解压到R8G8B8A8图像, rowPitch为0表示 4 * width. BC4输出(R, 0, 0, 255), BC5输出(R, G, 0, 255).
+	///</summary>
+	static void Decompress(const uint8_t* blocks, UINT width, UINT height, DXGI_FORMAT format,
+		uint8_t* rgba, UINT rowPitch = 0);
+
+	///<summary>
+	/// 原图与解压结果之间的峰值信噪比(dB), 只统计format保存的通道, BC1不统计透明像素的颜色.
+	///</summary>
+	static double ComputePSNR(const BCSurface& original, const uint8_t* blocks, DXGI_FORMAT format);
+
+	///<summary>
+	/// 把一张R8G8B8A8图像(及其已生成的mip链)压缩后写成DDS文件.
+	/// mips[0]为最高级, 每一级的尺寸必须依次减半.
+	///</summary>
+	static bool SaveDDS(
+		const std::wstring& filename,
+		const std::vector<BCSurface>& mips,
+		DXGI_FORMAT format,
+		BCQuality quality,
+		std::wstring& error,
+		UINT threadCount = 0);
+};
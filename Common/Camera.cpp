@@ -0,0 +1,209 @@
+﻿#include "Camera.h"
+#include "d3dUtil.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	bool Equal(const XMFLOAT3& a, const XMFLOAT3& b)
+	{
+		return a.x == b.x && a.y == b.y && a.z == b.z;
+	}
+}
+
+Camera::Camera()
+{
+	SetLens(0.25f * XM_PI, 1.0f, 1.0f, 1000.0f);
+}
+
+void Camera::SetLens(float fovY, float aspect, float zn, float zf)
+{
+	if (!mOrthographic && mFovY == fovY && mAspect == aspect && mNearZ == zn && mFarZ == zf)
+		return;
+
+	mOrthographic = false;
+	mFovY = fovY;
+	mAspect = aspect;
+	mNearZ = zn;
+	mFarZ = zf;
+
+	mDirty |= DirtyProj | DirtyViewProj | DirtyPlanes;
+	++mVersion;
+}
+
+void Camera::SetOrthographicLens(float viewWidth, float viewHeight, float zn, float zf)
+{
+	if (mOrthographic && mViewWidth == viewWidth && mViewHeight == viewHeight && mNearZ == zn && mFarZ == zf)
+		return;
+
+	mOrthographic = true;
+	mViewWidth = viewWidth;
+	mViewHeight = viewHeight;
+	mNearZ = zn;
+	mFarZ = zf;
+
+	mDirty |= DirtyProj | DirtyViewProj | DirtyPlanes;
+	++mVersion;
+}
+
+void Camera::LookAt(FXMVECTOR pos, FXMVECTOR target, FXMVECTOR worldUp)
+{
+	// 与XMMatrixLookAtLH相同的基向量.
+	XMVECTOR look = XMVector3Normalize(XMVectorSubtract(target, pos));
+	XMVECTOR right = XMVector3Normalize(XMVector3Cross(worldUp, look));
+	XMVECTOR up = XMVector3Cross(look, right);
+
+	XMFLOAT3 position, r, u, l;
+	XMStoreFloat3(&position, pos);
+	XMStoreFloat3(&r, right);
+	XMStoreFloat3(&u, up);
+	XMStoreFloat3(&l, look);
+
+	if (Equal(position, mPosition) && Equal(r, mRight) && Equal(u, mUp) && Equal(l, mLook))
+		return;
+
+	mPosition = position;
+	mRight = r;
+	mUp = u;
+	mLook = l;
+
+	mDirty |= DirtyView | DirtyViewProj | DirtyPlanes;
+	++mVersion;
+}
+
+void Camera::UpdateView() const
+{
+	XMVECTOR p = XMLoadFloat3(&mPosition);
+	XMVECTOR r = XMLoadFloat3(&mRight);
+	XMVECTOR u = XMLoadFloat3(&mUp);
+	XMVECTOR l = XMLoadFloat3(&mLook);
+
+	float x = -XMVectorGetX(XMVector3Dot(p, r));
+	float y = -XMVectorGetX(XMVector3Dot(p, u));
+	float z = -XMVectorGetX(XMVector3Dot(p, l));
+
+	mView = XMFLOAT4X4(
+		mRight.x, mUp.x, mLook.x, 0.0f,
+		mRight.y, mUp.y, mLook.y, 0.0f,
+		mRight.z, mUp.z, mLook.z, 0.0f,
+		x, y, z, 1.0f);
+
+	// 旋转部分的逆是转置, 平移部分的逆就是摄像机位置.
+	mInvView = XMFLOAT4X4(
+		mRight.x, mRight.y, mRight.z, 0.0f,
+		mUp.x, mUp.y, mUp.z, 0.0f,
+		mLook.x, mLook.y, mLook.z, 0.0f,
+		mPosition.x, mPosition.y, mPosition.z, 1.0f);
+
+	mDirty &= ~DirtyView;
+}
+
+void Camera::UpdateProj() const
+{
+	if (mOrthographic)
+	{
+		// (x, y, z, 1) -> (2x / w, 2y / h, (z - n) / (f - n), 1).
+		float a = 1.0f / (mFarZ - mNearZ);
+
+		mProj = XMFLOAT4X4(
+			2.0f / mViewWidth, 0.0f, 0.0f, 0.0f,
+			0.0f, 2.0f / mViewHeight, 0.0f, 0.0f,
+			0.0f, 0.0f, a, 0.0f,
+			0.0f, 0.0f, -a * mNearZ, 1.0f);
+
+		mInvProj = XMFLOAT4X4(
+			0.5f * mViewWidth, 0.0f, 0.0f, 0.0f,
+			0.0f, 0.5f * mViewHeight, 0.0f, 0.0f,
+			0.0f, 0.0f, mFarZ - mNearZ, 0.0f,
+			0.0f, 0.0f, mNearZ, 1.0f);
+	}
+	else
+	{
+		// (x, y, z, 1) -> (sx * x, sy * y, a * z + b, z), 逆变换为
+		// (X, Y, Z, W) -> (X / sx, Y / sy, W, (Z - a * W) / b).
+		float sy = 1.0f / tanf(0.5f * mFovY);
+		float sx = sy / mAspect;
+		float a = mFarZ / (mFarZ - mNearZ);
+		float b = -a * mNearZ;
+
+		mProj = XMFLOAT4X4(
+			sx, 0.0f, 0.0f, 0.0f,
+			0.0f, sy, 0.0f, 0.0f,
+			0.0f, 0.0f, a, 1.0f,
+			0.0f, 0.0f, b, 0.0f);
+
+		mInvProj = XMFLOAT4X4(
+			1.0f / sx, 0.0f, 0.0f, 0.0f,
+			0.0f, 1.0f / sy, 0.0f, 0.0f,
+			0.0f, 0.0f, 0.0f, 1.0f / b,
+			0.0f, 0.0f, 1.0f, -a / b);
+	}
+
+	mDirty &= ~DirtyProj;
+}
+
+void Camera::UpdateViewProj() const
+{
+	if (mDirty & DirtyView)
+		UpdateView();
+	if (mDirty & DirtyProj)
+		UpdateProj();
+
+	XMStoreFloat4x4(&mViewProj, XMMatrixMultiply(XMLoadFloat4x4(&mView), XMLoadFloat4x4(&mProj)));
+	XMStoreFloat4x4(&mInvViewProj, XMMatrixMultiply(XMLoadFloat4x4(&mInvProj), XMLoadFloat4x4(&mInvView)));
+
+	mDirty &= ~DirtyViewProj;
+}
+
+const XMFLOAT4X4& Camera::View() const
+{
+	if (mDirty & DirtyView)
+		UpdateView();
+	return mView;
+}
+
+const XMFLOAT4X4& Camera::Proj() const
+{
+	if (mDirty & DirtyProj)
+		UpdateProj();
+	return mProj;
+}
+
+const XMFLOAT4X4& Camera::ViewProj() const
+{
+	if (mDirty & DirtyViewProj)
+		UpdateViewProj();
+	return mViewProj;
+}
+
+const XMFLOAT4X4& Camera::InvView() const
+{
+	if (mDirty & DirtyView)
+		UpdateView();
+	return mInvView;
+}
+
+const XMFLOAT4X4& Camera::InvProj() const
+{
+	if (mDirty & DirtyProj)
+		UpdateProj();
+	return mInvProj;
+}
+
+const XMFLOAT4X4& Camera::InvViewProj() const
+{
+	if (mDirty & DirtyViewProj)
+		UpdateViewProj();
+	return mInvViewProj;
+}
+
+const XMFLOAT4* Camera::FrustumPlanes() const
+{
+	if (mDirty & DirtyPlanes)
+	{
+		ExtractFrustumPlanes(mFrustumPlanes, XMLoadFloat4x4(&ViewProj()));
+		mDirty &= ~DirtyPlanes;
+	}
+	return mFrustumPlanes;
+}
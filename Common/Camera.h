@@ -0,0 +1,89 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <Windows.h>
+
+///**************************************************************
+/// 摄像机: 保存位置、朝向和投影参数, 缓存由它们得到的观察矩阵、投影矩阵、
+/// 观察投影矩阵、三者的逆矩阵以及世界空间的视锥体平面.
+/// 设置的参数与原来相同时不做任何事; 参数改变时只标记受影响的矩阵, 在下一次读取时才重新计算.
+/// 观察矩阵是正交矩阵加平移, 透视/正交投影矩阵的形式固定, 它们的逆矩阵都直接写出,
+/// 观察投影矩阵的逆为 InvProj * InvView, 不需要求一般4x4矩阵的逆.
+/// Version()在矩阵每次改变后加1, 用于判断是否需要重新上传常量缓冲区.
+///**************************************************************
+class Camera
+{
+public:
+	Camera();
+
+	// 透视投影, 参数与XMMatrixPerspectiveFovLH相同.
+	void SetLens(float fovY, float aspect, float zn, float zf);
+
+	// 正交投影, 参数与XMMatrixOrthographicLH相同.
+	void SetOrthographicLens(float viewWidth, float viewHeight, float zn, float zf);
+
+	// 位置和朝向, 参数与XMMatrixLookAtLH相同.
+	void LookAt(DirectX::FXMVECTOR pos, DirectX::FXMVECTOR target, DirectX::FXMVECTOR worldUp);
+
+	DirectX::XMFLOAT3 GetPosition3f() const { return mPosition; }
+	DirectX::XMFLOAT3 GetRight3f() const { return mRight; }
+	DirectX::XMFLOAT3 GetUp3f() const { return mUp; }
+	DirectX::XMFLOAT3 GetLook3f() const { return mLook; }
+
+	float GetNearZ() const { return mNearZ; }
+	float GetFarZ() const { return mFarZ; }
+	bool IsOrthographic() const { return mOrthographic; }
+
+	// 缓存的矩阵, 需要时重新计算.
+	const DirectX::XMFLOAT4X4& View() const;
+	const DirectX::XMFLOAT4X4& Proj() const;
+	const DirectX::XMFLOAT4X4& ViewProj() const;
+	const DirectX::XMFLOAT4X4& InvView() const;
+	const DirectX::XMFLOAT4X4& InvProj() const;
+	const DirectX::XMFLOAT4X4& InvViewProj() const;
+
+	// 世界空间的视锥体平面, 顺序与ExtractFrustumPlanes相同.
+	const DirectX::XMFLOAT4* FrustumPlanes() const;
+
+	UINT Version() const { return mVersion; }
+
+private:
+	enum DirtyFlags : UINT
+	{
+		DirtyView = 1,
+		DirtyProj = 2,
+		DirtyViewProj = 4,
+		DirtyPlanes = 8
+	};
+
+	void UpdateView() const;
+	void UpdateProj() const;
+	void UpdateViewProj() const;
+
+private:
+	// 观察空间的基向量和位置.
+	DirectX::XMFLOAT3 mPosition = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 mRight = { 1.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 mUp = { 0.0f, 1.0f, 0.0f };
+	DirectX::XMFLOAT3 mLook = { 0.0f, 0.0f, 1.0f };
+
+	// 投影参数. 正交投影时mFovY/mAspect不使用, 用mViewWidth/mViewHeight.
+	bool mOrthographic = false;
+	float mFovY = 0.25f * DirectX::XM_PI;
+	float mAspect = 1.0f;
+	float mViewWidth = 1.0f;
+	float mViewHeight = 1.0f;
+	float mNearZ = 1.0f;
+	float mFarZ = 1000.0f;
+
+	UINT mVersion = 0;
+	mutable UINT mDirty = DirtyView | DirtyProj | DirtyViewProj | DirtyPlanes;
+
+	mutable DirectX::XMFLOAT4X4 mView;
+	mutable DirectX::XMFLOAT4X4 mProj;
+	mutable DirectX::XMFLOAT4X4 mViewProj;
+	mutable DirectX::XMFLOAT4X4 mInvView;
+	mutable DirectX::XMFLOAT4X4 mInvProj;
+	mutable DirectX::XMFLOAT4X4 mInvViewProj;
+	mutable DirectX::XMFLOAT4 mFrustumPlanes[6];
+};
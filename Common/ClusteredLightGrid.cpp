@@ -0,0 +1,216 @@
+﻿#include "ClusteredLightGrid.h"
+#include "d3dUtil.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	// 球(xyz为中心, w为半径)与包围盒是否相交.
+	bool SphereIntersectsBox(const XMFLOAT4& s, const XMFLOAT3& mn, const XMFLOAT3& mx)
+	{
+		float dx = s.x - (std::min)((std::max)(s.x, mn.x), mx.x);
+		float dy = s.y - (std::min)((std::max)(s.y, mn.y), mx.y);
+		float dz = s.z - (std::min)((std::max)(s.z, mn.z), mx.z);
+		return dx * dx + dy * dy + dz * dz < s.w * s.w;
+	}
+}
+
+ClusteredLightGrid::ClusteredLightGrid(UINT sizeX, UINT sizeY, UINT sizeZ) :
+	mSizeX(sizeX), mSizeY(sizeY), mSizeZ(sizeZ)
+{
+	assert(sizeX > 0 && sizeY > 0 && sizeZ > 0);
+}
+
+void ClusteredLightGrid::GetSliceScaleBias(float& scale, float& bias) const
+{
+	float logRange = logf(mFarZ / mNearZ);
+	scale = mSizeZ / logRange;
+	bias = -(float)mSizeZ * logf(mNearZ) / logRange;
+}
+
+void ClusteredLightGrid::UpdateClusterBounds(const Camera& camera)
+{
+	const XMFLOAT4X4& proj = camera.Proj();
+	float projX = proj(0, 0);
+	float projY = proj(1, 1);
+	float nearZ = camera.GetNearZ();
+	float farZ = camera.GetFarZ();
+
+	if (projX == mProjX && projY == mProjY && nearZ == mNearZ && farZ == mFarZ && !mClusterMin.empty())
+		return;
+
+	mProjX = projX;
+	mProjY = projY;
+	mNearZ = nearZ;
+	mFarZ = farZ;
+
+	// 层的分界 near * (far / near)^(k / SizeZ), 离摄像机越远层越厚.
+	mSliceDepth.resize(mSizeZ + 1);
+	for (UINT z = 0; z < mSizeZ; ++z)
+		mSliceDepth[z] = nearZ * powf(farZ / nearZ, (float)z / mSizeZ);
+	mSliceDepth[mSizeZ] = farZ;
+
+	mClusterMin.resize(ClusterCount());
+	mClusterMax.resize(ClusterCount());
+
+	for (UINT z = 0; z < mSizeZ; ++z)
+	{
+		float a = mSliceDepth[z];
+		float b = mSliceDepth[z + 1];
+
+		for (UINT y = 0; y < mSizeY; ++y)
+		{
+			// 深度为1处格子的上下边界.
+			float bottom = (1.0f - 2.0f * (y + 1) / mSizeY) / projY;
+			float top = (1.0f - 2.0f * y / mSizeY) / projY;
+
+			for (UINT x = 0; x < mSizeX; ++x)
+			{
+				float left = (-1.0f + 2.0f * x / mSizeX) / projX;
+				float right = (-1.0f + 2.0f * (x + 1) / mSizeX) / projX;
+
+				UINT c = ClusterIndex(x, y, z);
+				mClusterMin[c] = XMFLOAT3((std::min)(left * a, left * b), (std::min)(bottom * a, bottom * b), a);
+				mClusterMax[c] = XMFLOAT3((std::max)(right * a, right * b), (std::max)(top * a, top * b), b);
+			}
+		}
+	}
+}
+
+void ClusteredLightGrid::BinLights(const XMFLOAT4* spheres, UINT first, UINT last, Bins& bins) const
+{
+	for (UINT i = first; i < last; ++i)
+	{
+		const XMFLOAT4& s = spheres[i];
+		if (!(s.w > 0.0f))
+			continue;
+
+		// 候选范围稍微放大, 是否相交最终由球-包围盒测试决定.
+		float margin = s.w * 1.001f + 1.0e-4f;
+		if (s.z + margin < mNearZ || s.z - margin > mFarZ)
+			continue;
+
+		auto slice = [&](float depth)
+		{
+			UINT z = (UINT)(std::upper_bound(mSliceDepth.begin(), mSliceDepth.end(), depth) - mSliceDepth.begin());
+			return (std::min)((std::max)(z, 1u), mSizeZ) - 1;
+		};
+		UINT zFirst = slice(s.z - margin);
+		UINT zLast = slice(s.z + margin);
+
+		for (UINT z = zFirst; z <= zLast; ++z)
+		{
+			// 同一层中格子的x范围只与x有关, y范围只与y有关.
+			UINT xFirst = mSizeX, xLast = 0;
+			for (UINT x = 0; x < mSizeX; ++x)
+			{
+				UINT c = ClusterIndex(x, 0, z);
+				if (mClusterMax[c].x >= s.x - margin && mClusterMin[c].x <= s.x + margin)
+				{
+					xFirst = (std::min)(xFirst, x);
+					xLast = x;
+				}
+			}
+
+			UINT yFirst = mSizeY, yLast = 0;
+			for (UINT y = 0; y < mSizeY; ++y)
+			{
+				UINT c = ClusterIndex(0, y, z);
+				if (mClusterMax[c].y >= s.y - margin && mClusterMin[c].y <= s.y + margin)
+				{
+					yFirst = (std::min)(yFirst, y);
+					yLast = y;
+				}
+			}
+
+			for (UINT y = yFirst; y <= yLast && yFirst < mSizeY; ++y)
+			{
+				for (UINT x = xFirst; x <= xLast && xFirst < mSizeX; ++x)
+				{
+					UINT c = ClusterIndex(x, y, z);
+					if (SphereIntersectsBox(s, mClusterMin[c], mClusterMax[c]))
+					{
+						++bins.Counts[c];
+						bins.Entries.emplace_back(c, i);
+					}
+				}
+			}
+		}
+	}
+}
+
+void ClusteredLightGrid::Build(const Camera& camera, const Light* lights, UINT lightCount, UINT threadCount)
+{
+	assert(!camera.IsOrthographic());
+
+	UpdateClusterBounds(camera);
+
+	const UINT clusterCount = ClusterCount();
+	mClusters.assign(clusterCount, Cluster());
+	mLightIndices.clear();
+
+	// 光源变换到观察空间.
+	XMMATRIX view = XMLoadFloat4x4(&camera.View());
+	mSpheres.resize(lightCount);
+	for (UINT i = 0; i < lightCount; ++i)
+	{
+		XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&lights[i].Position), view);
+		XMStoreFloat4(&mSpheres[i], XMVectorSetW(center, lights[i].FalloffEnd));
+	}
+
+	if (threadCount == 0)
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	if (lightCount < ParallelThreshold)
+		threadCount = 1;
+	threadCount = (std::min)(threadCount, (std::max)(lightCount, 1u));
+
+	// 每个线程一段连续的光源, 合并时按线程顺序, 所以每个簇中的光源下标递增.
+	mBins.resize(threadCount);
+	UINT chunk = (lightCount + threadCount - 1) / threadCount;
+
+	auto worker = [this, chunk, lightCount](UINT t)
+	{
+		Bins& bins = mBins[t];
+		bins.Counts.assign(ClusterCount(), 0);
+		bins.Entries.clear();
+
+		UINT first = (std::min)(t * chunk, lightCount);
+		UINT last = (std::min)(first + chunk, lightCount);
+		BinLights(mSpheres.data(), first, last, bins);
+	};
+
+	std::vector<std::thread> threads;
+	for (UINT t = 1; t < threadCount; ++t)
+		threads.emplace_back(worker, t);
+
+	worker(0);
+
+	for (auto& t : threads)
+		t.join();
+
+	// 合并: Counts改为每个线程在各簇中的写入位置.
+	UINT offset = 0;
+	for (UINT c = 0; c < clusterCount; ++c)
+	{
+		mClusters[c].Offset = offset;
+		for (UINT t = 0; t < threadCount; ++t)
+		{
+			UINT count = mBins[t].Counts[c];
+			mBins[t].Counts[c] = offset;
+			offset += count;
+		}
+		mClusters[c].Count = offset - mClusters[c].Offset;
+	}
+
+	mLightIndices.resize(offset);
+	for (UINT t = 0; t < threadCount; ++t)
+	{
+		Bins& bins = mBins[t];
+		for (const auto& entry : bins.Entries)
+			mLightIndices[bins.Counts[entry.first]++] = entry.second;
+	}
+}
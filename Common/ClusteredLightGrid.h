@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include "Camera.h"
+#include <vector>
+
+struct Light;
+
+///**************************************************************
+/// 在CPU上每帧构建的观察空间分簇光源网格.
+/// 视锥体在屏幕上分成SizeX x SizeY个格子, 深度方向在[NearZ, FarZ]间按指数分成SizeZ层,
+/// 每个簇取其观察空间包围盒. 光源(点光源/聚光灯, 均按FalloffEnd球处理)变换到观察空间后,
+/// 只与深度、x、y范围内可能相交的簇做球-包围盒测试.
+/// 光源分段交给多个线程, 每个线程先写自己的(簇, 光源)列表, 最后按线程顺序合并,
+/// 结果与单线程相同: 每个簇的光源下标递增.
+/// 输出是扁平的两个数组: 每个簇一个(Offset, Count), 以及所有簇的光源下标, 可直接作为着色器的缓冲区.
+///**************************************************************
+class ClusteredLightGrid
+{
+public:
+	// 光源数超过这个数量才使用多线程.
+	static const UINT ParallelThreshold = 512;
+
+	// 一个簇的光源在LightIndices()中的区间, 与着色器中的uint2对应.
+	struct Cluster
+	{
+		UINT Offset = 0;
+		UINT Count = 0;
+	};
+
+	ClusteredLightGrid(UINT sizeX = 16, UINT sizeY = 9, UINT sizeZ = 24);
+
+	///<summary>
+	/// 用摄像机(须为透视投影)和世界空间的光源重新构建网格.
+	/// threadCount为0时使用所有硬件线程, 光源少于ParallelThreshold时总是单线程.
+	///</summary>
+	void Build(const Camera& camera, const Light* lights, UINT lightCount, UINT threadCount = 0);
+
+	UINT SizeX() const { return mSizeX; }
+	UINT SizeY() const { return mSizeY; }
+	UINT SizeZ() const { return mSizeZ; }
+	UINT ClusterCount() const { return mSizeX * mSizeY * mSizeZ; }
+
+	// 格子x从左到右, y从上到下, z从近到远.
+	UINT ClusterIndex(UINT x, UINT y, UINT z) const { return (z * mSizeY + y) * mSizeX + x; }
+
+	///<summary>
+	/// 观察空间深度所在的层 z = floor(log(depth) * scale + bias), 着色器中用同样的公式.
+	///</summary>
+	void GetSliceScaleBias(float& scale, float& bias) const;
+
+	const std::vector<Cluster>& Clusters() const { return mClusters; }
+	const std::vector<UINT>& LightIndices() const { return mLightIndices; }
+
+	// 簇的观察空间包围盒.
+	const DirectX::XMFLOAT3& ClusterMin(UINT cluster) const { return mClusterMin[cluster]; }
+	const DirectX::XMFLOAT3& ClusterMax(UINT cluster) const { return mClusterMax[cluster]; }
+
+private:
+	// 投影参数改变时重新计算所有簇的包围盒.
+	void UpdateClusterBounds(const Camera& camera);
+
+	// 每个线程的分簇结果.
+	struct Bins
+	{
+		std::vector<UINT> Counts;
+		std::vector<std::pair<UINT, UINT>> Entries;		// (簇, 光源).
+	};
+
+	// 把光源[first, last)(观察空间球: xyz为中心, w为半径)分到簇中.
+	void BinLights(const DirectX::XMFLOAT4* spheres, UINT first, UINT last, Bins& bins) const;
+
+private:
+	UINT mSizeX;
+	UINT mSizeY;
+	UINT mSizeZ;
+
+	// 生成当前包围盒时的投影参数.
+	float mProjX = 0.0f;
+	float mProjY = 0.0f;
+	float mNearZ = 0.0f;
+	float mFarZ = 0.0f;
+
+	std::vector<float> mSliceDepth;					// SizeZ + 1个层的分界深度.
+	std::vector<DirectX::XMFLOAT3> mClusterMin;
+	std::vector<DirectX::XMFLOAT3> mClusterMax;
+
+	std::vector<DirectX::XMFLOAT4> mSpheres;
+	std::vector<Bins> mBins;
+
+	std::vector<Cluster> mClusters;
+	std::vector<UINT> mLightIndices;
+};
@@ -0,0 +1,254 @@
+﻿#include "DDSWriter.h"
+#include "DDS.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t DDS_HEADER_FLAGS_TEXTURE = 0x00001007;	// DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT
+	const uint32_t DDS_HEADER_FLAGS_MIPMAP = 0x00020000;	// DDSD_MIPMAPCOUNT
+	const uint32_t DDS_HEADER_FLAGS_PITCH = 0x00000008;		// DDSD_PITCH
+	const uint32_t DDS_HEADER_FLAGS_LINEARSIZE = 0x00080000;	// DDSD_LINEARSIZE
+
+	const uint32_t DDS_SURFACE_FLAGS_TEXTURE = 0x00001000;	// DDSCAPS_TEXTURE
+	const uint32_t DDS_SURFACE_FLAGS_MIPMAP = 0x00400008;	// DDSCAPS_COMPLEX | DDSCAPS_MIPMAP
+	const uint32_t DDS_SURFACE_FLAGS_CUBEMAP = 0x00000008;	// DDSCAPS_COMPLEX
+
+	const uint32_t DDS_RESOURCE_DIMENSION_TEXTURE2D = 3;
+	const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+	inline bool IsCompressed(DXGI_FORMAT format)
+	{
+		return format >= DXGI_FORMAT_BC1_TYPELESS && format <= DXGI_FORMAT_BC5_SNORM;
+	}
+
+	///<summary>
+	/// 填充传统文件头的像素格式, 没有对应的传统格式时返回false.
+	///</summary>
+	bool GetLegacyPixelFormat(DXGI_FORMAT format, DDS_PIXELFORMAT& ddpf)
+	{
+		memset(&ddpf, 0, sizeof(ddpf));
+		ddpf.size = sizeof(DDS_PIXELFORMAT);
+
+		switch (format)
+		{
+		case DXGI_FORMAT_BC1_UNORM:
+			ddpf.flags = DDS_FOURCC;
+			ddpf.fourCC = MAKEFOURCC('D', 'X', 'T', '1');
+			return true;
+
+		case DXGI_FORMAT_BC2_UNORM:
+			ddpf.flags = DDS_FOURCC;
+			ddpf.fourCC = MAKEFOURCC('D', 'X', 'T', '3');
+			return true;
+
+		case DXGI_FORMAT_BC3_UNORM:
+			ddpf.flags = DDS_FOURCC;
+			ddpf.fourCC = MAKEFOURCC('D', 'X', 'T', '5');
+			return true;
+
+		case DXGI_FORMAT_BC4_UNORM:
+			ddpf.flags = DDS_FOURCC;
+			ddpf.fourCC = MAKEFOURCC('A', 'T', 'I', '1');
+			return true;
+
+		case DXGI_FORMAT_BC5_UNORM:
+			ddpf.flags = DDS_FOURCC;
+			ddpf.fourCC = MAKEFOURCC('A', 'T', 'I', '2');
+			return true;
+
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+			ddpf.flags = DDS_RGB | 0x00000001;	// DDPF_ALPHAPIXELS
+			ddpf.RGBBitCount = 32;
+			ddpf.RBitMask = 0x000000ff;
+			ddpf.GBitMask = 0x0000ff00;
+			ddpf.BBitMask = 0x00ff0000;
+			ddpf.ABitMask = 0xff000000;
+			return true;
+
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+			ddpf.flags = DDS_RGB | 0x00000001;
+			ddpf.RGBBitCount = 32;
+			ddpf.RBitMask = 0x00ff0000;
+			ddpf.GBitMask = 0x0000ff00;
+			ddpf.BBitMask = 0x000000ff;
+			ddpf.ABitMask = 0xff000000;
+			return true;
+
+		default:
+			return false;
+		}
+	}
+}
+
+size_t DDSWriter::SurfaceBytes(DXGI_FORMAT format, UINT width, UINT height)
+{
+	size_t numBytes = 0;
+	GetSurfaceInfo(width, height, format, &numBytes, nullptr, nullptr);
+	return numBytes;
+}
+
+bool DDSWriter::Build(const DDSImage& image, std::vector<uint8_t>& out, std::wstring& error)
+{
+	out.clear();
+
+	if (image.Width == 0 || image.Height == 0 || image.MipLevels == 0 || image.ArraySize == 0)
+	{
+		error = L"DDSWriter: empty image.";
+		return false;
+	}
+
+	if (BitsPerPixel(image.Format) == 0)
+	{
+		error = L"DDSWriter: unsupported format.";
+		return false;
+	}
+
+	if (image.IsCubeMap && (image.ArraySize % 6) != 0)
+	{
+		error = L"DDSWriter: cube map array size must be a multiple of 6.";
+		return false;
+	}
+
+	if (image.Subresources.size() != (size_t)image.MipLevels * image.ArraySize)
+	{
+		error = L"DDSWriter: subresource count does not match MipLevels * ArraySize.";
+		return false;
+	}
+
+	DDS_PIXELFORMAT ddpf;
+	const bool singleImage = image.IsCubeMap ? (image.ArraySize == 6) : (image.ArraySize == 1);
+	const bool legacy = singleImage && GetLegacyPixelFormat(image.Format, ddpf);
+
+	if (!legacy)
+	{
+		memset(&ddpf, 0, sizeof(ddpf));
+		ddpf.size = sizeof(DDS_PIXELFORMAT);
+		ddpf.flags = DDS_FOURCC;
+		ddpf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+	}
+
+	DDS_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.size = sizeof(DDS_HEADER);
+	header.flags = DDS_HEADER_FLAGS_TEXTURE;
+	header.height = image.Height;
+	header.width = image.Width;
+	header.depth = 1;
+	header.mipMapCount = image.MipLevels;
+	header.ddspf = ddpf;
+	header.caps = DDS_SURFACE_FLAGS_TEXTURE;
+
+	if (image.MipLevels > 1)
+	{
+		header.flags |= DDS_HEADER_FLAGS_MIPMAP;
+		header.caps |= DDS_SURFACE_FLAGS_MIPMAP;
+	}
+
+	if (image.IsCubeMap)
+	{
+		header.caps |= DDS_SURFACE_FLAGS_CUBEMAP;
+		header.caps2 = DDS_CUBEMAP_ALLFACES;
+	}
+
+	size_t rowBytes = 0;
+	size_t numBytes = 0;
+	GetSurfaceInfo(image.Width, image.Height, image.Format, &numBytes, &rowBytes, nullptr);
+	if (IsCompressed(image.Format))
+	{
+		header.flags |= DDS_HEADER_FLAGS_LINEARSIZE;
+		header.pitchOrLinearSize = (uint32_t)numBytes;
+	}
+	else
+	{
+		header.flags |= DDS_HEADER_FLAGS_PITCH;
+		header.pitchOrLinearSize = (uint32_t)rowBytes;
+	}
+
+	size_t dataBytes = 0;
+	for (UINT item = 0; item < image.ArraySize; ++item)
+	{
+		for (UINT mip = 0; mip < image.MipLevels; ++mip)
+		{
+			UINT w = (std::max)(image.Width >> mip, 1u);
+			UINT h = (std::max)(image.Height >> mip, 1u);
+			dataBytes += SurfaceBytes(image.Format, w, h);
+		}
+	}
+
+	const size_t headerBytes = sizeof(uint32_t) + sizeof(DDS_HEADER) + (legacy ? 0 : sizeof(DDS_HEADER_DXT10));
+	out.resize(headerBytes + dataBytes);
+
+	uint8_t* dst = out.data();
+	const uint32_t magic = DDS_MAGIC;
+	memcpy(dst, &magic, sizeof(magic));
+	dst += sizeof(magic);
+	memcpy(dst, &header, sizeof(header));
+	dst += sizeof(header);
+
+	if (!legacy)
+	{
+		DDS_HEADER_DXT10 ext;
+		memset(&ext, 0, sizeof(ext));
+		ext.dxgiFormat = image.Format;
+		ext.resourceDimension = DDS_RESOURCE_DIMENSION_TEXTURE2D;
+		ext.miscFlag = image.IsCubeMap ? DDS_RESOURCE_MISC_TEXTURECUBE : 0;
+		ext.arraySize = image.IsCubeMap ? image.ArraySize / 6 : image.ArraySize;
+		memcpy(dst, &ext, sizeof(ext));
+		dst += sizeof(ext);
+	}
+
+	size_t index = 0;
+	for (UINT item = 0; item < image.ArraySize; ++item)
+	{
+		for (UINT mip = 0; mip < image.MipLevels; ++mip, ++index)
+		{
+			UINT w = (std::max)(image.Width >> mip, 1u);
+			UINT h = (std::max)(image.Height >> mip, 1u);
+			size_t bytes = SurfaceBytes(image.Format, w, h);
+
+			if (image.Subresources[index] == nullptr)
+			{
+				out.clear();
+				error = L"DDSWriter: missing subresource data.";
+				return false;
+			}
+
+			memcpy(dst, image.Subresources[index], bytes);
+			dst += bytes;
+		}
+	}
+
+	return true;
+}
+
+bool DDSWriter::Save(const std::wstring& filename, const DDSImage& image, std::wstring& error)
+{
+	std::vector<uint8_t> data;
+	if (!Build(image, data, error))
+		return false;
+
+	return WriteFile(filename, data, error);
+}
+
+bool DDSWriter::WriteFile(const std::wstring& filename, const std::vector<uint8_t>& data, std::wstring& error)
+{
+	std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+	if (!fout)
+	{
+		error = L"DDSWriter: cannot create " + filename;
+		return false;
+	}
+
+	fout.write((const char*)data.data(), (std::streamsize)data.size());
+	if (!fout)
+	{
+		error = L"DDSWriter: failed to write " + filename;
+		return false;
+	}
+
+	return true;
+}
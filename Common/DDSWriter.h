@@ -0,0 +1,44 @@
+﻿#pragma once
+
+#include <dxgiformat.h>
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///**************************************************************
+/// DDS文件的写入, 写出的文件可以直接由DDSTextureLoader加载.
+/// 能用传统文件头表示的格式(BC1~BC5、RGBA8/BGRA8, 非数组)写传统文件头,
+/// 其它情况(sRGB、纹理数组等)写DX10扩展头.
+///**************************************************************
+
+struct DDSImage
+{
+	DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+	UINT Width = 0;
+	UINT Height = 0;
+	UINT MipLevels = 1;
+	UINT ArraySize = 1;					// 立方体贴图为6的倍数.
+	bool IsCubeMap = false;
+
+	///<summary>
+	/// 每个子资源的数据, 顺序与D3D11CalcSubresource相同(依次为每个数组元素的各级mip),
+	/// 每个子资源按GetSurfaceInfo给出的行字节数紧密排列.
+	///</summary>
+	std::vector<const uint8_t*> Subresources;
+};
+
+class DDSWriter
+{
+public:
+	// 把image序列化为DDS文件的内容.
+	static bool Build(const DDSImage& image, std::vector<uint8_t>& out, std::wstring& error);
+
+	static bool Save(const std::wstring& filename, const DDSImage& image, std::wstring& error);
+
+	// 把Build()得到(或修改过)的内容写入文件.
+	static bool WriteFile(const std::wstring& filename, const std::vector<uint8_t>& data, std::wstring& error);
+
+	// 一个子资源的字节数.
+	static size_t SurfaceBytes(DXGI_FORMAT format, UINT width, UINT height);
+};
@@ -0,0 +1,583 @@
+﻿#include "DynamicAabbTree.h"
+#include "d3dUtil.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	// 包围盒表面积的一半, 只用于比较大小.
+	float Area(const XMFLOAT3& mn, const XMFLOAT3& mx)
+	{
+		float dx = mx.x - mn.x;
+		float dy = mx.y - mn.y;
+		float dz = mx.z - mn.z;
+		return dx * dy + dy * dz + dz * dx;
+	}
+
+	float UnionArea(const XMFLOAT3& minA, const XMFLOAT3& maxA, const XMFLOAT3& minB, const XMFLOAT3& maxB)
+	{
+		XMFLOAT3 mn((std::min)(minA.x, minB.x), (std::min)(minA.y, minB.y), (std::min)(minA.z, minB.z));
+		XMFLOAT3 mx((std::max)(maxA.x, maxB.x), (std::max)(maxA.y, maxB.y), (std::max)(maxA.z, maxB.z));
+		return Area(mn, mx);
+	}
+
+	bool Contains(const XMFLOAT3& outerMin, const XMFLOAT3& outerMax, const XMFLOAT3& mn, const XMFLOAT3& mx)
+	{
+		return outerMin.x <= mn.x && outerMin.y <= mn.y && outerMin.z <= mn.z &&
+			mx.x <= outerMax.x && mx.y <= outerMax.y && mx.z <= outerMax.z;
+	}
+
+	void ToMinMax(const BoundingBox& box, XMFLOAT3& mn, XMFLOAT3& mx)
+	{
+		mn = XMFLOAT3(box.Center.x - box.Extents.x, box.Center.y - box.Extents.y, box.Center.z - box.Extents.z);
+		mx = XMFLOAT3(box.Center.x + box.Extents.x, box.Center.y + box.Extents.y, box.Center.z + box.Extents.z);
+	}
+
+	///<summary>
+	/// 射线与包围盒的相交测试(slab方法), 相交时返回射线进入包围盒的距离(起点在盒内时为0).
+	///</summary>
+	bool RayHit(const XMFLOAT3& origin, const XMFLOAT3& invDir, const XMFLOAT3& mn, const XMFLOAT3& mx,
+		float maxDistance, float& distance)
+	{
+		float t1 = (mn.x - origin.x) * invDir.x;
+		float t2 = (mx.x - origin.x) * invDir.x;
+		float tmin = (std::min)(t1, t2);
+		float tmax = (std::max)(t1, t2);
+
+		t1 = (mn.y - origin.y) * invDir.y;
+		t2 = (mx.y - origin.y) * invDir.y;
+		tmin = (std::max)(tmin, (std::min)(t1, t2));
+		tmax = (std::min)(tmax, (std::max)(t1, t2));
+
+		t1 = (mn.z - origin.z) * invDir.z;
+		t2 = (mx.z - origin.z) * invDir.z;
+		tmin = (std::max)(tmin, (std::min)(t1, t2));
+		tmax = (std::min)(tmax, (std::max)(t1, t2));
+
+		tmin = (std::max)(tmin, 0.0f);
+		distance = tmin;
+		return tmin <= tmax && tmin <= maxDistance;
+	}
+}
+
+DynamicAabbTree::DynamicAabbTree(float margin)
+	: mMargin(margin)
+{
+}
+
+void DynamicAabbTree::Clear()
+{
+	mNodes.clear();
+	mRoot = NullNode;
+	mFreeList = NullNode;
+	mProxyCount = 0;
+}
+
+int DynamicAabbTree::AllocateNode()
+{
+	if (mFreeList == NullNode)
+	{
+		mNodes.push_back(Node());
+		mFreeList = (int)mNodes.size() - 1;
+	}
+
+	int node = mFreeList;
+	mFreeList = mNodes[node].Parent;
+
+	mNodes[node] = Node();
+	mNodes[node].Height = 0;
+	return node;
+}
+
+void DynamicAabbTree::FreeNode(int node)
+{
+	mNodes[node].Parent = mFreeList;
+	mNodes[node].Height = -1;
+	mFreeList = node;
+}
+
+int DynamicAabbTree::CreateProxy(const BoundingBox& bounds, UINT userData)
+{
+	int proxy = AllocateNode();
+
+	Node& node = mNodes[proxy];
+	ToMinMax(bounds, node.Min, node.Max);
+	node.Min = XMFLOAT3(node.Min.x - mMargin, node.Min.y - mMargin, node.Min.z - mMargin);
+	node.Max = XMFLOAT3(node.Max.x + mMargin, node.Max.y + mMargin, node.Max.z + mMargin);
+	node.UserData = userData;
+
+	InsertLeaf(proxy);
+	++mProxyCount;
+
+	return proxy;
+}
+
+void DynamicAabbTree::DestroyProxy(int proxy)
+{
+	assert(mNodes[proxy].IsLeaf() && mNodes[proxy].Height == 0);
+
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	--mProxyCount;
+}
+
+bool DynamicAabbTree::MoveProxy(int proxy, const BoundingBox& bounds, const XMFLOAT3& displacement)
+{
+	Node& node = mNodes[proxy];
+	assert(node.IsLeaf() && node.Height == 0);
+
+	XMFLOAT3 mn, mx;
+	ToMinMax(bounds, mn, mx);
+	if (Contains(node.Min, node.Max, mn, mx))
+		return false;
+
+	RemoveLeaf(proxy);
+
+	// 外扩余量, 并沿位移方向多扩展两倍位移, 匀速运动的物体下一帧多半还在盒内.
+	mn = XMFLOAT3(mn.x - mMargin, mn.y - mMargin, mn.z - mMargin);
+	mx = XMFLOAT3(mx.x + mMargin, mx.y + mMargin, mx.z + mMargin);
+
+	const float d[3] = { 2.0f * displacement.x, 2.0f * displacement.y, 2.0f * displacement.z };
+	float* pMin = &mn.x;
+	float* pMax = &mx.x;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (d[i] < 0.0f)
+			pMin[i] += d[i];
+		else
+			pMax[i] += d[i];
+	}
+
+	node.Min = mn;
+	node.Max = mx;
+
+	InsertLeaf(proxy);
+	return true;
+}
+
+BoundingBox DynamicAabbTree::FatBounds(int proxy) const
+{
+	BoundingBox box;
+	BoundingBox::CreateFromPoints(box, XMLoadFloat3(&mNodes[proxy].Min), XMLoadFloat3(&mNodes[proxy].Max));
+	return box;
+}
+
+void DynamicAabbTree::InsertLeaf(int leaf)
+{
+	if (mRoot == NullNode)
+	{
+		mRoot = leaf;
+		mNodes[leaf].Parent = NullNode;
+		return;
+	}
+
+	const XMFLOAT3 leafMin = mNodes[leaf].Min;
+	const XMFLOAT3 leafMax = mNodes[leaf].Max;
+
+	// 从根节点向下, 比较"在当前节点处新建父节点"与"下降到某个子节点"的表面积代价.
+	int index = mRoot;
+	while (!mNodes[index].IsLeaf())
+	{
+		const Node& node = mNodes[index];
+
+		float area = Area(node.Min, node.Max);
+		float combinedArea = UnionArea(node.Min, node.Max, leafMin, leafMax);
+
+		// 新建父节点的代价, 以及继续下降时祖先包围盒变大带来的代价.
+		float cost = 2.0f * combinedArea;
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		const int children[2] = { node.Child1, node.Child2 };
+		for (int i = 0; i < 2; ++i)
+		{
+			const Node& child = mNodes[children[i]];
+			float childArea = UnionArea(child.Min, child.Max, leafMin, leafMax);
+			if (child.IsLeaf())
+				childCost[i] = childArea + inheritanceCost;
+			else
+				childCost[i] = childArea - Area(child.Min, child.Max) + inheritanceCost;
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+			break;
+
+		index = childCost[0] < childCost[1] ? node.Child1 : node.Child2;
+	}
+
+	const int sibling = index;
+	const int oldParent = mNodes[sibling].Parent;
+
+	const int newParent = AllocateNode();
+	mNodes[newParent].Parent = oldParent;
+	mNodes[newParent].Child1 = sibling;
+	mNodes[newParent].Child2 = leaf;
+	mNodes[sibling].Parent = newParent;
+	mNodes[leaf].Parent = newParent;
+
+	if (oldParent == NullNode)
+	{
+		mRoot = newParent;
+	}
+	else if (mNodes[oldParent].Child1 == sibling)
+	{
+		mNodes[oldParent].Child1 = newParent;
+	}
+	else
+	{
+		mNodes[oldParent].Child2 = newParent;
+	}
+
+	RefitAncestors(newParent);
+}
+
+void DynamicAabbTree::RemoveLeaf(int leaf)
+{
+	if (leaf == mRoot)
+	{
+		mRoot = NullNode;
+		return;
+	}
+
+	const int parent = mNodes[leaf].Parent;
+	const int grandParent = mNodes[parent].Parent;
+	const int sibling = mNodes[parent].Child1 == leaf ? mNodes[parent].Child2 : mNodes[parent].Child1;
+
+	FreeNode(parent);
+	mNodes[leaf].Parent = NullNode;
+
+	if (grandParent == NullNode)
+	{
+		mRoot = sibling;
+		mNodes[sibling].Parent = NullNode;
+		return;
+	}
+
+	// 兄弟节点取代父节点.
+	if (mNodes[grandParent].Child1 == parent)
+		mNodes[grandParent].Child1 = sibling;
+	else
+		mNodes[grandParent].Child2 = sibling;
+	mNodes[sibling].Parent = grandParent;
+
+	RefitAncestors(grandParent);
+}
+
+void DynamicAabbTree::SetFromChildren(int index)
+{
+	Node& node = mNodes[index];
+	const Node& a = mNodes[node.Child1];
+	const Node& b = mNodes[node.Child2];
+
+	node.Min = XMFLOAT3((std::min)(a.Min.x, b.Min.x), (std::min)(a.Min.y, b.Min.y), (std::min)(a.Min.z, b.Min.z));
+	node.Max = XMFLOAT3((std::max)(a.Max.x, b.Max.x), (std::max)(a.Max.y, b.Max.y), (std::max)(a.Max.z, b.Max.z));
+	node.Height = 1 + (std::max)(a.Height, b.Height);
+}
+
+void DynamicAabbTree::RefitAncestors(int index)
+{
+	while (index != NullNode)
+	{
+		SetFromChildren(index);
+		Rotate(index);
+		index = mNodes[index].Parent;
+	}
+}
+
+void DynamicAabbTree::Rotate(int a)
+{
+	// 以B与C的子节点F交换为例:
+	//   A(B, C(F, G))  ==>  A(F, C'(B, G))
+	// 旋转不改变A的包围盒, 只改变被修改的子节点(C')的包围盒, 比较它的表面积即可.
+	// 四种旋转: B与C的某个子节点交换, 或C与B的某个子节点交换.
+	const int b = mNodes[a].Child1;
+	const int c = mNodes[a].Child2;
+
+	int bestOuter = NullNode;		// 与孙节点交换的A的子节点.
+	int bestInner = NullNode;		// 被交换的孙节点.
+	float bestDelta = 0.0f;
+
+	const int pairs[2][2] = { { b, c }, { c, b } };
+	for (const auto& pair : pairs)
+	{
+		const int outer = pair[0];
+		const int other = pair[1];
+		const Node& otherNode = mNodes[other];
+		if (otherNode.IsLeaf())
+			continue;
+
+		const float otherArea = Area(otherNode.Min, otherNode.Max);
+		const Node& outerNode = mNodes[outer];
+		const int grandChildren[2] = { otherNode.Child1, otherNode.Child2 };
+		for (int i = 0; i < 2; ++i)
+		{
+			// outer与grandChildren[i]交换后, other的子节点变为outer和剩下的孙节点.
+			const Node& remaining = mNodes[grandChildren[1 - i]];
+			float delta = UnionArea(outerNode.Min, outerNode.Max, remaining.Min, remaining.Max) - otherArea;
+			if (delta < bestDelta)
+			{
+				bestDelta = delta;
+				bestOuter = outer;
+				bestInner = grandChildren[i];
+			}
+		}
+	}
+
+	if (bestOuter == NullNode)
+		return;
+
+	const int other = bestOuter == b ? c : b;
+
+	// A中的bestOuter换成bestInner.
+	if (mNodes[a].Child1 == bestOuter)
+		mNodes[a].Child1 = bestInner;
+	else
+		mNodes[a].Child2 = bestInner;
+	mNodes[bestInner].Parent = a;
+
+	// other中的bestInner换成bestOuter.
+	if (mNodes[other].Child1 == bestInner)
+		mNodes[other].Child1 = bestOuter;
+	else
+		mNodes[other].Child2 = bestOuter;
+	mNodes[bestOuter].Parent = other;
+
+	SetFromChildren(other);
+	SetFromChildren(a);
+}
+
+void DynamicAabbTree::QueryFrustum(const XMFLOAT4 frustumPlanes[6], std::vector<UINT>& visible) const
+{
+	if (mRoot == NullNode)
+		return;
+
+	XMFLOAT3 absNormals[6];
+	for (int p = 0; p < 6; ++p)
+		absNormals[p] = XMFLOAT3(fabsf(frustumPlanes[p].x), fabsf(frustumPlanes[p].y), fabsf(frustumPlanes[p].z));
+
+	mStack.clear();
+	mStack.push_back({ mRoot, 0x3f, 0.0f });
+
+	while (!mStack.empty())
+	{
+		StackEntry entry = mStack.back();
+		mStack.pop_back();
+
+		const Node& node = mNodes[entry.Node];
+
+		// mask为0时节点完全在视锥体内, 子树不再测试.
+		UINT mask = entry.PlaneMask;
+		if (mask != 0)
+		{
+			const float cx = 0.5f * (node.Min.x + node.Max.x);
+			const float cy = 0.5f * (node.Min.y + node.Max.y);
+			const float cz = 0.5f * (node.Min.z + node.Max.z);
+			const float ex = 0.5f * (node.Max.x - node.Min.x);
+			const float ey = 0.5f * (node.Max.y - node.Min.y);
+			const float ez = 0.5f * (node.Max.z - node.Min.z);
+
+			bool outside = false;
+			for (int p = 0; p < 6; ++p)
+			{
+				if ((mask & (1u << p)) == 0)
+					continue;
+
+				const XMFLOAT4& plane = frustumPlanes[p];
+				float d = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+				float r = absNormals[p].x * ex + absNormals[p].y * ey + absNormals[p].z * ez;
+
+				if (d + r < 0.0f)
+				{
+					outside = true;
+					break;
+				}
+
+				if (d - r >= 0.0f)
+					mask &= ~(1u << p);
+			}
+
+			if (outside)
+				continue;
+		}
+
+		if (node.IsLeaf())
+		{
+			visible.push_back(node.UserData);
+		}
+		else
+		{
+			mStack.push_back({ node.Child2, mask, 0.0f });
+			mStack.push_back({ node.Child1, mask, 0.0f });
+		}
+	}
+}
+
+void DynamicAabbTree::QueryOverlap(const BoundingBox& bounds, std::vector<UINT>& overlaps) const
+{
+	if (mRoot == NullNode)
+		return;
+
+	XMFLOAT3 mn, mx;
+	ToMinMax(bounds, mn, mx);
+
+	mStack.clear();
+	mStack.push_back({ mRoot, 0, 0.0f });
+
+	while (!mStack.empty())
+	{
+		const Node& node = mNodes[mStack.back().Node];
+		mStack.pop_back();
+
+		if (node.Max.x < mn.x || node.Min.x > mx.x ||
+			node.Max.y < mn.y || node.Min.y > mx.y ||
+			node.Max.z < mn.z || node.Min.z > mx.z)
+			continue;
+
+		if (node.IsLeaf())
+		{
+			overlaps.push_back(node.UserData);
+		}
+		else
+		{
+			mStack.push_back({ node.Child2, 0, 0.0f });
+			mStack.push_back({ node.Child1, 0, 0.0f });
+		}
+	}
+}
+
+void DynamicAabbTree::RayCast(FXMVECTOR origin, FXMVECTOR direction, float maxDistance,
+	const std::function<float(UINT userData, float maxDistance)>& callback) const
+{
+	if (mRoot == NullNode)
+		return;
+
+	XMFLOAT3 o, d;
+	XMStoreFloat3(&o, origin);
+	XMStoreFloat3(&d, direction);
+
+	// 方向分量为0时倒数为无穷大, slab测试仍然成立.
+	const XMFLOAT3 invDir(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+
+	float distance = 0.0f;
+	if (!RayHit(o, invDir, mNodes[mRoot].Min, mNodes[mRoot].Max, maxDistance, distance))
+		return;
+
+	mStack.clear();
+	mStack.push_back({ mRoot, 0, distance });
+
+	while (!mStack.empty())
+	{
+		StackEntry entry = mStack.back();
+		mStack.pop_back();
+
+		// 入栈后最远距离可能被更近的命中缩短了.
+		if (entry.Distance > maxDistance)
+			continue;
+
+		const Node& node = mNodes[entry.Node];
+		if (node.IsLeaf())
+		{
+			float value = callback(node.UserData, maxDistance);
+			if (value == 0.0f)
+				return;
+
+			maxDistance = (std::min)(maxDistance, value);
+			continue;
+		}
+
+		// 近的子节点后入栈, 先被访问.
+		float t1 = 0.0f;
+		float t2 = 0.0f;
+		bool hit1 = RayHit(o, invDir, mNodes[node.Child1].Min, mNodes[node.Child1].Max, maxDistance, t1);
+		bool hit2 = RayHit(o, invDir, mNodes[node.Child2].Min, mNodes[node.Child2].Max, maxDistance, t2);
+
+		if (hit1 && hit2)
+		{
+			if (t1 <= t2)
+			{
+				mStack.push_back({ node.Child2, 0, t2 });
+				mStack.push_back({ node.Child1, 0, t1 });
+			}
+			else
+			{
+				mStack.push_back({ node.Child1, 0, t1 });
+				mStack.push_back({ node.Child2, 0, t2 });
+			}
+		}
+		else if (hit1)
+		{
+			mStack.push_back({ node.Child1, 0, t1 });
+		}
+		else if (hit2)
+		{
+			mStack.push_back({ node.Child2, 0, t2 });
+		}
+	}
+}
+
+int DynamicAabbTree::Height() const
+{
+	return mRoot == NullNode ? 0 : mNodes[mRoot].Height;
+}
+
+float DynamicAabbTree::AreaRatio() const
+{
+	if (mRoot == NullNode)
+		return 0.0f;
+
+	float rootArea = Area(mNodes[mRoot].Min, mNodes[mRoot].Max);
+	if (rootArea <= 0.0f)
+		return 0.0f;
+
+	float totalArea = 0.0f;
+	for (const auto& node : mNodes)
+	{
+		if (node.Height > 0)
+			totalArea += Area(node.Min, node.Max);
+	}
+
+	return totalArea / rootArea;
+}
+
+bool DynamicAabbTree::Validate() const
+{
+	if (mRoot == NullNode)
+		return mProxyCount == 0;
+
+	if (mNodes[mRoot].Parent != NullNode)
+		return false;
+
+	// 可用节点数 = 叶节点数 + 内部节点数(叶节点数 - 1) + 空闲节点数.
+	UINT freeCount = 0;
+	for (int i = mFreeList; i != NullNode; i = mNodes[i].Parent)
+		++freeCount;
+
+	if (2 * mProxyCount - 1 + freeCount != (UINT)mNodes.size())
+		return false;
+
+	return ValidateNode(mRoot);
+}
+
+bool DynamicAabbTree::ValidateNode(int index) const
+{
+	const Node& node = mNodes[index];
+	if (node.IsLeaf())
+		return node.Height == 0 && node.Child2 == NullNode;
+
+	const Node& a = mNodes[node.Child1];
+	const Node& b = mNodes[node.Child2];
+	if (a.Parent != index || b.Parent != index)
+		return false;
+
+	if (node.Height != 1 + (std::max)(a.Height, b.Height))
+		return false;
+
+	// 内部节点的包围盒必须正好是两个子节点的并集.
+	if (node.Min.x != (std::min)(a.Min.x, b.Min.x) || node.Min.y != (std::min)(a.Min.y, b.Min.y) ||
+		node.Min.z != (std::min)(a.Min.z, b.Min.z) || node.Max.x != (std::max)(a.Max.x, b.Max.x) ||
+		node.Max.y != (std::max)(a.Max.y, b.Max.y) || node.Max.z != (std::max)(a.Max.z, b.Max.z))
+		return false;
+
+	return ValidateNode(node.Child1) && ValidateNode(node.Child2);
+}
@@ -0,0 +1,124 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXCollision.h>
+#include <Windows.h>
+#include <functional>
+#include <vector>
+
+///**************************************************************
+/// 动态包围盒层次树(Dynamic AABB Tree).
+/// 叶节点存放物体的世界空间包围盒(外扩了一圈余量), 插入时按表面积启发式(SAH)
+/// 选择兄弟节点, 插入/删除后沿祖先节点向上重新计算包围盒并做树旋转以降低表面积.
+/// 物体移动后只要新包围盒仍在外扩的包围盒内就不需要改动树, 否则只重新插入这一个叶节点.
+///**************************************************************
+class DynamicAabbTree
+{
+public:
+	static const int NullNode = -1;
+
+	///<summary>
+	/// margin为叶节点包围盒向外扩展的距离, 越大移动物体越少需要重新插入, 但查询越不精确.
+	///</summary>
+	explicit DynamicAabbTree(float margin = 0.1f);
+	DynamicAabbTree(const DynamicAabbTree& rhs) = delete;
+	DynamicAabbTree& operator=(const DynamicAabbTree& rhs) = delete;
+
+	// 删除所有物体.
+	void Clear();
+
+	///<summary>
+	/// 添加物体, bounds为世界空间包围盒, userData由查询返回.
+	/// 返回代理编号, 用于MoveProxy()/DestroyProxy().
+	///</summary>
+	int CreateProxy(const DirectX::BoundingBox& bounds, UINT userData);
+
+	void DestroyProxy(int proxy);
+
+	///<summary>
+	/// 物体移动后调用. displacement为本次的位移, 用于沿运动方向预先多扩展包围盒.
+	/// 返回true表示叶节点被重新插入, false表示新包围盒仍在原来外扩的包围盒内, 树没有改动.
+	///</summary>
+	bool MoveProxy(int proxy, const DirectX::BoundingBox& bounds,
+		const DirectX::XMFLOAT3& displacement = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	UINT UserData(int proxy) const { return mNodes[proxy].UserData; }
+
+	// 叶节点外扩后的包围盒.
+	DirectX::BoundingBox FatBounds(int proxy) const;
+
+	///<summary>
+	/// 视锥体查询, frustumPlanes是世界空间中法线朝内的平面(ExtractFrustumPlanes(planes, viewProj)).
+	/// 完全在视锥体内的子树不再逐个测试, 在某个平面内侧的节点其子节点不再测试该平面.
+	/// 结果(userData)追加到visible.
+	///</summary>
+	void QueryFrustum(const DirectX::XMFLOAT4 frustumPlanes[6], std::vector<UINT>& visible) const;
+
+	// 与包围盒相交的物体, 结果(userData)追加到overlaps.
+	void QueryOverlap(const DirectX::BoundingBox& bounds, std::vector<UINT>& overlaps) const;
+
+	///<summary>
+	/// 射线查询. 射线按与包围盒相交的先后访问叶节点, callback(userData, maxDistance)返回新的最远距离:
+	/// 返回命中距离可裁剪更远的节点, 返回maxDistance则继续, 返回0则结束查询.
+	/// direction须为单位向量, 距离以direction的长度为单位.
+	///</summary>
+	void RayCast(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance,
+		const std::function<float(UINT userData, float maxDistance)>& callback) const;
+
+	UINT ProxyCount() const { return mProxyCount; }
+
+	// 树的高度, 只有一个叶节点时为0.
+	int Height() const;
+
+	// 所有内部节点的表面积之和与根节点表面积的比值, 越小说明树的质量越好.
+	float AreaRatio() const;
+
+	// 检查树的结构和包围盒是否一致(调试用).
+	bool Validate() const;
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+
+		int Parent = NullNode;			// 在空闲链表中时为下一个空闲节点.
+		int Child1 = NullNode;			// 叶节点时为NullNode.
+		int Child2 = NullNode;
+		int Height = -1;				// 叶节点为0, 空闲节点为-1.
+		UINT UserData = 0;
+
+		bool IsLeaf() const { return Child1 == NullNode; }
+	};
+
+	struct StackEntry
+	{
+		int Node;
+		UINT PlaneMask;					// 视锥体查询: 还需要测试的平面.
+		float Distance;					// 射线查询: 射线进入节点包围盒的距离.
+	};
+
+	int AllocateNode();
+	void FreeNode(int node);
+
+	void InsertLeaf(int leaf);
+	void RemoveLeaf(int leaf);
+
+	// 从node开始向上重新计算包围盒和高度, 并尝试旋转.
+	void RefitAncestors(int node);
+	void Rotate(int node);
+
+	void SetFromChildren(int node);
+
+	bool ValidateNode(int node) const;
+
+private:
+	std::vector<Node> mNodes;
+	int mRoot = NullNode;
+	int mFreeList = NullNode;
+	UINT mProxyCount = 0;
+	float mMargin;
+
+	// 遍历用的栈, 避免每次查询分配内存(因此查询不能在多个线程中同时进行).
+	mutable std::vector<StackEntry> mStack;
+};
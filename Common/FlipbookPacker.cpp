@@ -0,0 +1,165 @@
+﻿#include "FlipbookPacker.h"
+#include "DDS.h"
+#include "DDSWriter.h"
+#include "MappedFile.h"
+#include <algorithm>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#include <cstdlib>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	///<summary>
+	/// 文件的最后修改时间, 文件不存在时返回false.
+	///</summary>
+	bool GetFileTime(const std::wstring& filename, uint64_t& time)
+	{
+#if defined(_WIN32)
+		WIN32_FILE_ATTRIBUTE_DATA data;
+		if (!GetFileAttributesExW(filename.c_str(), GetFileExInfoStandard, &data))
+			return false;
+
+		time = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+		return true;
+#else
+		std::vector<char> path(filename.size() * 4 + 1);
+		if (wcstombs(path.data(), filename.c_str(), path.size()) == (size_t)-1)
+			return false;
+
+		struct stat st;
+		if (stat(path.data(), &st) != 0)
+			return false;
+
+		time = (uint64_t)st.st_mtime;
+		return true;
+#endif
+	}
+}
+
+std::vector<std::wstring> FlipbookPacker::FramePaths(
+	const std::wstring& prefix,
+	UINT first,
+	UINT count,
+	UINT digits,
+	const std::wstring& extension)
+{
+	std::vector<std::wstring> paths;
+	paths.reserve(count);
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		std::wstring number = std::to_wstring(first + i);
+		if (number.size() < digits)
+			number.insert(0, digits - number.size(), L'0');
+
+		paths.push_back(prefix + number + extension);
+	}
+
+	return paths;
+}
+
+bool FlipbookPacker::Pack(const std::vector<std::wstring>& frames, const std::wstring& outFile, std::wstring& error)
+{
+	if (frames.empty())
+	{
+		error = L"FlipbookPacker: no frames.";
+		return false;
+	}
+
+	std::vector<MappedFile> files(frames.size());
+
+	DDSImage image;
+	image.ArraySize = (UINT)frames.size();
+	image.Subresources.reserve(frames.size() * 16);
+
+	for (size_t i = 0; i < frames.size(); ++i)
+	{
+		if (!files[i].Open(frames[i]))
+		{
+			error = L"FlipbookPacker: cannot open " + frames[i];
+			return false;
+		}
+
+		DDS_FILE_VIEW dds;
+		if (!ParseDDSData(files[i].Data(), files[i].Size(), dds))
+		{
+			error = L"FlipbookPacker: invalid DDS file " + frames[i];
+			return false;
+		}
+
+		const DDS_HEADER* header = dds.header;
+		const bool isArray = dds.headerDXT10 && (dds.headerDXT10->arraySize > 1 || dds.headerDXT10->resourceDimension != 3);
+		if ((header->flags & DDS_HEADER_FLAGS_VOLUME) || (header->caps2 & DDS_CUBEMAP) || isArray)
+		{
+			error = L"FlipbookPacker: frames must be single 2D textures, " + frames[i];
+			return false;
+		}
+
+		DXGI_FORMAT format = dds.headerDXT10 ? dds.headerDXT10->dxgiFormat : GetDXGIFormat(header->ddspf);
+		UINT mipLevels = (std::max)(header->mipMapCount, 1u);
+
+		if (i == 0)
+		{
+			if (format == DXGI_FORMAT_UNKNOWN)
+			{
+				error = L"FlipbookPacker: unsupported format in " + frames[i];
+				return false;
+			}
+
+			image.Format = format;
+			image.Width = header->width;
+			image.Height = header->height;
+			image.MipLevels = mipLevels;
+		}
+		else if (format != image.Format || header->width != image.Width ||
+			header->height != image.Height || mipLevels != image.MipLevels)
+		{
+			error = L"FlipbookPacker: " + frames[i] + L" does not match the size/format/mip count of " + frames[0];
+			return false;
+		}
+
+		const uint8_t* data = dds.bitData;
+		const uint8_t* end = dds.bitData + dds.bitSize;
+		for (UINT mip = 0; mip < mipLevels; ++mip)
+		{
+			size_t bytes = DDSWriter::SurfaceBytes(format, (std::max)(image.Width >> mip, 1u), (std::max)(image.Height >> mip, 1u));
+			if (data + bytes > end)
+			{
+				error = L"FlipbookPacker: truncated DDS file " + frames[i];
+				return false;
+			}
+
+			image.Subresources.push_back(data);
+			data += bytes;
+		}
+	}
+
+	return DDSWriter::Save(outFile, image, error);
+}
+
+bool FlipbookPacker::EnsurePacked(const std::vector<std::wstring>& frames, const std::wstring& outFile, std::wstring& error)
+{
+	uint64_t packedTime = 0;
+	if (GetFileTime(outFile, packedTime))
+	{
+		bool upToDate = true;
+		for (const auto& frame : frames)
+		{
+			uint64_t frameTime = 0;
+			if (GetFileTime(frame, frameTime) && frameTime > packedTime)
+			{
+				upToDate = false;
+				break;
+			}
+		}
+
+		if (upToDate)
+			return true;
+	}
+
+	return Pack(frames, outFile, error);
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+
+///**************************************************************
+/// 序列帧打包: 把尺寸、格式、mip数量都相同的一组2D DDS文件
+/// 合并成一个Texture2DArray的DDS文件(每一帧是一个数组元素).
+/// 运行时只需打开一个文件、创建一个SRV, 播放动画只需改变常量中的数组下标.
+///**************************************************************
+class FlipbookPacker
+{
+public:
+	///<summary>
+	/// 生成序列帧的文件名, 如FramePaths(L"Textures/Fire", 1, 120, 3, L".DDS")
+	/// 得到Textures/Fire001.DDS ~ Textures/Fire120.DDS.
+	///</summary>
+	static std::vector<std::wstring> FramePaths(
+		const std::wstring& prefix,
+		UINT first,
+		UINT count,
+		UINT digits,
+		const std::wstring& extension);
+
+	// 按frames的顺序打包到outFile.
+	static bool Pack(const std::vector<std::wstring>& frames, const std::wstring& outFile, std::wstring& error);
+
+	///<summary>
+	/// outFile不存在或比某一帧旧时重新打包, 否则直接使用已有的文件.
+	///</summary>
+	static bool EnsurePacked(const std::vector<std::wstring>& frames, const std::wstring& outFile, std::wstring& error);
+};
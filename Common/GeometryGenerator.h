@@ -58,7 +58,9 @@ public:
 
 	///<summary>
 	/// Creates a geosphere centered at the origin with the given radius.  The
-	/// depth controls the level of tessellation.
+	/// depth controls the level of tessellation.  Subdivide emits every triangle
+	/// with its own copies of the shared corners and midpoints; callers that want
+	/// shared vertices can weld them afterwards with MeshWelder::Weld.
 	///</summary>
 	void CreateGeosphere(float radius, UINT numSubdivisions, MeshData& meshData);
 
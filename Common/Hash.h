@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+///**************************************************************
+/// 64位FNV-1a哈希, 每次处理8个字节. 用作缓存的键(判断源文件内容是否改变), 不能用于安全用途.
+///**************************************************************
+namespace Fnv1a
+{
+	const uint64_t Offset = 0xcbf29ce484222325ull;
+	const uint64_t Prime = 0x100000001b3ull;
+
+	///<summary>
+	/// 把data混入hash并返回, 可以连续调用. 先混入长度, 拼接方式不同的数据不会得到相同的结果.
+	///</summary>
+	inline uint64_t Hash(const void* data, size_t size, uint64_t hash = Offset)
+	{
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		hash = (hash ^ (uint64_t)size) * Prime;
+
+		size_t i = 0;
+		for (; i + 8 <= size; i += 8)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			hash = (hash ^ word) * Prime;
+		}
+		for (; i < size; ++i)
+			hash = (hash ^ bytes[i]) * Prime;
+
+		return hash;
+	}
+}
@@ -0,0 +1,183 @@
+﻿#include "Heightfield.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <emmintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// 2PI = kTwoPiHi + kTwoPiLo, kTwoPiHi只有9位有效数字, k * kTwoPiHi在k < 2^15时没有舍入误差.
+	const float kTwoPiHi = 6.28125f;
+	const float kTwoPiLo = 1.9353071795864769e-3f;
+
+	// [-PI/2, PI/2]上的逼近多项式系数, sin为奇次项, cos为偶次项.
+	const float kSin[5] = { 0.9999999765912215f, -0.16666647635368012f, 8.3328998337859e-3f, -1.9800898316197152e-4f, 2.5904894818920704e-6f };
+	const float kCos[5] = { 0.9999999534662758f, -0.49999905346628004f, 4.16635846846814e-2f, -1.3853704256257722e-3f, 2.315393064265866e-5f };
+
+	// 一次处理一行的临时数组, 长度补齐到4的倍数.
+	struct RowScratch
+	{
+		std::vector<float> X, Z, Height, Dhdx, Dhdz;
+
+		void Resize(UINT count)
+		{
+			X.resize(count);
+			Z.resize(count);
+			Height.resize(count);
+			Dhdx.resize(count);
+			Dhdz.resize(count);
+		}
+	};
+
+	void EvaluateRow(const Heightfield::Function& function, BYTE* row, UINT vertexStride, UINT normalOffset,
+		UINT columnCount, RowScratch& scratch)
+	{
+		UINT paddedCount = (UINT)scratch.X.size();
+
+		for (UINT j = 0; j < columnCount; ++j)
+		{
+			const XMFLOAT3* p = (const XMFLOAT3*)(row + (size_t)j * vertexStride);
+			scratch.X[j] = p->x;
+			scratch.Z[j] = p->z;
+		}
+
+		// 补齐的部分重复最后一个点, 结果丢弃.
+		for (UINT j = columnCount; j < paddedCount; ++j)
+		{
+			scratch.X[j] = scratch.X[columnCount - 1];
+			scratch.Z[j] = scratch.Z[columnCount - 1];
+		}
+
+		function.Evaluate(scratch.X.data(), scratch.Z.data(), paddedCount,
+			scratch.Height.data(), scratch.Dhdx.data(), scratch.Dhdz.data());
+
+		if (normalOffset == Heightfield::NoNormal)
+		{
+			for (UINT j = 0; j < columnCount; ++j)
+				((XMFLOAT3*)(row + (size_t)j * vertexStride))->y = scratch.Height[j];
+			return;
+		}
+
+		// n = (-dh/dx, 1, -dh/dz) / sqrt(dh/dx^2 + 1 + dh/dz^2), 结果写回Dhdx/Dhdz/X(y分量).
+		XMVECTOR one = XMVectorReplicate(1.0f);
+		for (UINT j = 0; j < paddedCount; j += 4)
+		{
+			XMVECTOR dx = _mm_loadu_ps(&scratch.Dhdx[j]);
+			XMVECTOR dz = _mm_loadu_ps(&scratch.Dhdz[j]);
+			XMVECTOR lengthSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dz, dz, one));
+			XMVECTOR invLength = XMVectorDivide(one, XMVectorSqrt(lengthSq));
+
+			_mm_storeu_ps(&scratch.Dhdx[j], XMVectorNegate(XMVectorMultiply(dx, invLength)));
+			_mm_storeu_ps(&scratch.Dhdz[j], XMVectorNegate(XMVectorMultiply(dz, invLength)));
+			_mm_storeu_ps(&scratch.X[j], invLength);
+		}
+
+		for (UINT j = 0; j < columnCount; ++j)
+		{
+			BYTE* vertex = row + (size_t)j * vertexStride;
+			((XMFLOAT3*)vertex)->y = scratch.Height[j];
+			*(XMFLOAT3*)(vertex + normalOffset) = XMFLOAT3(scratch.Dhdx[j], scratch.X[j], scratch.Dhdz[j]);
+		}
+	}
+}
+
+void Heightfield::SinCos(FXMVECTOR x, XMVECTOR* sin, XMVECTOR* cos)
+{
+	// x - k * 2PI, k = round(x / 2PI).
+	XMVECTOR k = _mm_cvtepi32_ps(_mm_cvtps_epi32(XMVectorMultiply(x, XMVectorReplicate(1.0f / XM_2PI))));
+	XMVECTOR r = XMVectorNegativeMultiplySubtract(k, XMVectorReplicate(kTwoPiHi), x);
+	r = XMVectorNegativeMultiplySubtract(k, XMVectorReplicate(kTwoPiLo), r);
+
+	// |r| > PI/2 时: sin(r) = sin(sign(r) * PI - r), cos(r) = -cos(sign(r) * PI - r).
+	XMVECTOR signBit = XMVectorReplicate(-0.0f);
+	XMVECTOR sign = _mm_and_ps(r, signBit);
+	XMVECTOR signedPi = _mm_or_ps(XMVectorReplicate(XM_PI), sign);
+	XMVECTOR reflect = XMVectorGreater(_mm_andnot_ps(signBit, r), XMVectorReplicate(XM_PIDIV2));
+	r = XMVectorSelect(r, XMVectorSubtract(signedPi, r), reflect);
+	XMVECTOR cosSign = _mm_and_ps(reflect, signBit);
+
+	XMVECTOR r2 = XMVectorMultiply(r, r);
+
+	XMVECTOR s = XMVectorReplicate(kSin[4]);
+	s = XMVectorMultiplyAdd(s, r2, XMVectorReplicate(kSin[3]));
+	s = XMVectorMultiplyAdd(s, r2, XMVectorReplicate(kSin[2]));
+	s = XMVectorMultiplyAdd(s, r2, XMVectorReplicate(kSin[1]));
+	s = XMVectorMultiplyAdd(s, r2, XMVectorReplicate(kSin[0]));
+	*sin = XMVectorMultiply(s, r);
+
+	XMVECTOR c = XMVectorReplicate(kCos[4]);
+	c = XMVectorMultiplyAdd(c, r2, XMVectorReplicate(kCos[3]));
+	c = XMVectorMultiplyAdd(c, r2, XMVectorReplicate(kCos[2]));
+	c = XMVectorMultiplyAdd(c, r2, XMVectorReplicate(kCos[1]));
+	c = XMVectorMultiplyAdd(c, r2, XMVectorReplicate(kCos[0]));
+	*cos = _mm_xor_ps(c, cosSign);
+}
+
+void Heightfield::Hills::Evaluate(const float* x, const float* z, UINT count,
+	float* height, float* dhdx, float* dhdz) const
+{
+	XMVECTOR tenth = XMVectorReplicate(0.1f);
+	XMVECTOR a = XMVectorReplicate(0.3f);
+	XMVECTOR b = XMVectorReplicate(0.03f);
+
+	for (UINT i = 0; i < count; i += 4)
+	{
+		XMVECTOR px = _mm_loadu_ps(&x[i]);
+		XMVECTOR pz = _mm_loadu_ps(&z[i]);
+
+		XMVECTOR sinX, cosX, sinZ, cosZ;
+		SinCos(XMVectorMultiply(tenth, px), &sinX, &cosX);
+		SinCos(XMVectorMultiply(tenth, pz), &sinZ, &cosZ);
+
+		// h = 0.3 * (z * sin(0.1x) + x * cos(0.1z))
+		// dh/dx = 0.03 * z * cos(0.1x) + 0.3 * cos(0.1z)
+		// dh/dz = 0.3 * sin(0.1x) - 0.03 * x * sin(0.1z)
+		XMVECTOR h = XMVectorMultiply(a, XMVectorMultiplyAdd(pz, sinX, XMVectorMultiply(px, cosZ)));
+		XMVECTOR dx = XMVectorMultiplyAdd(XMVectorMultiply(b, pz), cosX, XMVectorMultiply(a, cosZ));
+		XMVECTOR dz = XMVectorNegativeMultiplySubtract(XMVectorMultiply(b, px), sinZ, XMVectorMultiply(a, sinX));
+
+		_mm_storeu_ps(&height[i], h);
+		_mm_storeu_ps(&dhdx[i], dx);
+		_mm_storeu_ps(&dhdz[i], dz);
+	}
+}
+
+void Heightfield::Evaluate(const Function& function, void* vertices, UINT vertexStride, UINT normalOffset,
+	UINT rowCount, UINT columnCount, UINT threadCount)
+{
+	if (rowCount == 0 || columnCount == 0)
+		return;
+
+	BYTE* base = (BYTE*)vertices;
+	UINT paddedCount = (columnCount + 3) & ~3u;
+	size_t rowBytes = (size_t)columnCount * vertexStride;
+
+	if (threadCount == 0)
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	if ((size_t)rowCount * columnCount < ParallelThreshold)
+		threadCount = 1;
+	threadCount = (std::min)(threadCount, rowCount);
+
+	// 每次取一行.
+	std::atomic<UINT> next(0);
+	auto worker = [&]()
+	{
+		RowScratch scratch;
+		scratch.Resize(paddedCount);
+
+		for (UINT i = next.fetch_add(1); i < rowCount; i = next.fetch_add(1))
+			EvaluateRow(function, base + i * rowBytes, vertexStride, normalOffset, columnCount, scratch);
+	};
+
+	std::vector<std::thread> threads;
+	for (UINT i = 1; i < threadCount; ++i)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto& t : threads)
+		t.join();
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <Windows.h>
+
+///**************************************************************
+/// 高度场批量求值: 对网格(如GeometryGenerator::CreateGrid)的顶点逐行计算高度和解析法线.
+/// 每一行的x、z坐标先收集到连续数组中, 高度函数一次处理一整行(SIMD, 每次4个点),
+/// 再由偏导数得到法线 n = normalize(-dh/dx, 1, -dh/dz), 最后写回顶点.
+/// 顶点很多时各行分给多个线程.
+///**************************************************************
+class Heightfield
+{
+public:
+	// 不写法线时的normalOffset.
+	static const UINT NoNormal = 0xffffffff;
+
+	// 顶点数超过这个数量才使用多线程.
+	static const UINT ParallelThreshold = 65536;
+
+	///<summary>
+	/// 高度函数. 实现Evaluate即可用于Heightfield::Evaluate.
+	///</summary>
+	class Function
+	{
+	public:
+		virtual ~Function() = default;
+
+		///<summary>
+		/// 计算count个点(x[i], z[i])的高度及两个偏导数. count是4的倍数, 数组不要求16字节对齐.
+		/// 会被多个线程同时调用.
+		///</summary>
+		virtual void Evaluate(const float* x, const float* z, UINT count,
+			float* height, float* dhdx, float* dhdz) const = 0;
+	};
+
+	///<summary>
+	/// 波浪演示中的山丘 h = 0.3 * (z * sin(0.1x) + x * cos(0.1z)).
+	///</summary>
+	class Hills : public Function
+	{
+	public:
+		void Evaluate(const float* x, const float* z, UINT count,
+			float* height, float* dhdx, float* dhdz) const override;
+	};
+
+	///<summary>
+	/// 同时计算4个sin和cos. 先用 x - k * 2PI 把角度变换到[-PI, PI](2PI拆成两部分相减, 减少舍入误差),
+	/// 再利用对称性变换到[-PI/2, PI/2], 用9次(sin)/8次(cos)的近似最佳一致逼近多项式计算.
+	/// 多项式本身的误差: sin不超过3.4e-9, cos不超过4.7e-8.
+	/// 加上float运算(主要是变换角度时)的舍入, 实测绝对误差: |x| <= 100时不超过3.0e-7,
+	/// |x| <= 10000时不超过3.6e-7; sinf/cosf的误差约为6e-8.
+	///</summary>
+	static void SinCos(DirectX::FXMVECTOR x, DirectX::XMVECTOR* sin, DirectX::XMVECTOR* cos);
+
+	///<summary>
+	/// 计算网格顶点的高度和法线. 顶点的位置(XMFLOAT3)须在顶点结构偏移0处, 只读取x、z, 写入y;
+	/// 法线(XMFLOAT3)在normalOffset处, 为NoNormal时不写法线.
+	/// 顶点按行存放, 共rowCount行, 每行columnCount个. threadCount为0时使用所有硬件线程.
+	///</summary>
+	static void Evaluate(const Function& function, void* vertices, UINT vertexStride, UINT normalOffset,
+		UINT rowCount, UINT columnCount, UINT threadCount = 0);
+};
@@ -0,0 +1,598 @@
+﻿#include "ImageImporter.h"
+#include "DDS.h"
+#include "DDSTextureLoader.h"
+#include "DDSWriter.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+
+using namespace DirectX;
+
+namespace
+{
+	inline uint16_t Read16(const uint8_t* p)
+	{
+		return (uint16_t)(p[0] | (p[1] << 8));
+	}
+
+	inline uint32_t Read32(const uint8_t* p)
+	{
+		return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+	}
+
+	///<summary>
+	/// BI_BITFIELDS中的一个通道: 按掩码取出后扩展到8位, 掩码为0时返回defaultValue.
+	///</summary>
+	struct ChannelMask
+	{
+		uint32_t Mask = 0;
+		UINT Shift = 0;
+		uint32_t Max = 0;
+
+		explicit ChannelMask(uint32_t mask) : Mask(mask)
+		{
+			if (mask == 0)
+				return;
+
+			while (((mask >> Shift) & 1) == 0)
+				++Shift;
+
+			Max = mask >> Shift;
+		}
+
+		uint8_t Extract(uint32_t pixel, uint8_t defaultValue) const
+		{
+			if (Mask == 0)
+				return defaultValue;
+
+			return (uint8_t)((((pixel & Mask) >> Shift) * 255 + Max / 2) / Max);
+		}
+	};
+
+	///<summary>
+	/// 很多工具写32位图像时alpha全部为0, 此时视为不透明. 之后统计是否存在透明像素.
+	///</summary>
+	void FinishAlpha(ImportedImage& image, bool hasAlphaChannel)
+	{
+		const size_t count = (size_t)image.Width * image.Height;
+		uint8_t* pixels = image.Pixels.data();
+
+		bool allZero = true;
+		for (size_t i = 0; i < count && allZero; ++i)
+			allZero = pixels[i * 4 + 3] == 0;
+
+		if (!hasAlphaChannel || allZero)
+		{
+			for (size_t i = 0; i < count; ++i)
+				pixels[i * 4 + 3] = 255;
+		}
+
+		image.HasAlpha = false;
+		for (size_t i = 0; i < count && !image.HasAlpha; ++i)
+			image.HasAlpha = pixels[i * 4 + 3] != 255;
+	}
+
+	// TGA的一个像素(或调色板项)转换为RGBA.
+	void DecodeTGAColor(const uint8_t* p, UINT bits, bool useAlpha, uint8_t* rgba)
+	{
+		switch (bits)
+		{
+		case 8:
+			rgba[0] = rgba[1] = rgba[2] = p[0];
+			rgba[3] = 255;
+			break;
+		case 15:
+		case 16:
+		{
+			const uint16_t v = Read16(p);
+			rgba[0] = (uint8_t)((((v >> 10) & 31) * 255 + 15) / 31);
+			rgba[1] = (uint8_t)((((v >> 5) & 31) * 255 + 15) / 31);
+			rgba[2] = (uint8_t)(((v & 31) * 255 + 15) / 31);
+			rgba[3] = (bits == 16 && useAlpha) ? ((v & 0x8000) ? 255 : 0) : 255;
+			break;
+		}
+		case 24:
+			rgba[0] = p[2];
+			rgba[1] = p[1];
+			rgba[2] = p[0];
+			rgba[3] = 255;
+			break;
+		default:
+			rgba[0] = p[2];
+			rgba[1] = p[1];
+			rgba[2] = p[0];
+			rgba[3] = p[3];
+			break;
+		}
+	}
+
+	DXGI_FORMAT SelectFormat(const ImportedImage& image, const ImageImportOptions& options)
+	{
+		if (options.Compress && image.Width % 4 == 0 && image.Height % 4 == 0)
+		{
+			if (image.HasAlpha)
+				return options.SRGB ? DXGI_FORMAT_BC3_UNORM_SRGB : DXGI_FORMAT_BC3_UNORM;
+
+			return options.SRGB ? DXGI_FORMAT_BC1_UNORM_SRGB : DXGI_FORMAT_BC1_UNORM;
+		}
+
+		return options.SRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	///<summary>
+	/// 缓存的DDS是否由内容哈希为sourceHash的源文件以相同参数转换而来.
+	///</summary>
+	bool IsValidCache(const std::wstring& ddsFile, uint64_t sourceHash, uint32_t optionsKey)
+	{
+		MappedFile file;
+		if (!file.Open(ddsFile))
+			return false;
+
+		DDS_FILE_VIEW dds;
+		if (!ParseDDSData(file.Data(), file.Size(), dds))
+			return false;
+
+		const uint32_t* stamp = dds.header->reserved1;
+		return stamp[0] == ImageImporter::Magic && stamp[1] == ImageImporter::Version &&
+			stamp[2] == (uint32_t)sourceHash && stamp[3] == (uint32_t)(sourceHash >> 32) &&
+			stamp[4] == optionsKey;
+	}
+}
+
+bool ImageImporter::IsSupported(const std::wstring& filename)
+{
+	const size_t dot = filename.find_last_of(L'.');
+	if (dot == std::wstring::npos)
+		return false;
+
+	std::wstring extension = filename.substr(dot + 1);
+	for (auto& c : extension)
+		c = (wchar_t)towlower(c);
+
+	return extension == L"bmp" || extension == L"tga";
+}
+
+bool ImageImporter::Decode(const uint8_t* data, size_t size, ImportedImage& image, std::wstring& error)
+{
+	// TGA没有文件标识, 不是BMP的都按TGA解析.
+	if (size >= 2 && data[0] == 'B' && data[1] == 'M')
+		return DecodeBMP(data, size, image, error);
+
+	return DecodeTGA(data, size, image, error);
+}
+
+bool ImageImporter::DecodeBMP(const uint8_t* data, size_t size, ImportedImage& image, std::wstring& error)
+{
+	if (size < 54 || data[0] != 'B' || data[1] != 'M')
+	{
+		error = L"不是有效的BMP文件.";
+		return false;
+	}
+
+	const uint32_t pixelOffset = Read32(data + 10);
+	const uint32_t headerSize = Read32(data + 14);
+	const int32_t width = (int32_t)Read32(data + 18);
+	const int32_t signedHeight = (int32_t)Read32(data + 22);
+	const UINT bitCount = Read16(data + 28);
+	const uint32_t compression = Read32(data + 30);
+	const uint32_t colorsUsed = Read32(data + 46);
+
+	// BITMAPCOREHEADER(12字节)只在很老的文件中使用.
+	if (headerSize < 40 || 14 + (size_t)headerSize > size)
+	{
+		error = L"BMP: 不支持的文件头.";
+		return false;
+	}
+
+	// 0: BI_RGB, 3: BI_BITFIELDS, 6: BI_ALPHABITFIELDS. RLE等压缩方式不支持.
+	if (compression != 0 && compression != 3 && compression != 6)
+	{
+		error = L"BMP: 不支持压缩的BMP文件.";
+		return false;
+	}
+
+	if (bitCount != 1 && bitCount != 4 && bitCount != 8 && bitCount != 16 && bitCount != 24 && bitCount != 32)
+	{
+		error = L"BMP: 不支持的像素位数.";
+		return false;
+	}
+
+	// 高度为负数时第一行在最上方.
+	const bool topDown = signedHeight < 0;
+	const int64_t height = topDown ? -(int64_t)signedHeight : signedHeight;
+	if (width <= 0 || height <= 0 || width > 16384 || height > 16384)
+	{
+		error = L"BMP: 无效的图像尺寸.";
+		return false;
+	}
+
+	const size_t rowBytes = (((size_t)width * bitCount + 31) / 32) * 4;
+	if ((size_t)pixelOffset + rowBytes * (size_t)height > size)
+	{
+		error = L"BMP: 文件不完整.";
+		return false;
+	}
+
+	// 16/32位的通道掩码: BI_BITFIELDS时紧跟在40字节的文件头之后(V4/V5文件头中位于同一位置).
+	uint32_t masks[4] = { 0, 0, 0, 0 };
+	if (compression == 3 || compression == 6)
+	{
+		if (54 + 12 > (size_t)pixelOffset)
+		{
+			error = L"BMP: 缺少通道掩码.";
+			return false;
+		}
+
+		masks[0] = Read32(data + 54);
+		masks[1] = Read32(data + 58);
+		masks[2] = Read32(data + 62);
+		if ((compression == 6 || headerSize >= 56) && 70 <= (size_t)pixelOffset)
+			masks[3] = Read32(data + 66);
+	}
+	else if (bitCount == 16)
+	{
+		masks[0] = 0x7c00;
+		masks[1] = 0x03e0;
+		masks[2] = 0x001f;
+	}
+	else if (bitCount == 32)
+	{
+		masks[0] = 0x00ff0000;
+		masks[1] = 0x0000ff00;
+		masks[2] = 0x000000ff;
+		masks[3] = 0xff000000;
+	}
+
+	const ChannelMask red(masks[0]), green(masks[1]), blue(masks[2]), alpha(masks[3]);
+
+	// 调色板紧跟在文件头之后, 每项为B, G, R, 保留.
+	std::vector<uint8_t> palette;
+	if (bitCount <= 8)
+	{
+		const size_t entries = colorsUsed != 0 ? (std::min)(colorsUsed, 256u) : ((size_t)1 << bitCount);
+		const size_t paletteOffset = 14 + (size_t)headerSize;
+		if (paletteOffset + entries * 4 > size)
+		{
+			error = L"BMP: 文件不完整.";
+			return false;
+		}
+
+		palette.assign(256 * 4, 0);
+		for (size_t i = 0; i < entries; ++i)
+		{
+			const uint8_t* p = data + paletteOffset + i * 4;
+			palette[i * 4 + 0] = p[2];
+			palette[i * 4 + 1] = p[1];
+			palette[i * 4 + 2] = p[0];
+			palette[i * 4 + 3] = 255;
+		}
+	}
+
+	image.Width = (UINT)width;
+	image.Height = (UINT)height;
+	image.Pixels.resize((size_t)image.Width * image.Height * 4);
+
+	for (UINT y = 0; y < image.Height; ++y)
+	{
+		const UINT srcY = topDown ? y : image.Height - 1 - y;
+		const uint8_t* src = data + pixelOffset + rowBytes * srcY;
+		uint8_t* dst = image.Pixels.data() + (size_t)y * image.Width * 4;
+
+		for (UINT x = 0; x < image.Width; ++x, dst += 4)
+		{
+			switch (bitCount)
+			{
+			case 1:
+			case 4:
+			case 8:
+			{
+				const UINT bit = x * bitCount;
+				const UINT index = (src[bit / 8] >> (8 - bitCount - bit % 8)) & ((1u << bitCount) - 1);
+				memcpy(dst, &palette[index * 4], 4);
+				break;
+			}
+			case 24:
+				dst[0] = src[x * 3 + 2];
+				dst[1] = src[x * 3 + 1];
+				dst[2] = src[x * 3 + 0];
+				dst[3] = 255;
+				break;
+			default:
+			{
+				const uint32_t pixel = bitCount == 16 ? Read16(src + x * 2) : Read32(src + x * 4);
+				dst[0] = red.Extract(pixel, 0);
+				dst[1] = green.Extract(pixel, 0);
+				dst[2] = blue.Extract(pixel, 0);
+				dst[3] = alpha.Extract(pixel, 255);
+				break;
+			}
+			}
+		}
+	}
+
+	FinishAlpha(image, bitCount >= 16 && masks[3] != 0);
+	return true;
+}
+
+bool ImageImporter::DecodeTGA(const uint8_t* data, size_t size, ImportedImage& image, std::wstring& error)
+{
+	if (size < 18)
+	{
+		error = L"不是有效的TGA文件.";
+		return false;
+	}
+
+	const UINT idLength = data[0];
+	const UINT colorMapType = data[1];
+	const UINT imageType = data[2];
+	const UINT colorMapFirst = Read16(data + 3);
+	const UINT colorMapLength = Read16(data + 5);
+	const UINT colorMapBits = data[7];
+	const UINT width = Read16(data + 12);
+	const UINT height = Read16(data + 14);
+	const UINT bitCount = data[16];
+	const UINT descriptor = data[17];
+
+	// 1: 调色板, 2: 真彩色, 3: 灰度, 加8为对应的RLE压缩类型.
+	const bool rle = imageType >= 9;
+	const UINT baseType = rle ? imageType - 8 : imageType;
+	const UINT alphaBits = descriptor & 0x0f;
+
+	bool valid = colorMapType <= 1 && baseType >= 1 && baseType <= 3 && width > 0 && height > 0;
+	switch (baseType)
+	{
+	case 1:
+		valid = valid && colorMapType == 1 && bitCount == 8 &&
+			(colorMapBits == 15 || colorMapBits == 16 || colorMapBits == 24 || colorMapBits == 32);
+		break;
+	case 2:
+		valid = valid && (bitCount == 15 || bitCount == 16 || bitCount == 24 || bitCount == 32);
+		break;
+	default:
+		valid = valid && bitCount == 8;
+		break;
+	}
+
+	if (!valid)
+	{
+		error = L"TGA: 不支持的图像类型或像素格式.";
+		return false;
+	}
+
+	size_t offset = 18 + idLength;
+
+	// 调色板, 非调色板图像也可能带有调色板, 跳过即可.
+	std::vector<uint8_t> palette;
+	if (colorMapType == 1)
+	{
+		const size_t entryBytes = (colorMapBits + 7) / 8;
+		if (offset + entryBytes * colorMapLength > size)
+		{
+			error = L"TGA: 文件不完整.";
+			return false;
+		}
+
+		if (baseType == 1)
+		{
+			palette.resize((size_t)colorMapLength * 4);
+			for (UINT i = 0; i < colorMapLength; ++i)
+				DecodeTGAColor(data + offset + i * entryBytes, colorMapBits, alphaBits > 0, &palette[i * 4]);
+		}
+
+		offset += entryBytes * colorMapLength;
+	}
+
+	const size_t pixelBytes = (bitCount + 7) / 8;
+	const size_t count = (size_t)width * height;
+
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.resize(count * 4);
+
+	// 描述字节第5位为1时第一行在最上方, 第4位为1时从右向左.
+	const bool topOrigin = (descriptor & 0x20) != 0;
+	const bool rightOrigin = (descriptor & 0x10) != 0;
+
+	auto store = [&](size_t index, const uint8_t* src) -> bool
+	{
+		const UINT x = (UINT)(index % width);
+		const UINT y = (UINT)(index / width);
+		uint8_t* dst = image.Pixels.data() +
+			((size_t)(topOrigin ? y : height - 1 - y) * width + (rightOrigin ? width - 1 - x : x)) * 4;
+
+		if (baseType != 1)
+		{
+			DecodeTGAColor(src, bitCount, alphaBits > 0, dst);
+			return true;
+		}
+
+		const UINT entry = src[0];
+		if (entry < colorMapFirst || entry - colorMapFirst >= colorMapLength)
+			return false;
+
+		memcpy(dst, &palette[(entry - colorMapFirst) * 4], 4);
+		return true;
+	};
+
+	size_t index = 0;
+	while (index < count)
+	{
+		// RLE: 包头最高位为1时下一个像素重复(低7位 + 1)次, 否则为(低7位 + 1)个原始像素.
+		size_t run = 1;
+		bool repeat = false;
+		if (rle)
+		{
+			if (offset >= size)
+				break;
+
+			run = (data[offset] & 0x7f) + 1;
+			repeat = (data[offset] & 0x80) != 0;
+			++offset;
+		}
+
+		run = (std::min)(run, count - index);
+		const size_t bytes = repeat ? pixelBytes : pixelBytes * run;
+		if (offset + bytes > size)
+			break;
+
+		for (size_t i = 0; i < run; ++i)
+		{
+			if (!store(index + i, data + offset + (repeat ? 0 : i * pixelBytes)))
+			{
+				error = L"TGA: 调色板索引越界.";
+				return false;
+			}
+		}
+
+		offset += bytes;
+		index += run;
+	}
+
+	if (index < count)
+	{
+		error = L"TGA: 文件不完整.";
+		return false;
+	}
+
+	const bool hasAlphaChannel = bitCount == 32 || (bitCount == 16 && alphaBits > 0) ||
+		(baseType == 1 && (colorMapBits == 32 || (colorMapBits == 16 && alphaBits > 0)));
+	FinishAlpha(image, hasAlphaChannel);
+	return true;
+}
+
+bool ImageImporter::Convert(const ImportedImage& image, const ImageImportOptions& options,
+	std::vector<uint8_t>& dds, std::wstring& error)
+{
+	const DXGI_FORMAT baseFormat = options.SRGB ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	const DXGI_FORMAT format = SelectFormat(image, options);
+
+	std::vector<std::vector<uint8_t>> mips;
+	if (options.GenerateMips)
+	{
+		MipGeneratorOptions mipOptions;
+		mipOptions.SRGB = options.SRGB;
+		mipOptions.AlphaCutoff = options.AlphaCutoff;
+		mipOptions.ThreadCount = options.ThreadCount;
+
+		if (!MipGenerator::Generate(image.Pixels.data(), image.Width, image.Height, 0,
+			baseFormat, mipOptions, mips, error))
+			return false;
+	}
+	else
+	{
+		mips.push_back(image.Pixels);
+	}
+
+	DDSImage ddsImage;
+	ddsImage.Format = format;
+	ddsImage.Width = image.Width;
+	ddsImage.Height = image.Height;
+	ddsImage.MipLevels = (UINT)mips.size();
+
+	std::vector<std::vector<uint8_t>> blocks;
+	if (format == baseFormat)
+	{
+		for (const auto& mip : mips)
+			ddsImage.Subresources.push_back(mip.data());
+	}
+	else
+	{
+		std::vector<BCSurface> surfaces(mips.size());
+		std::vector<uint8_t*> outputs(mips.size());
+		blocks.resize(mips.size());
+
+		for (UINT i = 0; i < (UINT)mips.size(); ++i)
+		{
+			surfaces[i].Pixels = mips[i].data();
+			surfaces[i].Width = (std::max)(image.Width >> i, 1u);
+			surfaces[i].Height = (std::max)(image.Height >> i, 1u);
+
+			blocks[i].resize(DDSWriter::SurfaceBytes(format, surfaces[i].Width, surfaces[i].Height));
+			outputs[i] = blocks[i].data();
+			ddsImage.Subresources.push_back(outputs[i]);
+		}
+
+		if (!BCCompressor::Compress(surfaces, format, options.Quality, outputs, options.ThreadCount))
+		{
+			error = L"块压缩失败.";
+			return false;
+		}
+	}
+
+	return DDSWriter::Build(ddsImage, dds, error);
+}
+
+bool ImageImporter::EnsureConverted(const std::wstring& source, const ImageImportOptions& options,
+	std::wstring& ddsFile, std::wstring& error)
+{
+	MappedFile file;
+	if (!file.Open(source))
+	{
+		error = source + L"不存在！";
+		return false;
+	}
+
+	const uint64_t sourceHash = Fnv1a::Hash(file.Data(), file.Size());
+	const uint32_t optionsKey = OptionsKey(options);
+
+	ddsFile = source + L".dds";
+	if (IsValidCache(ddsFile, sourceHash, optionsKey))
+		return true;
+
+	///
+	/// 缓存不存在或已失效, 重新转换.
+	///
+	ImportedImage image;
+	if (!Decode(file.Data(), file.Size(), image, error))
+	{
+		error = source + L": " + error;
+		return false;
+	}
+
+	std::vector<uint8_t> dds;
+	if (!Convert(image, options, dds, error))
+	{
+		error = source + L": " + error;
+		return false;
+	}
+
+	// 在文件头的保留字段中记录源文件哈希和转换参数.
+	DDS_HEADER* header = reinterpret_cast<DDS_HEADER*>(dds.data() + sizeof(uint32_t));
+	header->reserved1[0] = Magic;
+	header->reserved1[1] = Version;
+	header->reserved1[2] = (uint32_t)sourceHash;
+	header->reserved1[3] = (uint32_t)(sourceHash >> 32);
+	header->reserved1[4] = optionsKey;
+
+	return DDSWriter::WriteFile(ddsFile, dds, error);
+}
+
+bool ImageImporter::CreateTexture(ID3D11Device* device, const std::wstring& filename,
+	const ImageImportOptions& options, ID3D11ShaderResourceView** srv, std::wstring& error)
+{
+	std::wstring ddsFile = filename;
+	if (IsSupported(filename) && !EnsureConverted(filename, options, ddsFile, error))
+		return false;
+
+	if (FAILED(CreateDDSTextureFromFile(device, ddsFile.c_str(), nullptr, srv)))
+	{
+		error = ddsFile + L": 创建纹理失败.";
+		return false;
+	}
+
+	return true;
+}
+
+uint32_t ImageImporter::OptionsKey(const ImageImportOptions& options)
+{
+	const uint32_t cutoff = (uint32_t)((std::min)((std::max)(options.AlphaCutoff, 0.0f), 1.0f) * 255.0f + 0.5f);
+
+	return (options.GenerateMips ? 1u : 0u) |
+		(options.Compress ? 2u : 0u) |
+		(options.SRGB ? 4u : 0u) |
+		((uint32_t)options.Quality << 3) |
+		(cutoff << 8);
+}
@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include "BCCompressor.h"
+#include <d3d11_1.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///**************************************************************
+/// BMP/TGA导入: 解码为R8G8B8A8, 生成mip链并可选地块压缩, 转换结果
+/// 以DDS保存在源文件旁边(tree0.bmp -> tree0.bmp.dds). DDS文件头的保留字段
+/// 记录源文件内容的哈希和转换参数, 两者都没变时直接使用缓存的DDS,
+/// 之后与其他纹理一样由DDSTextureLoader加载.
+///   BMP: 非压缩的1/4/8位调色板, 16/24/32位, 以及BI_BITFIELDS;
+///   TGA: 类型1/2/3及其RLE版本(9/10/11), 8/15/16/24/32位.
+///**************************************************************
+struct ImportedImage
+{
+	UINT Width = 0;
+	UINT Height = 0;
+	std::vector<uint8_t> Pixels;		// R8G8B8A8, 紧密排列, 第一行在最上方.
+	bool HasAlpha = false;				// 存在alpha不为255的像素.
+};
+
+struct ImageImportOptions
+{
+	bool GenerateMips = true;
+
+	///<summary>
+	/// 宽高都是4的倍数时块压缩: 不透明的图像用BC1, 否则用BC3.
+	/// 不满足条件或关闭时保存为R8G8B8A8.
+	///</summary>
+	bool Compress = true;
+	BCQuality Quality = BCQuality::Normal;
+
+	bool SRGB = false;					// 输出_SRGB格式, mip在线性空间滤波.
+	float AlphaCutoff = 0.0f;			// 见MipGeneratorOptions::AlphaCutoff.
+	UINT ThreadCount = 0;				// 0表示使用所有硬件线程.
+};
+
+class ImageImporter
+{
+public:
+	static const UINT Magic = 0x54504d49;	// "IMPT", 写在DDS_HEADER::reserved1[0].
+	static const UINT Version = 1;
+
+	// 按扩展名判断是否为可以导入的图像(.bmp/.tga, 不区分大小写).
+	static bool IsSupported(const std::wstring& filename);
+
+	///<summary>
+	/// 解码内存中的BMP或TGA文件(按文件头判断).
+	///</summary>
+	static bool Decode(const uint8_t* data, size_t size, ImportedImage& image, std::wstring& error);
+
+	static bool DecodeBMP(const uint8_t* data, size_t size, ImportedImage& image, std::wstring& error);
+	static bool DecodeTGA(const uint8_t* data, size_t size, ImportedImage& image, std::wstring& error);
+
+	///<summary>
+	/// 把解码后的图像转换为DDS文件的内容.
+	///</summary>
+	static bool Convert(const ImportedImage& image, const ImageImportOptions& options,
+		std::vector<uint8_t>& dds, std::wstring& error);
+
+	///<summary>
+	/// 缓存不存在或已失效时转换source, ddsFile返回缓存文件名.
+	///</summary>
+	static bool EnsureConverted(const std::wstring& source, const ImageImportOptions& options,
+		std::wstring& ddsFile, std::wstring& error);
+
+	///<summary>
+	/// 创建纹理: DDS文件直接加载, BMP/TGA先经过EnsureConverted.
+	///</summary>
+	static bool CreateTexture(ID3D11Device* device, const std::wstring& filename,
+		const ImageImportOptions& options, ID3D11ShaderResourceView** srv, std::wstring& error);
+
+	// 转换参数的摘要, 参数不同的缓存互不通用.
+	static uint32_t OptionsKey(const ImageImportOptions& options);
+};
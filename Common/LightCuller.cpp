@@ -0,0 +1,191 @@
+﻿#include "LightCuller.h"
+#include "d3dUtil.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <emmintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// 每次分给一个线程的物体数.
+	const UINT ObjectsPerTask = 16;
+
+	float Luminance(const XMFLOAT3& c)
+	{
+		return 0.2126f * c.x + 0.7152f * c.y + 0.0722f * c.z;
+	}
+
+	// 衰减的倒数区间, FalloffStart与FalloffEnd相同时也不会除以0.
+	float InvFalloffRange(const Light& light)
+	{
+		return 1.0f / (std::max)(light.FalloffEnd - light.FalloffStart, 1.0e-4f);
+	}
+
+	float Saturate(float x)
+	{
+		return (std::min)((std::max)(x, 0.0f), 1.0f);
+	}
+
+	///<summary>
+	/// 按影响从大到小保存至多Capacity个光源. 光源按下标递增的顺序加入,
+	/// 影响相同时先加入的在前, 所以结果与稳定排序后取前Capacity个相同.
+	///</summary>
+	struct TopList
+	{
+		float* Scores;
+		UINT* Indices;
+		UINT Capacity;
+		UINT Count;
+
+		// 新光源的影响必须大于这个值才能加入.
+		float Threshold() const { return Count < Capacity ? 0.0f : Scores[Capacity - 1]; }
+
+		void Insert(float score, UINT index)
+		{
+			UINT i = Count < Capacity ? Count++ : Capacity - 1;
+			while (i > 0 && Scores[i - 1] < score)
+			{
+				Scores[i] = Scores[i - 1];
+				Indices[i] = Indices[i - 1];
+				--i;
+			}
+			Scores[i] = score;
+			Indices[i] = index;
+		}
+	};
+}
+
+void LightCuller::SetLights(const Light* lights, UINT count)
+{
+	mLightCount = count;
+
+	UINT paddedCount = (count + 3) & ~3u;
+	mX.assign(paddedCount, 0.0f);
+	mY.assign(paddedCount, 0.0f);
+	mZ.assign(paddedCount, 0.0f);
+	mEnd.assign(paddedCount, 0.0f);
+	mEndSq.assign(paddedCount, -1.0f);
+	mInvRange.assign(paddedCount, 0.0f);
+	mLuminance.assign(paddedCount, 0.0f);
+
+	for (UINT i = 0; i < count; ++i)
+	{
+		const Light& light = lights[i];
+		mX[i] = light.Position.x;
+		mY[i] = light.Position.y;
+		mZ[i] = light.Position.z;
+		mEnd[i] = light.FalloffEnd;
+		mEndSq[i] = light.FalloffEnd * light.FalloffEnd;
+		mInvRange[i] = InvFalloffRange(light);
+		mLuminance[i] = Luminance(light.Strength);
+	}
+}
+
+void LightCuller::AssignRange(const BoundingBox* bounds, UINT first, UINT last, UINT maxLightsPerObject,
+	Range* ranges, UINT* indices, float* scores) const
+{
+	const UINT paddedCount = (UINT)mX.size();
+
+	for (UINT i = first; i < last; ++i)
+	{
+		const BoundingBox& b = bounds[i];
+		XMVECTOR minX = XMVectorReplicate(b.Center.x - b.Extents.x);
+		XMVECTOR minY = XMVectorReplicate(b.Center.y - b.Extents.y);
+		XMVECTOR minZ = XMVectorReplicate(b.Center.z - b.Extents.z);
+		XMVECTOR maxX = XMVectorReplicate(b.Center.x + b.Extents.x);
+		XMVECTOR maxY = XMVectorReplicate(b.Center.y + b.Extents.y);
+		XMVECTOR maxZ = XMVectorReplicate(b.Center.z + b.Extents.z);
+
+		TopList list = { scores, indices + (size_t)i * maxLightsPerObject, maxLightsPerObject, 0 };
+
+		for (UINT j = 0; j < paddedCount; j += 4)
+		{
+			// 光源到包围盒最近点的距离的平方.
+			XMVECTOR px = _mm_loadu_ps(&mX[j]);
+			XMVECTOR py = _mm_loadu_ps(&mY[j]);
+			XMVECTOR pz = _mm_loadu_ps(&mZ[j]);
+			XMVECTOR dx = XMVectorSubtract(px, XMVectorMin(XMVectorMax(px, minX), maxX));
+			XMVECTOR dy = XMVectorSubtract(py, XMVectorMin(XMVectorMax(py, minY), maxY));
+			XMVECTOR dz = XMVectorSubtract(pz, XMVectorMin(XMVectorMax(pz, minZ), maxZ));
+			XMVECTOR d2 = XMVectorAdd(XMVectorAdd(XMVectorMultiply(dx, dx), XMVectorMultiply(dy, dy)), XMVectorMultiply(dz, dz));
+
+			int mask = _mm_movemask_ps(XMVectorLess(d2, _mm_loadu_ps(&mEndSq[j])));
+			if (mask == 0)
+				continue;
+
+			XMVECTOR att = XMVectorSubtract(_mm_loadu_ps(&mEnd[j]), XMVectorSqrt(d2));
+			att = XMVectorSaturate(XMVectorMultiply(att, _mm_loadu_ps(&mInvRange[j])));
+			XMVECTOR score = XMVectorMultiply(_mm_loadu_ps(&mLuminance[j]), att);
+
+			mask &= _mm_movemask_ps(XMVectorGreater(score, XMVectorReplicate(list.Threshold())));
+			if (mask == 0)
+				continue;
+
+			XMFLOAT4 s;
+			XMStoreFloat4(&s, score);
+			const float* lanes = &s.x;
+			for (UINT k = 0; k < 4; ++k)
+			{
+				// 同一组中前面的光源加入后门槛可能提高, 需要再比较一次.
+				if ((mask & (1 << k)) && lanes[k] > list.Threshold())
+					list.Insert(lanes[k], j + k);
+			}
+		}
+
+		ranges[i].Count = list.Count;
+	}
+}
+
+void LightCuller::Assign(const BoundingBox* bounds, UINT count, UINT maxLightsPerObject,
+	std::vector<Range>& ranges, std::vector<UINT>& indices, UINT threadCount) const
+{
+	ranges.assign(count, Range());
+	indices.clear();
+	if (count == 0 || maxLightsPerObject == 0 || mLightCount == 0)
+		return;
+
+	// 先按每个物体maxLightsPerObject个的固定间隔写出, 各线程互不干扰, 最后再压紧.
+	indices.resize((size_t)count * maxLightsPerObject);
+
+	if (threadCount == 0)
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	if ((size_t)count * mLightCount < ParallelThreshold)
+		threadCount = 1;
+	UINT taskCount = (count + ObjectsPerTask - 1) / ObjectsPerTask;
+	threadCount = (std::min)(threadCount, taskCount);
+
+	std::atomic<UINT> next(0);
+	auto worker = [&]()
+	{
+		std::vector<float> scores(maxLightsPerObject);
+
+		for (UINT t = next.fetch_add(1); t < taskCount; t = next.fetch_add(1))
+		{
+			UINT first = t * ObjectsPerTask;
+			UINT last = (std::min)(first + ObjectsPerTask, count);
+			AssignRange(bounds, first, last, maxLightsPerObject, ranges.data(), indices.data(), scores.data());
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (UINT i = 1; i < threadCount; ++i)
+		threads.emplace_back(worker);
+
+	worker();
+
+	for (auto& t : threads)
+		t.join();
+
+	// 压紧: 每个区间只会向前移动.
+	UINT offset = 0;
+	for (UINT i = 0; i < count; ++i)
+	{
+		const UINT* src = indices.data() + (size_t)i * maxLightsPerObject;
+		std::copy(src, src + ranges[i].Count, indices.data() + offset);
+		ranges[i].Offset = offset;
+		offset += ranges[i].Count;
+	}
+	indices.resize(offset);
+}
@@ -0,0 +1,61 @@
+﻿#pragma once
+
+#include <DirectXCollision.h>
+#include <Windows.h>
+#include <vector>
+
+struct Light;
+
+///**************************************************************
+/// 点光源/聚光灯的CPU分配: 为每个物体从大量光源中选出影响最大的几个.
+/// 光源的位置、FalloffEnd的平方、亮度等按SoA存放, 每次用SIMD测试4个光源的
+/// FalloffEnd球与物体包围盒是否相交; 相交的光源按包围盒上离光源最近的点处的
+/// 亮度 * 衰减(与着色器的CalcAttenuation相同)排序, 只保留前K个.
+/// 结果是紧凑的索引列表: 每个物体一个区间, 着色器只需循环这个区间内的光源.
+///**************************************************************
+class LightCuller
+{
+public:
+	// 物体数 * 光源数超过这个数量才使用多线程.
+	static const UINT ParallelThreshold = 1 << 20;
+
+	// 一个物体的光源在索引列表中的区间.
+	struct Range
+	{
+		UINT Offset = 0;
+		UINT Count = 0;
+	};
+
+	///<summary>
+	/// 设置参与分配的光源(只应包含点光源和聚光灯, 聚光灯也按FalloffEnd球处理).
+	/// 分配结果中的索引是光源在lights中的下标.
+	///</summary>
+	void SetLights(const Light* lights, UINT count);
+
+	UINT LightCount() const { return mLightCount; }
+
+	///<summary>
+	/// 为count个世界空间包围盒各选出至多maxLightsPerObject个光源, 按影响从大到小排列,
+	/// 影响相同时下标小的在前. ranges[i]是物体i在indices中的区间.
+	/// threadCount为0时使用所有硬件线程, 工作量小于ParallelThreshold时总是单线程.
+	///</summary>
+	void Assign(const DirectX::BoundingBox* bounds, UINT count, UINT maxLightsPerObject,
+		std::vector<Range>& ranges, std::vector<UINT>& indices, UINT threadCount = 0) const;
+
+private:
+	// 物体[first, last)的结果写到indices + i * maxLightsPerObject, 个数写到ranges[i].Count.
+	void AssignRange(const DirectX::BoundingBox* bounds, UINT first, UINT last, UINT maxLightsPerObject,
+		Range* ranges, UINT* indices, float* scores) const;
+
+private:
+	UINT mLightCount = 0;
+
+	// SoA, 长度补齐到4的倍数; 补齐的光源mEndSq为-1, 不会与任何包围盒相交.
+	std::vector<float> mX;
+	std::vector<float> mY;
+	std::vector<float> mZ;
+	std::vector<float> mEnd;
+	std::vector<float> mEndSq;
+	std::vector<float> mInvRange;
+	std::vector<float> mLuminance;
+};
@@ -0,0 +1,143 @@
+﻿#include "MappedFile.h"
+#include <utility>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdlib>
+#include <vector>
+#endif
+
+MappedFile::MappedFile(MappedFile&& rhs)
+{
+	*this = std::move(rhs);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs)
+{
+	if (this != &rhs)
+	{
+		Close();
+
+		std::swap(mData, rhs.mData);
+		std::swap(mSize, rhs.mSize);
+#if defined(_WIN32)
+		std::swap(mFile, rhs.mFile);
+		std::swap(mMapping, rhs.mMapping);
+#endif
+	}
+
+	return *this;
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::wstring& filename)
+{
+	Close();
+
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ,
+		nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// 空文件无法创建映射, 上面已经排除.
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	mFile = file;
+	mMapping = mapping;
+	mData = static_cast<const uint8_t*>(view);
+	mSize = (size_t)fileSize.QuadPart;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData)
+		UnmapViewOfFile(mData);
+	if (mMapping)
+		CloseHandle(mMapping);
+	if (mFile)
+		CloseHandle(mFile);
+
+	mData = nullptr;
+	mSize = 0;
+	mMapping = nullptr;
+	mFile = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::wstring& filename)
+{
+	Close();
+
+	std::vector<char> path(filename.size() * 4 + 1);
+	if (wcstombs(path.data(), filename.c_str(), path.size()) == (size_t)-1)
+		return false;
+
+	int fd = open(path.data(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// 映射建立后文件描述符就可以关闭了.
+	close(fd);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	mData = static_cast<const uint8_t*>(view);
+	mSize = (size_t)st.st_size;
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (mData)
+		munmap(const_cast<uint8_t*>(mData), mSize);
+
+	mData = nullptr;
+	mSize = 0;
+}
+
+#endif
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+///**************************************************************
+/// 只读内存映射文件, Windows下使用文件映射, 其他平台使用mmap.
+///**************************************************************
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	MappedFile(MappedFile&& rhs);
+	MappedFile& operator=(MappedFile&& rhs);
+	~MappedFile();
+
+	// 映射整个文件, 失败(文件不存在或为空)返回false.
+	bool Open(const std::wstring& filename);
+	void Close();
+
+	bool IsOpen() const { return mData != nullptr; }
+	const uint8_t* Data() const { return mData; }
+	size_t Size() const { return mSize; }
+
+private:
+	const uint8_t* mData = nullptr;
+	size_t mSize = 0;
+
+#if defined(_WIN32)
+	void* mFile = nullptr;
+	void* mMapping = nullptr;
+#endif
+};
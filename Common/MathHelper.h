@@ -3,14 +3,16 @@
 #include <Windows.h>
 #include <DirectXMath.h>
 #include <cstdint>
+#include "Random.h"
 
 class MathHelper
 {
 public:
 	// Returns random float in [0, 1).
+	// Uses the calling thread's RandomStream; create a RandomStream for reproducible sequences.
 	static float RandF()
 	{
-		return (float)(rand()) / (float)RAND_MAX;
+		return RandomStream::ThreadLocal().NextFloat();
 	}
 
 	// Returns random float in [a, b).
@@ -19,9 +21,10 @@ public:
 		return a + RandF()*(b-a);
 	}
 
+    // Returns random int in [a, b].
     static int Rand(int a, int b)
     {
-        return a + rand() % ((b - a) + 1);
+        return RandomStream::ThreadLocal().NextInt(a, b);
     }
 
 	template<typename T>
@@ -0,0 +1,499 @@
+﻿#include "MeshCache.h"
+#include "Hash.h"
+#include "ModelLoader.h"
+#include "MeshCodec.h"
+#include "MeshWeld.h"
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint64_t kAlignment = 16;
+
+	inline uint64_t AlignUp(uint64_t x)
+	{
+		return (x + kAlignment - 1) & ~(kAlignment - 1);
+	}
+
+	inline bool IsCompressedModel(const std::wstring& filename)
+	{
+		const std::wstring ext = L".mshz";
+		return filename.size() >= ext.size() &&
+			_wcsicmp(filename.c_str() + filename.size() - ext.size(), ext.c_str()) == 0;
+	}
+
+	/// TextModelReader和CompressedModelReader的接口相同.
+	template<typename Reader>
+	bool ReadModel(
+		const std::wstring& modelFile,
+		UINT vertexStride,
+		UINT normalOffset,
+		std::vector<uint8_t>& vertices,
+		std::vector<UINT>& indices,
+		std::wstring& error)
+	{
+		Reader reader;
+		if (!reader.Open(modelFile))
+		{
+			error = reader.ErrorMessage();
+			return false;
+		}
+
+		vertices.assign((size_t)reader.VertexCount() * vertexStride, 0);
+		indices.resize(3 * reader.TriangleCount());
+
+		if (!reader.ReadVertices(vertices.data(), vertexStride, normalOffset) ||
+			!reader.ReadIndices(indices.data()))
+		{
+			error = reader.ErrorMessage();
+			return false;
+		}
+
+		return true;
+	}
+
+	void FillElement(const D3D11_INPUT_ELEMENT_DESC& desc, MeshCacheElement& element)
+	{
+		memset(&element, 0, sizeof(MeshCacheElement));
+		strncpy_s(element.SemanticName, desc.SemanticName, _TRUNCATE);
+		element.SemanticIndex = desc.SemanticIndex;
+		element.Format = (UINT)desc.Format;
+		element.AlignedByteOffset = desc.AlignedByteOffset;
+	}
+
+	const D3D11_INPUT_ELEMENT_DESC* FindElement(
+		const D3D11_INPUT_ELEMENT_DESC* layout,
+		UINT elementCount,
+		const char* semanticName)
+	{
+		for (UINT i = 0; i < elementCount; ++i)
+		{
+			if (layout[i].SemanticIndex == 0 && _stricmp(layout[i].SemanticName, semanticName) == 0)
+				return &layout[i];
+		}
+
+		return nullptr;
+	}
+
+	// 计算被索引引用的顶点的包围盒.
+	void ComputeBounds(
+		const uint8_t* vertices,
+		UINT vertexStride,
+		UINT positionOffset,
+		const UINT* indices,
+		UINT indexCount,
+		UINT baseVertex,
+		XMFLOAT3& center,
+		XMFLOAT3& extents)
+	{
+		center = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		extents = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+		if (indexCount == 0)
+			return;
+
+		XMVECTOR vMin = XMVectorReplicate(+MathHelper::Infinity);
+		XMVECTOR vMax = XMVectorReplicate(-MathHelper::Infinity);
+
+		for (UINT i = 0; i < indexCount; ++i)
+		{
+			const uint8_t* v = vertices + (size_t)(baseVertex + indices[i]) * vertexStride + positionOffset;
+			XMVECTOR p = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(v));
+
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		XMStoreFloat3(&center, 0.5f * (vMin + vMax));
+		XMStoreFloat3(&extents, 0.5f * (vMax - vMin));
+	}
+
+	bool WriteImage(const std::wstring& filename, const std::vector<uint8_t>& image)
+	{
+		std::ofstream fout(filename, std::ios::binary | std::ios::trunc);
+		if (!fout)
+			return false;
+
+		fout.write(reinterpret_cast<const char*>(image.data()), (std::streamsize)image.size());
+
+		return fout.good();
+	}
+
+	// 把标签混入哈希, 结果不为0.
+	uint64_t HashTag(uint64_t hash, const std::string& tag)
+	{
+		hash = Fnv1a::Hash(tag.data(), tag.size(), hash);
+		return hash != 0 ? hash : 1;
+	}
+
+	// 由模型文件名得到子网格名称, 如"Models/skull.txt" -> "skull".
+	std::string SubmeshNameFromFile(const std::wstring& filename)
+	{
+		size_t begin = filename.find_last_of(L"/\\");
+		begin = (begin == std::wstring::npos) ? 0 : begin + 1;
+
+		size_t end = filename.find_last_of(L'.');
+		if (end == std::wstring::npos || end < begin)
+			end = filename.size();
+
+		std::string name;
+		for (size_t i = begin; i < end; ++i)
+			name.push_back((char)filename[i]);
+
+		return name;
+	}
+}
+
+void MeshCacheFile::Close()
+{
+	mFile.Close();
+	mImage.clear();
+	mImage.shrink_to_fit();
+
+	mBase = nullptr;
+	mHeader = nullptr;
+}
+
+const MeshCacheSubmesh& MeshCacheFile::Submesh(UINT i) const
+{
+	assert(i < mHeader->SubmeshCount);
+
+	return reinterpret_cast<const MeshCacheSubmesh*>(mBase + mHeader->SubmeshesOffset)[i];
+}
+
+const MeshCacheSubmesh* MeshCacheFile::FindSubmesh(const std::string& name) const
+{
+	for (UINT i = 0; i < mHeader->SubmeshCount; ++i)
+	{
+		const MeshCacheSubmesh& submesh = Submesh(i);
+		if (strncmp(submesh.Name, name.c_str(), sizeof(submesh.Name)) == 0)
+			return &submesh;
+	}
+
+	return nullptr;
+}
+
+BoundingBox MeshCacheFile::Bounds() const
+{
+	return BoundingBox(mHeader->BoundsCenter, mHeader->BoundsExtents);
+}
+
+bool MeshCache::Load(
+	const std::wstring& cacheFile,
+	uint64_t sourceHash,
+	const D3D11_INPUT_ELEMENT_DESC* layout,
+	UINT elementCount,
+	UINT vertexStride,
+	MeshCacheFile& mesh)
+{
+	mesh.Close();
+
+	MappedFile file;
+	if (!file.Open(cacheFile))
+		return false;
+
+	if (!Validate(file.Data(), file.Size(), sourceHash, layout, elementCount, vertexStride))
+		return false;
+
+	mesh.mFile = std::move(file);
+	mesh.mBase = mesh.mFile.Data();
+	mesh.mHeader = reinterpret_cast<const MeshCacheHeader*>(mesh.mBase);
+
+	return true;
+}
+
+bool MeshCache::Save(
+	const std::wstring& cacheFile,
+	uint64_t sourceHash,
+	const D3D11_INPUT_ELEMENT_DESC* layout,
+	UINT elementCount,
+	UINT vertexStride,
+	const void* vertices,
+	UINT vertexCount,
+	const UINT* indices,
+	UINT indexCount,
+	const std::vector<MeshCacheSubmesh>& submeshes)
+{
+	std::vector<uint8_t> image;
+	BuildImage(sourceHash, layout, elementCount, vertexStride,
+		vertices, vertexCount, indices, indexCount, submeshes, image);
+
+	return WriteImage(cacheFile, image);
+}
+
+bool MeshCache::LoadTextModel(
+	const std::wstring& modelFile,
+	const D3D11_INPUT_ELEMENT_DESC* layout,
+	UINT elementCount,
+	UINT vertexStride,
+	const std::function<void(void* vertices, UINT vertexCount)>& postProcess,
+	const std::string& postProcessTag,
+	MeshCacheFile& mesh,
+	std::wstring& error)
+{
+	error.clear();
+	mesh.Close();
+
+	uint64_t fileHash = HashFile(modelFile);
+	if (fileHash == 0)
+	{
+		error = modelFile + L"不存在！";
+		return false;
+	}
+
+	// 源文件相同但后处理不同的缓存也要失效.
+	const uint64_t sourceHash = HashTag(fileHash, postProcessTag);
+
+	// 缓存放在工作目录中: 几个程序共用Models中的同一个模型, 顶点格式各不相同.
+	size_t slash = modelFile.find_last_of(L"/\\");
+	const std::wstring cacheFile = modelFile.substr(slash == std::wstring::npos ? 0 : slash + 1) + L".mesh";
+	if (Load(cacheFile, sourceHash, layout, elementCount, vertexStride, mesh))
+		return true;
+
+	///
+	/// 缓存不存在或已失效, 解析源模型.
+	///
+	const D3D11_INPUT_ELEMENT_DESC* position = FindElement(layout, elementCount, "POSITION");
+	if (position == nullptr || position->AlignedByteOffset != 0 ||
+		position->Format != DXGI_FORMAT_R32G32B32_FLOAT)
+	{
+		error = modelFile + L": 顶点布局的POSITION必须是位于偏移0处的R32G32B32_FLOAT.";
+		return false;
+	}
+
+	UINT normalOffset = TextModelReader::NoNormal;
+	const D3D11_INPUT_ELEMENT_DESC* normal = FindElement(layout, elementCount, "NORMAL");
+	if (normal != nullptr && normal->Format == DXGI_FORMAT_R32G32B32_FLOAT)
+		normalOffset = normal->AlignedByteOffset;
+
+	// .mshz是压缩后的模型, 其余按文本格式解析.
+	std::vector<uint8_t> vertices;
+	std::vector<UINT> indices;
+	bool read = IsCompressedModel(modelFile) ?
+		ReadModel<CompressedModelReader>(modelFile, vertexStride, normalOffset, vertices, indices, error) :
+		ReadModel<TextModelReader>(modelFile, vertexStride, normalOffset, vertices, indices, error);
+	if (!read)
+		return false;
+
+	UINT sourceVertexCount = (UINT)(vertices.size() / vertexStride);
+
+	if (postProcess)
+		postProcess(vertices.data(), sourceVertexCount);
+
+	// 焊接重合顶点, 删除退化和重复三角形.
+	MeshWeldLayout weldLayout;
+	weldLayout.VertexStride = vertexStride;
+	weldLayout.PositionOffset = 0;
+	weldLayout.NormalOffset = (normalOffset == TextModelReader::NoNormal) ? MeshWeldLayout::NoAttribute : normalOffset;
+
+	const D3D11_INPUT_ELEMENT_DESC* texC = FindElement(layout, elementCount, "TEXCOORD");
+	if (texC != nullptr && texC->Format == DXGI_FORMAT_R32G32_FLOAT)
+		weldLayout.TexCOffset = texC->AlignedByteOffset;
+
+	MeshWeldStats weldStats;
+	UINT vertexCount = MeshWelder::Weld(vertices.data(), sourceVertexCount, indices,
+		weldLayout, MeshWeldOptions(), weldStats);
+	MeshWelder::Report(modelFile, weldStats);
+
+	MeshCacheSubmesh submesh;
+	memset(&submesh, 0, sizeof(MeshCacheSubmesh));
+	strncpy_s(submesh.Name, SubmeshNameFromFile(modelFile).c_str(), _TRUNCATE);
+	submesh.IndexCount = (UINT)indices.size();
+
+	std::vector<uint8_t> image;
+	BuildImage(sourceHash, layout, elementCount, vertexStride,
+		vertices.data(), vertexCount, indices.data(), (UINT)indices.size(),
+		std::vector<MeshCacheSubmesh>(1, submesh), image);
+
+	// 写入失败(比如目录只读)不影响本次使用, 下次启动会重新生成.
+	WriteImage(cacheFile, image);
+
+	mesh.mImage = std::move(image);
+	mesh.mBase = mesh.mImage.data();
+	mesh.mHeader = reinterpret_cast<const MeshCacheHeader*>(mesh.mBase);
+
+	return true;
+}
+
+uint64_t MeshCache::HashFile(const std::wstring& filename)
+{
+	MappedFile file;
+	if (!file.Open(filename))
+		return 0;
+
+	uint64_t hash = Fnv1a::Hash(file.Data(), file.Size());
+
+	// 0保留给"文件不存在".
+	return hash != 0 ? hash : 1;
+}
+
+void MeshCache::BuildImage(
+	uint64_t sourceHash,
+	const D3D11_INPUT_ELEMENT_DESC* layout,
+	UINT elementCount,
+	UINT vertexStride,
+	const void* vertices,
+	UINT vertexCount,
+	const UINT* indices,
+	UINT indexCount,
+	const std::vector<MeshCacheSubmesh>& submeshes,
+	std::vector<uint8_t>& image)
+{
+	const UINT submeshCount = submeshes.empty() ? 1 : (UINT)submeshes.size();
+
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(MeshCacheHeader));
+	header.Magic = Magic;
+	header.Version = Version;
+	header.SourceHash = sourceHash;
+	header.VertexStride = vertexStride;
+	header.VertexCount = vertexCount;
+	header.IndexCount = indexCount;
+	header.IndexFormat = DXGI_FORMAT_R32_UINT;
+	header.ElementCount = elementCount;
+	header.SubmeshCount = submeshCount;
+
+	uint64_t offset = AlignUp(sizeof(MeshCacheHeader));
+	header.ElementsOffset = (UINT)offset;
+	offset = AlignUp(offset + (uint64_t)elementCount * sizeof(MeshCacheElement));
+	header.SubmeshesOffset = (UINT)offset;
+	offset = AlignUp(offset + (uint64_t)submeshCount * sizeof(MeshCacheSubmesh));
+	header.VertexDataOffset = offset;
+	offset = AlignUp(offset + (uint64_t)vertexCount * vertexStride);
+	header.IndexDataOffset = offset;
+	offset = AlignUp(offset + (uint64_t)indexCount * sizeof(UINT));
+	header.FileSize = offset;
+
+	image.assign((size_t)header.FileSize, 0);
+	uint8_t* base = image.data();
+
+	MeshCacheElement* elements = reinterpret_cast<MeshCacheElement*>(base + header.ElementsOffset);
+	for (UINT i = 0; i < elementCount; ++i)
+		FillElement(layout[i], elements[i]);
+
+	MeshCacheSubmesh* dstSubmeshes = reinterpret_cast<MeshCacheSubmesh*>(base + header.SubmeshesOffset);
+	if (submeshes.empty())
+	{
+		memset(dstSubmeshes, 0, sizeof(MeshCacheSubmesh));
+		dstSubmeshes[0].IndexCount = indexCount;
+	}
+	else
+	{
+		memcpy(dstSubmeshes, submeshes.data(), submeshes.size() * sizeof(MeshCacheSubmesh));
+	}
+
+	if (vertexCount > 0)
+		memcpy(base + header.VertexDataOffset, vertices, (size_t)vertexCount * vertexStride);
+	if (indexCount > 0)
+		memcpy(base + header.IndexDataOffset, indices, (size_t)indexCount * sizeof(UINT));
+
+	///
+	/// 包围盒.
+	///
+	const D3D11_INPUT_ELEMENT_DESC* position = FindElement(layout, elementCount, "POSITION");
+	if (position != nullptr &&
+		(position->Format == DXGI_FORMAT_R32G32B32_FLOAT || position->Format == DXGI_FORMAT_R32G32B32A32_FLOAT))
+	{
+		const uint8_t* vertexData = static_cast<const uint8_t*>(vertices);
+
+		BoundingBox meshBounds;
+		for (UINT i = 0; i < submeshCount; ++i)
+		{
+			MeshCacheSubmesh& submesh = dstSubmeshes[i];
+			ComputeBounds(vertexData, vertexStride, position->AlignedByteOffset,
+				indices + submesh.StartIndexLocation, submesh.IndexCount, submesh.BaseVertexLocation,
+				submesh.BoundsCenter, submesh.BoundsExtents);
+
+			BoundingBox bounds(submesh.BoundsCenter, submesh.BoundsExtents);
+			if (i == 0)
+				meshBounds = bounds;
+			else
+				BoundingBox::CreateMerged(meshBounds, meshBounds, bounds);
+		}
+
+		header.BoundsCenter = meshBounds.Center;
+		header.BoundsExtents = meshBounds.Extents;
+	}
+
+	memcpy(base, &header, sizeof(MeshCacheHeader));
+}
+
+bool MeshCache::Validate(
+	const uint8_t* data,
+	size_t size,
+	uint64_t sourceHash,
+	const D3D11_INPUT_ELEMENT_DESC* layout,
+	UINT elementCount,
+	UINT vertexStride)
+{
+	if (size < sizeof(MeshCacheHeader))
+		return false;
+
+	const MeshCacheHeader& header = *reinterpret_cast<const MeshCacheHeader*>(data);
+
+	if (header.Magic != Magic || header.Version != Version ||
+		header.SourceHash != sourceHash || header.FileSize != size ||
+		header.VertexStride != vertexStride || header.ElementCount != elementCount ||
+		header.IndexFormat != DXGI_FORMAT_R32_UINT)
+	{
+		return false;
+	}
+
+	// 数据块必须对齐并且位于文件内(防止文件被截断).
+	if (header.ElementsOffset % kAlignment != 0 || header.SubmeshesOffset % kAlignment != 0 ||
+		header.VertexDataOffset % kAlignment != 0 || header.IndexDataOffset % kAlignment != 0)
+	{
+		return false;
+	}
+
+	if (header.ElementsOffset + (uint64_t)header.ElementCount * sizeof(MeshCacheElement) > size ||
+		header.SubmeshesOffset + (uint64_t)header.SubmeshCount * sizeof(MeshCacheSubmesh) > size ||
+		header.VertexDataOffset + (uint64_t)header.VertexCount * header.VertexStride > size ||
+		header.IndexDataOffset + (uint64_t)header.IndexCount * sizeof(UINT) > size)
+	{
+		return false;
+	}
+
+	// 顶点布局必须与调用者一致.
+	const MeshCacheElement* elements = reinterpret_cast<const MeshCacheElement*>(data + header.ElementsOffset);
+	for (UINT i = 0; i < elementCount; ++i)
+	{
+		MeshCacheElement element;
+		FillElement(layout[i], element);
+
+		if (memcmp(&element, &elements[i], sizeof(MeshCacheElement)) != 0)
+			return false;
+	}
+
+	const MeshCacheSubmesh* submeshes = reinterpret_cast<const MeshCacheSubmesh*>(data + header.SubmeshesOffset);
+	for (UINT i = 0; i < header.SubmeshCount; ++i)
+	{
+		if ((uint64_t)submeshes[i].StartIndexLocation + submeshes[i].IndexCount > header.IndexCount)
+			return false;
+	}
+
+	// 索引(加上子网格的BaseVertexLocation)必须引用存在的顶点, 否则损坏的缓存会得到越界的索引缓冲区.
+	const UINT* indices = reinterpret_cast<const UINT*>(data + header.IndexDataOffset);
+	for (UINT i = 0; i < header.IndexCount; ++i)
+	{
+		if (indices[i] >= header.VertexCount)
+			return false;
+	}
+
+	for (UINT i = 0; i < header.SubmeshCount; ++i)
+	{
+		const MeshCacheSubmesh& submesh = submeshes[i];
+		if (submesh.BaseVertexLocation == 0)
+			continue;
+
+		const UINT* first = indices + submesh.StartIndexLocation;
+		for (UINT j = 0; j < submesh.IndexCount; ++j)
+		{
+			if ((uint64_t)submesh.BaseVertexLocation + first[j] >= header.VertexCount)
+				return false;
+		}
+	}
+
+	return true;
+}
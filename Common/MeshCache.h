@@ -0,0 +1,166 @@
+﻿#pragma once
+
+#include "d3dUtil.h"
+#include "MappedFile.h"
+#include <DirectXCollision.h>
+#include <functional>
+
+///**************************************************************
+/// 二进制网格缓存.
+/// 文件布局: 文件头 | 顶点布局描述 | 子网格表 | 顶点数据 | 索引数据,
+/// 各数据块按16字节对齐, 映射后可以直接作为D3D11_SUBRESOURCE_DATA::pSysMem.
+///**************************************************************
+
+/// 顶点布局中的一个元素, 与D3D11_INPUT_ELEMENT_DESC对应.
+struct MeshCacheElement
+{
+	char SemanticName[16];
+	UINT SemanticIndex;
+	UINT Format;						// DXGI_FORMAT.
+	UINT AlignedByteOffset;
+	UINT Reserved;
+};
+
+/// 子网格表中的一项.
+struct MeshCacheSubmesh
+{
+	char Name[32];
+	UINT BaseVertexLocation;
+	UINT StartIndexLocation;
+	UINT IndexCount;
+	DirectX::XMFLOAT3 BoundsCenter;		// 模型空间包围盒.
+	DirectX::XMFLOAT3 BoundsExtents;
+};
+
+struct MeshCacheHeader
+{
+	UINT Magic;
+	UINT Version;
+	uint64_t SourceHash;				// 源文件内容(及后处理标签)的哈希, 不一致时缓存失效.
+	uint64_t FileSize;
+
+	UINT VertexStride;
+	UINT VertexCount;
+	UINT IndexCount;
+	UINT IndexFormat;					// DXGI_FORMAT, 目前只有R32_UINT.
+
+	UINT ElementCount;
+	UINT SubmeshCount;
+	UINT ElementsOffset;
+	UINT SubmeshesOffset;
+	uint64_t VertexDataOffset;
+	uint64_t IndexDataOffset;
+
+	DirectX::XMFLOAT3 BoundsCenter;		// 整个网格的包围盒.
+	DirectX::XMFLOAT3 BoundsExtents;
+};
+
+///**************************************************************
+/// 加载后的网格缓存, 数据指针在对象销毁或Close()前有效.
+///**************************************************************
+class MeshCacheFile
+{
+public:
+	bool IsOpen() const { return mHeader != nullptr; }
+	void Close();
+
+	// 是否来自磁盘上的缓存文件(false表示本次由源文件生成).
+	bool FromCache() const { return mFile.IsOpen(); }
+
+	const void* Vertices() const { return mBase + mHeader->VertexDataOffset; }
+	UINT VertexCount() const { return mHeader->VertexCount; }
+	UINT VertexStride() const { return mHeader->VertexStride; }
+
+	const UINT* Indices() const { return reinterpret_cast<const UINT*>(mBase + mHeader->IndexDataOffset); }
+	UINT IndexCount() const { return mHeader->IndexCount; }
+
+	UINT SubmeshCount() const { return mHeader->SubmeshCount; }
+	const MeshCacheSubmesh& Submesh(UINT i) const;
+	const MeshCacheSubmesh* FindSubmesh(const std::string& name) const;
+
+	DirectX::BoundingBox Bounds() const;
+
+private:
+	friend class MeshCache;
+
+	MappedFile mFile;
+	std::vector<uint8_t> mImage;		// 缓存文件无法写入时, 数据保存在内存中.
+
+	const uint8_t* mBase = nullptr;
+	const MeshCacheHeader* mHeader = nullptr;
+};
+
+class MeshCache
+{
+public:
+	static const UINT Magic = 0x4348534d;	// "MSHC".
+	static const UINT Version = 3;
+
+	///<summary>
+	/// 映射缓存文件, 检查版本、源文件哈希和顶点布局, 任一不一致都返回false.
+	///</summary>
+	static bool Load(
+		const std::wstring& cacheFile,
+		uint64_t sourceHash,
+		const D3D11_INPUT_ELEMENT_DESC* layout,
+		UINT elementCount,
+		UINT vertexStride,
+		MeshCacheFile& mesh);
+
+	///<summary>
+	/// 生成缓存文件, submeshes为空时整个网格作为一个子网格.
+	/// 子网格和整个网格的包围盒由POSITION元素计算.
+	///</summary>
+	static bool Save(
+		const std::wstring& cacheFile,
+		uint64_t sourceHash,
+		const D3D11_INPUT_ELEMENT_DESC* layout,
+		UINT elementCount,
+		UINT vertexStride,
+		const void* vertices,
+		UINT vertexCount,
+		const UINT* indices,
+		UINT indexCount,
+		const std::vector<MeshCacheSubmesh>& submeshes);
+
+	///<summary>
+	/// 加载skull.txt/car.txt格式的模型或压缩后的.mshz模型(见MeshCodec), 优先使用工作目录中的<模型文件名>.mesh缓存.
+	/// 缓存不存在或失效时解析源模型(POSITION必须在偏移0处, 有NORMAL时读取法线),
+	/// 调用postProcess填充其余顶点属性, 焊接重合顶点(见MeshWelder), 然后写入缓存.
+	/// postProcessTag标识postProcess的内容, 与源文件哈希一起作为缓存的键;
+	/// 修改postProcess时必须同时修改标签(比如递增其中的版本号), 否则会继续使用旧的缓存.
+	///</summary>
+	static bool LoadTextModel(
+		const std::wstring& modelFile,
+		const D3D11_INPUT_ELEMENT_DESC* layout,
+		UINT elementCount,
+		UINT vertexStride,
+		const std::function<void(void* vertices, UINT vertexCount)>& postProcess,
+		const std::string& postProcessTag,
+		MeshCacheFile& mesh,
+		std::wstring& error);
+
+	// 文件内容的64位哈希, 文件不存在时返回0.
+	static uint64_t HashFile(const std::wstring& filename);
+
+private:
+	static void BuildImage(
+		uint64_t sourceHash,
+		const D3D11_INPUT_ELEMENT_DESC* layout,
+		UINT elementCount,
+		UINT vertexStride,
+		const void* vertices,
+		UINT vertexCount,
+		const UINT* indices,
+		UINT indexCount,
+		const std::vector<MeshCacheSubmesh>& submeshes,
+		std::vector<uint8_t>& image);
+
+	static bool Validate(
+		const uint8_t* data,
+		size_t size,
+		uint64_t sourceHash,
+		const D3D11_INPUT_ELEMENT_DESC* layout,
+		UINT elementCount,
+		UINT vertexStride);
+};
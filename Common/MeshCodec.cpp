@@ -0,0 +1,1298 @@
+﻿#include "MeshCodec.h"
+#include "ModelLoader.h"
+#include "MathHelper.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <climits>
+#include <fstream>
+#include <queue>
+#include <emmintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT kHasNormals = 0x1;
+
+	enum StreamMode : uint8_t
+	{
+		StreamStored = 0,
+		StreamHuffman = 1,
+		StreamSingleByte = 2,
+	};
+
+	// 索引编码不小于此值时写入转义流.
+	const UINT kIndexEscape = 255;
+
+	const UINT kMaxCodeLength = 12;
+	const UINT kDecodeTableSize = 1 << kMaxCodeLength;
+
+	// 解码时一次读取8个字节, 且读取位置可能超前最多7个字节, 流的末尾需要补齐.
+	const UINT kStreamPadding = 16;
+
+	///
+	/// 字节读写.
+	///
+	inline void PutU32(std::vector<uint8_t>& out, UINT v)
+	{
+		uint8_t bytes[4];
+		memcpy(bytes, &v, 4);
+		out.insert(out.end(), bytes, bytes + 4);
+	}
+
+	inline void PutF32(std::vector<uint8_t>& out, float v)
+	{
+		UINT u;
+		memcpy(&u, &v, 4);
+		PutU32(out, u);
+	}
+
+	inline bool GetU32(const uint8_t*& cur, const uint8_t* end, UINT& v)
+	{
+		if (end - cur < 4)
+			return false;
+		memcpy(&v, cur, 4);
+		cur += 4;
+		return true;
+	}
+
+	inline bool GetF32(const uint8_t*& cur, const uint8_t* end, float& v)
+	{
+		UINT u;
+		if (!GetU32(cur, end, u))
+			return false;
+		memcpy(&v, &u, 4);
+		return true;
+	}
+
+	inline uint64_t Load64(const uint8_t* p)
+	{
+		uint64_t v;
+		memcpy(&v, p, 8);
+		return v;
+	}
+
+	///
+	/// zigzag: 把有符号差值映射到无符号数, 绝对值小的数得到小的编码.
+	///
+	inline uint16_t ZigZag16(uint16_t delta)
+	{
+		int16_t d = (int16_t)delta;
+		return (uint16_t)((delta << 1) ^ (uint16_t)(d >> 15));
+	}
+
+	inline uint16_t UnZigZag16(uint16_t z)
+	{
+		return (uint16_t)((z >> 1) ^ (uint16_t)(0 - (z & 1)));
+	}
+
+	///
+	/// 八面体法线编码, 结果在[-1, 1].
+	///
+	void OctEncode(const XMFLOAT3& n, float& u, float& v)
+	{
+		float l1 = fabsf(n.x) + fabsf(n.y) + fabsf(n.z);
+		if (l1 < 1e-20f)
+		{
+			u = 0.0f;
+			v = 0.0f;
+			return;
+		}
+
+		u = n.x / l1;
+		v = n.y / l1;
+
+		if (n.z < 0.0f)
+		{
+			float pu = u;
+			u = (1.0f - fabsf(v)) * (pu >= 0.0f ? 1.0f : -1.0f);
+			v = (1.0f - fabsf(pu)) * (v >= 0.0f ? 1.0f : -1.0f);
+		}
+	}
+
+	///
+	/// 每个分量单独成段: 与前一个顶点同一分量的差值 + zigzag, 再按字节拆成低/高两个平面.
+	/// 解码时每段是连续的前缀和, 可以一次处理8个值.
+	///
+	void SplitPlanes(const std::vector<uint16_t>& values, UINT components,
+		std::vector<uint8_t>& lo, std::vector<uint8_t>& hi)
+	{
+		const size_t count = values.size() / components;
+
+		lo.resize(values.size());
+		hi.resize(values.size());
+
+		for (UINT c = 0; c < components; ++c)
+		{
+			uint16_t prev = 0;
+			for (size_t i = 0; i < count; ++i)
+			{
+				uint16_t value = values[i * components + c];
+				uint16_t z = ZigZag16((uint16_t)(value - prev));
+				prev = value;
+
+				lo[c * count + i] = (uint8_t)(z & 0xff);
+				hi[c * count + i] = (uint8_t)(z >> 8);
+			}
+		}
+	}
+
+	///
+	/// 规范Huffman编码.
+	///
+	void BuildCodeLengths(const UINT counts[256], uint8_t lengths[256])
+	{
+		memset(lengths, 0, 256);
+
+		struct Node
+		{
+			uint64_t Count;
+			int Left;
+			int Right;
+		};
+
+		std::vector<Node> nodes;
+		typedef std::pair<uint64_t, int> Item;
+		std::priority_queue<Item, std::vector<Item>, std::greater<Item>> heap;
+
+		for (int s = 0; s < 256; ++s)
+		{
+			if (counts[s] == 0)
+				continue;
+
+			nodes.push_back({ counts[s], -1 - s, -1 - s });
+			heap.push(Item(counts[s], (int)nodes.size() - 1));
+		}
+
+		while (heap.size() > 1)
+		{
+			Item a = heap.top(); heap.pop();
+			Item b = heap.top(); heap.pop();
+
+			nodes.push_back({ a.first + b.first, a.second, b.second });
+			heap.push(Item(a.first + b.first, (int)nodes.size() - 1));
+		}
+
+		// 计算每个符号的深度.
+		UINT numCodes[64] = {};
+		std::vector<std::pair<int, UINT>> stack;
+		stack.push_back(std::make_pair(heap.top().second, 0u));
+		while (!stack.empty())
+		{
+			int node = stack.back().first;
+			UINT depth = stack.back().second;
+			stack.pop_back();
+
+			if (nodes[node].Left < 0)
+			{
+				numCodes[MathHelper::Min(depth, 63u)]++;
+				continue;
+			}
+
+			stack.push_back(std::make_pair(nodes[node].Left, depth + 1));
+			stack.push_back(std::make_pair(nodes[node].Right, depth + 1));
+		}
+
+		// 限制最大码长, 调整后仍满足Kraft不等式.
+		for (UINT i = kMaxCodeLength + 1; i < 64; ++i)
+		{
+			numCodes[kMaxCodeLength] += numCodes[i];
+			numCodes[i] = 0;
+		}
+
+		UINT total = 0;
+		for (UINT i = 1; i <= kMaxCodeLength; ++i)
+			total += numCodes[i] << (kMaxCodeLength - i);
+
+		while (total != (1u << kMaxCodeLength))
+		{
+			numCodes[kMaxCodeLength]--;
+			for (UINT i = kMaxCodeLength - 1; i > 0; --i)
+			{
+				if (numCodes[i])
+				{
+					numCodes[i]--;
+					numCodes[i + 1] += 2;
+					break;
+				}
+			}
+			total--;
+		}
+
+		// 频率高的符号使用短码.
+		std::vector<int> symbols;
+		for (int s = 0; s < 256; ++s)
+		{
+			if (counts[s] > 0)
+				symbols.push_back(s);
+		}
+
+		std::stable_sort(symbols.begin(), symbols.end(),
+			[&](int a, int b) { return counts[a] > counts[b]; });
+
+		size_t next = 0;
+		for (UINT len = 1; len <= kMaxCodeLength; ++len)
+		{
+			for (UINT k = 0; k < numCodes[len]; ++k)
+				lengths[symbols[next++]] = (uint8_t)len;
+		}
+	}
+
+	// 计算规范码, 按低位在前的顺序输出, 因此存储的是位反转后的码.
+	void BuildCodes(const uint8_t lengths[256], uint16_t codes[256])
+	{
+		UINT numCodes[kMaxCodeLength + 1] = {};
+		for (int s = 0; s < 256; ++s)
+			numCodes[lengths[s]]++;
+		numCodes[0] = 0;
+
+		UINT nextCode[kMaxCodeLength + 2] = {};
+		UINT code = 0;
+		for (UINT len = 1; len <= kMaxCodeLength; ++len)
+		{
+			code = (code + numCodes[len - 1]) << 1;
+			nextCode[len] = code;
+		}
+
+		for (int s = 0; s < 256; ++s)
+		{
+			UINT len = lengths[s];
+			if (len == 0)
+			{
+				codes[s] = 0;
+				continue;
+			}
+
+			UINT c = nextCode[len]++;
+			UINT reversed = 0;
+			for (UINT i = 0; i < len; ++i)
+				reversed |= ((c >> i) & 1) << (len - 1 - i);
+
+			codes[s] = (uint16_t)reversed;
+		}
+	}
+
+	// Huffman数据分成4段分别编码, 解码时交错进行, 减少移位的依赖链.
+	const UINT kSegmentCount = 4;
+
+	inline size_t SegmentBegin(size_t count, UINT segment)
+	{
+		size_t quarter = (count + kSegmentCount - 1) / kSegmentCount;
+		return MathHelper::Min(quarter * segment, count);
+	}
+
+	void EncodeStream(const std::vector<uint8_t>& data, std::vector<uint8_t>& out)
+	{
+		PutU32(out, (UINT)data.size());
+
+		UINT counts[256] = {};
+		for (uint8_t b : data)
+			counts[b]++;
+
+		UINT distinct = 0;
+		for (int s = 0; s < 256; ++s)
+			distinct += counts[s] ? 1 : 0;
+
+		if (distinct <= 1)
+		{
+			out.push_back(StreamSingleByte);
+			out.push_back(data.empty() ? 0 : data[0]);
+			return;
+		}
+
+		uint8_t lengths[256];
+		uint16_t codes[256];
+		BuildCodeLengths(counts, lengths);
+		BuildCodes(lengths, codes);
+
+		uint64_t bits = 0;
+		for (int s = 0; s < 256; ++s)
+			bits += (uint64_t)counts[s] * lengths[s];
+
+		const size_t tableSize = 128 + (kSegmentCount - 1) * 4;
+		if (tableSize + (size_t)((bits + 7) / 8) + kSegmentCount >= data.size())
+		{
+			out.push_back(StreamStored);
+			out.insert(out.end(), data.begin(), data.end());
+			return;
+		}
+
+		// 先编码各段, 再写入码长表和段大小.
+		std::vector<uint8_t> segments[kSegmentCount];
+		for (UINT seg = 0; seg < kSegmentCount; ++seg)
+		{
+			std::vector<uint8_t>& bytes = segments[seg];
+
+			uint64_t bitBuffer = 0;
+			UINT bitCount = 0;
+			for (size_t i = SegmentBegin(data.size(), seg); i < SegmentBegin(data.size(), seg + 1); ++i)
+			{
+				uint8_t b = data[i];
+				bitBuffer |= (uint64_t)codes[b] << bitCount;
+				bitCount += lengths[b];
+
+				while (bitCount >= 8)
+				{
+					bytes.push_back((uint8_t)bitBuffer);
+					bitBuffer >>= 8;
+					bitCount -= 8;
+				}
+			}
+			if (bitCount > 0)
+				bytes.push_back((uint8_t)bitBuffer);
+		}
+
+		size_t payloadSize = tableSize;
+		for (UINT seg = 0; seg < kSegmentCount; ++seg)
+			payloadSize += segments[seg].size();
+
+		out.push_back(StreamHuffman);
+		PutU32(out, (UINT)payloadSize);
+
+		// 码长表, 每个4位.
+		for (int s = 0; s < 256; s += 2)
+			out.push_back((uint8_t)(lengths[s] | (lengths[s + 1] << 4)));
+
+		for (UINT seg = 0; seg + 1 < kSegmentCount; ++seg)
+			PutU32(out, (UINT)segments[seg].size());
+
+		for (UINT seg = 0; seg < kSegmentCount; ++seg)
+			out.insert(out.end(), segments[seg].begin(), segments[seg].end());
+
+		out.insert(out.end(), kStreamPadding, 0);
+	}
+
+	/// 低位在前的位读取器, 每次补充后至少有56位可用.
+	struct BitReader
+	{
+		const uint8_t* Cur;
+		uint64_t Buffer;
+		UINT Count;
+
+		void Refill()
+		{
+			Buffer |= Load64(Cur) << Count;
+			Cur += (63 - Count) >> 3;
+			Count |= 56;
+		}
+
+		uint8_t Decode(const uint16_t* table)
+		{
+			uint16_t entry = table[Buffer & (kDecodeTableSize - 1)];
+			UINT len = entry >> 8;
+
+			Buffer >>= len;
+			Count -= len;
+
+			return (uint8_t)entry;
+		}
+
+		// 用双符号查找表解码, 总是在out处写2个字节, 返回实际解出的符号数.
+		UINT DecodePair(const uint32_t* table, uint8_t* out)
+		{
+			uint32_t entry = table[Buffer & (kDecodeTableSize - 1)];
+			UINT len = (entry >> 16) & 0xff;
+
+			memcpy(out, &entry, 2);
+			Buffer >>= len;
+			Count -= len;
+
+			return entry >> 24;
+		}
+	};
+
+	bool DecodeHuffman(const uint8_t* payload, size_t payloadSize, uint8_t* out, size_t count)
+	{
+		const size_t tableSize = 128 + (kSegmentCount - 1) * 4;
+		if (payloadSize < tableSize + kStreamPadding)
+			return false;
+
+		uint8_t lengths[256];
+		for (int s = 0; s < 256; s += 2)
+		{
+			lengths[s] = payload[s / 2] & 0xf;
+			lengths[s + 1] = payload[s / 2] >> 4;
+		}
+
+		// 码长必须满足Kraft等式, 否则查找表中会有空项.
+		UINT kraft = 0;
+		for (int s = 0; s < 256; ++s)
+		{
+			if (lengths[s] > kMaxCodeLength)
+				return false;
+			if (lengths[s] > 0)
+				kraft += kDecodeTableSize >> lengths[s];
+		}
+		if (kraft != kDecodeTableSize)
+			return false;
+
+		uint16_t codes[256];
+		BuildCodes(lengths, codes);
+
+		// 查找表: 低8位是符号, 高8位是码长.
+		uint16_t table[kDecodeTableSize];
+		for (int s = 0; s < 256; ++s)
+		{
+			UINT len = lengths[s];
+			if (len == 0)
+				continue;
+
+			for (UINT k = codes[s]; k < kDecodeTableSize; k += (1u << len))
+				table[k] = (uint16_t)(s | (len << 8));
+		}
+
+		// 双符号查找表: 第一个码之后剩下的位足够确定第二个码时, 一次查表解出两个符号.
+		// 0~15位是两个符号, 16~23位是总码长, 24~31位是符号数.
+		uint32_t pairs[kDecodeTableSize];
+		for (UINT k = 0; k < kDecodeTableSize; ++k)
+		{
+			UINT first = table[k];
+			UINT second = table[k >> (first >> 8)];
+			UINT len = (first >> 8) + (second >> 8);
+
+			if (len <= kMaxCodeLength)
+				pairs[k] = (first & 0xff) | ((second & 0xff) << 8) | (len << 16) | (2u << 24);
+			else
+				pairs[k] = (first & 0xff) | ((first >> 8) << 16) | (1u << 24);
+		}
+
+		///
+		/// 各段的起始位置.
+		///
+		const uint8_t* cur = payload + 128;
+		const uint8_t* end = payload + payloadSize;
+		const uint8_t* bitsEnd = end - kStreamPadding;
+
+		BitReader readers[kSegmentCount];
+		uint8_t* outBegin[kSegmentCount + 1];
+
+		const uint8_t* segment = payload + tableSize;
+		for (UINT seg = 0; seg < kSegmentCount; ++seg)
+		{
+			UINT segmentSize = 0;
+			if (seg + 1 < kSegmentCount)
+			{
+				memcpy(&segmentSize, cur + seg * 4, 4);
+				if ((size_t)(bitsEnd - segment) < segmentSize)
+					return false;
+			}
+
+			readers[seg].Cur = segment;
+			readers[seg].Buffer = 0;
+			readers[seg].Count = 0;
+			segment += segmentSize;
+
+			outBegin[seg] = out + SegmentBegin(count, seg);
+		}
+		outBegin[kSegmentCount] = out + count;
+
+		// 每次补充后每段查表4次, 最多写出8个符号再多写1个字节, 这些字节必须都在本段内,
+		// 否则会覆盖下一段已经解出的符号.
+		const ptrdiff_t pairMargin = 4 * 2 + 1;
+
+		// 读取器放在局部变量中, 避免写出的字节与读取器状态可能重叠而每次重新加载.
+		BitReader r0 = readers[0];
+		BitReader r1 = readers[1];
+		BitReader r2 = readers[2];
+		BitReader r3 = readers[3];
+		uint8_t* out0 = outBegin[0];
+		uint8_t* out1 = outBegin[1];
+		uint8_t* out2 = outBegin[2];
+		uint8_t* out3 = outBegin[3];
+
+		while (outBegin[1] - out0 >= pairMargin && outBegin[2] - out1 >= pairMargin &&
+			outBegin[3] - out2 >= pairMargin && outBegin[4] - out3 >= pairMargin)
+		{
+			if (end - r0.Cur < (ptrdiff_t)sizeof(uint64_t) || end - r1.Cur < (ptrdiff_t)sizeof(uint64_t) ||
+				end - r2.Cur < (ptrdiff_t)sizeof(uint64_t) || end - r3.Cur < (ptrdiff_t)sizeof(uint64_t))
+			{
+				return false;
+			}
+
+			r0.Refill();
+			r1.Refill();
+			r2.Refill();
+			r3.Refill();
+
+			for (UINT k = 0; k < 4; ++k)
+			{
+				out0 += r0.DecodePair(pairs, out0);
+				out1 += r1.DecodePair(pairs, out1);
+				out2 += r2.DecodePair(pairs, out2);
+				out3 += r3.DecodePair(pairs, out3);
+			}
+		}
+
+		readers[0] = r0;
+		readers[1] = r1;
+		readers[2] = r2;
+		readers[3] = r3;
+
+		uint8_t* outCur[kSegmentCount] = { out0, out1, out2, out3 };
+
+		// 剩下的部分逐段逐个符号解码.
+		for (UINT seg = 0; seg < kSegmentCount; ++seg)
+		{
+			BitReader& reader = readers[seg];
+			uint8_t* dst = outCur[seg];
+			uint8_t* dstEnd = outBegin[seg + 1];
+
+			while (dst != dstEnd)
+			{
+				if (end - reader.Cur < (ptrdiff_t)sizeof(uint64_t))
+					return false;
+				reader.Refill();
+
+				size_t n = MathHelper::Min((size_t)(dstEnd - dst), (size_t)4);
+				for (size_t k = 0; k < n; ++k)
+					*dst++ = reader.Decode(table);
+			}
+		}
+
+		return true;
+	}
+
+	///
+	/// 解码顶点: 差值累加、反量化和八面体解码(SSE2).
+	///
+
+	// 一个分量的低/高字节平面 -> 还原zigzag -> 前缀和, 一次8个值. out的长度补齐到8的倍数.
+	void AccumulatePlanes(const uint8_t* lo, const uint8_t* hi, size_t count, uint16_t* out)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i one = _mm_set1_epi16(1);
+		__m128i carry = zero;
+
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i z = _mm_unpacklo_epi8(
+				_mm_loadl_epi64((const __m128i*)(lo + i)), _mm_loadl_epi64((const __m128i*)(hi + i)));
+			__m128i d = _mm_xor_si128(_mm_srli_epi16(z, 1), _mm_sub_epi16(zero, _mm_and_si128(z, one)));
+
+			// 8个值内部的前缀和, 再加上前一组最后的值.
+			d = _mm_add_epi16(d, _mm_slli_si128(d, 2));
+			d = _mm_add_epi16(d, _mm_slli_si128(d, 4));
+			d = _mm_add_epi16(d, _mm_slli_si128(d, 8));
+			d = _mm_add_epi16(d, carry);
+			_mm_storeu_si128((__m128i*)(out + i), d);
+
+			carry = _mm_shufflehi_epi16(d, _MM_SHUFFLE(3, 3, 3, 3));
+			carry = _mm_unpackhi_epi64(carry, carry);
+		}
+
+		uint16_t prev = (uint16_t)_mm_extract_epi16(carry, 0);
+		for (; i < count; ++i)
+		{
+			prev = (uint16_t)(prev + UnZigZag16((uint16_t)(lo[i] | (hi[i] << 8))));
+			out[i] = prev;
+		}
+	}
+
+	inline XMVECTOR LoadQuantized4(const uint16_t* q)
+	{
+		__m128i v = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)q), _mm_setzero_si128());
+		return _mm_cvtepi32_ps(v);
+	}
+
+	// 4个顶点的x, y, z分量转置后写出前count个顶点, 每个顶点只写12字节.
+	inline void StoreFloat3x4(uint8_t* dst, UINT stride, size_t count, XMVECTOR x, XMVECTOR y, XMVECTOR z)
+	{
+		XMVECTOR w = XMVectorZero();
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		if (count == 4)
+		{
+			XMStoreFloat3((XMFLOAT3*)dst, x);
+			XMStoreFloat3((XMFLOAT3*)(dst + stride), y);
+			XMStoreFloat3((XMFLOAT3*)(dst + 2 * stride), z);
+			XMStoreFloat3((XMFLOAT3*)(dst + 3 * stride), w);
+			return;
+		}
+
+		const XMVECTOR v[3] = { x, y, z };
+		for (size_t k = 0; k < count; ++k)
+			XMStoreFloat3((XMFLOAT3*)(dst + k * stride), v[k]);
+	}
+
+	// 八面体坐标([-1, 1])解码为单位法线. 折叠后|x| + |y| + |z| = 1, 长度不会为0.
+	inline void OctDecode4(XMVECTOR u, XMVECTOR v, XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+	{
+		const XMVECTOR signBit = XMVectorReplicate(-0.0f);
+
+		z = XMVectorSubtract(XMVectorSubtract(XMVectorSplatOne(), XMVectorAbs(u)), XMVectorAbs(v));
+
+		// z < 0时: u -= sign(u) * (-z), v -= sign(v) * (-z).
+		XMVECTOR t = XMVectorMax(XMVectorNegate(z), XMVectorZero());
+		x = XMVectorSubtract(u, _mm_or_ps(t, _mm_and_ps(u, signBit)));
+		y = XMVectorSubtract(v, _mm_or_ps(t, _mm_and_ps(v, signBit)));
+
+		XMVECTOR lengthSq = XMVectorMultiplyAdd(x, x, XMVectorMultiplyAdd(y, y, XMVectorMultiply(z, z)));
+		XMVECTOR invLength = XMVectorDivide(XMVectorSplatOne(), XMVectorSqrt(lengthSq));
+
+		x = XMVectorMultiply(x, invLength);
+		y = XMVectorMultiply(y, invLength);
+		z = XMVectorMultiply(z, invLength);
+	}
+
+	inline bool ReadVarint(const uint8_t*& cur, const uint8_t* end, UINT& value)
+	{
+		value = 0;
+		for (UINT shift = 0; shift <= 28; shift += 7)
+		{
+			if (cur == end)
+				return false;
+
+			uint8_t b = *cur++;
+			value |= (UINT)(b & 0x7f) << shift;
+
+			if ((b & 0x80) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	///
+	/// Forsyth顶点缓存优化的评分.
+	///
+	const int kCacheSize = 32;
+
+	float VertexScore(int cachePosition, UINT remainingTris)
+	{
+		if (remainingTris == 0)
+			return -1.0f;
+
+		float score = 0.0f;
+		if (cachePosition >= 0)
+		{
+			if (cachePosition < 3)
+			{
+				// 刚用过的三个顶点固定得分, 避免总是选择相邻的三角形.
+				score = 0.75f;
+			}
+			else
+			{
+				const float scaler = 1.0f / (kCacheSize - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, 1.5f);
+			}
+		}
+
+		// 剩余三角形少的顶点优先处理完.
+		score += 2.0f * powf((float)remainingTris, -0.5f);
+
+		return score;
+	}
+}
+
+void MeshCodec::OptimizeVertexCache(std::vector<UINT>& indices, UINT vertexCount)
+{
+	const UINT triCount = (UINT)indices.size() / 3;
+	if (triCount == 0)
+		return;
+
+	// 顶点 -> 三角形邻接表.
+	std::vector<UINT> adjOffsets(vertexCount + 1, 0);
+	for (UINT i = 0; i < triCount * 3; ++i)
+		adjOffsets[indices[i] + 1]++;
+	for (UINT v = 0; v < vertexCount; ++v)
+		adjOffsets[v + 1] += adjOffsets[v];
+
+	std::vector<UINT> adjTris(triCount * 3);
+	std::vector<UINT> remaining(vertexCount);
+	for (UINT v = 0; v < vertexCount; ++v)
+		remaining[v] = adjOffsets[v + 1] - adjOffsets[v];
+
+	{
+		std::vector<UINT> fill(adjOffsets.begin(), adjOffsets.end() - 1);
+		for (UINT t = 0; t < triCount; ++t)
+		{
+			for (UINT k = 0; k < 3; ++k)
+				adjTris[fill[indices[t * 3 + k]]++] = t;
+		}
+	}
+
+	std::vector<int> cachePos(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (UINT v = 0; v < vertexCount; ++v)
+		vertexScore[v] = VertexScore(-1, remaining[v]);
+
+	std::vector<float> triScore(triCount);
+	std::vector<bool> emitted(triCount, false);
+	for (UINT t = 0; t < triCount; ++t)
+	{
+		triScore[t] = vertexScore[indices[t * 3 + 0]] +
+			vertexScore[indices[t * 3 + 1]] +
+			vertexScore[indices[t * 3 + 2]];
+	}
+
+	std::vector<UINT> output;
+	output.reserve(indices.size());
+
+	UINT cache[kCacheSize + 3];
+	UINT cacheCount = 0;
+
+	UINT bestTri = 0;
+	for (UINT t = 1; t < triCount; ++t)
+	{
+		if (triScore[t] > triScore[bestTri])
+			bestTri = t;
+	}
+
+	UINT scanCursor = 0;
+
+	while (bestTri != UINT_MAX)
+	{
+		emitted[bestTri] = true;
+
+		UINT newCache[kCacheSize + 3];
+		UINT newCount = 0;
+
+		for (UINT k = 0; k < 3; ++k)
+		{
+			UINT v = indices[bestTri * 3 + k];
+			output.push_back(v);
+			newCache[newCount++] = v;
+
+			// 把这个三角形从顶点的邻接表中移除.
+			UINT begin = adjOffsets[v];
+			UINT end = begin + remaining[v];
+			for (UINT a = begin; a < end; ++a)
+			{
+				if (adjTris[a] == bestTri)
+				{
+					adjTris[a] = adjTris[end - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// LRU缓存: 新的三个顶点放在最前面.
+		for (UINT i = 0; i < cacheCount; ++i)
+		{
+			UINT v = cache[i];
+			if (v != newCache[0] && v != newCache[1] && v != newCache[2])
+				newCache[newCount++] = v;
+		}
+
+		for (UINT i = 0; i < newCount; ++i)
+		{
+			UINT v = newCache[i];
+			cachePos[v] = i < (UINT)kCacheSize ? (int)i : -1;
+			vertexScore[v] = VertexScore(cachePos[v], remaining[v]);
+		}
+
+		cacheCount = MathHelper::Min(newCount, (UINT)kCacheSize);
+		memcpy(cache, newCache, cacheCount * sizeof(UINT));
+
+		// 只需要更新缓存中顶点相关的三角形.
+		bestTri = UINT_MAX;
+		float bestScore = -1.0f;
+		for (UINT i = 0; i < newCount; ++i)
+		{
+			UINT v = newCache[i];
+			for (UINT a = adjOffsets[v]; a < adjOffsets[v] + remaining[v]; ++a)
+			{
+				UINT t = adjTris[a];
+				triScore[t] = vertexScore[indices[t * 3 + 0]] +
+					vertexScore[indices[t * 3 + 1]] +
+					vertexScore[indices[t * 3 + 2]];
+
+				if (triScore[t] > bestScore)
+				{
+					bestScore = triScore[t];
+					bestTri = t;
+				}
+			}
+		}
+
+		// 缓存中没有候选时, 取下一个未输出的三角形.
+		if (bestTri == UINT_MAX)
+		{
+			while (scanCursor < triCount && emitted[scanCursor])
+				++scanCursor;
+			if (scanCursor < triCount)
+				bestTri = scanCursor;
+		}
+	}
+
+	indices.swap(output);
+}
+
+void MeshCodec::Encode(
+	const XMFLOAT3* positions,
+	const XMFLOAT3* normals,
+	UINT vertexCount,
+	const UINT* indices,
+	UINT indexCount,
+	const MeshCodecOptions& options,
+	std::vector<uint8_t>& out)
+{
+	const UINT positionBits = MathHelper::Clamp(options.PositionBits, 1u, 16u);
+	const UINT normalBits = MathHelper::Clamp(options.NormalBits, 1u, 16u);
+
+	///
+	/// 三角形重排, 然后顶点按首次引用的顺序重新编号(未引用的顶点被丢弃).
+	///
+	std::vector<UINT> triIndices(indices, indices + indexCount);
+	if (options.OptimizeVertexCache)
+		OptimizeVertexCache(triIndices, vertexCount);
+
+	std::vector<UINT> remap(vertexCount, UINT_MAX);
+	std::vector<UINT> order;
+	order.reserve(vertexCount);
+	for (UINT& index : triIndices)
+	{
+		if (remap[index] == UINT_MAX)
+		{
+			remap[index] = (UINT)order.size();
+			order.push_back(index);
+		}
+		index = remap[index];
+	}
+
+	const UINT outVertexCount = (UINT)order.size();
+
+	///
+	/// 位置量化.
+	///
+	XMFLOAT3 vMin(0.0f, 0.0f, 0.0f);
+	XMFLOAT3 vMax(0.0f, 0.0f, 0.0f);
+	if (outVertexCount > 0)
+	{
+		vMin = vMax = positions[order[0]];
+		for (UINT v : order)
+		{
+			vMin.x = MathHelper::Min(vMin.x, positions[v].x);
+			vMin.y = MathHelper::Min(vMin.y, positions[v].y);
+			vMin.z = MathHelper::Min(vMin.z, positions[v].z);
+			vMax.x = MathHelper::Max(vMax.x, positions[v].x);
+			vMax.y = MathHelper::Max(vMax.y, positions[v].y);
+			vMax.z = MathHelper::Max(vMax.z, positions[v].z);
+		}
+	}
+
+	const float maxQ = (float)((1u << positionBits) - 1);
+	const float minValue[3] = { vMin.x, vMin.y, vMin.z };
+	float step[3] = { (vMax.x - vMin.x) / maxQ, (vMax.y - vMin.y) / maxQ, (vMax.z - vMin.z) / maxQ };
+
+	std::vector<uint16_t> quantized(outVertexCount * 3);
+	for (UINT i = 0; i < outVertexCount; ++i)
+	{
+		const float* p = &positions[order[i]].x;
+		for (UINT c = 0; c < 3; ++c)
+		{
+			float q = step[c] > 0.0f ? (p[c] - minValue[c]) / step[c] : 0.0f;
+			quantized[i * 3 + c] = (uint16_t)MathHelper::Clamp(q + 0.5f, 0.0f, maxQ);
+		}
+	}
+
+	///
+	/// 写文件头和各个字节流.
+	///
+	out.clear();
+	PutU32(out, Magic);
+	PutU32(out, Version);
+	PutU32(out, outVertexCount);
+	PutU32(out, (UINT)triIndices.size());
+	PutU32(out, normals != nullptr ? kHasNormals : 0);
+	PutU32(out, positionBits);
+	PutU32(out, normalBits);
+	for (UINT c = 0; c < 3; ++c)
+		PutF32(out, minValue[c]);
+	for (UINT c = 0; c < 3; ++c)
+		PutF32(out, step[c]);
+
+	std::vector<uint8_t> lo, hi;
+	SplitPlanes(quantized, 3, lo, hi);
+	EncodeStream(lo, out);
+	EncodeStream(hi, out);
+
+	if (normals != nullptr)
+	{
+		const float maxN = (float)((1u << normalBits) - 1);
+
+		std::vector<uint16_t> octs(outVertexCount * 2);
+		for (UINT i = 0; i < outVertexCount; ++i)
+		{
+			float u, v;
+			OctEncode(normals[order[i]], u, v);
+
+			octs[i * 2 + 0] = (uint16_t)MathHelper::Clamp((u * 0.5f + 0.5f) * maxN + 0.5f, 0.0f, maxN);
+			octs[i * 2 + 1] = (uint16_t)MathHelper::Clamp((v * 0.5f + 0.5f) * maxN + 0.5f, 0.0f, maxN);
+		}
+
+		SplitPlanes(octs, 2, lo, hi);
+		EncodeStream(lo, out);
+		EncodeStream(hi, out);
+	}
+
+	// 索引: 顶点按首次引用编号, 第一次出现的顶点一定是下一个新编号, 写0,
+	// 其余写下一个新编号与它的差值. 每个索引一个字节, 放不下的以变长字节写入转义流.
+	std::vector<uint8_t> indexBytes;
+	std::vector<uint8_t> escapeBytes;
+	indexBytes.reserve(triIndices.size());
+
+	UINT nextVertex = 0;
+	for (UINT index : triIndices)
+	{
+		UINT z = 0;
+		if (index == nextVertex)
+			++nextVertex;
+		else
+			z = nextVertex - index;
+
+		if (z < kIndexEscape)
+		{
+			indexBytes.push_back((uint8_t)z);
+			continue;
+		}
+
+		indexBytes.push_back((uint8_t)kIndexEscape);
+		z -= kIndexEscape;
+		while (z >= 0x80)
+		{
+			escapeBytes.push_back((uint8_t)(z | 0x80));
+			z >>= 7;
+		}
+		escapeBytes.push_back((uint8_t)z);
+	}
+
+	EncodeStream(indexBytes, out);
+	EncodeStream(escapeBytes, out);
+}
+
+bool MeshCodec::EncodeTextModel(
+	const std::wstring& textFile,
+	const std::wstring& outFile,
+	const MeshCodecOptions& options,
+	std::wstring& error)
+{
+	struct ModelVertex
+	{
+		XMFLOAT3 Position;
+		XMFLOAT3 Normal;
+	};
+
+	TextModelReader reader;
+	if (!reader.Open(textFile))
+	{
+		error = reader.ErrorMessage();
+		return false;
+	}
+
+	std::vector<ModelVertex> vertices(reader.VertexCount());
+	std::vector<UINT> indices(3 * reader.TriangleCount());
+	if (!reader.ReadVertices(vertices.data(), sizeof(ModelVertex), offsetof(ModelVertex, Normal)) ||
+		!reader.ReadIndices(indices.data()))
+	{
+		error = reader.ErrorMessage();
+		return false;
+	}
+
+	std::vector<XMFLOAT3> positions(vertices.size());
+	std::vector<XMFLOAT3> normals(vertices.size());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		positions[i] = vertices[i].Position;
+		normals[i] = vertices[i].Normal;
+	}
+
+	std::vector<uint8_t> encoded;
+	Encode(positions.data(), normals.data(), (UINT)vertices.size(),
+		indices.data(), (UINT)indices.size(), options, encoded);
+
+	std::ofstream fout(outFile, std::ios::binary | std::ios::trunc);
+	fout.write(reinterpret_cast<const char*>(encoded.data()), (std::streamsize)encoded.size());
+	if (!fout.good())
+	{
+		error = outFile + L"无法写入.";
+		return false;
+	}
+
+	return true;
+}
+
+bool CompressedModelReader::Open(const std::wstring& filename)
+{
+	mFilename = filename;
+
+	if (!mFile.Open(filename))
+	{
+		mError = mFilename + L": 不存在或无法读取.";
+		return false;
+	}
+
+	return Open(mFile.Data(), mFile.Size());
+}
+
+bool CompressedModelReader::Open(const uint8_t* data, size_t size)
+{
+	mError.clear();
+	mVerticesRead = false;
+
+	mCur = data;
+	mEnd = data + size;
+
+	UINT magic = 0;
+	UINT version = 0;
+	if (!GetU32(mCur, mEnd, magic) || !GetU32(mCur, mEnd, version) ||
+		magic != MeshCodec::Magic || version != MeshCodec::Version)
+	{
+		return Fail(L"不是有效的压缩模型文件.");
+	}
+
+	bool ok = GetU32(mCur, mEnd, mVertexCount) &&
+		GetU32(mCur, mEnd, mIndexCount) &&
+		GetU32(mCur, mEnd, mFlags) &&
+		GetU32(mCur, mEnd, mPositionBits) &&
+		GetU32(mCur, mEnd, mNormalBits);
+
+	for (UINT c = 0; c < 3 && ok; ++c)
+		ok = GetF32(mCur, mEnd, mBoundsMin[c]);
+	for (UINT c = 0; c < 3 && ok; ++c)
+		ok = GetF32(mCur, mEnd, mPositionStep[c]);
+
+	if (!ok || mIndexCount % 3 != 0 || (mVertexCount == 0 && mIndexCount != 0) ||
+		mPositionBits == 0 || mPositionBits > 16 || mNormalBits == 0 || mNormalBits > 16)
+	{
+		return Fail(L"文件头格式错误.");
+	}
+
+	return true;
+}
+
+bool CompressedModelReader::ReadVertices(void* vertices, UINT vertexStride, UINT normalOffset)
+{
+	if (mCur == nullptr || mVerticesRead)
+		return Fail(L"读取顺序错误.");
+
+	std::vector<uint8_t>& lo = mScratch[0];
+	std::vector<uint8_t>& hi = mScratch[1];
+
+	uint8_t* dst = static_cast<uint8_t*>(vertices);
+
+	///
+	/// 位置.
+	///
+	if (!ReadStream(lo) || !ReadStream(hi) ||
+		lo.size() != (size_t)mVertexCount * 3 || hi.size() != lo.size())
+	{
+		return Fail(L"位置数据损坏.");
+	}
+
+	// 每个分量的量化值连续存放, 每段补齐到8的倍数.
+	const size_t count = mVertexCount;
+	const size_t padded = (count + 7) & ~(size_t)7;
+	mQuantized.resize(padded * 3);
+
+	for (UINT c = 0; c < 3; ++c)
+		AccumulatePlanes(&lo[c * count], &hi[c * count], count, &mQuantized[c * padded]);
+
+	const uint16_t* qx = &mQuantized[0];
+	const uint16_t* qy = &mQuantized[padded];
+	const uint16_t* qz = &mQuantized[2 * padded];
+
+	const XMVECTOR minX = XMVectorReplicate(mBoundsMin[0]);
+	const XMVECTOR minY = XMVectorReplicate(mBoundsMin[1]);
+	const XMVECTOR minZ = XMVectorReplicate(mBoundsMin[2]);
+	const XMVECTOR stepX = XMVectorReplicate(mPositionStep[0]);
+	const XMVECTOR stepY = XMVectorReplicate(mPositionStep[1]);
+	const XMVECTOR stepZ = XMVectorReplicate(mPositionStep[2]);
+
+	for (size_t i = 0; i < count; i += 4)
+	{
+		XMVECTOR x = XMVectorMultiplyAdd(LoadQuantized4(qx + i), stepX, minX);
+		XMVECTOR y = XMVectorMultiplyAdd(LoadQuantized4(qy + i), stepY, minY);
+		XMVECTOR z = XMVectorMultiplyAdd(LoadQuantized4(qz + i), stepZ, minZ);
+
+		StoreFloat3x4(dst + i * vertexStride, vertexStride, MathHelper::Min(count - i, (size_t)4), x, y, z);
+	}
+
+	///
+	/// 法线.
+	///
+	if (mFlags & kHasNormals)
+	{
+		if (!ReadStream(lo) || !ReadStream(hi) ||
+			lo.size() != count * 2 || hi.size() != lo.size())
+		{
+			return Fail(L"法线数据损坏.");
+		}
+
+		if (normalOffset != NoNormal)
+		{
+			AccumulatePlanes(&lo[0], &hi[0], count, &mQuantized[0]);
+			AccumulatePlanes(&lo[count], &hi[count], count, &mQuantized[padded]);
+
+			const uint16_t* qu = &mQuantized[0];
+			const uint16_t* qv = &mQuantized[padded];
+
+			const XMVECTOR scale = XMVectorReplicate(2.0f / (float)((1u << mNormalBits) - 1));
+			const XMVECTOR negOne = XMVectorReplicate(-1.0f);
+
+			for (size_t i = 0; i < count; i += 4)
+			{
+				XMVECTOR u = XMVectorMultiplyAdd(LoadQuantized4(qu + i), scale, negOne);
+				XMVECTOR v = XMVectorMultiplyAdd(LoadQuantized4(qv + i), scale, negOne);
+
+				XMVECTOR x, y, z;
+				OctDecode4(u, v, x, y, z);
+
+				StoreFloat3x4(dst + i * vertexStride + normalOffset, vertexStride,
+					MathHelper::Min(count - i, (size_t)4), x, y, z);
+			}
+		}
+	}
+	else if (normalOffset != NoNormal)
+	{
+		for (UINT i = 0; i < mVertexCount; ++i)
+			memset(dst + (size_t)i * vertexStride + normalOffset, 0, sizeof(XMFLOAT3));
+	}
+
+	mVerticesRead = true;
+
+	return true;
+}
+
+bool CompressedModelReader::ReadIndices(UINT* indices)
+{
+	if (!mVerticesRead)
+		return Fail(L"读取顺序错误.");
+
+	std::vector<uint8_t>& bytes = mScratch[0];
+	std::vector<uint8_t>& escapes = mScratch[1];
+	if (!ReadStream(bytes) || !ReadStream(escapes) || bytes.size() != mIndexCount)
+		return Fail(L"索引数据损坏.");
+
+	const uint8_t* escape = escapes.data();
+	const uint8_t* escapeEnd = escape + escapes.size();
+
+	// 逐个还原, 遇到转义时从转义流读取.
+	UINT nextVertex = 0;
+	auto decodeScalar = [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			UINT z = bytes[i];
+			if (z == kIndexEscape)
+			{
+				UINT extra = 0;
+				if (!ReadVarint(escape, escapeEnd, extra))
+					return false;
+				z += extra;
+			}
+
+			// 新顶点不用分支, 避免每个新顶点一次预测失败. z大于nextVertex时差值回绕, 同样超出顶点数量.
+			UINT index = nextVertex - z;
+			nextVertex += z == 0 ? 1 : 0;
+			if (index >= mVertexCount)
+				return false;
+
+			indices[i] = index;
+		}
+		return true;
+	};
+
+	// 16个字节都不是转义时一次还原16个索引: 新顶点数量的前缀和得到每个位置的nextVertex.
+	// 越界检查按无符号比较(最高位取反后有符号比较)累积到最后.
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i escapeByte = _mm_set1_epi8((char)kIndexEscape);
+	const __m128i bias = _mm_set1_epi32(INT_MIN);
+	const __m128i maxIndex = _mm_set1_epi32((int)((mVertexCount - 1) ^ 0x80000000u));
+	__m128i outOfRange = zero;
+
+	size_t i = 0;
+	for (; i + 16 <= mIndexCount; i += 16)
+	{
+		__m128i b = _mm_loadu_si128((const __m128i*)&bytes[i]);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(b, escapeByte)) != 0)
+		{
+			if (!decodeScalar(i, i + 16))
+				return Fail(L"索引数据损坏或越界.");
+			continue;
+		}
+
+		__m128i base = _mm_set1_epi32((int)nextVertex);
+		__m128i b16[2] = { _mm_unpacklo_epi8(b, zero), _mm_unpackhi_epi8(b, zero) };
+		for (UINT k = 0; k < 4; ++k)
+		{
+			__m128i z = k & 1 ? _mm_unpackhi_epi16(b16[k >> 1], zero) : _mm_unpacklo_epi16(b16[k >> 1], zero);
+
+			// isNew为-1或0, 前缀和取反即为到此为止(含)的新顶点数量.
+			__m128i isNew = _mm_cmpeq_epi32(z, zero);
+			__m128i newCount = _mm_add_epi32(isNew, _mm_slli_si128(isNew, 4));
+			newCount = _mm_add_epi32(newCount, _mm_slli_si128(newCount, 8));
+
+			// index = base + (不含当前的新顶点数量) - z.
+			__m128i index = _mm_sub_epi32(_mm_sub_epi32(base, _mm_sub_epi32(newCount, isNew)), z);
+			_mm_storeu_si128((__m128i*)&indices[i + 4 * k], index);
+
+			outOfRange = _mm_or_si128(outOfRange, _mm_cmpgt_epi32(_mm_xor_si128(index, bias), maxIndex));
+			base = _mm_sub_epi32(base, _mm_shuffle_epi32(newCount, _MM_SHUFFLE(3, 3, 3, 3)));
+		}
+		nextVertex = (UINT)_mm_cvtsi128_si32(base);
+	}
+
+	if (!decodeScalar(i, mIndexCount) || _mm_movemask_epi8(outOfRange) != 0)
+		return Fail(L"索引数据损坏或越界.");
+
+	mFile.Close();
+	mCur = mEnd = nullptr;
+
+	return true;
+}
+
+bool CompressedModelReader::Fail(const std::wstring& msg)
+{
+	mError = mFilename + L": " + msg;
+	mFile.Close();
+	mCur = mEnd = nullptr;
+
+	return false;
+}
+
+bool CompressedModelReader::ReadStream(std::vector<uint8_t>& out)
+{
+	UINT rawSize = 0;
+	if (!GetU32(mCur, mEnd, rawSize) || mCur == mEnd)
+		return false;
+
+	uint8_t mode = *mCur++;
+	switch (mode)
+	{
+	case StreamSingleByte:
+		if (mCur == mEnd)
+			return false;
+		out.assign(rawSize, *mCur++);
+		return true;
+
+	case StreamStored:
+		if ((size_t)(mEnd - mCur) < rawSize)
+			return false;
+		out.assign(mCur, mCur + rawSize);
+		mCur += rawSize;
+		return true;
+
+	case StreamHuffman:
+	{
+		UINT payloadSize = 0;
+		if (!GetU32(mCur, mEnd, payloadSize) ||
+			(size_t)(mEnd - mCur) < (size_t)payloadSize + kStreamPadding)
+		{
+			return false;
+		}
+
+		out.resize(rawSize);
+		if (!DecodeHuffman(mCur, (size_t)payloadSize + kStreamPadding, out.data(), rawSize))
+			return false;
+
+		mCur += payloadSize + kStreamPadding;
+		return true;
+	}
+
+	default:
+		return false;
+	}
+}
@@ -0,0 +1,107 @@
+﻿#pragma once
+
+#include "MappedFile.h"
+#include <Windows.h>
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+///**************************************************************
+/// 模型压缩格式(.mshz).
+/// 位置按包围盒量化, 法线八面体编码后量化, 解码结果与量化后的数据完全一致.
+/// 编码前先做顶点缓存优化并按首次引用重排顶点, 然后:
+///   索引: 新顶点写0, 其余写下一个新顶点编号与它的差值, 小于255的写一个字节, 其余写255, 超出部分以变长字节写入转义流;
+///   顶点: 每个分量单独成段, 与前一个顶点的差值 -> zigzag -> 按字节拆成低/高两个平面;
+/// 每个字节流再用规范Huffman编码(查表解码, 一次查表最多解出两个符号).
+/// 解码时差值累加、反量化和八面体解码都用SSE2一次处理多个值.
+///**************************************************************
+
+struct MeshCodecOptions
+{
+	UINT PositionBits = 16;				// 每个分量的量化位数, 1~16.
+	UINT NormalBits = 12;				// 八面体坐标每个分量的量化位数, 1~16.
+	bool OptimizeVertexCache = true;	// 编码前重排三角形(Forsyth算法).
+};
+
+class MeshCodec
+{
+public:
+	static const UINT Magic = 0x5a48534d;	// "MSHZ".
+	static const UINT Version = 2;
+
+	///<summary>
+	/// 压缩一个模型, normals可以为nullptr. 三角形和顶点的顺序会被改变.
+	///</summary>
+	static void Encode(
+		const DirectX::XMFLOAT3* positions,
+		const DirectX::XMFLOAT3* normals,
+		UINT vertexCount,
+		const UINT* indices,
+		UINT indexCount,
+		const MeshCodecOptions& options,
+		std::vector<uint8_t>& out);
+
+	// 把skull.txt/car.txt格式的模型转换成.mshz文件.
+	static bool EncodeTextModel(
+		const std::wstring& textFile,
+		const std::wstring& outFile,
+		const MeshCodecOptions& options,
+		std::wstring& error);
+
+	// 按Forsyth的线性时间算法重排三角形, 提高顶点缓存命中率.
+	static void OptimizeVertexCache(std::vector<UINT>& indices, UINT vertexCount);
+};
+
+///**************************************************************
+/// .mshz的读取, 接口与TextModelReader相同.
+///**************************************************************
+class CompressedModelReader
+{
+public:
+	static const UINT NoNormal = 0xffffffff;
+
+	bool Open(const std::wstring& filename);
+
+	// 直接从内存中解码, data在读取完成前必须有效.
+	bool Open(const uint8_t* data, size_t size);
+
+	UINT VertexCount() const { return mVertexCount; }
+	UINT TriangleCount() const { return mIndexCount / 3; }
+
+	///<summary>
+	/// 解码顶点到vertices(至少VertexCount()个), 位置写在顶点偏移0处,
+	/// 法线写在normalOffset处(文件中没有法线时写入0).
+	///</summary>
+	bool ReadVertices(void* vertices, UINT vertexStride, UINT normalOffset = NoNormal);
+
+	// 解码索引到indices(至少3 * TriangleCount()个).
+	bool ReadIndices(UINT* indices);
+
+	const std::wstring& ErrorMessage() const { return mError; }
+
+private:
+	bool Fail(const std::wstring& msg);
+
+	// 读取并解码下一个字节流.
+	bool ReadStream(std::vector<uint8_t>& out);
+
+private:
+	MappedFile mFile;
+	std::wstring mFilename;
+	std::wstring mError;
+
+	const uint8_t* mCur = nullptr;
+	const uint8_t* mEnd = nullptr;
+
+	UINT mVertexCount = 0;
+	UINT mIndexCount = 0;
+	UINT mFlags = 0;
+	UINT mPositionBits = 0;
+	UINT mNormalBits = 0;
+	float mBoundsMin[3] = {};
+	float mPositionStep[3] = {};
+
+	bool mVerticesRead = false;
+	std::vector<uint8_t> mScratch[2];
+	std::vector<uint16_t> mQuantized;
+};
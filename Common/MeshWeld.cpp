@@ -0,0 +1,358 @@
+﻿#include "MeshWeld.h"
+#include <cstring>
+#include <cmath>
+#include <climits>
+
+using namespace DirectX;
+
+namespace
+{
+	inline const float* FloatsAt(const uint8_t* vertex, UINT offset)
+	{
+		return reinterpret_cast<const float*>(vertex + offset);
+	}
+
+	inline bool NearlyEqual(const float* a, const float* b, UINT count, float tolerance)
+	{
+		for (UINT i = 0; i < count; ++i)
+		{
+			if (fabsf(a[i] - b[i]) > tolerance)
+				return false;
+		}
+
+		return true;
+	}
+
+	inline uint64_t CellKey(int64_t x, int64_t y, int64_t z)
+	{
+		// 哈希冲突只会让不同格子共用一条链, 比较时仍然按容差判断.
+		uint64_t h = (uint64_t)x * 0x9e3779b97f4a7c15ull;
+		h ^= (uint64_t)y * 0xc2b2ae3d27d4eb4full + (h << 6) + (h >> 2);
+		h ^= (uint64_t)z * 0x165667b19e3779f9ull + (h << 6) + (h >> 2);
+		return h;
+	}
+
+	/// 必须逐字节相同的区间(布局中除了可容差比较的属性之外的部分).
+	struct ByteRange
+	{
+		UINT Offset;
+		UINT Size;
+	};
+
+	std::vector<ByteRange> BuildExactRanges(const MeshWeldLayout& layout)
+	{
+		std::vector<bool> tolerant(layout.VertexStride, false);
+
+		auto markFloats = [&](UINT offset, UINT count)
+		{
+			if (offset == MeshWeldLayout::NoAttribute)
+				return;
+			for (UINT i = offset; i < offset + count * sizeof(float) && i < layout.VertexStride; ++i)
+				tolerant[i] = true;
+		};
+
+		markFloats(layout.PositionOffset, 3);
+		markFloats(layout.NormalOffset, 3);
+		markFloats(layout.TexCOffset, 2);
+
+		std::vector<ByteRange> ranges;
+		for (UINT i = 0; i < layout.VertexStride; )
+		{
+			if (tolerant[i])
+			{
+				++i;
+				continue;
+			}
+
+			UINT begin = i;
+			while (i < layout.VertexStride && !tolerant[i])
+				++i;
+			ranges.push_back({ begin, i - begin });
+		}
+
+		return ranges;
+	}
+
+	struct TriangleKey
+	{
+		UINT V[3];
+		UINT Triangle;
+
+		bool operator<(const TriangleKey& rhs) const
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				if (V[i] != rhs.V[i])
+					return V[i] < rhs.V[i];
+			}
+			return Triangle < rhs.Triangle;
+		}
+
+		bool SameVertices(const TriangleKey& rhs) const
+		{
+			return V[0] == rhs.V[0] && V[1] == rhs.V[1] && V[2] == rhs.V[2];
+		}
+	};
+}
+
+UINT MeshWelder::Weld(
+	void* vertices,
+	UINT vertexCount,
+	std::vector<UINT>& indices,
+	const MeshWeldLayout& layout,
+	const MeshWeldOptions& options,
+	MeshWeldStats& stats)
+{
+	const UINT stride = layout.VertexStride;
+	uint8_t* data = static_cast<uint8_t*>(vertices);
+
+	stats = MeshWeldStats();
+	stats.VerticesBefore = vertexCount;
+	stats.TrianglesBefore = (UINT)indices.size() / 3;
+	stats.BytesBefore = (size_t)vertexCount * stride + indices.size() * sizeof(UINT);
+
+	const std::vector<ByteRange> exactRanges = BuildExactRanges(layout);
+
+	///
+	/// 焊接: 按位置划分空间网格, 在相邻的3x3x3个格子中寻找可以合并的顶点.
+	///
+	const float cellSize = MathHelper::Max(options.PositionTolerance, 1e-6f);
+	const float invCellSize = 1.0f / cellSize;
+
+	std::unordered_map<uint64_t, UINT> cellHeads;
+	cellHeads.reserve(vertexCount);
+	std::vector<UINT> nextInCell(vertexCount, UINT_MAX);
+	std::vector<UINT> remap(vertexCount);
+
+	for (UINT i = 0; i < vertexCount; ++i)
+	{
+		const uint8_t* v = data + (size_t)i * stride;
+		const float* p = FloatsAt(v, layout.PositionOffset);
+
+		int64_t cx = (int64_t)floorf(p[0] * invCellSize);
+		int64_t cy = (int64_t)floorf(p[1] * invCellSize);
+		int64_t cz = (int64_t)floorf(p[2] * invCellSize);
+
+		UINT match = UINT_MAX;
+		for (int dz = -1; dz <= 1 && match == UINT_MAX; ++dz)
+		{
+			for (int dy = -1; dy <= 1 && match == UINT_MAX; ++dy)
+			{
+				for (int dx = -1; dx <= 1 && match == UINT_MAX; ++dx)
+				{
+					auto it = cellHeads.find(CellKey(cx + dx, cy + dy, cz + dz));
+					if (it == cellHeads.end())
+						continue;
+
+					for (UINT r = it->second; r != UINT_MAX; r = nextInCell[r])
+					{
+						const uint8_t* rv = data + (size_t)r * stride;
+
+						if (!NearlyEqual(p, FloatsAt(rv, layout.PositionOffset), 3, options.PositionTolerance))
+							continue;
+						if (layout.NormalOffset != MeshWeldLayout::NoAttribute &&
+							!NearlyEqual(FloatsAt(v, layout.NormalOffset), FloatsAt(rv, layout.NormalOffset), 3, options.NormalTolerance))
+							continue;
+						if (layout.TexCOffset != MeshWeldLayout::NoAttribute &&
+							!NearlyEqual(FloatsAt(v, layout.TexCOffset), FloatsAt(rv, layout.TexCOffset), 2, options.TexCTolerance))
+							continue;
+
+						bool same = true;
+						for (const auto& range : exactRanges)
+						{
+							if (memcmp(v + range.Offset, rv + range.Offset, range.Size) != 0)
+							{
+								same = false;
+								break;
+							}
+						}
+
+						if (same)
+						{
+							match = r;
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		if (match != UINT_MAX)
+		{
+			remap[i] = match;
+			continue;
+		}
+
+		// 新的代表顶点, 加入所在格子的链表.
+		remap[i] = i;
+
+		uint64_t key = CellKey(cx, cy, cz);
+		auto it = cellHeads.find(key);
+		if (it == cellHeads.end())
+		{
+			cellHeads[key] = i;
+		}
+		else
+		{
+			nextInCell[i] = it->second;
+			it->second = i;
+		}
+	}
+
+	///
+	/// 删除退化三角形.
+	///
+	const UINT triCount = (UINT)indices.size() / 3;
+	std::vector<bool> keep(triCount, true);
+
+	for (UINT t = 0; t < triCount; ++t)
+	{
+		UINT a = remap[indices[t * 3 + 0]];
+		UINT b = remap[indices[t * 3 + 1]];
+		UINT c = remap[indices[t * 3 + 2]];
+
+		indices[t * 3 + 0] = a;
+		indices[t * 3 + 1] = b;
+		indices[t * 3 + 2] = c;
+
+		if (!options.RemoveDegenerateTriangles)
+			continue;
+
+		bool degenerate = (a == b || b == c || a == c);
+		if (!degenerate)
+		{
+			XMVECTOR p0 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(data + (size_t)a * stride + layout.PositionOffset));
+			XMVECTOR p1 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(data + (size_t)b * stride + layout.PositionOffset));
+			XMVECTOR p2 = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(data + (size_t)c * stride + layout.PositionOffset));
+
+			XMVECTOR e0 = p1 - p0;
+			XMVECTOR e1 = p2 - p0;
+
+			// 面积相对于边长平方可以忽略(三点共线)时视为退化.
+			float crossLen = XMVectorGetX(XMVector3Length(XMVector3Cross(e0, e1)));
+			float edgeSq = XMVectorGetX(XMVector3LengthSq(e0) + XMVector3LengthSq(e1));
+			degenerate = crossLen <= 1e-7f * edgeSq;
+		}
+
+		if (degenerate)
+		{
+			keep[t] = false;
+			++stats.DegenerateTriangles;
+		}
+	}
+
+	///
+	/// 删除重复三角形, 旋转到最小索引在前以保持绕序, 相反绕序不算重复.
+	///
+	if (options.RemoveDuplicateTriangles)
+	{
+		std::vector<TriangleKey> keys;
+		keys.reserve(triCount);
+
+		for (UINT t = 0; t < triCount; ++t)
+		{
+			if (!keep[t])
+				continue;
+
+			const UINT* tri = &indices[t * 3];
+			UINT first = 0;
+			if (tri[1] < tri[first]) first = 1;
+			if (tri[2] < tri[first]) first = 2;
+
+			TriangleKey key;
+			key.V[0] = tri[first];
+			key.V[1] = tri[(first + 1) % 3];
+			key.V[2] = tri[(first + 2) % 3];
+			key.Triangle = t;
+			keys.push_back(key);
+		}
+
+		std::sort(keys.begin(), keys.end());
+
+		for (size_t i = 1; i < keys.size(); ++i)
+		{
+			if (keys[i].SameVertices(keys[i - 1]))
+			{
+				keep[keys[i].Triangle] = false;
+				++stats.DuplicateTriangles;
+			}
+		}
+	}
+
+	///
+	/// 压缩: 顶点按首次被引用的顺序重新编号, 未被引用的顶点被丢弃.
+	///
+	std::vector<UINT> newIndex(vertexCount, UINT_MAX);
+	std::vector<uint8_t> compacted;
+	compacted.reserve((size_t)vertexCount * stride);
+
+	UINT newVertexCount = 0;
+	UINT writeIndex = 0;
+
+	for (UINT t = 0; t < triCount; ++t)
+	{
+		if (!keep[t])
+			continue;
+
+		for (UINT k = 0; k < 3; ++k)
+		{
+			UINT v = indices[t * 3 + k];
+			if (newIndex[v] == UINT_MAX)
+			{
+				newIndex[v] = newVertexCount++;
+
+				const uint8_t* src = data + (size_t)v * stride;
+				compacted.insert(compacted.end(), src, src + stride);
+			}
+
+			indices[writeIndex++] = newIndex[v];
+		}
+	}
+
+	indices.resize(writeIndex);
+
+	if (!compacted.empty())
+		memcpy(data, compacted.data(), compacted.size());
+
+	stats.VerticesAfter = newVertexCount;
+	stats.TrianglesAfter = writeIndex / 3;
+	stats.BytesAfter = (size_t)newVertexCount * stride + indices.size() * sizeof(UINT);
+
+	return newVertexCount;
+}
+
+void MeshWelder::Weld(GeometryGenerator::MeshData& meshData, const MeshWeldOptions& options, MeshWeldStats& stats)
+{
+	MeshWeldLayout layout;
+	layout.VertexStride = sizeof(GeometryGenerator::Vertex);
+	layout.PositionOffset = offsetof(GeometryGenerator::Vertex, Position);
+	layout.NormalOffset = offsetof(GeometryGenerator::Vertex, Normal);
+	layout.TexCOffset = offsetof(GeometryGenerator::Vertex, TexC);
+
+	UINT vertexCount = Weld(meshData.Vertices.data(), (UINT)meshData.Vertices.size(),
+		meshData.Indices, layout, options, stats);
+
+	meshData.Vertices.resize(vertexCount);
+}
+
+void MeshWelder::Report(const std::wstring& meshName, const MeshWeldStats& stats)
+{
+	auto percent = [](double before, double after)
+	{
+		return before > 0.0 ? 100.0 * (before - after) / before : 0.0;
+	};
+
+	std::wostringstream oss;
+	oss.setf(std::ios::fixed);
+	oss.precision(1);
+
+	oss << L"MeshWeld " << meshName << L": "
+		<< L"vertices " << stats.VerticesBefore << L" -> " << stats.VerticesAfter
+		<< L" (-" << percent(stats.VerticesBefore, stats.VerticesAfter) << L"%), "
+		<< L"triangles " << stats.TrianglesBefore << L" -> " << stats.TrianglesAfter
+		<< L" (degenerate " << stats.DegenerateTriangles << L", duplicate " << stats.DuplicateTriangles << L"), "
+		<< L"memory " << stats.BytesBefore / 1024.0 << L" KB -> " << stats.BytesAfter / 1024.0
+		<< L" KB (-" << percent((double)stats.BytesBefore, (double)stats.BytesAfter) << L"%)\n";
+
+	OutputDebugStringW(oss.str().c_str());
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include "d3dUtil.h"
+#include "GeometryGenerator.h"
+
+///**************************************************************
+/// 导入时的网格清理: 按容差焊接重合顶点, 删除退化三角形和重复三角形,
+/// 并把顶点压缩、重排为紧凑的索引缓冲区.
+///**************************************************************
+
+/// 顶点结构中各属性的字节偏移, 没有的属性使用NoAttribute.
+struct MeshWeldLayout
+{
+	static const UINT NoAttribute = 0xffffffff;
+
+	UINT VertexStride = 0;
+	UINT PositionOffset = 0;				// XMFLOAT3.
+	UINT NormalOffset = NoAttribute;		// XMFLOAT3.
+	UINT TexCOffset = NoAttribute;			// XMFLOAT2.
+};
+
+struct MeshWeldOptions
+{
+	// 各分量的最大差值, 超过任意一个都不焊接. 布局中其余字节必须完全相同.
+	float PositionTolerance = 1e-5f;
+	float NormalTolerance = 1e-3f;
+	float TexCTolerance = 1e-4f;
+
+	bool RemoveDegenerateTriangles = true;	// 重复索引或面积为0.
+	bool RemoveDuplicateTriangles = true;	// 相同顶点、相同绕序.
+};
+
+struct MeshWeldStats
+{
+	UINT VerticesBefore = 0;
+	UINT VerticesAfter = 0;
+	UINT TrianglesBefore = 0;
+	UINT TrianglesAfter = 0;
+	UINT DegenerateTriangles = 0;
+	UINT DuplicateTriangles = 0;
+	size_t BytesBefore = 0;					// 顶点缓冲区 + 索引缓冲区.
+	size_t BytesAfter = 0;
+};
+
+class MeshWelder
+{
+public:
+	///<summary>
+	/// 在原数组上完成焊接, 焊接后的顶点按首次被索引引用的顺序排列在vertices前部,
+	/// 返回新的顶点数量. indices会被改写(删除的三角形也会被移除).
+	///</summary>
+	static UINT Weld(
+		void* vertices,
+		UINT vertexCount,
+		std::vector<UINT>& indices,
+		const MeshWeldLayout& layout,
+		const MeshWeldOptions& options,
+		MeshWeldStats& stats);
+
+	// GeometryGenerator生成的几何体.
+	static void Weld(GeometryGenerator::MeshData& meshData, const MeshWeldOptions& options, MeshWeldStats& stats);
+
+	// 把统计信息输出到调试窗口.
+	static void Report(const std::wstring& meshName, const MeshWeldStats& stats);
+};
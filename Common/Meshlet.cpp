@@ -0,0 +1,289 @@
+﻿#include "Meshlet.h"
+#include <climits>
+
+using namespace DirectX;
+
+namespace
+{
+	inline const XMFLOAT3& PositionAt(const void* vertices, UINT vertexStride, UINT i)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(static_cast<const BYTE*>(vertices) + (size_t)i * vertexStride);
+	}
+
+	// 计算簇的包围球和法线锥.
+	void ComputeMeshletBounds(
+		const void* vertices,
+		UINT vertexStride,
+		const UINT* triIndices,
+		UINT indexCount,
+		const std::vector<UINT>& meshletVertices,
+		Meshlet& meshlet)
+	{
+		std::vector<XMFLOAT3> points(meshletVertices.size());
+		for (size_t i = 0; i < meshletVertices.size(); ++i)
+			points[i] = PositionAt(vertices, vertexStride, meshletVertices[i]);
+
+		BoundingSphere::CreateFromPoints(meshlet.Bounds, points.size(), points.data(), sizeof(XMFLOAT3));
+
+		// 三角形法线(D3D中顺时针为正面, cross(e1, e2)即为外法线).
+		std::vector<XMFLOAT3> normals;
+		normals.reserve(indexCount / 3);
+
+		XMVECTOR axis = XMVectorZero();
+		for (UINT i = 0; i < indexCount; i += 3)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&PositionAt(vertices, vertexStride, triIndices[i + 0]));
+			XMVECTOR p1 = XMLoadFloat3(&PositionAt(vertices, vertexStride, triIndices[i + 1]));
+			XMVECTOR p2 = XMLoadFloat3(&PositionAt(vertices, vertexStride, triIndices[i + 2]));
+
+			XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			float len = XMVectorGetX(XMVector3Length(n));
+
+			// 退化三角形不参与计算.
+			if (len < 1e-12f)
+				continue;
+
+			n = n / len;
+			axis += n;
+
+			XMFLOAT3 nf;
+			XMStoreFloat3(&nf, n);
+			normals.push_back(nf);
+		}
+
+		meshlet.ConeAxis = XMFLOAT3(0.0f, 0.0f, 1.0f);
+		meshlet.ConeCutoff = 1.0f;
+
+		float axisLen = XMVectorGetX(XMVector3Length(axis));
+		if (normals.empty() || axisLen < 1e-6f)
+			return;
+
+		axis = axis / axisLen;
+
+		float minDot = 1.0f;
+		for (const auto& nf : normals)
+			minDot = MathHelper::Min(minDot, XMVectorGetX(XMVector3Dot(axis, XMLoadFloat3(&nf))));
+
+		// 法线锥张角接近或超过半球时, 背面剔除已没有意义.
+		if (minDot <= 0.1f)
+			return;
+
+		XMStoreFloat3(&meshlet.ConeAxis, axis);
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+void MeshletBuilder::Build(
+	const void* vertices,
+	UINT vertexStride,
+	UINT vertexCount,
+	std::vector<UINT>& indices,
+	MeshletData& meshletData,
+	UINT maxVertices,
+	UINT maxTriangles)
+{
+	assert(maxVertices >= 3 && maxTriangles >= 1);
+
+	meshletData.Meshlets.clear();
+
+	const UINT triCount = (UINT)indices.size() / 3;
+	if (triCount == 0)
+		return;
+
+	///
+	/// 顶点 -> 三角形的邻接表(CSR格式).
+	///
+	std::vector<UINT> adjOffsets(vertexCount + 1, 0);
+	for (UINT i = 0; i < triCount * 3; ++i)
+		adjOffsets[indices[i] + 1]++;
+	for (UINT v = 0; v < vertexCount; ++v)
+		adjOffsets[v + 1] += adjOffsets[v];
+
+	std::vector<UINT> adjTris(triCount * 3);
+	std::vector<UINT> adjFill(adjOffsets.begin(), adjOffsets.end() - 1);
+	for (UINT t = 0; t < triCount; ++t)
+	{
+		for (UINT k = 0; k < 3; ++k)
+			adjTris[adjFill[indices[t * 3 + k]]++] = t;
+	}
+
+	///
+	/// 贪心构建: 从种子三角形开始, 每次加入与簇共享顶点最多的相邻三角形.
+	///
+	std::vector<bool> emitted(triCount, false);
+	std::vector<UINT> vertexTag(vertexCount, UINT_MAX);
+	std::vector<UINT> meshletVertices;
+	meshletVertices.reserve(maxVertices);
+
+	std::vector<UINT> newIndices;
+	newIndices.reserve(indices.size());
+
+	UINT seedCursor = 0;
+	UINT meshletId = 0;
+
+	while (true)
+	{
+		while (seedCursor < triCount && emitted[seedCursor])
+			++seedCursor;
+		if (seedCursor == triCount)
+			break;
+
+		Meshlet meshlet;
+		meshlet.StartIndexLocation = (UINT)newIndices.size();
+		meshletVertices.clear();
+
+		UINT tri = seedCursor;
+		UINT meshletTris = 0;
+
+		while (true)
+		{
+			// 把三角形加入当前簇.
+			emitted[tri] = true;
+			for (UINT k = 0; k < 3; ++k)
+			{
+				UINT v = indices[tri * 3 + k];
+				newIndices.push_back(v);
+
+				if (vertexTag[v] != meshletId)
+				{
+					vertexTag[v] = meshletId;
+					meshletVertices.push_back(v);
+				}
+			}
+			++meshletTris;
+
+			if (meshletTris >= maxTriangles)
+				break;
+
+			// 在簇的顶点邻域里找新增顶点最少的三角形.
+			UINT best = UINT_MAX;
+			UINT bestNew = 4;
+			for (size_t i = 0; i < meshletVertices.size() && bestNew > 0; ++i)
+			{
+				UINT v = meshletVertices[i];
+				for (UINT a = adjOffsets[v]; a < adjOffsets[v + 1]; ++a)
+				{
+					UINT t = adjTris[a];
+					if (emitted[t])
+						continue;
+
+					UINT newVerts = 0;
+					for (UINT k = 0; k < 3; ++k)
+						newVerts += (vertexTag[indices[t * 3 + k]] != meshletId) ? 1 : 0;
+
+					if (meshletVertices.size() + newVerts > maxVertices)
+						continue;
+
+					if (newVerts < bestNew || (newVerts == bestNew && t < best))
+					{
+						best = t;
+						bestNew = newVerts;
+					}
+				}
+			}
+
+			if (best == UINT_MAX)
+				break;
+
+			tri = best;
+		}
+
+		meshlet.IndexCount = (UINT)newIndices.size() - meshlet.StartIndexLocation;
+		meshlet.VertexCount = (UINT)meshletVertices.size();
+
+		ComputeMeshletBounds(vertices, vertexStride, &newIndices[meshlet.StartIndexLocation],
+			meshlet.IndexCount, meshletVertices, meshlet);
+
+		meshletData.Meshlets.push_back(meshlet);
+		++meshletId;
+	}
+
+	indices.swap(newIndices);
+}
+
+UINT MeshletCuller::Cull(
+	const MeshletData& meshletData,
+	CXMMATRIX world,
+	const XMFLOAT4 frustumPlanes[6],
+	const XMFLOAT3& eyePosW,
+	std::vector<MeshletDrawRange>& drawRanges)
+{
+	drawRanges.clear();
+
+	XMVECTOR planes[6];
+	for (int i = 0; i < 6; ++i)
+		planes[i] = XMLoadFloat4(&frustumPlanes[i]);
+
+	XMVECTOR eyePos = XMLoadFloat3(&eyePosW);
+
+	// 法线锥只在等比缩放下成立, 非等比缩放时跳过背面剔除.
+	float sx = XMVectorGetX(XMVector3Length(world.r[0]));
+	float sy = XMVectorGetX(XMVector3Length(world.r[1]));
+	float sz = XMVectorGetX(XMVector3Length(world.r[2]));
+	float maxScale = MathHelper::Max(sx, MathHelper::Max(sy, sz));
+	float minScale = MathHelper::Min(sx, MathHelper::Min(sy, sz));
+	bool coneCulling = maxScale - minScale <= 0.01f * maxScale;
+
+	UINT visibleCount = 0;
+	for (const auto& meshlet : meshletData.Meshlets)
+	{
+		BoundingSphere sphere;
+		meshlet.Bounds.Transform(sphere, world);
+
+		XMVECTOR center = XMLoadFloat3(&sphere.Center);
+		center = XMVectorSetW(center, 1.0f);
+
+		// 视锥体剔除.
+		bool culled = false;
+		for (int i = 0; i < 6 && !culled; ++i)
+		{
+			float d = XMVectorGetX(XMVector4Dot(planes[i], center));
+			culled = d < -sphere.Radius;
+		}
+
+		// 法线锥背面剔除.
+		if (!culled && coneCulling && meshlet.ConeCutoff < 1.0f)
+		{
+			XMVECTOR axis = XMVector3Normalize(
+				XMVector3TransformNormal(XMLoadFloat3(&meshlet.ConeAxis), world));
+			XMVECTOR toCenter = center - eyePos;
+
+			float dist = XMVectorGetX(XMVector3Length(toCenter));
+			float d = XMVectorGetX(XMVector3Dot(toCenter, axis));
+			culled = d >= meshlet.ConeCutoff * dist + sphere.Radius;
+		}
+
+		if (culled)
+			continue;
+
+		++visibleCount;
+
+		// 相邻的可见簇合并为一个绘制区间.
+		if (!drawRanges.empty() &&
+			drawRanges.back().StartIndexLocation + drawRanges.back().IndexCount == meshlet.StartIndexLocation)
+		{
+			drawRanges.back().IndexCount += meshlet.IndexCount;
+		}
+		else
+		{
+			drawRanges.push_back({ meshlet.StartIndexLocation, meshlet.IndexCount });
+		}
+	}
+
+	return visibleCount;
+}
+
+void MeshletCuller::BuildCompactedIndices(
+	const std::vector<MeshletDrawRange>& drawRanges,
+	const std::vector<UINT>& indices,
+	std::vector<UINT>& compactedIndices)
+{
+	compactedIndices.clear();
+
+	for (const auto& range : drawRanges)
+	{
+		compactedIndices.insert(compactedIndices.end(),
+			indices.begin() + range.StartIndexLocation,
+			indices.begin() + range.StartIndexLocation + range.IndexCount);
+	}
+}
@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include "d3dUtil.h"
+#include "GeometryGenerator.h"
+#include <DirectXCollision.h>
+
+///**************************************************************
+/// 网格簇(Meshlet), 把一个几何体切分成若干小簇, 用于CPU端的细粒度剔除.
+///**************************************************************
+
+/// 一个网格簇, 簇内三角形在索引缓冲区中是连续的.
+struct Meshlet
+{
+	UINT StartIndexLocation = 0;		// 簇在索引缓冲区中的偏移量(相对子网格).
+	UINT IndexCount = 0;				// 簇的索引数量.
+	UINT VertexCount = 0;				// 簇引用的不重复顶点数量.
+
+	DirectX::BoundingSphere Bounds;		// 簇的包围球(模型空间).
+
+	// 法线锥, 用于背面剔除. ConeCutoff >= 1 表示法线过于分散, 不做背面剔除.
+	DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 1.0f };
+	float ConeCutoff = 1.0f;
+};
+
+/// 一个几何体的所有网格簇.
+struct MeshletData
+{
+	std::vector<Meshlet> Meshlets;
+};
+
+/// 剔除后需要绘制的索引区间, 相邻的可见簇会合并成一个区间.
+struct MeshletDrawRange
+{
+	UINT StartIndexLocation;
+	UINT IndexCount;
+};
+
+class MeshletBuilder
+{
+public:
+	static const UINT DefaultMaxVertices = 64;
+	static const UINT DefaultMaxTriangles = 124;
+
+	///<summary>
+	/// 把三角形列表划分为网格簇. 顶点的前12字节必须是位置,
+	/// indices 会被重新排序, 使每个簇的三角形在索引缓冲区中连续.
+	///</summary>
+	static void Build(
+		const void* vertices,
+		UINT vertexStride,
+		UINT vertexCount,
+		std::vector<UINT>& indices,
+		MeshletData& meshletData,
+		UINT maxVertices = DefaultMaxVertices,
+		UINT maxTriangles = DefaultMaxTriangles);
+
+	template<typename T>
+	static void Build(
+		const std::vector<T>& vertices,
+		std::vector<UINT>& indices,
+		MeshletData& meshletData,
+		UINT maxVertices = DefaultMaxVertices,
+		UINT maxTriangles = DefaultMaxTriangles)
+	{
+		Build(vertices.data(), sizeof(T), (UINT)vertices.size(),
+			indices, meshletData, maxVertices, maxTriangles);
+	}
+
+	static void Build(
+		GeometryGenerator::MeshData& meshData,
+		MeshletData& meshletData,
+		UINT maxVertices = DefaultMaxVertices,
+		UINT maxTriangles = DefaultMaxTriangles)
+	{
+		Build(meshData.Vertices, meshData.Indices, meshletData, maxVertices, maxTriangles);
+	}
+};
+
+class MeshletCuller
+{
+public:
+	///<summary>
+	/// 每帧剔除网格簇: 视锥体剔除 + 法线锥背面剔除.
+	/// frustumPlanes 是世界空间的平面(可用ExtractFrustumPlanes(planes, viewProj)得到).
+	/// 输出合并后的绘制区间, 返回可见簇的数量.
+	///</summary>
+	static UINT Cull(
+		const MeshletData& meshletData,
+		DirectX::CXMMATRIX world,
+		const DirectX::XMFLOAT4 frustumPlanes[6],
+		const DirectX::XMFLOAT3& eyePosW,
+		std::vector<MeshletDrawRange>& drawRanges);
+
+	///<summary>
+	/// 根据绘制区间生成紧凑的索引列表, 适合上传到动态索引缓冲区后一次绘制.
+	///</summary>
+	static void BuildCompactedIndices(
+		const std::vector<MeshletDrawRange>& drawRanges,
+		const std::vector<UINT>& indices,
+		std::vector<UINT>& compactedIndices);
+};
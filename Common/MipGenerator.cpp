@@ -0,0 +1,630 @@
+﻿#include "MipGenerator.h"
+#include "BCCompressor.h"
+#include "DDS.h"
+#include "DDSWriter.h"
+#include "MappedFile.h"
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+	enum class PixelType
+	{
+		Unknown,
+		UNorm8,
+		Half,
+		Float
+	};
+
+	PixelType GetPixelType(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R8G8B8A8_UNORM:
+		case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		case DXGI_FORMAT_B8G8R8A8_UNORM:
+		case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+			return PixelType::UNorm8;
+
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+			return PixelType::Half;
+
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+			return PixelType::Float;
+
+		default:
+			return PixelType::Unknown;
+		}
+	}
+
+	inline UINT PixelBytes(PixelType type)
+	{
+		return type == PixelType::UNorm8 ? 4 : (type == PixelType::Half ? 8 : 16);
+	}
+
+	///
+	/// sRGB与线性空间的转换.
+	///
+
+	inline float SRGBToLinear(float v)
+	{
+		return v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+	}
+
+	inline float LinearToSRGB(float v)
+	{
+		v = (std::min)((std::max)(v, 0.0f), 1.0f);
+		return v <= 0.0031308f ? v * 12.92f : 1.055f * std::pow(v, 1.0f / 2.4f) - 0.055f;
+	}
+
+	struct SRGBTable
+	{
+		static const int EncodeSteps = 4096;
+
+		float ToLinear[256];
+		uint8_t ToSRGB[EncodeSteps + 1];	// 线性值量化到1/4096后查表, 避免每个分量调用pow.
+
+		SRGBTable()
+		{
+			for (int i = 0; i < 256; ++i)
+				ToLinear[i] = SRGBToLinear(i / 255.0f);
+
+			for (int i = 0; i <= EncodeSteps; ++i)
+				ToSRGB[i] = (uint8_t)(LinearToSRGB((float)i / EncodeSteps) * 255.0f + 0.5f);
+		}
+
+		uint8_t Encode(float v) const
+		{
+			v = (std::min)((std::max)(v, 0.0f), 1.0f);
+			return ToSRGB[(int)(v * EncodeSteps + 0.5f)];
+		}
+	};
+
+	// 第一次生成mip时才建表.
+	const SRGBTable& SRGB()
+	{
+		static const SRGBTable table;
+		return table;
+	}
+
+	inline uint8_t ToUNorm8(float v)
+	{
+		v = (std::min)((std::max)(v, 0.0f), 1.0f);
+		return (uint8_t)(v * 255.0f + 0.5f);
+	}
+
+	///<summary>
+	/// 把[0, count)分给threadCount个线程执行, 每次取一个.
+	///</summary>
+	void ParallelFor(UINT count, UINT threadCount, const std::function<void(UINT)>& body)
+	{
+		std::atomic<UINT> next(0);
+		auto worker = [&]()
+		{
+			for (UINT i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+				body(i);
+		};
+
+		if (threadCount == 0)
+			threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+		threadCount = (std::min)(threadCount, count);
+
+		std::vector<std::thread> threads;
+		for (UINT i = 1; i < threadCount; ++i)
+			threads.emplace_back(worker);
+
+		worker();
+
+		for (auto& t : threads)
+			t.join();
+	}
+
+	/// 一级mip, 每个像素4个float, 颜色已在线性空间.
+	struct FloatImage
+	{
+		UINT Width = 0;
+		UINT Height = 0;
+		std::vector<float> Pixels;
+	};
+
+	void Decode(const uint8_t* src, UINT width, UINT height, UINT rowPitch, PixelType type, bool srgb, FloatImage& image)
+	{
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.resize((size_t)width * height * 4);
+
+		const SRGBTable& table = SRGB();
+		for (UINT y = 0; y < height; ++y)
+		{
+			const uint8_t* row = src + (size_t)y * rowPitch;
+			float* dst = image.Pixels.data() + (size_t)y * width * 4;
+
+			switch (type)
+			{
+			case PixelType::UNorm8:
+				for (UINT i = 0; i < 4 * width; ++i)
+				{
+					if (srgb && (i & 3) != 3)
+						dst[i] = table.ToLinear[row[i]];
+					else
+						dst[i] = row[i] / 255.0f;
+				}
+				break;
+
+			case PixelType::Half:
+				for (UINT i = 0; i < 4 * width; ++i)
+					dst[i] = XMConvertHalfToFloat(((const HALF*)row)[i]);
+				break;
+
+			default:
+				memcpy(dst, row, (size_t)width * 16);
+				break;
+			}
+		}
+	}
+
+	void Encode(const FloatImage& image, PixelType type, bool srgb, std::vector<uint8_t>& out)
+	{
+		const size_t count = (size_t)image.Width * image.Height * 4;
+		out.resize((size_t)image.Width * image.Height * PixelBytes(type));
+
+		const SRGBTable& table = SRGB();
+		switch (type)
+		{
+		case PixelType::UNorm8:
+			for (size_t i = 0; i < count; ++i)
+			{
+				float v = image.Pixels[i];
+				out[i] = (srgb && (i & 3) != 3) ? table.Encode(v) : ToUNorm8(v);
+			}
+			break;
+
+		case PixelType::Half:
+			for (size_t i = 0; i < count; ++i)
+				((HALF*)out.data())[i] = XMConvertFloatToHalf(image.Pixels[i]);
+			break;
+
+		default:
+			memcpy(out.data(), image.Pixels.data(), count * sizeof(float));
+			break;
+		}
+	}
+
+	///
+	/// 一维滤波核, 每个目标像素对应一段连续的源像素及其权重.
+	///
+
+	struct FilterTaps
+	{
+		std::vector<UINT> First;
+		std::vector<UINT> Count;
+		std::vector<UINT> Offset;		// 在Weights中的起始位置.
+		std::vector<float> Weights;
+	};
+
+	const float KaiserWidth = 3.0f;		// 以目标像素为单位的半径.
+	const float KaiserAlpha = 4.0f;
+
+	// 第一类零阶修正贝塞尔函数.
+	float BesselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (x / (2.0f * k)) * (x / (2.0f * k));
+			sum += term;
+			if (term < sum * 1e-8f)
+				break;
+		}
+		return sum;
+	}
+
+	float KaiserSinc(float x)
+	{
+		float t = x / KaiserWidth;
+		if (std::fabs(t) >= 1.0f)
+			return 0.0f;
+
+		float window = BesselI0(KaiserAlpha * std::sqrt(1.0f - t * t)) / BesselI0(KaiserAlpha);
+		float sinc = (std::fabs(x) < 1e-6f) ? 1.0f : std::sin(XM_PI * x) / (XM_PI * x);
+		return sinc * window;
+	}
+
+	void BuildFilter(UINT srcSize, UINT dstSize, MipFilter filter, FilterTaps& taps)
+	{
+		taps.First.resize(dstSize);
+		taps.Count.resize(dstSize);
+		taps.Offset.resize(dstSize);
+		taps.Weights.clear();
+
+		const float scale = (float)srcSize / (float)dstSize;
+		std::vector<float> weights(srcSize);
+
+		for (UINT x = 0; x < dstSize; ++x)
+		{
+			const float center = (x + 0.5f) * scale;
+			std::fill(weights.begin(), weights.end(), 0.0f);
+
+			if (filter == MipFilter::Box || srcSize == dstSize)
+			{
+				const float radius = 0.5f * scale;
+				int i0 = (int)std::floor(center - radius);
+				int i1 = (int)std::ceil(center + radius);
+				for (int i = i0; i < i1; ++i)
+				{
+					float overlap = (std::min)(i + 1.0f, center + radius) - (std::max)((float)i, center - radius);
+					if (overlap > 0.0f)
+						weights[(std::min)((std::max)(i, 0), (int)srcSize - 1)] += overlap;
+				}
+			}
+			else
+			{
+				const float radius = KaiserWidth * scale;
+				int i0 = (int)std::floor(center - radius);
+				int i1 = (int)std::ceil(center + radius);
+				for (int i = i0; i <= i1; ++i)
+				{
+					// 超出边界的源像素取边缘值.
+					float w = KaiserSinc((i + 0.5f - center) / scale);
+					weights[(std::min)((std::max)(i, 0), (int)srcSize - 1)] += w;
+				}
+			}
+
+			UINT first = 0;
+			while (first < srcSize && weights[first] == 0.0f)
+				++first;
+			UINT last = srcSize;
+			while (last > first && weights[last - 1] == 0.0f)
+				--last;
+
+			float sum = 0.0f;
+			for (UINT i = first; i < last; ++i)
+				sum += weights[i];
+
+			taps.First[x] = first;
+			taps.Count[x] = last - first;
+			taps.Offset[x] = (UINT)taps.Weights.size();
+			for (UINT i = first; i < last; ++i)
+				taps.Weights.push_back(weights[i] / sum);
+		}
+	}
+
+	///<summary>
+	/// 可分离滤波: 先按行缩小宽度, 再按列缩小高度.
+	///</summary>
+	void Downsample(const FloatImage& src, FloatImage& dst, MipFilter filter, UINT threadCount)
+	{
+		dst.Width = (std::max)(src.Width / 2, 1u);
+		dst.Height = (std::max)(src.Height / 2, 1u);
+		dst.Pixels.assign((size_t)dst.Width * dst.Height * 4, 0.0f);
+
+		FilterTaps horz, vert;
+		BuildFilter(src.Width, dst.Width, filter, horz);
+		BuildFilter(src.Height, dst.Height, filter, vert);
+
+		std::vector<float> temp((size_t)dst.Width * src.Height * 4);
+
+		ParallelFor(src.Height, threadCount, [&](UINT y)
+		{
+			const float* row = src.Pixels.data() + (size_t)y * src.Width * 4;
+			float* out = temp.data() + (size_t)y * dst.Width * 4;
+			for (UINT x = 0; x < dst.Width; ++x)
+			{
+				const float* w = horz.Weights.data() + horz.Offset[x];
+				const float* p = row + (size_t)horz.First[x] * 4;
+				float r = 0.0f, g = 0.0f, b = 0.0f, a = 0.0f;
+				for (UINT k = 0; k < horz.Count[x]; ++k, p += 4)
+				{
+					r += w[k] * p[0];
+					g += w[k] * p[1];
+					b += w[k] * p[2];
+					a += w[k] * p[3];
+				}
+				out[4 * x + 0] = r;
+				out[4 * x + 1] = g;
+				out[4 * x + 2] = b;
+				out[4 * x + 3] = a;
+			}
+		});
+
+		const size_t rowFloats = (size_t)dst.Width * 4;
+		ParallelFor(dst.Height, threadCount, [&](UINT y)
+		{
+			float* out = dst.Pixels.data() + y * rowFloats;
+			const float* w = vert.Weights.data() + vert.Offset[y];
+			for (UINT k = 0; k < vert.Count[y]; ++k)
+			{
+				const float* row = temp.data() + (vert.First[y] + k) * rowFloats;
+				for (size_t i = 0; i < rowFloats; ++i)
+					out[i] += w[k] * row[i];
+			}
+		});
+	}
+
+	///
+	/// alpha覆盖率.
+	///
+
+	float AlphaCoverage(const FloatImage& image, float cutoff, float scale)
+	{
+		const size_t count = (size_t)image.Width * image.Height;
+		size_t covered = 0;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (image.Pixels[4 * i + 3] * scale > cutoff)
+				++covered;
+		}
+		return (float)covered / (float)count;
+	}
+
+	///<summary>
+	/// 二分查找alpha的缩放系数, 使覆盖率接近target, 然后缩放alpha.
+	///</summary>
+	void PreserveAlphaCoverage(FloatImage& image, float cutoff, float target)
+	{
+		float lo = 0.0f;
+		float hi = 4.0f;
+		float bestScale = 1.0f;
+		float bestDiff = std::fabs(AlphaCoverage(image, cutoff, 1.0f) - target);
+
+		for (int it = 0; it < 16 && bestDiff > 0.0f; ++it)
+		{
+			float mid = 0.5f * (lo + hi);
+			float coverage = AlphaCoverage(image, cutoff, mid);
+			float diff = std::fabs(coverage - target);
+			if (diff < bestDiff)
+			{
+				bestDiff = diff;
+				bestScale = mid;
+			}
+
+			if (coverage < target)
+				lo = mid;
+			else
+				hi = mid;
+		}
+
+		if (bestScale == 1.0f)
+			return;
+
+		const size_t count = (size_t)image.Width * image.Height;
+		for (size_t i = 0; i < count; ++i)
+			image.Pixels[4 * i + 3] = (std::min)(image.Pixels[4 * i + 3] * bestScale, 1.0f);
+	}
+
+	inline bool IsSRGBBlockFormat(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_BC1_UNORM_SRGB || format == DXGI_FORMAT_BC2_UNORM_SRGB || format == DXGI_FORMAT_BC3_UNORM_SRGB;
+	}
+}
+
+bool MipGenerator::IsSupported(DXGI_FORMAT format)
+{
+	return GetPixelType(format) != PixelType::Unknown;
+}
+
+UINT MipGenerator::CountLevels(UINT width, UINT height)
+{
+	UINT levels = 1;
+	while (width > 1 || height > 1)
+	{
+		width = (std::max)(width / 2, 1u);
+		height = (std::max)(height / 2, 1u);
+		++levels;
+	}
+	return levels;
+}
+
+bool MipGenerator::Generate(
+	const uint8_t* pixels,
+	UINT width,
+	UINT height,
+	UINT rowPitch,
+	DXGI_FORMAT format,
+	const MipGeneratorOptions& options,
+	std::vector<std::vector<uint8_t>>& mips,
+	std::wstring& error)
+{
+	mips.clear();
+
+	const PixelType type = GetPixelType(format);
+	if (type == PixelType::Unknown)
+	{
+		error = L"MipGenerator: unsupported format.";
+		return false;
+	}
+
+	if (pixels == nullptr || width == 0 || height == 0)
+	{
+		error = L"MipGenerator: empty image.";
+		return false;
+	}
+
+	if (rowPitch == 0)
+		rowPitch = width * PixelBytes(type);
+
+	const bool srgb = (type == PixelType::UNorm8) && (options.SRGB || MakeSRGB(format) == format);
+
+	UINT levels = CountLevels(width, height);
+	if (options.MaxLevels > 0)
+		levels = (std::min)(levels, options.MaxLevels);
+
+	mips.resize(levels);
+
+	// 第0级原样拷贝, 不经过浮点转换.
+	const size_t rowBytes = (size_t)width * PixelBytes(type);
+	mips[0].resize(rowBytes * height);
+	for (UINT y = 0; y < height; ++y)
+		memcpy(mips[0].data() + y * rowBytes, pixels + (size_t)y * rowPitch, rowBytes);
+
+	FloatImage current;
+	Decode(pixels, width, height, rowPitch, type, srgb, current);
+
+	const bool keepCoverage = options.AlphaCutoff > 0.0f;
+	const float coverage = keepCoverage ? AlphaCoverage(current, options.AlphaCutoff, 1.0f) : 0.0f;
+
+	FloatImage next;
+	FloatImage scaled;
+	for (UINT level = 1; level < levels; ++level)
+	{
+		// 始终由未缩放alpha的上一级滤波, 缩放的误差不会逐级累积.
+		Downsample(current, next, options.Filter, options.ThreadCount);
+		std::swap(current, next);
+
+		if (keepCoverage)
+		{
+			scaled = current;
+			PreserveAlphaCoverage(scaled, options.AlphaCutoff, coverage);
+			Encode(scaled, type, srgb, mips[level]);
+		}
+		else
+		{
+			Encode(current, type, srgb, mips[level]);
+		}
+	}
+
+	return true;
+}
+
+bool MipGenerator::ProcessDDS(
+	const std::wstring& inFile,
+	const std::wstring& outFile,
+	const MipGeneratorOptions& options,
+	std::wstring& error)
+{
+	MappedFile file;
+	if (!file.Open(inFile))
+	{
+		error = L"MipGenerator: cannot open " + inFile;
+		return false;
+	}
+
+	DDS_FILE_VIEW dds;
+	if (!ParseDDSData(file.Data(), file.Size(), dds))
+	{
+		error = L"MipGenerator: invalid DDS file " + inFile;
+		return false;
+	}
+
+	const DDS_HEADER* header = dds.header;
+	if (header->flags & DDS_HEADER_FLAGS_VOLUME)
+	{
+		error = L"MipGenerator: volume textures are not supported.";
+		return false;
+	}
+
+	DDSImage image;
+	image.Width = header->width;
+	image.Height = header->height;
+
+	if (dds.headerDXT10)
+	{
+		if (dds.headerDXT10->resourceDimension != 3)	// D3D11_RESOURCE_DIMENSION_TEXTURE2D
+		{
+			error = L"MipGenerator: only 2D textures are supported.";
+			return false;
+		}
+
+		image.Format = dds.headerDXT10->dxgiFormat;
+		image.IsCubeMap = (dds.headerDXT10->miscFlag & 0x4) != 0;	// D3D11_RESOURCE_MISC_TEXTURECUBE
+		image.ArraySize = dds.headerDXT10->arraySize * (image.IsCubeMap ? 6 : 1);
+	}
+	else
+	{
+		image.Format = GetDXGIFormat(header->ddspf);
+		image.IsCubeMap = (header->caps2 & DDS_CUBEMAP) != 0;
+		image.ArraySize = image.IsCubeMap ? 6 : 1;
+	}
+
+	const bool compressed = BCCompressor::IsSupported(image.Format);
+	if (!compressed && !IsSupported(image.Format))
+	{
+		error = L"MipGenerator: unsupported format in " + inFile;
+		return false;
+	}
+
+	// 块压缩格式解压到RGBA8后处理.
+	DXGI_FORMAT workFormat = image.Format;
+	if (compressed)
+		workFormat = IsSRGBBlockFormat(image.Format) ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+
+	const UINT oldLevels = (std::max)(header->mipMapCount, 1u);
+	size_t sliceBytes = 0;
+	for (UINT mip = 0; mip < oldLevels; ++mip)
+		sliceBytes += DDSWriter::SurfaceBytes(image.Format, (std::max)(image.Width >> mip, 1u), (std::max)(image.Height >> mip, 1u));
+
+	if (sliceBytes * image.ArraySize > dds.bitSize)
+	{
+		error = L"MipGenerator: truncated DDS file " + inFile;
+		return false;
+	}
+
+	std::vector<std::vector<std::vector<uint8_t>>> slices(image.ArraySize);
+	std::vector<uint8_t> decoded;
+	for (UINT item = 0; item < image.ArraySize; ++item)
+	{
+		const uint8_t* top = dds.bitData + sliceBytes * item;
+		if (compressed)
+		{
+			decoded.resize((size_t)image.Width * image.Height * 4);
+			BCCompressor::Decompress(top, image.Width, image.Height, image.Format, decoded.data());
+			top = decoded.data();
+		}
+
+		if (!Generate(top, image.Width, image.Height, 0, workFormat, options, slices[item], error))
+			return false;
+	}
+
+	file.Close();
+
+	image.MipLevels = (UINT)slices[0].size();
+
+	std::vector<std::vector<uint8_t>> blocks;
+	if (compressed)
+	{
+		std::vector<BCSurface> surfaces;
+		std::vector<uint8_t*> outputs;
+		blocks.resize((size_t)image.ArraySize * image.MipLevels);
+
+		for (UINT item = 0; item < image.ArraySize; ++item)
+		{
+			for (UINT mip = 0; mip < image.MipLevels; ++mip)
+			{
+				BCSurface s;
+				s.Pixels = slices[item][mip].data();
+				s.Width = (std::max)(image.Width >> mip, 1u);
+				s.Height = (std::max)(image.Height >> mip, 1u);
+				surfaces.push_back(s);
+
+				auto& out = blocks[item * image.MipLevels + mip];
+				out.resize(DDSWriter::SurfaceBytes(image.Format, s.Width, s.Height));
+				outputs.push_back(out.data());
+			}
+		}
+
+		BCCompressor::Compress(surfaces, image.Format, BCQuality::Normal, outputs, options.ThreadCount);
+
+		for (auto& b : blocks)
+			image.Subresources.push_back(b.data());
+	}
+	else
+	{
+		for (UINT item = 0; item < image.ArraySize; ++item)
+		{
+			for (UINT mip = 0; mip < image.MipLevels; ++mip)
+				image.Subresources.push_back(slices[item][mip].data());
+		}
+	}
+
+	return DDSWriter::Save(outFile, image, error);
+}
@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include <dxgiformat.h>
+#include <Windows.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///**************************************************************
+/// CPU端的mip链生成.
+/// 支持R8G8B8A8/B8G8R8A8(UNORM与sRGB)、R16G16B16A16_FLOAT和R32G32B32A32_FLOAT.
+/// sRGB数据先转换到线性空间再滤波. 每一级都由上一级生成, 可分离滤波, 按行在线程间分配.
+/// 对alpha测试的纹理可以保持每一级的alpha覆盖率, 避免远处的树叶、铁丝网逐渐消失.
+///**************************************************************
+
+enum class MipFilter
+{
+	Box,		// 按面积平均, 非2的幂尺寸也正确.
+	Kaiser		// Kaiser窗的sinc, 远处更清晰.
+};
+
+struct MipGeneratorOptions
+{
+	MipFilter Filter = MipFilter::Box;
+
+	// 8位格式按sRGB解码后滤波. 格式本身为_SRGB时总是开启.
+	bool SRGB = false;
+
+	///<summary>
+	/// 大于0时保持alpha大于该值的像素比例与第0级相同,
+	/// 应与着色器中alpha测试的阈值一致(如clip(a - 0.1f)对应0.1).
+	///</summary>
+	float AlphaCutoff = 0.0f;
+
+	UINT MaxLevels = 0;		// 0表示生成到1x1.
+	UINT ThreadCount = 0;	// 0表示使用所有硬件线程.
+};
+
+class MipGenerator
+{
+public:
+	static bool IsSupported(DXGI_FORMAT format);
+
+	// width x height的完整mip链级数.
+	static UINT CountLevels(UINT width, UINT height);
+
+	///<summary>
+	/// 由第0级生成mip链, mips[0]为第0级的拷贝, 每一级都紧密排列, 格式与输入相同.
+	/// rowPitch为0表示紧密排列.
+	///</summary>
+	static bool Generate(
+		const uint8_t* pixels,
+		UINT width,
+		UINT height,
+		UINT rowPitch,
+		DXGI_FORMAT format,
+		const MipGeneratorOptions& options,
+		std::vector<std::vector<uint8_t>>& mips,
+		std::wstring& error);
+
+	///<summary>
+	/// 读入DDS文件, 丢弃已有的mip, 由每个数组元素的第0级重新生成mip链后写到outFile(可以与inFile相同).
+	/// 块压缩格式先解压, 生成后用BCCompressor重新压缩.
+	///</summary>
+	static bool ProcessDDS(
+		const std::wstring& inFile,
+		const std::wstring& outFile,
+		const MipGeneratorOptions& options,
+		std::wstring& error);
+};
@@ -0,0 +1,291 @@
+﻿#include "ModelLoader.h"
+#include <cstring>
+
+namespace
+{
+	// 10的整数次幂, double可以精确表示到1e22.
+	const double kPow10[] =
+	{
+		1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+	}
+
+	inline bool IsDigit(char c)
+	{
+		return (unsigned)(c - '0') < 10u;
+	}
+}
+
+bool TextModelReader::Open(const std::wstring& filename)
+{
+	mFilename = filename;
+	mError.clear();
+	mVertexCount = 0;
+	mTriangleCount = 0;
+	mVerticesRead = false;
+
+	if (!mFile.Open(filename))
+		return Fail(L"不存在或无法读取.");
+
+	mCur = reinterpret_cast<const char*>(mFile.Data());
+	mEnd = mCur + mFile.Size();
+
+	// VertexCount: n
+	// TriangleCount: m
+	// VertexList (pos, normal)
+	// {
+	if (!ExpectToken("VertexCount:") || !ParseUInt(mVertexCount) ||
+		!ExpectToken("TriangleCount:") || !ParseUInt(mTriangleCount))
+	{
+		return Fail(L"文件头格式错误.");
+	}
+
+	// 跳过"VertexList (pos, normal)"直到"{".
+	while (true)
+	{
+		SkipSpace();
+		if (mCur == mEnd)
+			return Fail(L"缺少顶点列表.");
+		if (*mCur == '{')
+		{
+			++mCur;
+			break;
+		}
+		SkipToken();
+	}
+
+	return true;
+}
+
+bool TextModelReader::ReadVertices(void* vertices, UINT vertexStride, UINT normalOffset)
+{
+	if (mCur == nullptr || mVerticesRead)
+		return Fail(L"读取顺序错误.");
+
+	BYTE* dst = static_cast<BYTE*>(vertices);
+	for (UINT i = 0; i < mVertexCount; ++i, dst += vertexStride)
+	{
+		float p[3];
+		float n[3];
+		if (!ParseFloat(p[0]) || !ParseFloat(p[1]) || !ParseFloat(p[2]) ||
+			!ParseFloat(n[0]) || !ParseFloat(n[1]) || !ParseFloat(n[2]))
+		{
+			return Fail(L"顶点数据不足或格式错误.");
+		}
+
+		memcpy(dst, p, sizeof(p));
+		if (normalOffset != NoNormal)
+			memcpy(dst + normalOffset, n, sizeof(n));
+	}
+
+	// 顶点数量必须与文件头一致.
+	if (!ExpectToken("}"))
+		return Fail(L"顶点数量与文件头不一致.");
+
+	if (!ExpectToken("TriangleList") || !ExpectToken("{"))
+		return Fail(L"缺少三角形列表.");
+
+	mVerticesRead = true;
+
+	return true;
+}
+
+bool TextModelReader::ReadIndices(UINT* indices)
+{
+	if (!mVerticesRead)
+		return Fail(L"读取顺序错误.");
+
+	const UINT indexCount = 3 * mTriangleCount;
+	for (UINT i = 0; i < indexCount; ++i)
+	{
+		if (!ParseUInt(indices[i]))
+			return Fail(L"索引数据不足或格式错误.");
+
+		if (indices[i] >= mVertexCount)
+			return Fail(L"索引越界.");
+	}
+
+	if (!ExpectToken("}"))
+		return Fail(L"三角形数量与文件头不一致.");
+
+	// 数据已经全部读取, 释放映射.
+	mFile.Close();
+	mCur = mEnd = nullptr;
+
+	return true;
+}
+
+bool TextModelReader::Fail(const std::wstring& msg)
+{
+	mError = mFilename + L": " + msg;
+	mFile.Close();
+	mCur = mEnd = nullptr;
+
+	return false;
+}
+
+void TextModelReader::SkipSpace()
+{
+	while (mCur != mEnd && IsSpace(*mCur))
+		++mCur;
+}
+
+bool TextModelReader::SkipToken()
+{
+	SkipSpace();
+
+	const char* start = mCur;
+	while (mCur != mEnd && !IsSpace(*mCur))
+		++mCur;
+
+	return mCur != start;
+}
+
+bool TextModelReader::ExpectToken(const char* token)
+{
+	SkipSpace();
+
+	size_t len = strlen(token);
+	if ((size_t)(mEnd - mCur) < len || memcmp(mCur, token, len) != 0)
+		return false;
+
+	mCur += len;
+
+	return true;
+}
+
+bool TextModelReader::ParseUInt(UINT& value)
+{
+	SkipSpace();
+
+	if (mCur == mEnd || !IsDigit(*mCur))
+		return false;
+
+	uint64_t v = 0;
+	while (mCur != mEnd && IsDigit(*mCur))
+	{
+		v = v * 10 + (uint64_t)(*mCur - '0');
+		if (v > 0xffffffffull)
+			return false;
+		++mCur;
+	}
+
+	value = (UINT)v;
+
+	return true;
+}
+
+bool TextModelReader::ParseFloat(float& value)
+{
+	SkipSpace();
+
+	if (mCur == mEnd)
+		return false;
+
+	bool negative = false;
+	if (*mCur == '-' || *mCur == '+')
+	{
+		negative = (*mCur == '-');
+		++mCur;
+	}
+
+	// 最多累计19位有效数字, 超出的部分只影响指数.
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exponent = 0;
+	bool any = false;
+
+	while (mCur != mEnd && IsDigit(*mCur))
+	{
+		if (digits < 19)
+		{
+			mantissa = mantissa * 10 + (uint64_t)(*mCur - '0');
+			if (mantissa != 0)
+				++digits;
+		}
+		else
+		{
+			++exponent;
+		}
+		any = true;
+		++mCur;
+	}
+
+	if (mCur != mEnd && *mCur == '.')
+	{
+		++mCur;
+		while (mCur != mEnd && IsDigit(*mCur))
+		{
+			if (digits < 19)
+			{
+				mantissa = mantissa * 10 + (uint64_t)(*mCur - '0');
+				if (mantissa != 0)
+					++digits;
+				--exponent;
+			}
+			any = true;
+			++mCur;
+		}
+	}
+
+	if (!any)
+		return false;
+
+	if (mCur != mEnd && (*mCur == 'e' || *mCur == 'E'))
+	{
+		++mCur;
+
+		bool negExp = false;
+		if (mCur != mEnd && (*mCur == '-' || *mCur == '+'))
+		{
+			negExp = (*mCur == '-');
+			++mCur;
+		}
+
+		if (mCur == mEnd || !IsDigit(*mCur))
+			return false;
+
+		int e = 0;
+		while (mCur != mEnd && IsDigit(*mCur))
+		{
+			if (e < 10000)
+				e = e * 10 + (*mCur - '0');
+			++mCur;
+		}
+
+		exponent += negExp ? -e : e;
+	}
+
+	// 数字后面必须是空白或文件结束.
+	if (mCur != mEnd && !IsSpace(*mCur))
+		return false;
+
+	double v = (double)mantissa;
+	if (exponent < 0)
+	{
+		while (exponent < -22)
+		{
+			v /= kPow10[22];
+			exponent += 22;
+		}
+		v /= kPow10[-exponent];
+	}
+	else
+	{
+		while (exponent > 22)
+		{
+			v *= kPow10[22];
+			exponent -= 22;
+		}
+		v *= kPow10[exponent];
+	}
+
+	value = (float)(negative ? -v : v);
+
+	return true;
+}
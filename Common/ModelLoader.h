@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "MappedFile.h"
+#include <Windows.h>
+#include <string>
+
+///**************************************************************
+/// skull.txt/car.txt格式的文本模型读取.
+/// 文件通过内存映射读取, 数字直接解析到调用者预先分配的数组中, 不经过iostream.
+///**************************************************************
+class TextModelReader
+{
+public:
+	// 顶点结构中没有法线时使用.
+	static const UINT NoNormal = 0xffffffff;
+
+	// 映射文件并解析文件头(顶点数量、三角形数量).
+	bool Open(const std::wstring& filename);
+
+	UINT VertexCount() const { return mVertexCount; }
+	UINT TriangleCount() const { return mTriangleCount; }
+
+	///<summary>
+	/// 读取顶点到vertices(至少VertexCount()个), 位置写在顶点偏移0处,
+	/// 法线写在normalOffset处. 必须先于ReadIndices调用.
+	///</summary>
+	bool ReadVertices(void* vertices, UINT vertexStride, UINT normalOffset = NoNormal);
+
+	// 读取索引到indices(至少3 * TriangleCount()个), 并检查索引是否越界.
+	bool ReadIndices(UINT* indices);
+
+	// 出错时的描述信息, 可直接用于MessageBox.
+	const std::wstring& ErrorMessage() const { return mError; }
+
+private:
+	bool Fail(const std::wstring& msg);
+
+	void SkipSpace();
+	bool SkipToken();
+	bool ExpectToken(const char* token);
+	bool ParseUInt(UINT& value);
+	bool ParseFloat(float& value);
+
+private:
+	MappedFile mFile;
+	std::wstring mFilename;
+	std::wstring mError;
+
+	const char* mCur = nullptr;
+	const char* mEnd = nullptr;
+
+	UINT mVertexCount = 0;
+	UINT mTriangleCount = 0;
+	bool mVerticesRead = false;
+};
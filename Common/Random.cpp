@@ -0,0 +1,326 @@
+﻿#include "Random.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <emmintrin.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// 前进2^64步.
+	const uint32_t kJump[4] = { 0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b };
+
+	// 前进2^96步.
+	const uint32_t kLongJump[4] = { 0xb523952e, 0x0b6f099f, 0xccf5a0ef, 0x1c580662 };
+
+	inline uint32_t Rotl(uint32_t x, int k)
+	{
+		return (x << k) | (x >> (32 - k));
+	}
+
+	inline uint32_t Next(uint32_t s[4])
+	{
+		uint32_t result = s[0] + s[3];
+		uint32_t t = s[1] << 9;
+
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = Rotl(s[3], 11);
+
+		return result;
+	}
+
+	inline uint64_t SplitMix64(uint64_t& x)
+	{
+		uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+		z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+		z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+		return z ^ (z >> 31);
+	}
+
+	// 高24位转换为[0, 1)的浮点数.
+	inline float ToFloat(uint32_t x)
+	{
+		return (float)(x >> 8) * (1.0f / 16777216.0f);
+	}
+
+	///<summary>
+	/// 4个子序列的状态, 每个分量一个寄存器.
+	///</summary>
+	struct LaneState
+	{
+		__m128i S0, S1, S2, S3;
+
+		explicit LaneState(const uint32_t lanes[4][4])
+		{
+			S0 = _mm_loadu_si128((const __m128i*)lanes[0]);
+			S1 = _mm_loadu_si128((const __m128i*)lanes[1]);
+			S2 = _mm_loadu_si128((const __m128i*)lanes[2]);
+			S3 = _mm_loadu_si128((const __m128i*)lanes[3]);
+		}
+
+		void Store(uint32_t lanes[4][4]) const
+		{
+			_mm_storeu_si128((__m128i*)lanes[0], S0);
+			_mm_storeu_si128((__m128i*)lanes[1], S1);
+			_mm_storeu_si128((__m128i*)lanes[2], S2);
+			_mm_storeu_si128((__m128i*)lanes[3], S3);
+		}
+
+		__m128i Next()
+		{
+			__m128i result = _mm_add_epi32(S0, S3);
+			__m128i t = _mm_slli_epi32(S1, 9);
+
+			S2 = _mm_xor_si128(S2, S0);
+			S3 = _mm_xor_si128(S3, S1);
+			S1 = _mm_xor_si128(S1, S2);
+			S0 = _mm_xor_si128(S0, S3);
+			S2 = _mm_xor_si128(S2, t);
+			S3 = _mm_or_si128(_mm_slli_epi32(S3, 11), _mm_srli_epi32(S3, 21));
+
+			return result;
+		}
+
+		// 4个[0, 1)的浮点数.
+		XMVECTOR NextFloat()
+		{
+			__m128i bits = _mm_srli_epi32(Next(), 8);
+			return _mm_mul_ps(_mm_cvtepi32_ps(bits), _mm_set1_ps(1.0f / 16777216.0f));
+		}
+
+		///<summary>
+		/// 4个球面上均匀分布的单位向量: z在[-1, 1)上均匀分布, 方位角在[-PI, PI)上均匀分布.
+		/// 不需要像逐个生成时那样在立方体中拒绝采样.
+		///</summary>
+		void NextUnitVec3(XMVECTOR& x, XMVECTOR& y, XMVECTOR& z)
+		{
+			z = XMVectorMultiplyAdd(NextFloat(), XMVectorReplicate(2.0f), XMVectorReplicate(-1.0f));
+			XMVECTOR phi = XMVectorMultiplyAdd(NextFloat(), XMVectorReplicate(XM_2PI), XMVectorReplicate(-XM_PI));
+			XMVECTOR r = XMVectorSqrt(XMVectorMax(XMVectorZero(), XMVectorNegativeMultiplySubtract(z, z, XMVectorReplicate(1.0f))));
+
+			XMVECTOR sinPhi, cosPhi;
+			XMVectorSinCos(&sinPhi, &cosPhi, phi);
+			x = XMVectorMultiply(r, cosPhi);
+			y = XMVectorMultiply(r, sinPhi);
+		}
+	};
+
+	// 4个向量(x, y, z分别在3个寄存器中)转置后写出, count为实际要写出的数量.
+	void StoreVec3(XMFLOAT3* out, UINT count, XMVECTOR x, XMVECTOR y, XMVECTOR z)
+	{
+		XMVECTOR w = XMVectorZero();
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		const XMVECTOR v[4] = { x, y, z, w };
+		for (UINT i = 0; i < count; ++i)
+			XMStoreFloat3(&out[i], v[i]);
+	}
+}
+
+RandomStream::RandomStream(uint64_t seed, UINT stream)
+{
+	Seed(seed, stream);
+}
+
+void RandomStream::Seed(uint64_t seed, UINT stream)
+{
+	uint64_t x = seed;
+	uint64_t a = SplitMix64(x);
+	uint64_t b = SplitMix64(x);
+	mState[0] = (uint32_t)a;
+	mState[1] = (uint32_t)(a >> 32);
+	mState[2] = (uint32_t)b;
+	mState[3] = (uint32_t)(b >> 32);
+
+	// 全0状态不会改变.
+	if ((mState[0] | mState[1] | mState[2] | mState[3]) == 0)
+		mState[0] = 1;
+
+	for (UINT i = 0; i < stream; ++i)
+		Jump(mState, kLongJump);
+
+	InitLanes();
+}
+
+void RandomStream::Jump(uint32_t state[4], const uint32_t table[4])
+{
+	uint32_t s[4] = { 0, 0, 0, 0 };
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int b = 0; b < 32; ++b)
+		{
+			if (table[i] & (1u << b))
+			{
+				s[0] ^= state[0];
+				s[1] ^= state[1];
+				s[2] ^= state[2];
+				s[3] ^= state[3];
+			}
+			Next(state);
+		}
+	}
+
+	state[0] = s[0];
+	state[1] = s[1];
+	state[2] = s[2];
+	state[3] = s[3];
+}
+
+void RandomStream::InitLanes()
+{
+	// 第lane个子序列从流的起点前进(lane + 1) * 2^64步, 逐个生成用的序列不会追上它们.
+	uint32_t s[4] = { mState[0], mState[1], mState[2], mState[3] };
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		Jump(s, kJump);
+		for (int k = 0; k < 4; ++k)
+			mLanes[k][lane] = s[k];
+	}
+}
+
+uint32_t RandomStream::NextUInt()
+{
+	return Next(mState);
+}
+
+float RandomStream::NextFloat()
+{
+	return ToFloat(Next(mState));
+}
+
+int RandomStream::NextInt(int a, int b)
+{
+	uint32_t range = (uint32_t)b - (uint32_t)a + 1u;
+	uint32_t x = Next(mState);
+
+	// 整个32位范围.
+	if (range == 0)
+		return (int)x;
+
+	// Lemire的乘法映射, 落在多出来的那部分时重新生成.
+	uint64_t m = (uint64_t)x * range;
+	uint32_t low = (uint32_t)m;
+	if (low < range)
+	{
+		uint32_t threshold = (0u - range) % range;
+		while (low < threshold)
+		{
+			x = Next(mState);
+			m = (uint64_t)x * range;
+			low = (uint32_t)m;
+		}
+	}
+
+	return (int)((uint32_t)a + (uint32_t)(m >> 32));
+}
+
+XMVECTOR RandomStream::NextUnitVec3()
+{
+	float z = 2.0f * NextFloat() - 1.0f;
+	float phi = XM_2PI * NextFloat() - XM_PI;
+	float r = sqrtf((std::max)(0.0f, 1.0f - z * z));
+
+	return XMVectorSet(r * cosf(phi), r * sinf(phi), z, 0.0f);
+}
+
+XMVECTOR RandomStream::NextHemisphereUnitVec3(FXMVECTOR n)
+{
+	// 球面上的点关于原点对称, 翻转到n一侧后在半球面上仍是均匀分布.
+	XMVECTOR v = NextUnitVec3();
+	if (XMVectorGetX(XMVector3Dot(n, v)) < 0.0f)
+		v = XMVectorNegate(v);
+
+	return v;
+}
+
+void RandomStream::FillUInts(uint32_t* values, UINT count)
+{
+	LaneState lanes(mLanes);
+
+	UINT i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_si128((__m128i*)&values[i], lanes.Next());
+
+	if (i < count)
+	{
+		uint32_t tail[4];
+		_mm_storeu_si128((__m128i*)tail, lanes.Next());
+		for (UINT k = 0; i < count; ++i, ++k)
+			values[i] = tail[k];
+	}
+
+	lanes.Store(mLanes);
+}
+
+void RandomStream::FillFloats(float* values, UINT count, float a, float b)
+{
+	LaneState lanes(mLanes);
+	XMVECTOR scale = XMVectorReplicate(b - a);
+	XMVECTOR offset = XMVectorReplicate(a);
+
+	UINT i = 0;
+	for (; i + 4 <= count; i += 4)
+		_mm_storeu_ps(&values[i], XMVectorMultiplyAdd(lanes.NextFloat(), scale, offset));
+
+	if (i < count)
+	{
+		float tail[4];
+		_mm_storeu_ps(tail, XMVectorMultiplyAdd(lanes.NextFloat(), scale, offset));
+		for (UINT k = 0; i < count; ++i, ++k)
+			values[i] = tail[k];
+	}
+
+	lanes.Store(mLanes);
+}
+
+void RandomStream::FillUnitVec3(XMFLOAT3* vectors, UINT count)
+{
+	LaneState lanes(mLanes);
+
+	for (UINT i = 0; i < count; i += 4)
+	{
+		XMVECTOR x, y, z;
+		lanes.NextUnitVec3(x, y, z);
+		StoreVec3(&vectors[i], (std::min)(4u, count - i), x, y, z);
+	}
+
+	lanes.Store(mLanes);
+}
+
+void RandomStream::FillHemisphereUnitVec3(XMFLOAT3* vectors, UINT count, FXMVECTOR n)
+{
+	LaneState lanes(mLanes);
+	XMVECTOR nx = XMVectorSplatX(n);
+	XMVECTOR ny = XMVectorSplatY(n);
+	XMVECTOR nz = XMVectorSplatZ(n);
+	XMVECTOR signBit = XMVectorReplicate(-0.0f);
+
+	for (UINT i = 0; i < count; i += 4)
+	{
+		XMVECTOR x, y, z;
+		lanes.NextUnitVec3(x, y, z);
+
+		// 与n的点积为负的向量取反(异或点积的符号位).
+		XMVECTOR d = XMVectorMultiplyAdd(nx, x, XMVectorMultiplyAdd(ny, y, XMVectorMultiply(nz, z)));
+		XMVECTOR flip = _mm_and_ps(d, signBit);
+		x = _mm_xor_ps(x, flip);
+		y = _mm_xor_ps(y, flip);
+		z = _mm_xor_ps(z, flip);
+
+		StoreVec3(&vectors[i], (std::min)(4u, count - i), x, y, z);
+	}
+
+	lanes.Store(mLanes);
+}
+
+RandomStream& RandomStream::ThreadLocal()
+{
+	static std::atomic<UINT> nextStream(0);
+	thread_local RandomStream stream(DefaultSeed, nextStream.fetch_add(1));
+	return stream;
+}
@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <Windows.h>
+#include <cstdint>
+
+///**************************************************************
+/// 随机数生成器(xoshiro128+, 周期2^128 - 1), 替代C的rand():
+/// 状态保存在对象中, 相同的种子和流编号得到相同的序列, 与线程无关.
+/// 流编号不同的生成器相隔2^96步(long jump), 多个线程各用一个流互不重叠.
+/// 批量接口用4个相隔2^64步的子序列, 在SSE寄存器中一次生成4个数.
+/// 浮点数取结果的高24位(xoshiro128+低位的质量较差).
+///**************************************************************
+class RandomStream
+{
+public:
+	static const uint64_t DefaultSeed = 0x853c49e6748fea9bull;
+
+	explicit RandomStream(uint64_t seed = DefaultSeed, UINT stream = 0);
+
+	///<summary>
+	/// 用种子初始化状态(splitmix64), 再跳到第stream个流.
+	///</summary>
+	void Seed(uint64_t seed, UINT stream = 0);
+
+	uint32_t NextUInt();
+
+	// [0, 1).
+	float NextFloat();
+
+	// [a, b).
+	float NextFloat(float a, float b) { return a + NextFloat() * (b - a); }
+
+	// [a, b], 没有取模造成的偏差.
+	int NextInt(int a, int b);
+
+	// 球面上均匀分布的单位向量(w = 0).
+	DirectX::XMVECTOR NextUnitVec3();
+
+	// n所在一侧的半球面上均匀分布的单位向量.
+	DirectX::XMVECTOR NextHemisphereUnitVec3(DirectX::FXMVECTOR n);
+
+	///<summary>
+	/// 批量生成, 每次4个. 与逐个调用Next*()得到的序列不同, 但同样只取决于种子和流编号.
+	///</summary>
+	void FillUInts(uint32_t* values, UINT count);
+	void FillFloats(float* values, UINT count, float a = 0.0f, float b = 1.0f);
+	void FillUnitVec3(DirectX::XMFLOAT3* vectors, UINT count);
+	void FillHemisphereUnitVec3(DirectX::XMFLOAT3* vectors, UINT count, DirectX::FXMVECTOR n);
+
+	///<summary>
+	/// 当前线程的生成器, 每个线程第一次使用时按线程的先后分配流编号.
+	/// 供MathHelper::RandF()等沿用旧接口的代码使用, 需要可重复结果时应自己创建RandomStream.
+	///</summary>
+	static RandomStream& ThreadLocal();
+
+private:
+	// 4个子序列, 按分量交错存放: mLanes[k][lane].
+	void InitLanes();
+	static void Jump(uint32_t state[4], const uint32_t table[4]);
+
+private:
+	uint32_t mState[4];
+	uint32_t mLanes[4][4];
+};
@@ -0,0 +1,198 @@
+﻿#include "TextureCache.h"
+#include "Hash.h"
+#include "DDS.h"
+#include "DDSTextureLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <sstream>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <climits>
+#include <cstdlib>
+#endif
+
+using namespace DirectX;
+
+void TextureCache::Initialize(ID3D11Device* device)
+{
+	mDevice = device;
+}
+
+TextureHandle TextureCache::Acquire(const std::wstring& filename, std::wstring& error)
+{
+	++mRequestCount;
+
+	const std::wstring path = CanonicalPath(filename);
+
+	// 同一路径的纹理还存活时不读取文件.
+	auto known = mPathTextures.find(path);
+	if (known != mPathTextures.end())
+	{
+		if (TextureHandle texture = known->second.lock())
+		{
+			++mHitCount;
+			return texture;
+		}
+	}
+
+	MappedFile file;
+	if (!file.Open(path))
+	{
+		error = filename + L"不存在！";
+		return nullptr;
+	}
+
+	const ContentKey key = { (uint64_t)file.Size(), Fnv1a::Hash(file.Data(), file.Size()) };
+
+	// 其他路径下内容相同的纹理.
+	if (TextureHandle texture = FindSameContent(key, file.Data()))
+	{
+		++mHitCount;
+		mPathTextures[path] = texture;
+		return texture;
+	}
+
+	DDS_FILE_VIEW dds;
+	if (!ParseDDSData(file.Data(), file.Size(), dds))
+	{
+		error = filename + L": 不是有效的DDS文件.";
+		return nullptr;
+	}
+
+	auto texture = std::make_shared<CachedTexture>();
+	texture->Path = path;
+	texture->ContentSize = key.Size;
+	texture->ContentHash = key.Hash;
+
+	if (FAILED(CreateDDSTextureFromMemory(mDevice.Get(), file.Data(), file.Size(),
+		nullptr, texture->Srv.GetAddressOf())))
+	{
+		error = filename + L": 创建纹理失败.";
+		return nullptr;
+	}
+
+	mPathTextures[path] = texture;
+	mTextures[key].push_back(texture);
+	return texture;
+}
+
+TextureHandle TextureCache::FindSameContent(const ContentKey& key, const uint8_t* data) const
+{
+	auto candidates = mTextures.find(key);
+	if (candidates == mTextures.end())
+		return nullptr;
+
+	for (const auto& candidate : candidates->second)
+	{
+		TextureHandle texture = candidate.lock();
+		if (!texture)
+			continue;
+
+		// 哈希只用来筛选, 源文件(可能已被修改或删除)必须逐字节相同.
+		MappedFile source;
+		if (source.Open(texture->Path) && source.Size() == key.Size &&
+			memcmp(source.Data(), data, (size_t)key.Size) == 0)
+		{
+			return texture;
+		}
+	}
+
+	return nullptr;
+}
+
+UINT TextureCache::LiveCount() const
+{
+	UINT count = 0;
+	for (const auto& entry : mTextures)
+	{
+		for (const auto& texture : entry.second)
+		{
+			if (!texture.expired())
+				++count;
+		}
+	}
+
+	return count;
+}
+
+void TextureCache::Trim()
+{
+	for (auto it = mTextures.begin(); it != mTextures.end();)
+	{
+		auto& textures = it->second;
+		textures.erase(std::remove_if(textures.begin(), textures.end(),
+			[](const std::weak_ptr<const CachedTexture>& texture) { return texture.expired(); }), textures.end());
+
+		if (textures.empty())
+			it = mTextures.erase(it);
+		else
+			++it;
+	}
+
+	for (auto it = mPathTextures.begin(); it != mPathTextures.end();)
+	{
+		if (it->second.expired())
+			it = mPathTextures.erase(it);
+		else
+			++it;
+	}
+}
+
+void TextureCache::Report() const
+{
+	std::wostringstream oss;
+
+	for (const auto& entry : mTextures)
+	{
+		for (const auto& weak : entry.second)
+		{
+			TextureHandle texture = weak.lock();
+			if (!texture)
+				continue;
+
+			// 减去这里的临时引用.
+			oss << L"Texture " << texture->Path << L": hash " << std::hex << texture->ContentHash << std::dec
+				<< L", " << texture->ContentSize << L" bytes, " << texture.use_count() - 1 << L" refs\n";
+		}
+	}
+
+	oss << L"Textures: " << LiveCount() << L" live, " << mHitCount << L"/" << mRequestCount << L" requests hit\n";
+
+	OutputDebugStringW(oss.str().c_str());
+}
+
+std::wstring TextureCache::CanonicalPath(const std::wstring& filename)
+{
+#if defined(_WIN32)
+	DWORD length = GetFullPathNameW(filename.c_str(), 0, nullptr, nullptr);
+	if (length == 0)
+		return filename;
+
+	std::wstring path(length, L'\0');
+	length = GetFullPathNameW(filename.c_str(), length, &path[0], nullptr);
+	path.resize(length);
+
+	// NTFS不区分大小写, 斜杠和反斜杠等价.
+	for (auto& c : path)
+		c = (c == L'/') ? L'\\' : (wchar_t)towlower(c);
+
+	return path;
+#else
+	std::vector<char> narrow(filename.size() * 4 + 1);
+	if (wcstombs(narrow.data(), filename.c_str(), narrow.size()) == (size_t)-1)
+		return filename;
+
+	char resolved[PATH_MAX];
+	if (realpath(narrow.data(), resolved) == nullptr)
+		return filename;
+
+	std::vector<wchar_t> wide(strlen(resolved) + 1);
+	if (mbstowcs(wide.data(), resolved, wide.size()) == (size_t)-1)
+		return filename;
+
+	return std::wstring(wide.data());
+#endif
+}
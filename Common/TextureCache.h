@@ -0,0 +1,88 @@
+﻿#pragma once
+
+#include <d3d11_1.h>
+#include <wrl.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+///**************************************************************
+/// 按内容寻址的纹理缓存.
+/// 路径先规范化(绝对路径, Windows下不区分大小写和斜杠方向), 再按文件大小和内容哈希
+/// 查找候选纹理, 与候选的源文件逐字节比较相同后才共用, 内容相同的纹理只创建一次.
+/// 返回的句柄是共享的引用计数指针,
+/// 最后一个引用释放时纹理随之释放, 缓存本身只保存弱引用.
+///**************************************************************
+struct CachedTexture
+{
+	std::wstring Path;					// 第一次加载时的规范化路径.
+	uint64_t ContentSize = 0;
+	uint64_t ContentHash = 0;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Srv;
+};
+
+using TextureHandle = std::shared_ptr<const CachedTexture>;
+
+class TextureCache
+{
+public:
+	TextureCache() = default;
+	TextureCache(const TextureCache& rhs) = delete;
+	TextureCache& operator=(const TextureCache& rhs) = delete;
+
+	void Initialize(ID3D11Device* device);
+
+	///<summary>
+	/// 取得纹理的共享句柄, 失败返回nullptr并设置error.
+	/// 同一路径的纹理仍然存活时直接返回, 不再读取文件;
+	/// 否则读取文件, 与大小和哈希相同的存活纹理的源文件逐字节比较, 内容相同的纹理共用同一个资源视图.
+	///</summary>
+	TextureHandle Acquire(const std::wstring& filename, std::wstring& error);
+
+	// 当前存活的纹理数(不同内容).
+	UINT LiveCount() const;
+
+	// 请求次数, 其中命中缓存的次数.
+	UINT RequestCount() const { return mRequestCount; }
+	UINT HitCount() const { return mHitCount; }
+
+	// 删除已经释放的纹理条目.
+	void Trim();
+
+	// 输出存活的纹理及其引用数, 以及命中率.
+	void Report() const;
+
+	static std::wstring CanonicalPath(const std::wstring& filename);
+
+private:
+	// (文件大小, 内容哈希).
+	struct ContentKey
+	{
+		uint64_t Size;
+		uint64_t Hash;
+
+		bool operator==(const ContentKey& rhs) const { return Size == rhs.Size && Hash == rhs.Hash; }
+	};
+
+	struct ContentKeyHasher
+	{
+		size_t operator()(const ContentKey& key) const { return (size_t)(key.Hash ^ (key.Size * 0x9e3779b97f4a7c15ull)); }
+	};
+
+	// 在key相同的纹理中找出源文件与data逐字节相同的存活纹理.
+	TextureHandle FindSameContent(const ContentKey& key, const uint8_t* data) const;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> mDevice;
+
+	// 规范化路径 -> 纹理, 避免同一路径重复读取文件.
+	std::unordered_map<std::wstring, std::weak_ptr<const CachedTexture>> mPathTextures;
+
+	// 哈希碰撞时同一个键下有多个内容不同的纹理.
+	std::unordered_map<ContentKey, std::vector<std::weak_ptr<const CachedTexture>>, ContentKeyHasher> mTextures;
+
+	UINT mRequestCount = 0;
+	UINT mHitCount = 0;
+};
@@ -0,0 +1,489 @@
+﻿#include "TextureManifest.h"
+#include "DDS.h"
+#include <algorithm>
+#include <cstring>
+#include <cwctype>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#include <sys/stat.h>
+#include <cstdlib>
+#endif
+
+using namespace DirectX;
+
+namespace
+{
+	/// 目录中的一个文件.
+	struct DirectoryFile
+	{
+		std::wstring Name;
+		uint64_t Size;
+		uint64_t Time;
+	};
+
+	inline bool HasDDSExtension(const std::wstring& name)
+	{
+		const std::wstring ext = L".dds";
+		if (name.size() < ext.size())
+			return false;
+
+		for (size_t i = 0; i < ext.size(); ++i)
+		{
+			if (towlower(name[name.size() - ext.size() + i]) != ext[i])
+				return false;
+		}
+
+		return true;
+	}
+
+	std::wstring ToLower(const std::wstring& s)
+	{
+		std::wstring lower(s);
+		for (auto& c : lower)
+			c = (wchar_t)towlower(c);
+		return lower;
+	}
+
+	std::wstring StripDirectory(const std::wstring& filename)
+	{
+		size_t slash = filename.find_last_of(L"/\\");
+		return (slash == std::wstring::npos) ? filename : filename.substr(slash + 1);
+	}
+
+#if defined(_WIN32)
+
+	bool ListDDSFiles(const std::wstring& directory, std::vector<DirectoryFile>& files)
+	{
+		WIN32_FIND_DATAW data;
+		HANDLE find = FindFirstFileW((directory + L"\\*.dds").c_str(), &data);
+		if (find == INVALID_HANDLE_VALUE)
+			return GetLastError() == ERROR_FILE_NOT_FOUND;
+
+		do
+		{
+			if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+				continue;
+
+			DirectoryFile file;
+			file.Name = data.cFileName;
+			file.Size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+			file.Time = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+			files.push_back(file);
+		} while (FindNextFileW(find, &data));
+
+		FindClose(find);
+		return true;
+	}
+
+#else
+
+	std::string Narrow(const std::wstring& s)
+	{
+		std::vector<char> buffer(s.size() * 4 + 1);
+		if (wcstombs(buffer.data(), s.c_str(), buffer.size()) == (size_t)-1)
+			return std::string();
+		return buffer.data();
+	}
+
+	bool ListDDSFiles(const std::wstring& directory, std::vector<DirectoryFile>& files)
+	{
+		const std::string path = Narrow(directory);
+
+		DIR* dir = opendir(path.c_str());
+		if (dir == nullptr)
+			return false;
+
+		while (dirent* item = readdir(dir))
+		{
+			std::vector<wchar_t> name(strlen(item->d_name) + 1);
+			if (mbstowcs(name.data(), item->d_name, name.size()) == (size_t)-1)
+				continue;
+
+			DirectoryFile file;
+			file.Name = name.data();
+			if (!HasDDSExtension(file.Name))
+				continue;
+
+			struct stat st;
+			if (stat((path + "/" + item->d_name).c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+				continue;
+
+			file.Size = (uint64_t)st.st_size;
+			file.Time = (uint64_t)st.st_mtime;
+			files.push_back(file);
+		}
+
+		closedir(dir);
+		return true;
+	}
+
+#endif
+
+	// 由尺寸、格式和mip数量计算每级mip的字节数和总字节数.
+	void ComputeSizes(TextureManifestEntry& entry)
+	{
+		entry.MipBytes.resize(entry.MipLevels);
+
+		size_t w = entry.Width;
+		size_t h = entry.Height;
+		size_t d = entry.Depth;
+
+		uint64_t sliceBytes = 0;
+		for (UINT i = 0; i < entry.MipLevels; ++i)
+		{
+			size_t numBytes = 0;
+			GetSurfaceInfo(w, h, entry.Format, &numBytes, nullptr, nullptr);
+
+			entry.MipBytes[i] = (uint64_t)numBytes * d;
+			sliceBytes += entry.MipBytes[i];
+
+			w = std::max<size_t>(w >> 1, 1);
+			h = std::max<size_t>(h >> 1, 1);
+			d = std::max<size_t>(d >> 1, 1);
+		}
+
+		entry.TotalBytes = sliceBytes * entry.ArraySize;
+	}
+
+	/// 清单文件中每个纹理的固定部分, 后面紧跟Name(UTF-16).
+	struct ManifestRecord
+	{
+		uint64_t FileSize;
+		uint64_t FileTime;
+		UINT Dimension;
+		UINT Format;
+		UINT Width;
+		UINT Height;
+		UINT Depth;
+		UINT MipLevels;
+		UINT ArraySize;
+		UINT IsCubeMap;
+		UINT NameLength;
+		UINT Reserved;
+	};
+
+	template<typename T>
+	bool ReadValue(const std::vector<uint8_t>& data, size_t& offset, T& value)
+	{
+		if (data.size() - offset < sizeof(T))
+			return false;
+
+		memcpy(&value, data.data() + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	template<typename T>
+	void WriteValue(std::vector<uint8_t>& data, const T& value)
+	{
+		const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+		data.insert(data.end(), bytes, bytes + sizeof(T));
+	}
+}
+
+uint64_t TextureManifestEntry::BytesFromMip(UINT firstMip) const
+{
+	uint64_t sliceBytes = 0;
+	for (UINT i = firstMip; i < (UINT)MipBytes.size(); ++i)
+		sliceBytes += MipBytes[i];
+
+	return sliceBytes * ArraySize;
+}
+
+bool TextureManifest::Scan(const std::wstring& directory, const std::wstring& cacheFile)
+{
+	const std::wstring manifestFile = cacheFile.empty() ? directory + L"/textures.manifest" : cacheFile;
+
+	mWarnings.clear();
+	mScannedCount = 0;
+
+	std::vector<DirectoryFile> files;
+	if (!ListDDSFiles(directory, files))
+	{
+		mEntries.clear();
+		mWarnings.push_back(directory + L"不存在！");
+		return false;
+	}
+
+	// 旧的清单, 文件大小和修改时间一致的记录直接复用.
+	std::unordered_map<std::wstring, TextureManifestEntry> cached;
+	if (Load(manifestFile))
+	{
+		for (auto& entry : mEntries)
+			cached[ToLower(entry.Name)] = std::move(entry);
+	}
+
+	mEntries.clear();
+	mEntries.reserve(files.size());
+
+	bool changed = (cached.size() != files.size());
+
+	for (const auto& file : files)
+	{
+		auto it = cached.find(ToLower(file.Name));
+		if (it != cached.end() && it->second.FileSize == file.Size && it->second.FileTime == file.Time)
+		{
+			mEntries.push_back(std::move(it->second));
+			continue;
+		}
+
+		changed = true;
+		++mScannedCount;
+
+		TextureManifestEntry entry;
+		if (!ReadHeader(directory + L"/" + file.Name, entry))
+		{
+			mWarnings.push_back(file.Name + L": 不是有效的DDS文件或格式不受支持.");
+			continue;
+		}
+
+		entry.Name = file.Name;
+		entry.FileSize = file.Size;
+		entry.FileTime = file.Time;
+		mEntries.push_back(std::move(entry));
+	}
+
+	std::sort(mEntries.begin(), mEntries.end(),
+		[](const TextureManifestEntry& a, const TextureManifestEntry& b) { return ToLower(a.Name) < ToLower(b.Name); });
+
+	// 写入失败(比如目录只读)不影响本次结果.
+	if (changed)
+		Save(manifestFile);
+
+	return true;
+}
+
+bool TextureManifest::Load(const std::wstring& cacheFile)
+{
+	mEntries.clear();
+
+	std::ifstream fin(cacheFile, std::ios::binary);
+	if (!fin)
+		return false;
+
+	std::vector<uint8_t> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+
+	size_t offset = 0;
+	UINT magic = 0, version = 0, count = 0;
+	if (!ReadValue(data, offset, magic) || !ReadValue(data, offset, version) || !ReadValue(data, offset, count) ||
+		magic != Magic || version != Version)
+	{
+		return false;
+	}
+
+	std::vector<TextureManifestEntry> entries(count);
+	for (auto& entry : entries)
+	{
+		ManifestRecord record;
+		if (!ReadValue(data, offset, record) || data.size() - offset < (size_t)record.NameLength * sizeof(uint16_t))
+			return false;
+
+		entry.Name.resize(record.NameLength);
+		for (UINT i = 0; i < record.NameLength; ++i)
+		{
+			uint16_t c;
+			ReadValue(data, offset, c);
+			entry.Name[i] = (wchar_t)c;
+		}
+
+		entry.FileSize = record.FileSize;
+		entry.FileTime = record.FileTime;
+		entry.Dimension = (D3D11_RESOURCE_DIMENSION)record.Dimension;
+		entry.Format = (DXGI_FORMAT)record.Format;
+		entry.Width = record.Width;
+		entry.Height = record.Height;
+		entry.Depth = record.Depth;
+		entry.MipLevels = record.MipLevels;
+		entry.ArraySize = record.ArraySize;
+		entry.IsCubeMap = (record.IsCubeMap != 0);
+
+		if (entry.MipLevels == 0 || entry.MipLevels > D3D11_REQ_MIP_LEVELS || BitsPerPixel(entry.Format) == 0)
+			return false;
+
+		ComputeSizes(entry);
+	}
+
+	mEntries = std::move(entries);
+	return true;
+}
+
+bool TextureManifest::Save(const std::wstring& cacheFile) const
+{
+	std::vector<uint8_t> data;
+	WriteValue(data, (UINT)Magic);
+	WriteValue(data, (UINT)Version);
+	WriteValue(data, (UINT)mEntries.size());
+
+	for (const auto& entry : mEntries)
+	{
+		ManifestRecord record;
+		memset(&record, 0, sizeof(ManifestRecord));
+		record.FileSize = entry.FileSize;
+		record.FileTime = entry.FileTime;
+		record.Dimension = (UINT)entry.Dimension;
+		record.Format = (UINT)entry.Format;
+		record.Width = entry.Width;
+		record.Height = entry.Height;
+		record.Depth = entry.Depth;
+		record.MipLevels = entry.MipLevels;
+		record.ArraySize = entry.ArraySize;
+		record.IsCubeMap = entry.IsCubeMap ? 1 : 0;
+		record.NameLength = (UINT)entry.Name.size();
+
+		WriteValue(data, record);
+		for (wchar_t c : entry.Name)
+			WriteValue(data, (uint16_t)c);
+	}
+
+	std::ofstream fout(cacheFile, std::ios::binary | std::ios::trunc);
+	if (!fout)
+		return false;
+
+	fout.write(reinterpret_cast<const char*>(data.data()), (std::streamsize)data.size());
+
+	return fout.good();
+}
+
+const TextureManifestEntry* TextureManifest::Find(const std::wstring& name) const
+{
+	const std::wstring key = ToLower(StripDirectory(name));
+
+	for (const auto& entry : mEntries)
+	{
+		if (ToLower(entry.Name) == key)
+			return &entry;
+	}
+
+	return nullptr;
+}
+
+uint64_t TextureManifest::TotalBytes() const
+{
+	uint64_t total = 0;
+	for (const auto& entry : mEntries)
+		total += entry.TotalBytes;
+
+	return total;
+}
+
+void TextureManifest::Report() const
+{
+	std::wostringstream oss;
+	oss.setf(std::ios::fixed);
+	oss.precision(1);
+
+	for (const auto& entry : mEntries)
+	{
+		oss << L"Texture " << entry.Name << L": " << entry.Width << L"x" << entry.Height;
+		if (entry.Depth > 1)
+			oss << L"x" << entry.Depth;
+		oss << L", " << entry.MipLevels << L" mips, array " << entry.ArraySize
+			<< L", format " << (UINT)entry.Format << L", " << entry.TotalBytes / 1024.0 << L" KB\n";
+	}
+
+	oss << L"Textures: " << mEntries.size() << L" files, " << TotalBytes() / (1024.0 * 1024.0)
+		<< L" MB, " << mScannedCount << L" headers read\n";
+
+	OutputDebugStringW(oss.str().c_str());
+}
+
+bool TextureManifest::ReadHeader(const std::wstring& filename, TextureManifestEntry& entry)
+{
+	std::ifstream fin(filename, std::ios::binary);
+	if (!fin)
+		return false;
+
+	// 魔数 + DDS_HEADER + DDS_HEADER_DXT10, 没有DX10扩展的文件只有前128字节有效.
+	uint8_t header[sizeof(uint32_t) + sizeof(DDS_HEADER) + sizeof(DDS_HEADER_DXT10)];
+	fin.read(reinterpret_cast<char*>(header), sizeof(header));
+
+	return DescribeHeader(header, (size_t)fin.gcount(), entry);
+}
+
+bool TextureManifest::DescribeHeader(const uint8_t* data, size_t size, TextureManifestEntry& entry)
+{
+	DDS_FILE_VIEW dds;
+	if (!ParseDDSData(data, size, dds))
+		return false;
+
+	// 与DDSTextureLoader中CreateTextureFromDDS的判断一致.
+	const DDS_HEADER* header = dds.header;
+
+	entry.Width = header->width;
+	entry.Height = header->height;
+	entry.Depth = header->depth;
+	entry.MipLevels = std::max<UINT>(header->mipMapCount, 1);
+	entry.ArraySize = 1;
+	entry.IsCubeMap = false;
+
+	if (dds.headerDXT10)
+	{
+		const DDS_HEADER_DXT10* d3d10ext = dds.headerDXT10;
+
+		entry.ArraySize = d3d10ext->arraySize;
+		entry.Format = d3d10ext->dxgiFormat;
+		if (entry.ArraySize == 0 || BitsPerPixel(entry.Format) == 0)
+			return false;
+
+		switch (d3d10ext->resourceDimension)
+		{
+		case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+			entry.Height = entry.Depth = 1;
+			break;
+
+		case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+			if (d3d10ext->miscFlag & D3D11_RESOURCE_MISC_TEXTURECUBE)
+			{
+				entry.ArraySize *= 6;
+				entry.IsCubeMap = true;
+			}
+			entry.Depth = 1;
+			break;
+
+		case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+			if (!(header->flags & DDS_HEADER_FLAGS_VOLUME) || entry.ArraySize > 1)
+				return false;
+			break;
+
+		default:
+			return false;
+		}
+
+		entry.Dimension = (D3D11_RESOURCE_DIMENSION)d3d10ext->resourceDimension;
+	}
+	else
+	{
+		entry.Format = GetDXGIFormat(header->ddspf);
+		if (entry.Format == DXGI_FORMAT_UNKNOWN)
+			return false;
+
+		if (header->flags & DDS_HEADER_FLAGS_VOLUME)
+		{
+			entry.Dimension = D3D11_RESOURCE_DIMENSION_TEXTURE3D;
+		}
+		else
+		{
+			if (header->caps2 & DDS_CUBEMAP)
+			{
+				if ((header->caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+					return false;
+
+				entry.ArraySize = 6;
+				entry.IsCubeMap = true;
+			}
+
+			entry.Depth = 1;
+			entry.Dimension = D3D11_RESOURCE_DIMENSION_TEXTURE2D;
+		}
+	}
+
+	if (entry.MipLevels > D3D11_REQ_MIP_LEVELS || entry.Width == 0 || entry.Height == 0 || entry.Depth == 0)
+		return false;
+
+	ComputeSizes(entry);
+	return true;
+}
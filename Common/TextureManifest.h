@@ -0,0 +1,83 @@
+﻿#pragma once
+
+#include <d3d11_1.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///**************************************************************
+/// 纹理清单: 只读取Textures/下每个DDS文件的文件头(128或148字节),
+/// 得到尺寸、格式、mip数量以及每级mip的字节数, 不读取任何纹素数据.
+/// 结果缓存在目录下的清单文件中, 文件大小和修改时间都没变的纹理不再打开.
+/// 用于在加载纹理之前规划内存池、选择质量等级和安排加载顺序.
+///**************************************************************
+
+struct TextureManifestEntry
+{
+	std::wstring Name;					// 相对于扫描目录的文件名, 如"bricks.dds".
+	uint64_t FileSize = 0;
+	uint64_t FileTime = 0;				// 最后修改时间, 只用于判断缓存是否有效.
+
+	D3D11_RESOURCE_DIMENSION Dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+	DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+	UINT Width = 0;
+	UINT Height = 0;
+	UINT Depth = 0;
+	UINT MipLevels = 0;
+	UINT ArraySize = 0;					// 立方体贴图为6的倍数.
+	bool IsCubeMap = false;
+
+	std::vector<uint64_t> MipBytes;		// 每级mip在一个数组元素中的字节数(含深度).
+	uint64_t TotalBytes = 0;			// 所有mip、所有数组元素的总字节数.
+
+	// 从第firstMip级开始常驻时的字节数(所有数组元素).
+	uint64_t BytesFromMip(UINT firstMip) const;
+};
+
+class TextureManifest
+{
+public:
+	static const UINT Magic = 0x464d5854;	// "TXMF".
+	static const UINT Version = 1;
+
+	///<summary>
+	/// 扫描directory下的所有.dds文件(不含子目录), 优先使用cacheFile中的记录,
+	/// 有变化时重新写入cacheFile. cacheFile为空时使用directory + "/textures.manifest".
+	/// 无法解析的文件会被跳过, 并在warnings中记录.
+	///</summary>
+	bool Scan(const std::wstring& directory, const std::wstring& cacheFile = L"");
+
+	bool Load(const std::wstring& cacheFile);
+	bool Save(const std::wstring& cacheFile) const;
+
+	const std::vector<TextureManifestEntry>& Entries() const { return mEntries; }
+
+	// 按文件名查找(不区分大小写, 忽略路径部分), 找不到返回nullptr.
+	const TextureManifestEntry* Find(const std::wstring& name) const;
+
+	// 所有纹理完整加载时的总字节数.
+	uint64_t TotalBytes() const;
+
+	// 本次扫描中打开读取了文件头的纹理数量, 其余来自缓存.
+	UINT ScannedCount() const { return mScannedCount; }
+
+	const std::vector<std::wstring>& Warnings() const { return mWarnings; }
+
+	// 通过OutputDebugString输出每个纹理的尺寸和占用.
+	void Report() const;
+
+	///<summary>
+	/// 只读取filename的文件头填充entry(不包括Name、FileSize和FileTime).
+	///</summary>
+	static bool ReadHeader(const std::wstring& filename, TextureManifestEntry& entry);
+
+	///<summary>
+	/// 由内存中的文件头(至少包含魔数和DDS_HEADER, 有DX10扩展时还要包含扩展头)填充entry.
+	///</summary>
+	static bool DescribeHeader(const uint8_t* data, size_t size, TextureManifestEntry& entry);
+
+private:
+	std::vector<TextureManifestEntry> mEntries;
+	std::vector<std::wstring> mWarnings;
+	UINT mScannedCount = 0;
+};
@@ -0,0 +1,394 @@
+﻿#include "TextureRegistry.h"
+#include "DDS.h"
+#include "DDSTextureLoader.h"
+#include <algorithm>
+#include <cassert>
+#include <sstream>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	inline UINT MipDimension(UINT size, UINT mip)
+	{
+		return std::max<UINT>(size >> mip, 1);
+	}
+
+	inline bool IsBlockCompressed(DXGI_FORMAT format)
+	{
+		size_t numRows = 0;
+		GetSurfaceInfo(4, 4, format, nullptr, nullptr, &numRows);
+		return numRows == 1;
+	}
+
+	inline std::wstring Widen(const std::string& s)
+	{
+		return std::wstring(s.begin(), s.end());
+	}
+}
+
+void TextureRegistry::Initialize(ID3D11Device* device, uint64_t budgetBytes, UINT minResidentSize)
+{
+	mDevice = device;
+	mBudgetBytes = budgetBytes;
+	mMinResidentSize = minResidentSize;
+}
+
+int TextureRegistry::Register(const std::wstring& name, const std::string& category,
+	ID3D11ShaderResourceView* srv, const std::wstring& filename)
+{
+	if (srv == nullptr)
+		return -1;
+
+	auto texture = std::make_unique<RegisteredTexture>();
+	texture->Name = name;
+	texture->Category = category;
+	texture->Filename = filename;
+
+	if (!Describe(*texture, srv))
+		return -1;
+
+	mTextures.push_back(std::move(texture));
+	return (int)mTextures.size() - 1;
+}
+
+int TextureRegistry::Load(const std::wstring& filename, const std::string& category, std::wstring& error)
+{
+	ComPtr<ID3D11ShaderResourceView> srv;
+	HRESULT hr = CreateDDSTextureFromFile(mDevice.Get(), filename.c_str(), nullptr, srv.GetAddressOf());
+	if (FAILED(hr))
+	{
+		error = L"TextureRegistry: failed to load " + filename;
+		return -1;
+	}
+
+	size_t slash = filename.find_last_of(L"/\\");
+	std::wstring name = (slash == std::wstring::npos) ? filename : filename.substr(slash + 1);
+
+	int handle = Register(name, category, srv.Get(), filename);
+	if (handle < 0)
+		error = L"TextureRegistry: unsupported resource in " + filename;
+
+	return handle;
+}
+
+ID3D11ShaderResourceView* TextureRegistry::Use(int handle)
+{
+	assert(IsValid(handle));
+	if (!IsValid(handle))
+		return nullptr;
+
+	auto& texture = *mTextures[handle];
+	texture.LastUsedFrame = mFrame;
+	return texture.Srv.Get();
+}
+
+ID3D11ShaderResourceView* TextureRegistry::GetSrv(int handle) const
+{
+	assert(IsValid(handle));
+	if (!IsValid(handle))
+		return nullptr;
+
+	return mTextures[handle]->Srv.Get();
+}
+
+void TextureRegistry::EndFrame(ID3D11DeviceContext* context)
+{
+	if (mBudgetBytes > 0)
+	{
+		uint64_t resident = ResidentBytes();
+		while (resident > mBudgetBytes)
+		{
+			// 最近最少使用的优先, 同一帧使用的先丢弃占用大的.
+			RegisteredTexture* victim = nullptr;
+			for (auto& texture : mTextures)
+			{
+				if (!CanDrop(*texture))
+					continue;
+
+				if (victim == nullptr || texture->LastUsedFrame < victim->LastUsedFrame ||
+					(texture->LastUsedFrame == victim->LastUsedFrame &&
+						texture->MipBytes[texture->DroppedMips] > victim->MipBytes[victim->DroppedMips]))
+				{
+					victim = texture.get();
+				}
+			}
+
+			if (victim == nullptr)
+				break;
+
+			const uint64_t freed = victim->MipBytes[victim->DroppedMips];
+			if (!DropTopMip(context, *victim))
+				break;
+
+			resident -= freed;
+		}
+	}
+
+	++mFrame;
+}
+
+bool TextureRegistry::Restore(int handle, std::wstring& error)
+{
+	auto& texture = *mTextures[handle];
+	if (texture.DroppedMips == 0)
+		return true;
+
+	if (texture.Filename.empty())
+	{
+		error = L"TextureRegistry: " + texture.Name + L" was not loaded from a file.";
+		return false;
+	}
+
+	ComPtr<ID3D11ShaderResourceView> srv;
+	HRESULT hr = CreateDDSTextureFromFile(mDevice.Get(), texture.Filename.c_str(), nullptr, srv.GetAddressOf());
+	if (FAILED(hr) || !Describe(texture, srv.Get()))
+	{
+		error = L"TextureRegistry: failed to reload " + texture.Filename;
+		return false;
+	}
+
+	texture.DroppedMips = 0;
+	return true;
+}
+
+uint64_t TextureRegistry::ResidentBytes() const
+{
+	uint64_t total = 0;
+	for (int i = 0; i < (int)mTextures.size(); ++i)
+		total += ResidentBytes(i);
+	return total;
+}
+
+uint64_t TextureRegistry::ResidentBytes(int handle) const
+{
+	const auto& texture = *mTextures[handle];
+
+	uint64_t total = 0;
+	for (UINT mip = texture.DroppedMips; mip < texture.MipLevels; ++mip)
+		total += texture.MipBytes[mip];
+	return total;
+}
+
+std::map<std::string, uint64_t> TextureRegistry::BytesByCategory() const
+{
+	std::map<std::string, uint64_t> categories;
+	for (int i = 0; i < (int)mTextures.size(); ++i)
+		categories[mTextures[i]->Category] += ResidentBytes(i);
+	return categories;
+}
+
+uint64_t TextureRegistry::MipBytes(int handle, UINT mip) const
+{
+	const auto& texture = *mTextures[handle];
+	return mip < texture.MipLevels ? texture.MipBytes[mip] : 0;
+}
+
+UINT TextureRegistry::DroppedMips(int handle) const
+{
+	return mTextures[handle]->DroppedMips;
+}
+
+uint64_t TextureRegistry::LastUsedFrame(int handle) const
+{
+	return mTextures[handle]->LastUsedFrame;
+}
+
+void TextureRegistry::Report() const
+{
+	std::wostringstream oss;
+	oss.setf(std::ios::fixed);
+	oss.precision(1);
+
+	for (int i = 0; i < (int)mTextures.size(); ++i)
+	{
+		const auto& texture = *mTextures[i];
+		oss << L"Texture " << texture.Name << L" [" << Widen(texture.Category) << L"]: "
+			<< MipDimension(texture.Width, texture.DroppedMips) << L"x" << MipDimension(texture.Height, texture.DroppedMips)
+			<< L", " << texture.MipLevels - texture.DroppedMips << L"/" << texture.MipLevels << L" mips, array " << texture.ArraySize
+			<< L", format " << (UINT)texture.Format << L", " << ResidentBytes(i) / 1024.0 << L" KB, last used frame "
+			<< texture.LastUsedFrame << L"\n";
+	}
+
+	for (const auto& category : BytesByCategory())
+		oss << L"Category " << Widen(category.first) << L": " << category.second / (1024.0 * 1024.0) << L" MB\n";
+
+	oss << L"Textures: " << mTextures.size() << L", " << ResidentBytes() / (1024.0 * 1024.0) << L" MB resident";
+	if (mBudgetBytes > 0)
+		oss << L", budget " << mBudgetBytes / (1024.0 * 1024.0) << L" MB";
+	oss << L", frame " << mFrame << L"\n";
+
+	OutputDebugStringW(oss.str().c_str());
+}
+
+bool TextureRegistry::Describe(RegisteredTexture& texture, ID3D11ShaderResourceView* srv)
+{
+	ComPtr<ID3D11Resource> resource;
+	srv->GetResource(resource.GetAddressOf());
+	if (!resource)
+		return false;
+
+	D3D11_RESOURCE_DIMENSION dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+	resource->GetType(&dimension);
+
+	UINT depth = 1;
+	switch (dimension)
+	{
+	case D3D11_RESOURCE_DIMENSION_TEXTURE1D:
+	{
+		ComPtr<ID3D11Texture1D> tex;
+		if (FAILED(resource.As(&tex)))
+			return false;
+
+		D3D11_TEXTURE1D_DESC desc;
+		tex->GetDesc(&desc);
+		texture.Format = desc.Format;
+		texture.Width = desc.Width;
+		texture.Height = 1;
+		texture.MipLevels = desc.MipLevels;
+		texture.ArraySize = desc.ArraySize;
+		break;
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE2D:
+	{
+		ComPtr<ID3D11Texture2D> tex;
+		if (FAILED(resource.As(&tex)))
+			return false;
+
+		D3D11_TEXTURE2D_DESC desc;
+		tex->GetDesc(&desc);
+		texture.Format = desc.Format;
+		texture.Width = desc.Width;
+		texture.Height = desc.Height;
+		texture.MipLevels = desc.MipLevels;
+		texture.ArraySize = desc.ArraySize;
+		break;
+	}
+
+	case D3D11_RESOURCE_DIMENSION_TEXTURE3D:
+	{
+		ComPtr<ID3D11Texture3D> tex;
+		if (FAILED(resource.As(&tex)))
+			return false;
+
+		D3D11_TEXTURE3D_DESC desc;
+		tex->GetDesc(&desc);
+		texture.Format = desc.Format;
+		texture.Width = desc.Width;
+		texture.Height = desc.Height;
+		texture.MipLevels = desc.MipLevels;
+		texture.ArraySize = 1;
+		depth = desc.Depth;
+		break;
+	}
+
+	default:
+		return false;
+	}
+
+	texture.Dimension = dimension;
+	texture.Resource = resource;
+	texture.Srv = srv;
+
+	texture.MipBytes.resize(texture.MipLevels);
+	for (UINT mip = 0; mip < texture.MipLevels; ++mip)
+	{
+		size_t numBytes = 0;
+		GetSurfaceInfo(MipDimension(texture.Width, mip), MipDimension(texture.Height, mip), texture.Format,
+			&numBytes, nullptr, nullptr);
+		texture.MipBytes[mip] = (uint64_t)numBytes * MipDimension(depth, mip) * texture.ArraySize;
+	}
+
+	return true;
+}
+
+bool TextureRegistry::CanDrop(const RegisteredTexture& texture) const
+{
+	if (texture.Dimension != D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+		return false;
+
+	const UINT top = texture.DroppedMips;
+	if (top + 1 >= texture.MipLevels)
+		return false;
+
+	// 宽高都不超过mMinResidentSize的mip始终保留.
+	if (MipDimension(texture.Width, top) <= mMinResidentSize && MipDimension(texture.Height, top) <= mMinResidentSize)
+		return false;
+
+	// 块压缩纹理的最高一级mip宽高必须是4的倍数.
+	if (IsBlockCompressed(texture.Format) &&
+		(MipDimension(texture.Width, top + 1) % 4 != 0 || MipDimension(texture.Height, top + 1) % 4 != 0))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+bool TextureRegistry::DropTopMip(ID3D11DeviceContext* context, RegisteredTexture& texture)
+{
+	ComPtr<ID3D11Texture2D> oldTexture;
+	if (FAILED(texture.Resource.As(&oldTexture)))
+		return false;
+
+	D3D11_TEXTURE2D_DESC desc;
+	oldTexture->GetDesc(&desc);
+
+	const UINT oldMipLevels = desc.MipLevels;
+	const UINT newMipLevels = oldMipLevels - 1;
+
+	desc.Width = MipDimension(desc.Width, 1);
+	desc.Height = MipDimension(desc.Height, 1);
+	desc.MipLevels = newMipLevels;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.CPUAccessFlags = 0;
+
+	ComPtr<ID3D11Texture2D> newTexture;
+	if (FAILED(mDevice->CreateTexture2D(&desc, nullptr, newTexture.GetAddressOf())))
+		return false;
+
+	for (UINT slice = 0; slice < desc.ArraySize; ++slice)
+	{
+		for (UINT mip = 0; mip < newMipLevels; ++mip)
+		{
+			context->CopySubresourceRegion(newTexture.Get(), D3D11CalcSubresource(mip, slice, newMipLevels), 0, 0, 0,
+				oldTexture.Get(), D3D11CalcSubresource(mip + 1, slice, oldMipLevels), nullptr);
+		}
+	}
+
+	// 视图与原来相同, 只是mip数量少一级.
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	texture.Srv->GetDesc(&srvDesc);
+	switch (srvDesc.ViewDimension)
+	{
+	case D3D11_SRV_DIMENSION_TEXTURE2D:
+		srvDesc.Texture2D.MostDetailedMip = 0;
+		srvDesc.Texture2D.MipLevels = newMipLevels;
+		break;
+	case D3D11_SRV_DIMENSION_TEXTURE2DARRAY:
+		srvDesc.Texture2DArray.MostDetailedMip = 0;
+		srvDesc.Texture2DArray.MipLevels = newMipLevels;
+		break;
+	case D3D11_SRV_DIMENSION_TEXTURECUBE:
+		srvDesc.TextureCube.MostDetailedMip = 0;
+		srvDesc.TextureCube.MipLevels = newMipLevels;
+		break;
+	case D3D11_SRV_DIMENSION_TEXTURECUBEARRAY:
+		srvDesc.TextureCubeArray.MostDetailedMip = 0;
+		srvDesc.TextureCubeArray.MipLevels = newMipLevels;
+		break;
+	default:
+		return false;
+	}
+
+	ComPtr<ID3D11ShaderResourceView> newSrv;
+	if (FAILED(mDevice->CreateShaderResourceView(newTexture.Get(), &srvDesc, newSrv.GetAddressOf())))
+		return false;
+
+	texture.Resource = newTexture;
+	texture.Srv = newSrv;
+	++texture.DroppedMips;
+	return true;
+}
@@ -0,0 +1,121 @@
+﻿#pragma once
+
+#include <d3d11_1.h>
+#include <wrl.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+///**************************************************************
+/// 纹理注册表: 按GetSurfaceInfo精确统计每个纹理、每级mip占用的显存,
+/// 在绘制提交时记录最后使用的帧, 并按类别(如"diffuse"、"normal")汇总.
+/// 总占用超过预算时, 丢弃最近最少使用的纹理的最精细mip(重新创建纹理并复制剩余的mip).
+/// 丢弃的mip不会自动恢复(需要按需加载时使用TextureStreamer), 可以用Restore从文件重新加载.
+///**************************************************************
+class TextureRegistry
+{
+public:
+	TextureRegistry() = default;
+	TextureRegistry(const TextureRegistry& rhs) = delete;
+	TextureRegistry& operator=(const TextureRegistry& rhs) = delete;
+
+	///<summary>
+	/// budgetBytes: 所有纹理的显存预算, 0表示不限制;
+	/// minResidentSize: 宽高都不超过该值的mip不会被丢弃.
+	///</summary>
+	void Initialize(ID3D11Device* device, uint64_t budgetBytes, UINT minResidentSize = 64);
+
+	void SetBudget(uint64_t budgetBytes) { mBudgetBytes = budgetBytes; }
+	uint64_t BudgetBytes() const { return mBudgetBytes; }
+
+	///<summary>
+	/// 注册一个已创建的纹理, 返回句柄. 只有2D纹理(包括数组和立方体贴图)可以丢弃mip,
+	/// 其它类型只统计占用. filename非空时可以用Restore重新加载.
+	///</summary>
+	int Register(const std::wstring& name, const std::string& category,
+		ID3D11ShaderResourceView* srv, const std::wstring& filename = L"");
+
+	///<summary>
+	/// 用CreateDDSTextureFromFile加载并注册, 失败返回-1并设置error.
+	///</summary>
+	int Load(const std::wstring& filename, const std::string& category, std::wstring& error);
+
+	// 句柄是否对应一个已注册的纹理(Load/Register失败时返回-1).
+	bool IsValid(int handle) const { return handle >= 0 && handle < (int)mTextures.size(); }
+
+	// 绘制提交时调用: 记录本帧使用了该纹理, 返回当前的视图. 句柄无效时返回nullptr.
+	ID3D11ShaderResourceView* Use(int handle);
+
+	// 当前的视图, 丢弃mip后会改变, 不要长期保存.
+	ID3D11ShaderResourceView* GetSrv(int handle) const;
+
+	///<summary>
+	/// 每帧绘制提交后调用一次: 超出预算时按最近最少使用的顺序丢弃最精细的mip, 然后进入下一帧.
+	///</summary>
+	void EndFrame(ID3D11DeviceContext* context);
+
+	// 从文件重新加载完整的mip链.
+	bool Restore(int handle, std::wstring& error);
+
+	// 所有纹理当前占用的字节数.
+	uint64_t ResidentBytes() const;
+	uint64_t ResidentBytes(int handle) const;
+
+	// 每个类别当前占用的字节数.
+	std::map<std::string, uint64_t> BytesByCategory() const;
+
+	// 原始纹理第mip级(所有数组元素)的字节数.
+	uint64_t MipBytes(int handle, UINT mip) const;
+
+	// 已经丢弃的最精细mip的数量.
+	UINT DroppedMips(int handle) const;
+
+	// 最后一次使用的帧, 从未使用过为0.
+	uint64_t LastUsedFrame(int handle) const;
+	uint64_t Frame() const { return mFrame; }
+	UINT Count() const { return (UINT)mTextures.size(); }
+
+	// 通过OutputDebugString输出每个纹理和每个类别的占用.
+	void Report() const;
+
+private:
+	struct RegisteredTexture
+	{
+		std::wstring Name;
+		std::string Category;
+		std::wstring Filename;
+
+		Microsoft::WRL::ComPtr<ID3D11Resource> Resource;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Srv;
+
+		D3D11_RESOURCE_DIMENSION Dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+		DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+		UINT Width = 0;
+		UINT Height = 0;
+		UINT MipLevels = 0;				// 原始的mip数量.
+		UINT ArraySize = 0;
+
+		std::vector<uint64_t> MipBytes;	// 原始纹理每级mip(所有数组元素)的字节数.
+		UINT DroppedMips = 0;
+		uint64_t LastUsedFrame = 0;		// 0表示注册后还没有使用过.
+	};
+
+	// 由视图取得资源并统计每级mip的大小.
+	bool Describe(RegisteredTexture& texture, ID3D11ShaderResourceView* srv);
+
+	// 是否还能再丢弃一级mip.
+	bool CanDrop(const RegisteredTexture& texture) const;
+
+	// 重新创建少一级mip的纹理和视图.
+	bool DropTopMip(ID3D11DeviceContext* context, RegisteredTexture& texture);
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> mDevice;
+	uint64_t mBudgetBytes = 0;
+	UINT mMinResidentSize = 64;
+	uint64_t mFrame = 1;
+
+	std::vector<std::unique_ptr<RegisteredTexture>> mTextures;
+};
@@ -0,0 +1,509 @@
+﻿#include "TextureStreamer.h"
+#include "DDS.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	inline UINT MipDimension(UINT size, UINT mip)
+	{
+		return std::max<UINT>(size >> mip, 1);
+	}
+
+	// 块压缩格式4x4个像素只有一行数据.
+	inline bool IsBlockCompressed(DXGI_FORMAT format)
+	{
+		size_t numRows = 0;
+		GetSurfaceInfo(4, 4, format, nullptr, nullptr, &numRows);
+		return numRows == 1;
+	}
+
+	// 块压缩纹理的最高一级mip宽高必须是4的倍数.
+	inline bool IsValidTopMip(const TextureManifestEntry& info, UINT mip)
+	{
+		if (mip == 0 || !IsBlockCompressed(info.Format))
+			return true;
+
+		return MipDimension(info.Width, mip) % 4 == 0 && MipDimension(info.Height, mip) % 4 == 0;
+	}
+
+	// 请求的mip取整并限制在[0, lowestStreamedMip]之内.
+	inline UINT WantedMip(float requestedMip, UINT lowestStreamedMip)
+	{
+		if (requestedMip >= (float)lowestStreamedMip)
+			return lowestStreamedMip;
+
+		return requestedMip <= 0.0f ? 0 : (UINT)requestedMip;
+	}
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	if (mWorker.joinable())
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mQuit = true;
+		}
+
+		mCondition.notify_all();
+		mWorker.join();
+	}
+}
+
+void TextureStreamer::Initialize(ID3D11Device* device, uint64_t budgetBytes, UINT residentSize)
+{
+	mDevice = device;
+	mBudgetBytes = budgetBytes;
+	mResidentSize = std::max<UINT>(residentSize, 1);
+
+	if (!mWorker.joinable())
+		mWorker = std::thread(&TextureStreamer::WorkerMain, this);
+}
+
+int TextureStreamer::Load(const std::wstring& filename, std::wstring& error)
+{
+	auto texture = std::make_unique<StreamedTexture>();
+	texture->Filename = filename;
+
+	if (!texture->File.Open(filename))
+	{
+		error = filename + L"不存在！";
+		return -1;
+	}
+
+	DDS_FILE_VIEW dds;
+	if (!ParseDDSData(texture->File.Data(), texture->File.Size(), dds) ||
+		!TextureManifest::DescribeHeader(texture->File.Data(), texture->File.Size(), texture->Info))
+	{
+		error = filename + L": 不是有效的DDS文件或格式不受支持.";
+		return -1;
+	}
+
+	const TextureManifestEntry& info = texture->Info;
+	if (info.Dimension != D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+	{
+		error = filename + L": 只支持2D纹理的流式加载.";
+		return -1;
+	}
+
+	if (dds.bitSize < info.TotalBytes)
+	{
+		error = filename + L": 文件不完整.";
+		return -1;
+	}
+
+	texture->Bits = dds.bitData;
+
+	// 宽高都不超过mResidentSize的mip始终常驻.
+	UINT lowest = 0;
+	while (lowest + 1 < info.MipLevels &&
+		(std::max(MipDimension(info.Width, lowest), MipDimension(info.Height, lowest)) > mResidentSize ||
+		!IsValidTopMip(info, lowest)))
+	{
+		++lowest;
+	}
+
+	// 较小的纹理没有满足条件的mip时全部常驻.
+	if (!IsValidTopMip(info, lowest))
+		lowest = 0;
+
+	texture->LowestStreamedMip = lowest;
+
+	// 常驻的mip直接从映射的文件上传.
+	const UINT mipLevels = info.MipLevels - lowest;
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(mipLevels * info.ArraySize);
+
+	for (UINT slice = 0; slice < info.ArraySize; ++slice)
+	{
+		for (UINT mip = lowest; mip < info.MipLevels; ++mip)
+		{
+			size_t numBytes = 0;
+			size_t rowBytes = 0;
+			GetSurfaceInfo(MipDimension(info.Width, mip), MipDimension(info.Height, mip), info.Format,
+				&numBytes, &rowBytes, nullptr);
+
+			auto& data = initData[slice * mipLevels + (mip - lowest)];
+			data.pSysMem = texture->Bits + SubresourceOffset(info, slice, mip);
+			data.SysMemPitch = (UINT)rowBytes;
+			data.SysMemSlicePitch = (UINT)numBytes;
+		}
+	}
+
+	if (!CreateTexture(*texture, lowest, initData.data(), texture->Texture, texture->Srv))
+	{
+		error = filename + L": 创建纹理失败.";
+		return -1;
+	}
+
+	texture->ResidentMip = lowest;
+
+	mTextures.push_back(std::move(texture));
+	return (int)mTextures.size() - 1;
+}
+
+ID3D11ShaderResourceView* TextureStreamer::GetSrv(int handle) const
+{
+	assert(handle >= 0 && handle < (int)mTextures.size());
+	return mTextures[handle]->Srv.Get();
+}
+
+const TextureManifestEntry& TextureStreamer::Info(int handle) const
+{
+	assert(handle >= 0 && handle < (int)mTextures.size());
+	return mTextures[handle]->Info;
+}
+
+void TextureStreamer::RequestMip(int handle, float mip)
+{
+	assert(handle >= 0 && handle < (int)mTextures.size());
+	auto& texture = *mTextures[handle];
+	texture.RequestedMip = std::min(texture.RequestedMip, mip);
+	texture.LastUsedFrame = mFrame;
+}
+
+UINT TextureStreamer::ResidentMip(int handle) const
+{
+	return mTextures[handle]->ResidentMip;
+}
+
+uint64_t TextureStreamer::ResidentBytes() const
+{
+	uint64_t total = 0;
+	for (const auto& texture : mTextures)
+		total += texture->Info.BytesFromMip(texture->ResidentMip);
+
+	return total;
+}
+
+void TextureStreamer::Update(ID3D11DeviceContext* context)
+{
+	///
+	/// 上传后台读取完成的mip.
+	///
+	std::vector<LoadRequest> completed;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		completed.swap(mCompleted);
+	}
+
+	for (const auto& request : completed)
+	{
+		auto& texture = *mTextures[request.Handle];
+		texture.PendingMip = UINT_MAX;
+
+		// 读取期间纹理被丢弃过mip时, 数据已经接不上了, 等下一次请求.
+		if (texture.ResidentMip != request.LastMip)
+			continue;
+
+		Rebuild(context, texture, request.FirstMip, &request);
+	}
+
+	///
+	/// 发出新的读取请求, 需要的mip差距越大越优先.
+	///
+	uint64_t committed = 0;
+	std::vector<int> candidates;
+
+	for (int i = 0; i < (int)mTextures.size(); ++i)
+	{
+		const auto& texture = *mTextures[i];
+		committed += texture.Info.BytesFromMip(texture.ResidentMip);
+
+		if (texture.PendingMip != UINT_MAX)
+		{
+			committed += texture.Info.BytesFromMip(texture.PendingMip) - texture.Info.BytesFromMip(texture.ResidentMip);
+			continue;
+		}
+
+		if (texture.LastUsedFrame == mFrame && WantedMip(texture.RequestedMip, texture.LowestStreamedMip) < texture.ResidentMip)
+			candidates.push_back(i);
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [this](int a, int b)
+	{
+		const auto& ta = *mTextures[a];
+		const auto& tb = *mTextures[b];
+		return ta.ResidentMip - WantedMip(ta.RequestedMip, ta.LowestStreamedMip) >
+			tb.ResidentMip - WantedMip(tb.RequestedMip, tb.LowestStreamedMip);
+	});
+
+	for (int handle : candidates)
+	{
+		auto& texture = *mTextures[handle];
+		UINT wanted = WantedMip(texture.RequestedMip, texture.LowestStreamedMip);
+
+		uint64_t extra = texture.Info.BytesFromMip(wanted) - texture.Info.BytesFromMip(texture.ResidentMip);
+		if (committed + extra > mBudgetBytes)
+			committed -= Evict(context, committed + extra - mBudgetBytes);
+
+		// 预算不够时退而求其次, 只加载放得下的几级.
+		while (wanted < texture.ResidentMip && committed + extra > mBudgetBytes)
+		{
+			++wanted;
+			extra = texture.Info.BytesFromMip(wanted) - texture.Info.BytesFromMip(texture.ResidentMip);
+		}
+
+		if (wanted >= texture.ResidentMip)
+			continue;
+
+		LoadRequest request;
+		request.Handle = handle;
+		request.Source = &texture;
+		request.FirstMip = wanted;
+		request.LastMip = texture.ResidentMip;
+
+		texture.PendingMip = wanted;
+		committed += extra;
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mRequests.push_back(std::move(request));
+		}
+		mCondition.notify_one();
+	}
+
+	// 预算被调小等情况下仍然超出时继续丢弃.
+	uint64_t resident = ResidentBytes();
+	if (resident > mBudgetBytes)
+		Evict(context, resident - mBudgetBytes);
+
+	for (auto& texture : mTextures)
+		texture->RequestedMip = FLT_MAX;
+
+	++mFrame;
+}
+
+float TextureStreamer::ComputeRequiredMip(UINT width, UINT height, float uvDensity, float pixelsPerWorldUnit)
+{
+	if (uvDensity <= 0.0f || pixelsPerWorldUnit <= 0.0f)
+		return 0.0f;
+
+	// 每个像素在一个方向上覆盖的纹素数.
+	float texelsPerPixel = sqrtf(uvDensity * (float)width * (float)height) / pixelsPerWorldUnit;
+
+	return texelsPerPixel > 1.0f ? log2f(texelsPerPixel) : 0.0f;
+}
+
+float TextureStreamer::MeasureUVDensity(
+	const XMFLOAT3* positions, UINT positionStride,
+	const XMFLOAT2* texcoords, UINT texcoordStride,
+	const UINT* indices, UINT indexCount)
+{
+	auto position = [&](UINT i)
+	{
+		return XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(reinterpret_cast<const uint8_t*>(positions) + (size_t)i * positionStride));
+	};
+	auto texcoord = [&](UINT i)
+	{
+		return XMLoadFloat2(reinterpret_cast<const XMFLOAT2*>(reinterpret_cast<const uint8_t*>(texcoords) + (size_t)i * texcoordStride));
+	};
+
+	float worldArea = 0.0f;
+	float uvArea = 0.0f;
+
+	for (UINT i = 0; i + 2 < indexCount; i += 3)
+	{
+		XMVECTOR p0 = position(indices[i + 0]);
+		XMVECTOR p1 = position(indices[i + 1]);
+		XMVECTOR p2 = position(indices[i + 2]);
+		worldArea += 0.5f * XMVectorGetX(XMVector3Length(XMVector3Cross(p1 - p0, p2 - p0)));
+
+		XMVECTOR t0 = texcoord(indices[i + 0]);
+		XMVECTOR t1 = texcoord(indices[i + 1]);
+		XMVECTOR t2 = texcoord(indices[i + 2]);
+		uvArea += 0.5f * fabsf(XMVectorGetX(XMVector2Cross(t1 - t0, t2 - t0)));
+	}
+
+	return worldArea > 0.0f ? uvArea / worldArea : 0.0f;
+}
+
+size_t TextureStreamer::SubresourceOffset(const TextureManifestEntry& info, UINT slice, UINT mip)
+{
+	// DDS中按数组元素存放, 每个元素依次是所有mip.
+	size_t offset = (size_t)slice * (size_t)info.BytesFromMip(0) / info.ArraySize;
+	for (UINT i = 0; i < mip; ++i)
+		offset += (size_t)info.MipBytes[i];
+
+	return offset;
+}
+
+bool TextureStreamer::CreateTexture(StreamedTexture& texture, UINT firstMip, const D3D11_SUBRESOURCE_DATA* initData,
+	ComPtr<ID3D11Texture2D>& result, ComPtr<ID3D11ShaderResourceView>& srv)
+{
+	const TextureManifestEntry& info = texture.Info;
+
+	D3D11_TEXTURE2D_DESC desc;
+	desc.Width = MipDimension(info.Width, firstMip);
+	desc.Height = MipDimension(info.Height, firstMip);
+	desc.MipLevels = info.MipLevels - firstMip;
+	desc.ArraySize = info.ArraySize;
+	desc.Format = info.Format;
+	desc.SampleDesc.Count = 1;
+	desc.SampleDesc.Quality = 0;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	desc.CPUAccessFlags = 0;
+	desc.MiscFlags = info.IsCubeMap ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+	ComPtr<ID3D11Texture2D> tex;
+	if (FAILED(mDevice->CreateTexture2D(&desc, initData, tex.GetAddressOf())))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	memset(&srvDesc, 0, sizeof(srvDesc));
+	srvDesc.Format = info.Format;
+
+	if (info.IsCubeMap && info.ArraySize > 6)
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+		srvDesc.TextureCubeArray.MipLevels = desc.MipLevels;
+		srvDesc.TextureCubeArray.NumCubes = info.ArraySize / 6;
+	}
+	else if (info.IsCubeMap)
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = desc.MipLevels;
+	}
+	else if (info.ArraySize > 1)
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = desc.MipLevels;
+		srvDesc.Texture2DArray.ArraySize = info.ArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = desc.MipLevels;
+	}
+
+	ComPtr<ID3D11ShaderResourceView> view;
+	if (FAILED(mDevice->CreateShaderResourceView(tex.Get(), &srvDesc, view.GetAddressOf())))
+		return false;
+
+	result = tex;
+	srv = view;
+
+	return true;
+}
+
+bool TextureStreamer::Rebuild(ID3D11DeviceContext* context, StreamedTexture& texture, UINT firstMip, const LoadRequest* request)
+{
+	const TextureManifestEntry& info = texture.Info;
+
+	ComPtr<ID3D11Texture2D> tex;
+	ComPtr<ID3D11ShaderResourceView> srv;
+	if (!CreateTexture(texture, firstMip, nullptr, tex, srv))
+		return false;
+
+	const UINT oldMipLevels = info.MipLevels - texture.ResidentMip;
+	const UINT newMipLevels = info.MipLevels - firstMip;
+
+	const uint8_t* src = request ? request->Data.data() : nullptr;
+
+	for (UINT slice = 0; slice < info.ArraySize; ++slice)
+	{
+		for (UINT mip = firstMip; mip < info.MipLevels; ++mip)
+		{
+			UINT dstSubresource = D3D11CalcSubresource(mip - firstMip, slice, newMipLevels);
+
+			// 已经常驻的mip在显存中复制.
+			if (mip >= texture.ResidentMip)
+			{
+				UINT srcSubresource = D3D11CalcSubresource(mip - texture.ResidentMip, slice, oldMipLevels);
+				context->CopySubresourceRegion(tex.Get(), dstSubresource, 0, 0, 0,
+					texture.Texture.Get(), srcSubresource, nullptr);
+				continue;
+			}
+
+			size_t numBytes = 0;
+			size_t rowBytes = 0;
+			GetSurfaceInfo(MipDimension(info.Width, mip), MipDimension(info.Height, mip), info.Format,
+				&numBytes, &rowBytes, nullptr);
+
+			context->UpdateSubresource(tex.Get(), dstSubresource, nullptr, src, (UINT)rowBytes, (UINT)numBytes);
+			src += numBytes;
+		}
+	}
+
+	texture.Texture = tex;
+	texture.Srv = srv;
+	texture.ResidentMip = firstMip;
+
+	return true;
+}
+
+UINT TextureStreamer::KeepMip(const StreamedTexture& texture) const
+{
+	if (texture.LastUsedFrame != mFrame)
+		return texture.LowestStreamedMip;
+
+	return std::max(texture.ResidentMip, WantedMip(texture.RequestedMip, texture.LowestStreamedMip));
+}
+
+uint64_t TextureStreamer::Evict(ID3D11DeviceContext* context, uint64_t bytesToFree)
+{
+	std::vector<StreamedTexture*> lru;
+	for (auto& texture : mTextures)
+	{
+		if (texture->ResidentMip < KeepMip(*texture))
+			lru.push_back(texture.get());
+	}
+
+	std::sort(lru.begin(), lru.end(), [](const StreamedTexture* a, const StreamedTexture* b)
+	{
+		return a->LastUsedFrame < b->LastUsedFrame;
+	});
+
+	uint64_t freed = 0;
+	for (auto texture : lru)
+	{
+		if (freed >= bytesToFree)
+			break;
+
+		UINT keepMip = KeepMip(*texture);
+		uint64_t bytes = texture->Info.BytesFromMip(texture->ResidentMip) - texture->Info.BytesFromMip(keepMip);
+
+		if (Rebuild(context, *texture, keepMip, nullptr))
+			freed += bytes;
+	}
+
+	return freed;
+}
+
+void TextureStreamer::WorkerMain()
+{
+	for (;;)
+	{
+		LoadRequest request;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mQuit || !mRequests.empty(); });
+
+			if (mQuit)
+				return;
+
+			request = std::move(mRequests.front());
+			mRequests.pop_front();
+		}
+
+		// 从映射的文件中复制, 缺页时的磁盘读取发生在这个线程中.
+		const TextureManifestEntry& info = request.Source->Info;
+		for (UINT slice = 0; slice < info.ArraySize; ++slice)
+		{
+			const uint8_t* src = request.Source->Bits + SubresourceOffset(info, slice, request.FirstMip);
+			size_t size = SubresourceOffset(info, slice, request.LastMip) - SubresourceOffset(info, slice, request.FirstMip);
+			request.Data.insert(request.Data.end(), src, src + size);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mCompleted.push_back(std::move(request));
+		}
+	}
+}
@@ -0,0 +1,138 @@
+﻿#pragma once
+
+#include "TextureManifest.h"
+#include "MappedFile.h"
+#include <DirectXMath.h>
+#include <wrl.h>
+#include <cfloat>
+#include <climits>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+///**************************************************************
+/// mip级纹理流式加载.
+/// 纹理创建时只上传较小的几级mip(常驻部分), 每帧由CPU根据渲染项
+/// 在屏幕上的尺寸和UV密度计算需要的mip, 较精细的mip在后台线程从磁盘读取,
+/// 在Update()中上传. 总占用超过预算时按最近最少使用的顺序丢弃精细的mip.
+/// 只支持2D纹理(包括纹理数组和立方体贴图).
+///**************************************************************
+class TextureStreamer
+{
+public:
+	TextureStreamer() = default;
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	~TextureStreamer();
+
+	///<summary>
+	/// budgetBytes: 所有纹理的显存预算; residentSize: 宽高都不超过该值的mip始终常驻.
+	///</summary>
+	void Initialize(ID3D11Device* device, uint64_t budgetBytes, UINT residentSize = 64);
+
+	///<summary>
+	/// 打开DDS文件并上传常驻的mip, 返回纹理句柄, 失败返回-1并设置error.
+	///</summary>
+	int Load(const std::wstring& filename, std::wstring& error);
+
+	// 当前可用的着色器资源视图, 精细的mip加载或丢弃后会改变, 每帧绘制前重新获取.
+	ID3D11ShaderResourceView* GetSrv(int handle) const;
+
+	// 纹理的尺寸等信息(来自文件头).
+	const TextureManifestEntry& Info(int handle) const;
+
+	///<summary>
+	/// 本帧需要的最精细mip(可以为小数), 同一纹理多次请求时取最小值.
+	///</summary>
+	void RequestMip(int handle, float mip);
+
+	///<summary>
+	/// 每帧调用一次: 上传后台读取完成的mip, 发出新的读取请求, 超出预算时丢弃.
+	///</summary>
+	void Update(ID3D11DeviceContext* context);
+
+	// 当前常驻的最精细mip.
+	UINT ResidentMip(int handle) const;
+
+	// 所有纹理当前占用的字节数.
+	uint64_t ResidentBytes() const;
+	uint64_t BudgetBytes() const { return mBudgetBytes; }
+
+	///<summary>
+	/// 需要的mip: 每个像素覆盖的纹素数取对数.
+	/// uvDensity是单位世界面积对应的UV面积(纹理坐标变换之后),
+	/// pixelsPerWorldUnit是物体所在距离上一个世界单位在屏幕上的像素数.
+	///</summary>
+	static float ComputeRequiredMip(UINT width, UINT height, float uvDensity, float pixelsPerWorldUnit);
+
+	///<summary>
+	/// 网格的平均UV密度: 所有三角形的UV面积之和 / 世界面积之和.
+	///</summary>
+	static float MeasureUVDensity(
+		const DirectX::XMFLOAT3* positions, UINT positionStride,
+		const DirectX::XMFLOAT2* texcoords, UINT texcoordStride,
+		const UINT* indices, UINT indexCount);
+
+private:
+	struct StreamedTexture
+	{
+		std::wstring Filename;
+		TextureManifestEntry Info;
+		MappedFile File;
+		const uint8_t* Bits = nullptr;	// 文件中纹素数据的起始位置.
+
+		Microsoft::WRL::ComPtr<ID3D11Texture2D> Texture;
+		Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> Srv;
+
+		UINT ResidentMip = 0;			// 当前常驻的最精细mip.
+		UINT LowestStreamedMip = 0;		// 不小于该值的mip始终常驻.
+		UINT PendingMip = UINT_MAX;		// 正在后台读取的mip, 没有时为UINT_MAX.
+		float RequestedMip = FLT_MAX;	// 本帧请求的mip.
+		uint64_t LastUsedFrame = 0;
+	};
+
+	/// 后台线程读取的数据, 依次是每个数组元素的[FirstMip, LastMip)级mip.
+	struct LoadRequest
+	{
+		int Handle;
+		const StreamedTexture* Source;	// 后台线程只读取Info和Bits, 加载后不再改变.
+		UINT FirstMip;
+		UINT LastMip;
+		std::vector<uint8_t> Data;
+	};
+
+	// 文件中第slice个数组元素第mip级的偏移.
+	static size_t SubresourceOffset(const TextureManifestEntry& info, UINT slice, UINT mip);
+
+	// 重新创建只包含[firstMip, MipLevels)级的纹理, 已有的mip从旧纹理复制.
+	bool Rebuild(ID3D11DeviceContext* context, StreamedTexture& texture, UINT firstMip, const LoadRequest* request);
+
+	// 本帧不需要丢弃的最精细mip: 本帧用到的纹理保留请求的mip, 其余只保留常驻部分.
+	UINT KeepMip(const StreamedTexture& texture) const;
+
+	// 按最近最少使用的顺序丢弃精细的mip, 直到释放bytesToFree字节, 返回实际释放的字节数.
+	uint64_t Evict(ID3D11DeviceContext* context, uint64_t bytesToFree);
+
+	bool CreateTexture(StreamedTexture& texture, UINT firstMip, const D3D11_SUBRESOURCE_DATA* initData,
+		Microsoft::WRL::ComPtr<ID3D11Texture2D>& result, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& srv);
+
+	void WorkerMain();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Device> mDevice;
+	uint64_t mBudgetBytes = 0;
+	UINT mResidentSize = 64;
+	uint64_t mFrame = 0;
+
+	std::vector<std::unique_ptr<StreamedTexture>> mTextures;
+
+	// 后台线程.
+	std::thread mWorker;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	std::deque<LoadRequest> mRequests;
+	std::vector<LoadRequest> mCompleted;
+	bool mQuit = false;
+};
@@ -0,0 +1,84 @@
+﻿#include "TransformBatch.h"
+#include <algorithm>
+#include <thread>
+
+using namespace DirectX;
+
+void TransformBatch::Clear()
+{
+	mWorld.clear();
+	mTexTransform.clear();
+}
+
+UINT TransformBatch::Add(const XMFLOAT4X4& world, const XMFLOAT4X4& texTransform)
+{
+	mWorld.push_back(world);
+	mTexTransform.push_back(texTransform);
+	return (UINT)mWorld.size() - 1;
+}
+
+void TransformBatch::BuildRange(const UINT* slots, UINT first, UINT last, BYTE* output, UINT outputStride) const
+{
+	const XMFLOAT4X4* world = mWorld.data();
+	const XMFLOAT4X4* texTransform = mTexTransform.data();
+
+	for (UINT i = first; i < last; ++i)
+	{
+		UINT slot = slots != nullptr ? slots[i] : i;
+
+		// 可见物体的槽位不连续, 提前取几个物体之后的矩阵.
+		if (slots != nullptr && i + 4 < last)
+		{
+			UINT ahead = slots[i + 4];
+			_mm_prefetch((const char*)&world[ahead], _MM_HINT_T0);
+			_mm_prefetch((const char*)&world[ahead] + 32, _MM_HINT_T0);
+			_mm_prefetch((const char*)&texTransform[ahead], _MM_HINT_T0);
+			_mm_prefetch((const char*)&texTransform[ahead] + 32, _MM_HINT_T0);
+		}
+
+		// 每个矩阵4次加载, 在寄存器中转置, 4次存储.
+		XMFLOAT4X4* block = (XMFLOAT4X4*)(output + (size_t)slot * outputStride);
+		XMStoreFloat4x4(&block[0], XMMatrixTranspose(XMLoadFloat4x4(&world[slot])));
+		XMStoreFloat4x4(&block[1], XMMatrixTranspose(XMLoadFloat4x4(&texTransform[slot])));
+	}
+}
+
+void TransformBatch::BuildConstants(const UINT* slots, UINT count, void* output, UINT outputStride, UINT threadCount) const
+{
+	if (count == 0)
+		return;
+
+	if (count < ParallelThreshold || threadCount == 1)
+	{
+		BuildRange(slots, 0, count, (BYTE*)output, outputStride);
+		return;
+	}
+
+	if (threadCount == 0)
+		threadCount = (std::max)(1u, std::thread::hardware_concurrency());
+	threadCount = (std::min)(threadCount, count / (ParallelThreshold / 4));
+	threadCount = (std::max)(threadCount, 1u);
+
+	// 每个线程一段连续的物体, 写出的常量块互不重叠.
+	UINT chunk = (count + threadCount - 1) / threadCount;
+
+	std::vector<std::thread> threads;
+	for (UINT t = 1; t < threadCount; ++t)
+	{
+		UINT first = t * chunk;
+		UINT last = (std::min)(first + chunk, count);
+		if (first >= last)
+			break;
+		threads.emplace_back([=]() { BuildRange(slots, first, last, (BYTE*)output, outputStride); });
+	}
+
+	BuildRange(slots, 0, (std::min)(chunk, count), (BYTE*)output, outputStride);
+
+	for (auto& t : threads)
+		t.join();
+}
+
+void TransformBatch::BuildConstants(void* output, UINT outputStride, UINT threadCount) const
+{
+	BuildConstants(nullptr, Size(), output, outputStride, threadCount);
+}
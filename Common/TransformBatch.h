@@ -0,0 +1,53 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <Windows.h>
+#include <vector>
+
+///**************************************************************
+/// 物体变换的批量处理.
+/// 世界矩阵和纹理矩阵分别连续存放(按槽位索引, 两个数组), 每帧对所有可见物体一次性
+/// 用SIMD转置成着色器使用的列主序常量块, 不再在绘制时逐个渲染项加载、转置、打包.
+/// 常量块的布局为 { World(转置); TexTransform(转置); ... }, 即ObjectConstants的前128字节.
+/// 物体数量很多时分段交给多个线程处理.
+///**************************************************************
+class TransformBatch
+{
+public:
+	// 超过这个数量才使用多线程, 数量少时创建线程的开销大于转置本身.
+	static const UINT ParallelThreshold = 16384;
+
+	// 一个常量块中两个矩阵的字节数.
+	static const UINT BlockBytes = 2 * sizeof(DirectX::XMFLOAT4X4);
+
+	void Clear();
+
+	// 添加一个物体, 返回槽位.
+	UINT Add(const DirectX::XMFLOAT4X4& world, const DirectX::XMFLOAT4X4& texTransform);
+
+	void SetWorld(UINT slot, const DirectX::XMFLOAT4X4& world) { mWorld[slot] = world; }
+	void SetTexTransform(UINT slot, const DirectX::XMFLOAT4X4& texTransform) { mTexTransform[slot] = texTransform; }
+
+	const DirectX::XMFLOAT4X4& World(UINT slot) const { return mWorld[slot]; }
+	const DirectX::XMFLOAT4X4& TexTransform(UINT slot) const { return mTexTransform[slot]; }
+
+	UINT Size() const { return (UINT)mWorld.size(); }
+
+	///<summary>
+	/// 把slots[0, count)中每个槽位的两个矩阵转置后写到 output + slot * outputStride,
+	/// 即常量块按槽位存放, outputStride通常为sizeof(ObjectConstants)(不小于BlockBytes).
+	/// threadCount为0时使用所有硬件线程, 数量小于ParallelThreshold时总是单线程.
+	///</summary>
+	void BuildConstants(const UINT* slots, UINT count, void* output, UINT outputStride, UINT threadCount = 0) const;
+
+	// 所有槽位都写出.
+	void BuildConstants(void* output, UINT outputStride, UINT threadCount = 0) const;
+
+private:
+	// slots为nullptr时处理槽位[first, last).
+	void BuildRange(const UINT* slots, UINT first, UINT last, BYTE* output, UINT outputStride) const;
+
+private:
+	std::vector<DirectX::XMFLOAT4X4> mWorld;
+	std::vector<DirectX::XMFLOAT4X4> mTexTransform;
+};
@@ -0,0 +1,411 @@
+﻿#include "TriangleBvh.h"
+#include "d3dUtil.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+
+using namespace DirectX;
+
+namespace
+{
+	const UINT BinCount = 16;
+	const UINT NoTriangle = 0xffffffff;
+
+	const XMFLOAT3& PositionAt(const void* vertices, UINT vertexStride, UINT index)
+	{
+		return *reinterpret_cast<const XMFLOAT3*>(static_cast<const BYTE*>(vertices) + (size_t)index * vertexStride);
+	}
+
+	float Area(FXMVECTOR mn, FXMVECTOR mx)
+	{
+		XMFLOAT3 d;
+		XMStoreFloat3(&d, XMVectorMax(mx - mn, XMVectorZero()));
+		return d.x * d.y + d.y * d.z + d.z * d.x;
+	}
+
+	///<summary>
+	/// 射线与节点包围盒的相交测试(slab方法, 三个轴同时计算), 返回射线进入包围盒的距离.
+	///</summary>
+	bool RayBox(FXMVECTOR origin, FXMVECTOR invDir, const XMFLOAT3& mn, const XMFLOAT3& mx, float maxDistance, float& enter)
+	{
+		XMVECTOR t1 = (XMLoadFloat3(&mn) - origin) * invDir;
+		XMVECTOR t2 = (XMLoadFloat3(&mx) - origin) * invDir;
+		XMVECTOR tNear = XMVectorMin(t1, t2);
+		XMVECTOR tFar = XMVectorMax(t1, t2);
+
+		enter = (std::max)((std::max)(XMVectorGetX(tNear), XMVectorGetY(tNear)), (std::max)(XMVectorGetZ(tNear), 0.0f));
+		float exit = (std::min)((std::min)(XMVectorGetX(tFar), XMVectorGetY(tFar)), (std::min)(XMVectorGetZ(tFar), maxDistance));
+		return enter <= exit;
+	}
+}
+
+void TriangleBvh::Build(const void* vertices, UINT vertexStride, const UINT* indices, UINT indexCount, UINT baseVertex)
+{
+	mNodes.clear();
+	mPackets.clear();
+	mTriangleCount = indexCount / 3;
+
+	if (mTriangleCount == 0)
+		return;
+
+	std::vector<BuildTriangle> tris(mTriangleCount);
+	std::vector<UINT> order(mTriangleCount);
+	for (UINT i = 0; i < mTriangleCount; ++i)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&PositionAt(vertices, vertexStride, baseVertex + indices[3 * i + 0]));
+		XMVECTOR p1 = XMLoadFloat3(&PositionAt(vertices, vertexStride, baseVertex + indices[3 * i + 1]));
+		XMVECTOR p2 = XMLoadFloat3(&PositionAt(vertices, vertexStride, baseVertex + indices[3 * i + 2]));
+
+		BuildTriangle& tri = tris[i];
+		XMStoreFloat3(&tri.V0, p0);
+		XMStoreFloat3(&tri.V1, p1);
+		XMStoreFloat3(&tri.V2, p2);
+		XMStoreFloat3(&tri.Min, XMVectorMin(p0, XMVectorMin(p1, p2)));
+		XMStoreFloat3(&tri.Max, XMVectorMax(p0, XMVectorMax(p1, p2)));
+		XMStoreFloat3(&tri.Centroid, (p0 + p1 + p2) * (1.0f / 3.0f));
+		order[i] = i;
+	}
+
+	// 二叉树的节点数不超过2n-1.
+	mNodes.reserve(2 * mTriangleCount);
+	mPackets.reserve(mTriangleCount / 2 + 1);
+
+	BuildNode(tris, order, 0, mTriangleCount, 0);
+}
+
+void TriangleBvh::BuildSubmeshBvhs(MeshGeometry& geo, const void* vertices, UINT vertexStride, const UINT* indices)
+{
+	for (auto& pair : geo.DrawArgs)
+	{
+		SubmeshGeometry& submesh = pair.second;
+
+		submesh.Bvh = std::make_shared<TriangleBvh>();
+		submesh.Bvh->Build(vertices, vertexStride, indices + submesh.StartIndexLocation,
+			submesh.IndexCount, submesh.BaseVertexLocation);
+	}
+}
+
+UINT TriangleBvh::BuildNode(std::vector<BuildTriangle>& tris, std::vector<UINT>& order, UINT first, UINT count, UINT depth)
+{
+	// 中位数划分保证深度不会超过MaxSahDepth + log2(2^32 / MaxLeafSize).
+	assert(depth < MaxDepth);
+
+	const UINT nodeIndex = (UINT)mNodes.size();
+	mNodes.push_back(Node());
+
+	XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR centroidMin = XMVectorReplicate(FLT_MAX);
+	XMVECTOR centroidMax = XMVectorReplicate(-FLT_MAX);
+	for (UINT i = first; i < first + count; ++i)
+	{
+		const BuildTriangle& tri = tris[order[i]];
+		boundsMin = XMVectorMin(boundsMin, XMLoadFloat3(&tri.Min));
+		boundsMax = XMVectorMax(boundsMax, XMLoadFloat3(&tri.Max));
+		centroidMin = XMVectorMin(centroidMin, XMLoadFloat3(&tri.Centroid));
+		centroidMax = XMVectorMax(centroidMax, XMLoadFloat3(&tri.Centroid));
+	}
+
+	XMStoreFloat3(&mNodes[nodeIndex].Min, boundsMin);
+	XMStoreFloat3(&mNodes[nodeIndex].Max, boundsMax);
+
+	// 在三个轴上分别把三角形按重心分到若干桶中, 只在桶的边界处尝试划分.
+	int bestAxis = -1;
+	UINT bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	XMFLOAT3 cMin, cMax;
+	XMStoreFloat3(&cMin, centroidMin);
+	XMStoreFloat3(&cMax, centroidMax);
+
+	const bool useSah = depth < MaxSahDepth;
+	if (count > 2 && useSah)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			const float lo = (&cMin.x)[axis];
+			const float extent = (&cMax.x)[axis] - lo;
+			if (extent <= 0.0f)
+				continue;
+
+			const float scale = BinCount / extent;
+
+			UINT binCount[BinCount] = {};
+			XMVECTOR binMin[BinCount];
+			XMVECTOR binMax[BinCount];
+			for (UINT b = 0; b < BinCount; ++b)
+			{
+				binMin[b] = XMVectorReplicate(FLT_MAX);
+				binMax[b] = XMVectorReplicate(-FLT_MAX);
+			}
+
+			for (UINT i = first; i < first + count; ++i)
+			{
+				const BuildTriangle& tri = tris[order[i]];
+				UINT b = (std::min)((UINT)(((&tri.Centroid.x)[axis] - lo) * scale), BinCount - 1);
+				++binCount[b];
+				binMin[b] = XMVectorMin(binMin[b], XMLoadFloat3(&tri.Min));
+				binMax[b] = XMVectorMax(binMax[b], XMLoadFloat3(&tri.Max));
+			}
+
+			// 从右往左累计每个划分位置右侧的面积和数量, 再从左往右计算代价.
+			float rightArea[BinCount];
+			UINT rightCount[BinCount];
+			XMVECTOR accMin = XMVectorReplicate(FLT_MAX);
+			XMVECTOR accMax = XMVectorReplicate(-FLT_MAX);
+			UINT accCount = 0;
+			for (UINT b = BinCount - 1; b > 0; --b)
+			{
+				accMin = XMVectorMin(accMin, binMin[b]);
+				accMax = XMVectorMax(accMax, binMax[b]);
+				accCount += binCount[b];
+				rightArea[b] = Area(accMin, accMax);
+				rightCount[b] = accCount;
+			}
+
+			accMin = XMVectorReplicate(FLT_MAX);
+			accMax = XMVectorReplicate(-FLT_MAX);
+			accCount = 0;
+			for (UINT split = 1; split < BinCount; ++split)
+			{
+				accMin = XMVectorMin(accMin, binMin[split - 1]);
+				accMax = XMVectorMax(accMax, binMax[split - 1]);
+				accCount += binCount[split - 1];
+				if (accCount == 0 || rightCount[split] == 0)
+					continue;
+
+				float cost = Area(accMin, accMax) * accCount + rightArea[split] * rightCount[split];
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestSplit = split;
+				}
+			}
+		}
+	}
+
+	// 划分不比直接作为叶节点更好时作为叶节点.
+	const float leafCost = Area(boundsMin, boundsMax) * count;
+	if (count <= MaxLeafSize && (bestAxis < 0 || bestCost >= leafCost))
+	{
+		Node& leaf = mNodes[nodeIndex];
+		leaf.Offset = (UINT)mPackets.size();
+		leaf.Count = count;
+
+		for (UINT i = 0; i < count; i += 4)
+		{
+			TrianglePacket packet = {};
+			for (UINT lane = 0; lane < 4; ++lane)
+			{
+				packet.Triangle[lane] = NoTriangle;
+				if (i + lane >= count)
+					continue;	// 补齐的三角形两条边为0, 永远不会命中.
+
+				const UINT t = order[first + i + lane];
+				const BuildTriangle& tri = tris[t];
+				packet.Triangle[lane] = t;
+
+				const float* v0 = &tri.V0.x;
+				const float* v1 = &tri.V1.x;
+				const float* v2 = &tri.V2.x;
+				for (int c = 0; c < 3; ++c)
+				{
+					(&packet.V0[c].x)[lane] = v0[c];
+					(&packet.E1[c].x)[lane] = v1[c] - v0[c];
+					(&packet.E2[c].x)[lane] = v2[c] - v0[c];
+				}
+			}
+			mPackets.push_back(packet);
+		}
+
+		return nodeIndex;
+	}
+
+	UINT mid = first;
+	if (bestAxis >= 0)
+	{
+		const float lo = (&cMin.x)[bestAxis];
+		const float scale = BinCount / ((&cMax.x)[bestAxis] - lo);
+		mid = (UINT)(std::partition(order.begin() + first, order.begin() + first + count, [&](UINT t)
+		{
+			UINT b = (std::min)((UINT)(((&tris[t].Centroid.x)[bestAxis] - lo) * scale), BinCount - 1);
+			return b < bestSplit;
+		}) - order.begin());
+	}
+
+	else if (!useSah)
+	{
+		// 太深时按重心跨度最大的轴取中位数, 不让SAH一直切出很不平衡的分支.
+		int axis = 0;
+		if (cMax.y - cMin.y > (&cMax.x)[axis] - (&cMin.x)[axis])
+			axis = 1;
+		if (cMax.z - cMin.z > (&cMax.x)[axis] - (&cMin.x)[axis])
+			axis = 2;
+
+		mid = first + count / 2;
+		std::nth_element(order.begin() + first, order.begin() + mid, order.begin() + first + count, [&](UINT a, UINT b)
+		{
+			return (&tris[a].Centroid.x)[axis] < (&tris[b].Centroid.x)[axis];
+		});
+	}
+
+	// 重心全部重合等无法按SAH划分的情况, 按数量对半分.
+	if (mid == first || mid == first + count)
+		mid = first + count / 2;
+
+	BuildNode(tris, order, first, mid - first, depth + 1);
+	const UINT right = BuildNode(tris, order, mid, first + count - mid, depth + 1);
+
+	mNodes[nodeIndex].Offset = right;
+	mNodes[nodeIndex].Count = 0;
+	return nodeIndex;
+}
+
+bool TriangleBvh::Intersect(FXMVECTOR origin, FXMVECTOR direction, float maxDistance,
+	float& distance, UINT& triangle) const
+{
+	if (mNodes.empty())
+		return false;
+
+	// 方向分量为0时倒数为无穷大, slab测试仍然成立.
+	const XMVECTOR invDir = XMVectorReciprocal(direction);
+
+	float enter = 0.0f;
+	if (!RayBox(origin, invDir, mNodes[0].Min, mNodes[0].Max, maxDistance, enter))
+		return false;
+
+	// 射线的各分量广播到4个通道, 与4个三角形同时做Moller-Trumbore测试.
+	const XMVECTOR ox = XMVectorSplatX(origin);
+	const XMVECTOR oy = XMVectorSplatY(origin);
+	const XMVECTOR oz = XMVectorSplatZ(origin);
+	const XMVECTOR dx = XMVectorSplatX(direction);
+	const XMVECTOR dy = XMVectorSplatY(direction);
+	const XMVECTOR dz = XMVectorSplatZ(direction);
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+
+	float best = maxDistance;
+	UINT bestTriangle = NoTriangle;
+
+	struct Entry
+	{
+		UINT Node;
+		float Enter;
+	};
+	// 深度优先遍历时栈中最多有深度 + 1个节点, 见MaxDepth.
+	Entry stack[MaxDepth + 1];
+	UINT top = 0;
+	stack[top++] = { 0, enter };
+
+	while (top > 0)
+	{
+		const Entry entry = stack[--top];
+		if (entry.Enter > best)
+			continue;
+
+		const Node& node = mNodes[entry.Node];
+		if (node.Count > 0)
+		{
+			const UINT packetCount = (node.Count + 3) / 4;
+			for (UINT p = node.Offset; p < node.Offset + packetCount; ++p)
+			{
+				const TrianglePacket& packet = mPackets[p];
+
+				const XMVECTOR e1x = XMLoadFloat4(&packet.E1[0]);
+				const XMVECTOR e1y = XMLoadFloat4(&packet.E1[1]);
+				const XMVECTOR e1z = XMLoadFloat4(&packet.E1[2]);
+				const XMVECTOR e2x = XMLoadFloat4(&packet.E2[0]);
+				const XMVECTOR e2y = XMLoadFloat4(&packet.E2[1]);
+				const XMVECTOR e2z = XMLoadFloat4(&packet.E2[2]);
+
+				// p = d x e2, det = e1 . p
+				const XMVECTOR px = dy * e2z - dz * e2y;
+				const XMVECTOR py = dz * e2x - dx * e2z;
+				const XMVECTOR pz = dx * e2y - dy * e2x;
+				const XMVECTOR det = e1x * px + e1y * py + e1z * pz;
+				const XMVECTOR invDet = XMVectorReciprocal(det);
+
+				// s = o - v0, u = (s . p) / det
+				const XMVECTOR sx = ox - XMLoadFloat4(&packet.V0[0]);
+				const XMVECTOR sy = oy - XMLoadFloat4(&packet.V0[1]);
+				const XMVECTOR sz = oz - XMLoadFloat4(&packet.V0[2]);
+				const XMVECTOR u = (sx * px + sy * py + sz * pz) * invDet;
+
+				// q = s x e1, v = (d . q) / det, t = (e2 . q) / det
+				const XMVECTOR qx = sy * e1z - sz * e1y;
+				const XMVECTOR qy = sz * e1x - sx * e1z;
+				const XMVECTOR qz = sx * e1y - sy * e1x;
+				const XMVECTOR v = (dx * qx + dy * qy + dz * qz) * invDet;
+				const XMVECTOR t = (e2x * qx + e2y * qy + e2z * qz) * invDet;
+
+				XMVECTOR hit = XMVectorNotEqual(det, zero);
+				hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(u, zero));
+				hit = XMVectorAndInt(hit, XMVectorGreaterOrEqual(v, zero));
+				hit = XMVectorAndInt(hit, XMVectorLessOrEqual(u + v, one));
+				hit = XMVectorAndInt(hit, XMVectorGreater(t, zero));
+				hit = XMVectorAndInt(hit, XMVectorLess(t, XMVectorReplicate(best)));
+
+				XMUINT4 mask;
+				XMStoreUInt4(&mask, hit);
+				if ((mask.x | mask.y | mask.z | mask.w) == 0)
+					continue;
+
+				XMFLOAT4 dist;
+				XMStoreFloat4(&dist, t);
+				const UINT* laneMask = &mask.x;
+				const float* laneDist = &dist.x;
+				for (UINT lane = 0; lane < 4; ++lane)
+				{
+					if (laneMask[lane] && laneDist[lane] < best)
+					{
+						best = laneDist[lane];
+						bestTriangle = packet.Triangle[lane];
+					}
+				}
+			}
+			continue;
+		}
+
+		// 近的子节点后入栈, 先被访问. 建树时限制了深度, 栈不会溢出.
+		assert(top + 2 <= MaxDepth + 1);
+		if (top + 2 > MaxDepth + 1)
+			return false;
+
+		const UINT left = entry.Node + 1;
+		const UINT right = node.Offset;
+		float enterLeft = 0.0f;
+		float enterRight = 0.0f;
+		bool hitLeft = RayBox(origin, invDir, mNodes[left].Min, mNodes[left].Max, best, enterLeft);
+		bool hitRight = RayBox(origin, invDir, mNodes[right].Min, mNodes[right].Max, best, enterRight);
+
+		if (hitLeft && hitRight)
+		{
+			if (enterLeft <= enterRight)
+			{
+				stack[top++] = { right, enterRight };
+				stack[top++] = { left, enterLeft };
+			}
+			else
+			{
+				stack[top++] = { left, enterLeft };
+				stack[top++] = { right, enterRight };
+			}
+		}
+		else if (hitLeft)
+		{
+			stack[top++] = { left, enterLeft };
+		}
+		else if (hitRight)
+		{
+			stack[top++] = { right, enterRight };
+		}
+	}
+
+	if (bestTriangle == NoTriangle)
+		return false;
+
+	distance = best;
+	triangle = bestTriangle;
+	return true;
+}
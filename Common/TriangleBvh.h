@@ -0,0 +1,86 @@
+﻿#pragma once
+
+#include <DirectXMath.h>
+#include <Windows.h>
+#include <vector>
+
+struct MeshGeometry;
+
+///**************************************************************
+/// 三角形层次包围盒(BVH), 用于射线拾取.
+/// 按分桶的表面积启发式(binned SAH)自顶向下构建, 节点按深度优先顺序存放在一个数组中
+/// (左子节点紧跟在父节点之后). 叶节点的三角形按4个一组以结构数组存放,
+/// 射线一次与4个三角形做SIMD相交测试.
+///**************************************************************
+class TriangleBvh
+{
+public:
+	///<summary>
+	/// 构建BVH. 顶点位置须在顶点结构偏移0处, 三角形为indices[0, indexCount),
+	/// 索引加上baseVertex后引用vertices中的顶点.
+	///</summary>
+	void Build(const void* vertices, UINT vertexStride, const UINT* indices, UINT indexCount, UINT baseVertex = 0);
+
+	///<summary>
+	/// 为geo中每个子网格构建BVH, 存入SubmeshGeometry::Bvh. indices为合并后的整个索引缓冲区数据.
+	/// 顶点数据很多时构建需要一定时间, 只对需要拾取的几何体调用.
+	///</summary>
+	static void BuildSubmeshBvhs(MeshGeometry& geo, const void* vertices, UINT vertexStride, const UINT* indices);
+
+	///<summary>
+	/// 射线与三角形求交(两面都可命中), 返回是否有距离小于maxDistance的交点.
+	/// distance以direction的长度为单位, direction不要求是单位向量,
+	/// 因此可以直接传入变换到模型空间的射线, 距离与世界空间一致.
+	/// triangle为命中三角形在indices中的序号(第几个三角形).
+	///</summary>
+	bool Intersect(DirectX::FXMVECTOR origin, DirectX::FXMVECTOR direction, float maxDistance,
+		float& distance, UINT& triangle) const;
+
+	UINT TriangleCount() const { return mTriangleCount; }
+	UINT NodeCount() const { return (UINT)mNodes.size(); }
+	bool Empty() const { return mNodes.empty(); }
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 Min;
+		UINT Offset;			// 内部节点: 右子节点的编号; 叶节点: 第一个三角形组的编号.
+		DirectX::XMFLOAT3 Max;
+		UINT Count;				// 内部节点为0; 叶节点: 三角形数量.
+	};
+
+	// 4个三角形, 每个分量一个向量: 顶点v0, 边e1 = v1 - v0, 边e2 = v2 - v0.
+	struct TrianglePacket
+	{
+		DirectX::XMFLOAT4 V0[3];
+		DirectX::XMFLOAT4 E1[3];
+		DirectX::XMFLOAT4 E2[3];
+		UINT Triangle[4];
+	};
+
+	// 叶节点最多的三角形数量.
+	static const UINT MaxLeafSize = 8;
+
+	// 超过这个深度后不再按SAH划分, 改为按重心中位数对半分, 剩余深度不超过log2(三角形数量).
+	static const UINT MaxSahDepth = 32;
+
+	// 树的最大深度, 也是求交时遍历栈的容量(栈中的节点数不超过深度 + 1).
+	static const UINT MaxDepth = 64;
+
+	std::vector<Node> mNodes;
+	std::vector<TrianglePacket> mPackets;
+	UINT mTriangleCount = 0;
+
+	// 构建时的临时数据.
+	struct BuildTriangle
+	{
+		DirectX::XMFLOAT3 V0;
+		DirectX::XMFLOAT3 V1;
+		DirectX::XMFLOAT3 V2;
+		DirectX::XMFLOAT3 Min;
+		DirectX::XMFLOAT3 Max;
+		DirectX::XMFLOAT3 Centroid;
+	};
+
+	UINT BuildNode(std::vector<BuildTriangle>& tris, std::vector<UINT>& order, UINT first, UINT count, UINT depth);
+};
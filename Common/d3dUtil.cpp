@@ -10,13 +10,9 @@ ComPtr<ID3D11ShaderResourceView> d3dHelper::CreateRandomTexture1DSRV(ID3D11Devic
 	//
 	XMFLOAT4 *randomValues = new XMFLOAT4[1024];
 
-	for(int i = 0; i < 1024; ++i)
-	{
-		randomValues[i].x = MathHelper::RandF(-1.0f, 1.0f);
-		randomValues[i].y = MathHelper::RandF(-1.0f, 1.0f);
-		randomValues[i].z = MathHelper::RandF(-1.0f, 1.0f);
-		randomValues[i].w = MathHelper::RandF(-1.0f, 1.0f);
-	}
+	// 固定种子, 每次运行得到相同的纹理.
+	RandomStream rng;
+	rng.FillFloats(&randomValues[0].x, 4 * 1024, -1.0f, 1.0f);
 
     D3D11_SUBRESOURCE_DATA initData;
     initData.pSysMem = randomValues;
@@ -117,6 +113,46 @@ void ExtractFrustumPlanes(XMFLOAT4 planes[6], CXMMATRIX T)
 	}
 }
 
+BoundingBox TransformBounds(const BoundingBox& local, CXMMATRIX world)
+{
+	BoundingBox bounds;
+
+	// 最后一列为(0, 0, 0, 1)时是仿射变换: 中心直接变换, 半长用矩阵元素的绝对值变换.
+	XMFLOAT4X4 M;
+	XMStoreFloat4x4(&M, world);
+	if (M(0, 3) == 0.0f && M(1, 3) == 0.0f && M(2, 3) == 0.0f && M(3, 3) == 1.0f)
+	{
+		XMVECTOR c = XMVector3Transform(XMLoadFloat3(&local.Center), world);
+		XMVECTOR e = XMLoadFloat3(&local.Extents);
+		XMVECTOR worldExtents =
+			XMVectorAbs(world.r[0]) * XMVectorSplatX(e) +
+			XMVectorAbs(world.r[1]) * XMVectorSplatY(e) +
+			XMVectorAbs(world.r[2]) * XMVectorSplatZ(e);
+
+		XMStoreFloat3(&bounds.Center, c);
+		XMStoreFloat3(&bounds.Extents, worldExtents);
+	}
+	else
+	{
+		XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+		local.GetCorners(corners);
+
+		XMVECTOR vMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR vMax = XMVectorReplicate(-FLT_MAX);
+		for (UINT i = 0; i < BoundingBox::CORNER_COUNT; ++i)
+		{
+			XMVECTOR p = XMVector3TransformCoord(XMLoadFloat3(&corners[i]), world);
+			vMin = XMVectorMin(vMin, p);
+			vMax = XMVectorMax(vMax, p);
+		}
+
+		XMStoreFloat3(&bounds.Center, (vMin + vMax) * 0.5f);
+		XMStoreFloat3(&bounds.Extents, (vMax - vMin) * 0.5f);
+	}
+
+	return bounds;
+}
+
 ComPtr<ID3DBlob> d3dUtil::CompileShader(const std::wstring& filename, const D3D_SHADER_MACRO* defines, const std::string& entrypoint, const std::string& target)
 {
 	UINT compileFlags = 0;
@@ -159,6 +195,49 @@ ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring& filename)
 	return blob;
 }
 
+void d3dUtil::ComputeSubmeshBounds(MeshGeometry& geo, const void* vertices, UINT vertexStride, const UINT* indices)
+{
+	const BYTE* base = (const BYTE*)vertices;
+	std::vector<XMFLOAT3> points;
+	std::vector<bool> used;
+
+	for (auto& pair : geo.DrawArgs)
+	{
+		SubmeshGeometry& submesh = pair.second;
+
+		// 只取索引引用到的顶点(去重), 共用顶点缓冲区的其它子网格不参与计算.
+		points.clear();
+		used.clear();
+		for (UINT i = 0; i < submesh.IndexCount; ++i)
+		{
+			UINT index = indices[submesh.StartIndexLocation + i];
+			if (index >= used.size())
+				used.resize(index + 1, false);
+			if (used[index])
+				continue;
+
+			used[index] = true;
+			points.push_back(*(const XMFLOAT3*)(base + (size_t)(submesh.BaseVertexLocation + index) * vertexStride));
+		}
+
+		if (points.empty())
+		{
+			submesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+			submesh.Sphere = BoundingSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+			continue;
+		}
+
+		BoundingBox::CreateFromPoints(submesh.Bounds, points.size(), points.data(), sizeof(XMFLOAT3));
+
+		// Ritter算法得到的包围球, 对于盒子一类的形状可能比包围盒的外接球大, 取两者中较小的.
+		BoundingSphere boxSphere;
+		BoundingSphere::CreateFromPoints(submesh.Sphere, points.size(), points.data(), sizeof(XMFLOAT3));
+		BoundingSphere::CreateFromBoundingBox(boxSphere, submesh.Bounds);
+		if (boxSphere.Radius < submesh.Sphere.Radius)
+			submesh.Sphere = boxSphere;
+	}
+}
+
 void d3dUtil::CopyDataToGpu(ID3D11DeviceContext* context, const void* srcCpuData, rsize_t dataSize, ID3D11Resource* dstGpuData)
 {
 	D3D11_MAPPED_SUBRESOURCE mappedData;
@@ -10,6 +10,7 @@
 #include <DirectXMath.h>
 #include <DirectXPackedVector.h>
 #include <DirectXColors.h>
+#include <DirectXCollision.h>
 #include <d3dcompiler.h>
 #include "dxerr.h"
 #include <cassert>
@@ -23,6 +24,14 @@
 #include "MathHelper.h"
 #include <wrl.h>
 #include <unordered_map>
+#include <memory>
+
+// 完整定义在TextureCache.h中, 只有创建纹理的代码需要包含.
+struct CachedTexture;
+using TextureHandle = std::shared_ptr<const CachedTexture>;
+
+// 完整定义在TriangleBvh.h中, 只有构建或查询BVH的代码需要包含.
+class TriangleBvh;
 
 ///**************************************************************
 /// 用于输出错误信息.
@@ -82,6 +91,11 @@ public:
 // Order: left, right, bottom, top, near, far.
 void ExtractFrustumPlanes(DirectX::XMFLOAT4 planes[6], DirectX::CXMMATRIX T);
 
+// 把包围盒变换到世界空间. 支持带透视除法的矩阵(如XMMatrixShadow), 此时变换包围盒的8个顶点.
+DirectX::BoundingBox TransformBounds(const DirectX::BoundingBox& localBounds, DirectX::CXMMATRIX world);
+
+struct MeshGeometry;
+
 ///**************************************************************
 /// 常用的一些方法.
 ///**************************************************************
@@ -103,6 +117,16 @@ public:
 		const void* srcCpuData, 
 		rsize_t dataSize, 
 		ID3D11Resource* dstGpuData);
+
+	///<summary>
+	/// 计算geo中每个子网格的模型空间包围盒和包围球, 只统计子网格索引实际引用到的顶点.
+	/// 顶点位置须在顶点结构偏移0处, indices为合并后的整个索引缓冲区数据.
+	///</summary>
+	static void ComputeSubmeshBounds(
+		MeshGeometry& geo,
+		const void* vertices,
+		UINT vertexStride,
+		const UINT* indices);
 };
 
 /// 几何体辅助结构, 存储数据方便渲染项使用.
@@ -111,6 +135,13 @@ struct SubmeshGeometry
 	UINT BaseVertexLocation;			// 顶点缓冲区偏移量.
 	UINT StartIndexLocation;			// 索引缓冲区偏移量.
 	UINT IndexCount;					// 索引的数量.
+
+	// 模型空间的包围体, 由d3dUtil::ComputeSubmeshBounds在创建几何体时计算.
+	DirectX::BoundingBox Bounds;
+	DirectX::BoundingSphere Sphere;
+
+	// 模型空间的三角形BVH, 由TriangleBvh::BuildSubmeshBvhs构建, 未构建时为空.
+	std::shared_ptr<TriangleBvh> Bvh;
 };
 
 /// 一类几何体(顶点缓冲区、索引缓冲区合并了的物体)都放在这里, 通过无序图在渲染项中确定数据.
@@ -161,6 +192,9 @@ struct Material
 	int DiffuseSrvHeapIndex = -1;
 	int NormalSrvHeapIndex = -1;
 
+	// 由TextureCache取得的共享纹理, 多个材质可以引用同一纹理.
+	TextureHandle DiffuseTexture;
+
 	DirectX::XMFLOAT4 DiffuseAlbedo = { 1.0f, 1.0f, 1.0f, 1.0f };
 	DirectX::XMFLOAT3 FresnelR0 = { 0.01f, 0.01f, 0.01f };
 	float Roughness = 0.25f;